@@ -0,0 +1,28 @@
+#ifndef PYAWAITABLE_BENCH_H
+#define PYAWAITABLE_BENCH_H
+
+#include <Python.h>
+#include <pyawaitable.h>
+
+#define BENCHES(name) PyMethodDef _pyawaitable_bench_ ## name []
+
+/*
+ * Results go here, and loops that are otherwise invariant read their input
+ * from here, so that the compiler can't throw away or hoist the work.
+ */
+extern void *volatile bench_sink;
+extern PyObject *volatile bench_source;
+
+/* Gather the awaitables in a sequence into a new awaitable */
+PyObject *Bench_GatherSequence(PyObject *seq);
+
+extern BENCHES(values);
+extern BENCHES(startup);
+extern BENCHES(subinterpreters);
+extern BENCHES(gather);
+extern BENCHES(timer);
+extern BENCHES(pool);
+extern BENCHES(io);
+extern BENCHES(fileio);
+
+#endif
@@ -0,0 +1,47 @@
+"""
+Benchmarks for PyAwaitable's C API, compared against plain asyncio where
+there's something to compare against.
+
+Build the extension first (``pip install ./benchmarks``, or
+``python setup.py build_ext --inplace`` in this directory), and then run
+``python bench.py [NAME ...]``. With no names, every benchmark is run.
+
+Each feature's benchmarks live in a ``bench_<feature>.py`` file, next to
+the ``bench_<feature>.c`` file with its half of the extension.
+"""
+
+from __future__ import annotations
+
+import argparse
+import importlib
+import sys
+from pathlib import Path
+
+from harness import BENCHMARKS
+
+
+def load_benchmarks() -> None:
+    for path in sorted(Path(__file__).parent.glob("bench_*.py")):
+        importlib.import_module(path.stem)
+
+
+def main() -> None:
+    load_benchmarks()
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("names", nargs="*", metavar="NAME")
+    args = parser.parse_args()
+    unknown = set(args.names) - BENCHMARKS.keys()
+    if unknown:
+        parser.error(
+            f"unknown benchmarks: {', '.join(sorted(unknown))} "
+            f"(choose from {', '.join(BENCHMARKS)})"
+        )
+    print(f"Python {sys.version.split()[0]} on {sys.platform}")
+    for name in args.names or BENCHMARKS:
+        func = BENCHMARKS[name]
+        print(f"{name}: {func.__doc__}")
+        func()
+
+
+if __name__ == "__main__":
+    main()
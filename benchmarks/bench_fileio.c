@@ -0,0 +1,162 @@
+#include <Python.h>
+#include <stdint.h>
+#include <pyawaitable.h>
+#include "bench.h"
+
+#ifndef _WIN32
+#  include <unistd.h>
+#endif
+#ifdef _PyAwaitable_HAVE_IO_URING
+#  include <sys/syscall.h>
+#endif
+
+#define PREAD_SIZE 4096
+
+#ifndef _WIN32
+/*
+ * Only the loop thread copies reads into this, so it can be shared by all
+ * of the readers.
+ */
+static char pread_buffer[PREAD_SIZE];
+
+static int
+pread_next(PyObject *awaitable);
+
+static int
+pread_done(PyObject *awaitable, Py_ssize_t size)
+{
+    if (size != PREAD_SIZE) {
+        PyErr_Format(PyExc_RuntimeError, "short read of %zd bytes", size);
+        return -1;
+    }
+
+    return pread_next(awaitable);
+}
+
+/* Read a random block, until there's nothing left to read */
+static int
+pread_next(PyObject *awaitable)
+{
+    void *fd;
+    void *blocks;
+    void *left;
+    void *rng;
+    if (
+        PyAwaitable_UnpackArbValues(awaitable, &fd, &blocks, &left, &rng) < 0
+    ) {
+        return -1;
+    }
+
+    if (left == NULL) {
+        return 0;
+    }
+
+    uint64_t state = (uint64_t)(uintptr_t)rng;
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    long long block = (long long)((state >> 33) % (uintptr_t)blocks);
+    if (
+        PyAwaitable_SetArbValue(
+            awaitable,
+            2,
+            (void *)((intptr_t)left - 1)
+        ) < 0
+        || PyAwaitable_SetArbValue(awaitable, 3, (void *)(uintptr_t)state) < 0
+    ) {
+        return -1;
+    }
+
+    return PyAwaitable_AddPread(
+        awaitable,
+        (int)(intptr_t)fd,
+        pread_buffer,
+        PREAD_SIZE,
+        block * PREAD_SIZE,
+        pread_done
+    );
+}
+
+/* Do count random 4 KiB reads of fd, with concurrency of them at a time */
+static PyObject *
+pread_random(PyObject *self, PyObject *args)
+{
+    int fd;
+    long long file_size;
+    Py_ssize_t count;
+    Py_ssize_t concurrency;
+    if (
+        !PyArg_ParseTuple(
+            args,
+            "iLnn",
+            &fd,
+            &file_size,
+            &count,
+            &concurrency
+        )
+    ) {
+        return NULL;
+    }
+
+    if (file_size < PREAD_SIZE || concurrency < 1) {
+        PyErr_SetString(PyExc_ValueError, "nothing to read");
+        return NULL;
+    }
+
+    PyObject *children = PyList_New(concurrency);
+    if (children == NULL) {
+        return NULL;
+    }
+
+    for (Py_ssize_t i = 0; i < concurrency; ++i) {
+        PyObject *child = PyAwaitable_New();
+        if (child == NULL) {
+            Py_DECREF(children);
+            return NULL;
+        }
+
+        PyList_SET_ITEM(children, i, child);
+        // Spread the remainder over the first few readers
+        Py_ssize_t share = count / concurrency + (i < count % concurrency);
+        if (
+            PyAwaitable_SaveArbValues(
+                child,
+                4,
+                (void *)(intptr_t)fd,
+                (void *)(uintptr_t)(file_size / PREAD_SIZE),
+                (void *)(intptr_t)share,
+                (void *)(uintptr_t)(i + 1)
+            ) < 0
+            || PyAwaitable_DeferAwait(child, pread_next) < 0
+        ) {
+            Py_DECREF(children);
+            return NULL;
+        }
+    }
+
+    PyObject *awaitable = Bench_GatherSequence(children);
+    Py_DECREF(children);
+    return awaitable;
+}
+#endif
+
+/* Whether the kernel lets us set up an io_uring instance */
+static PyObject *
+has_io_uring(PyObject *self, PyObject *nothing)
+{
+#ifdef _PyAwaitable_HAVE_IO_URING
+    struct io_uring_params params = {0};
+    long fd = syscall(__NR_io_uring_setup, 1, &params);
+    if (fd >= 0) {
+        close((int)fd);
+        Py_RETURN_TRUE;
+    }
+#endif
+    Py_RETURN_FALSE;
+}
+
+BENCHES(fileio) = {
+#ifndef _WIN32
+    {"pread_random", pread_random, METH_VARARGS, NULL},
+#endif
+    {"has_io_uring", has_io_uring, METH_NOARGS, NULL},
+    {NULL}
+};
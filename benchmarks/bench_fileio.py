@@ -0,0 +1,74 @@
+import asyncio
+import os
+import sys
+import tempfile
+
+from harness import bench, benchmark, best_of, report, run
+
+try:
+    import _pyawaitable_bench_nouring as bench_nouring
+except ImportError:
+    bench_nouring = None
+
+
+async def python_pread(fd: int, size: int, count: int, concurrency: int):
+    loop = asyncio.get_running_loop()
+    blocks = size // 4096
+
+    async def reader(seed: int, share: int) -> None:
+        state = seed
+        for _ in range(share):
+            state = (state * 6364136223846793005 + 1442695040888963407) % 2**64
+            offset = ((state >> 33) % blocks) * 4096
+            data = await loop.run_in_executor(None, os.pread, fd, 4096, offset)
+            assert len(data) == 4096
+
+    shares = [
+        count // concurrency + (i < count % concurrency)
+        for i in range(concurrency)
+    ]
+    await asyncio.gather(
+        *(reader(i + 1, share) for i, share in enumerate(shares))
+    )
+
+
+@benchmark
+def pread() -> None:
+    """Random 4 KiB reads of a cached 64 MiB file, 32 at a time."""
+    if sys.platform == "win32":
+        print("  skipped: not supported on Windows")
+        return
+
+    size = 64 * 1024 * 1024
+    count = 50_000
+    concurrency = 32
+    with tempfile.TemporaryFile() as file:
+        file.write(os.urandom(size))
+        file.flush()
+        fd = file.fileno()
+        # Pull the whole thing into the page cache
+        os.pread(fd, size, 0)
+
+        python = best_of(
+            run(lambda: python_pread(fd, size, count, concurrency)),
+            repeat=3,
+        )
+        report("loop.run_in_executor(os.pread)", python, count)
+        if bench_nouring is not None:
+            pool = best_of(
+                run(
+                    lambda: bench_nouring.pread_random(
+                        fd, size, count, concurrency
+                    )
+                ),
+                repeat=3,
+            )
+            report("PyAwaitable_AddPread(), pool only", pool, count, python)
+        name = "PyAwaitable_AddPread(), io_uring"
+        if not bench.has_io_uring():
+            name += " (unavailable, so pool)"
+        native = best_of(
+            run(lambda: bench.pread_random(fd, size, count, concurrency)),
+            repeat=3,
+        )
+        report(name, native, count, python)
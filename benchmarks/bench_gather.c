@@ -0,0 +1,44 @@
+#include <Python.h>
+#include <pyawaitable.h>
+#include "bench.h"
+
+/* Gather the awaitables in a sequence */
+PyObject *
+Bench_GatherSequence(PyObject *seq)
+{
+    PyObject *fast = PySequence_Fast(seq, "expected a sequence");
+    if (fast == NULL) {
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (
+        awaitable == NULL
+        || PyAwaitable_AddGather(
+            awaitable,
+            PySequence_Fast_ITEMS(fast),
+            PySequence_Fast_GET_SIZE(fast),
+            NULL,
+            NULL,
+            0
+        ) < 0
+    ) {
+        Py_XDECREF(awaitable);
+        Py_DECREF(fast);
+        return NULL;
+    }
+
+    Py_DECREF(fast);
+    return awaitable;
+}
+
+static PyObject *
+gather(PyObject *self, PyObject *seq)
+{
+    return Bench_GatherSequence(seq);
+}
+
+BENCHES(gather) = {
+    {"gather", gather, METH_O, NULL},
+    {NULL}
+};
@@ -0,0 +1,32 @@
+from __future__ import annotations
+
+import asyncio
+from collections.abc import Callable
+from typing import Any
+
+from harness import bench, benchmark, best_of, report, run
+
+
+async def many(make: Callable[[], Any], times: int) -> None:
+    for _ in range(times):
+        await make()
+
+
+@benchmark
+def gather() -> None:
+    """PyAwaitable_AddGather() vs. asyncio.gather() over empty awaitables."""
+    for size in (2, 10, 100, 1_000, 10_000):
+        times = max(1, 20_000 // size)
+
+        def children() -> list[Any]:
+            return [bench.new_awaitable() for _ in range(size)]
+
+        python = best_of(
+            run(lambda: many(lambda: asyncio.gather(*children()), times))
+        )
+        native = best_of(
+            run(lambda: many(lambda: bench.gather(children()), times))
+        )
+        print(f"  N = {size}")
+        report("asyncio.gather()", python, times * size)
+        report("PyAwaitable_AddGather()", native, times * size, python)
@@ -0,0 +1,97 @@
+#include <Python.h>
+#include <stdint.h>
+#include <pyawaitable.h>
+#include "bench.h"
+
+#ifndef _WIN32
+#  include <unistd.h>
+
+/* Send a byte, and wait for it to come back out of the other end */
+static int
+ping(PyObject *awaitable);
+
+static int
+pong(PyObject *awaitable, int fd)
+{
+    char byte;
+    if (read(fd, &byte, 1) != 1) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+
+    return ping(awaitable);
+}
+
+static int
+ping(PyObject *awaitable)
+{
+    void *read_fd;
+    void *write_fd;
+    void *left;
+    if (
+        PyAwaitable_UnpackArbValues(awaitable, &read_fd, &write_fd, &left) < 0
+    ) {
+        return -1;
+    }
+
+    if (left == NULL) {
+        return 0;
+    }
+
+    if (
+        PyAwaitable_SetArbValue(
+            awaitable,
+            2,
+            (void *)((intptr_t)left - 1)
+        ) < 0
+    ) {
+        return -1;
+    }
+
+    if (write((int)(intptr_t)write_fd, "x", 1) != 1) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+
+    return PyAwaitable_AddReadable(awaitable, (int)(intptr_t)read_fd, pong);
+}
+
+static PyObject *
+readable_pingpong(PyObject *self, PyObject *args)
+{
+    int read_fd;
+    int write_fd;
+    Py_ssize_t n;
+    if (!PyArg_ParseTuple(args, "iin", &read_fd, &write_fd, &n)) {
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    if (
+        PyAwaitable_SaveArbValues(
+            awaitable,
+            3,
+            (void *)(intptr_t)read_fd,
+            (void *)(intptr_t)write_fd,
+            (void *)(intptr_t)n
+        ) < 0
+        || PyAwaitable_DeferAwait(awaitable, ping) < 0
+    ) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    return awaitable;
+}
+#endif
+
+BENCHES(io) = {
+#ifndef _WIN32
+    {"readable_pingpong", readable_pingpong, METH_VARARGS, NULL},
+#endif
+    {NULL}
+};
@@ -0,0 +1,38 @@
+import asyncio
+import socket
+import sys
+
+from harness import bench, benchmark, best_of, report, run
+
+
+async def python_pingpong(read_sock: socket.socket, write_sock: socket.socket, n: int):
+    loop = asyncio.get_running_loop()
+    for _ in range(n):
+        write_sock.send(b"x")
+        future = loop.create_future()
+        loop.add_reader(read_sock, future.set_result, None)
+        try:
+            await future
+        finally:
+            loop.remove_reader(read_sock)
+        read_sock.recv(1)
+
+
+@benchmark
+def readable() -> None:
+    """Round trips through a socketpair, waiting for each to be readable."""
+    if sys.platform == "win32":
+        print("  skipped: not supported on Windows")
+        return
+
+    n = 100_000
+    left, right = socket.socketpair()
+    with left, right:
+        left.setblocking(False)
+        right.setblocking(False)
+        python = best_of(run(lambda: python_pingpong(left, right, n)))
+        report("loop.add_reader()", python, n)
+        native = best_of(
+            run(lambda: bench.readable_pingpong(left.fileno(), right.fileno(), n))
+        )
+        report("PyAwaitable_AddReadable()", native, n, python)
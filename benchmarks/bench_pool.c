@@ -0,0 +1,94 @@
+#include <Python.h>
+#include <stdint.h>
+#include <pyawaitable.h>
+#include "bench.h"
+
+/* CPU-bound work that takes about as long as its argument says */
+static void *
+spin(void *arg)
+{
+    uint64_t x = 88172645463325252ULL;
+    for (uintptr_t i = 0; i < (uintptr_t)arg; ++i) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+    }
+
+    return (void *)(uintptr_t)x;
+}
+
+static int
+spin_step(PyObject *awaitable, void *arg)
+{
+    bench_sink = spin(arg);
+    return 0;
+}
+
+static PyObject *
+parallel_map(PyObject *self, PyObject *args)
+{
+    Py_ssize_t n;
+    Py_ssize_t work;
+    if (!PyArg_ParseTuple(args, "nn", &n, &work)) {
+        return NULL;
+    }
+
+    void **items = PyMem_Malloc(sizeof(void *) * (n > 0 ? n : 1));
+    if (items == NULL) {
+        return PyErr_NoMemory();
+    }
+
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        items[i] = (void *)(uintptr_t)work;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (
+        awaitable == NULL
+        || PyAwaitable_AddParallelMap(awaitable, spin, items, n, 1, NULL) < 0
+    ) {
+        Py_XDECREF(awaitable);
+        PyMem_Free(items);
+        return NULL;
+    }
+
+    PyMem_Free(items);
+    return awaitable;
+}
+
+/* The same work as parallel_map(), but in steps on the event loop */
+static PyObject *
+sequential(PyObject *self, PyObject *args)
+{
+    Py_ssize_t n;
+    Py_ssize_t work;
+    if (!PyArg_ParseTuple(args, "nn", &n, &work)) {
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        if (
+            PyAwaitable_DeferAwaitEx(
+                awaitable,
+                spin_step,
+                (void *)(uintptr_t)work
+            ) < 0
+        ) {
+            Py_DECREF(awaitable);
+            return NULL;
+        }
+    }
+
+    return awaitable;
+}
+
+BENCHES(pool) = {
+    {"parallel_map", parallel_map, METH_VARARGS, NULL},
+    {"sequential", sequential, METH_VARARGS, NULL},
+    {NULL}
+};
@@ -0,0 +1,15 @@
+import os
+
+from harness import bench, benchmark, best_of, report, run
+
+
+@benchmark
+def parallel_map() -> None:
+    """CPU-bound items on the thread pool vs. one DeferAwait step each."""
+    n = 256
+    work = 500_000
+    print(f"  {os.cpu_count()} CPUs, {n} items")
+    sequential = best_of(run(lambda: bench.sequential(n, work)))
+    report("DeferAwait steps", sequential, n)
+    parallel = best_of(run(lambda: bench.parallel_map(n, work)))
+    report("PyAwaitable_AddParallelMap()", parallel, n, sequential)
@@ -0,0 +1,25 @@
+#include <Python.h>
+#include <pyawaitable.h>
+#include "bench.h"
+
+static PyObject *
+init_many(PyObject *self, PyObject *args)
+{
+    Py_ssize_t n;
+    if (!PyArg_ParseTuple(args, "n", &n)) {
+        return NULL;
+    }
+
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        if (PyAwaitable_Init() < 0) {
+            return NULL;
+        }
+    }
+
+    Py_RETURN_NONE;
+}
+
+BENCHES(startup) = {
+    {"init", init_many, METH_VARARGS, NULL},
+    {NULL}
+};
@@ -0,0 +1,56 @@
+import os
+import subprocess
+import sys
+
+from harness import REPEAT, bench, benchmark, best_of, report
+
+# Keep this in sync with setup.py
+STARTUP_MODULES = 16
+STARTUP_SCRIPT = """
+import sys
+import time
+sys.path.insert(0, {path!r})
+for name in sys.argv[1:]:
+    start = time.perf_counter()
+    __import__(name)
+    print(time.perf_counter() - start)
+"""
+
+
+def import_times(prefix: str) -> list[float]:
+    """Import each module in a new process, and return the fastest times."""
+    names = [f"{prefix}{i}" for i in range(STARTUP_MODULES)]
+    path = os.path.dirname(os.path.abspath(bench.__file__))
+    best = [float("inf")] * len(names)
+    for _ in range(REPEAT):
+        output = subprocess.run(
+            [sys.executable, "-c", STARTUP_SCRIPT.format(path=path), *names],
+            check=True,
+            capture_output=True,
+            text=True,
+        ).stdout
+        best = [min(a, float(b)) for a, b in zip(best, output.split())]
+    return best
+
+
+@benchmark
+def startup() -> None:
+    """Importing extensions that each vendor their own PyAwaitable."""
+    plain = import_times("_pyawaitable_startup_plain_")
+    vendored = import_times("_pyawaitable_startup_")
+    print(f"  {STARTUP_MODULES} extensions")
+    report("First import, without PyAwaitable", plain[0], 1)
+    report("First import, with PyAwaitable", vendored[0], 1, plain[0])
+    rest = len(plain) - 1
+    report("Later imports, without PyAwaitable", sum(plain[1:]), rest)
+    report(
+        "Later imports, with PyAwaitable",
+        sum(vendored[1:]),
+        rest,
+        sum(plain[1:]),
+    )
+
+    # Once the state has been used on this thread
+    bench.new_awaitable()
+    n = 1_000_000
+    report("PyAwaitable_Init() again", best_of(lambda: bench.init(n)), n)
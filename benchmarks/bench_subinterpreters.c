@@ -0,0 +1,65 @@
+#include <Python.h>
+#include <stdint.h>
+#include <pyawaitable.h>
+#include "bench.h"
+
+#define STEP_BUDGET 1000
+
+/* Await an empty awaitable, and then do it again until the count runs out */
+static int
+step_again(PyObject *awaitable)
+{
+    intptr_t left = (intptr_t)PyAwaitable_GetArbValue(awaitable, 0);
+    if (left == 0) {
+        return PyErr_Occurred() ? -1 : 0;
+    }
+
+    if (PyAwaitable_SetArbValue(awaitable, 0, (void *)(left - 1)) < 0) {
+        return -1;
+    }
+
+    PyObject *inner = PyAwaitable_New();
+    if (inner == NULL) {
+        return -1;
+    }
+
+    int res = PyAwaitable_AddAwait(awaitable, inner, NULL, NULL);
+    Py_DECREF(inner);
+    if (res < 0) {
+        return -1;
+    }
+
+    return PyAwaitable_DeferAwait(awaitable, step_again);
+}
+
+static PyObject *
+steps(PyObject *self, PyObject *args)
+{
+    Py_ssize_t n;
+    if (!PyArg_ParseTuple(args, "n", &n)) {
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    // Steps that finish right away recurse unless the compiler supports
+    // musttail, so yield to the loop often enough to keep the stack shallow.
+    if (
+        PyAwaitable_SaveArbValues(awaitable, 1, (void *)(intptr_t)n) < 0
+        || PyAwaitable_SetStepBudget(awaitable, STEP_BUDGET) < 0
+        || PyAwaitable_DeferAwait(awaitable, step_again) < 0
+    ) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    return awaitable;
+}
+
+BENCHES(subinterpreters) = {
+    {"steps", steps, METH_VARARGS, NULL},
+    {NULL}
+};
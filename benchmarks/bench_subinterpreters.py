@@ -0,0 +1,56 @@
+from __future__ import annotations
+
+import os
+import threading
+
+from harness import REPEAT, bench, benchmark, report, run_on_threads
+
+try:
+    # asyncio doesn't run reliably in isolated subinterpreters before 3.13
+    import _interpreters as interpreters
+except ImportError:
+    interpreters = None
+
+
+IMPORT_SCRIPT = """
+import sys
+sys.path.insert(0, {path!r})
+import _pyawaitable_bench
+"""
+STEPS_SCRIPT = """
+import asyncio
+import _pyawaitable_bench as bench
+asyncio.run(bench.steps({n}))
+"""
+
+
+@benchmark
+def subinterpreters() -> None:
+    """Steps on an event loop per isolated subinterpreter, one per thread."""
+    if interpreters is None:
+        print("  skipped: needs Python 3.13 or newer")
+        return
+
+    n = 200_000
+    script = STEPS_SCRIPT.format(n=n)
+    for count in (1, 2, 4, 8):
+        ids = [interpreters.create() for _ in range(count)]
+        try:
+            path = os.path.dirname(os.path.abspath(bench.__file__))
+            for interp in ids:
+                interpreters.run_string(interp, IMPORT_SCRIPT.format(path=path))
+            seconds = float("inf")
+            for _ in range(REPEAT):
+                it = iter(ids)
+                lock = threading.Lock()
+
+                def target() -> None:
+                    with lock:
+                        interp = next(it)
+                    interpreters.run_string(interp, script)
+
+                seconds = min(seconds, run_on_threads(count, target))
+        finally:
+            for interp in ids:
+                interpreters.destroy(interp)
+        report(f"{count} interpreter(s), total", seconds, n * count)
@@ -0,0 +1,18 @@
+import asyncio
+import sys
+
+from harness import REPEAT, bench, benchmark, report, run_on_threads
+
+
+@benchmark
+def threads() -> None:
+    """Steps on an event loop per thread, all in the main interpreter."""
+    gil = getattr(sys, "_is_gil_enabled", lambda: True)()
+    print(f"  GIL {'enabled' if gil else 'disabled'}")
+    n = 200_000
+    for count in (1, 2, 4, 8):
+        seconds = min(
+            run_on_threads(count, lambda: asyncio.run(bench.steps(n)))
+            for _ in range(REPEAT)
+        )
+        report(f"{count} thread(s), total", seconds, n * count)
@@ -0,0 +1,95 @@
+#include <Python.h>
+#include <pyawaitable.h>
+#include "bench.h"
+
+/* Sleep for the same time in each of n awaitables, all at once */
+static PyObject *
+sleep_many(PyObject *self, PyObject *args)
+{
+    Py_ssize_t n;
+    double seconds;
+    if (!PyArg_ParseTuple(args, "nd", &n, &seconds)) {
+        return NULL;
+    }
+
+    PyObject *children = PyList_New(n);
+    if (children == NULL) {
+        return NULL;
+    }
+
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        PyObject *child = PyAwaitable_New();
+        if (child == NULL) {
+            Py_DECREF(children);
+            return NULL;
+        }
+
+        PyList_SET_ITEM(children, i, child);
+        if (PyAwaitable_AddSleep(child, seconds) < 0) {
+            Py_DECREF(children);
+            return NULL;
+        }
+    }
+
+    PyObject *awaitable = Bench_GatherSequence(children);
+    Py_DECREF(children);
+    return awaitable;
+}
+
+/* Await each of the awaitables under a deadline, all at once */
+static PyObject *
+deadlines(PyObject *self, PyObject *args)
+{
+    PyObject *seq;
+    double seconds;
+    if (!PyArg_ParseTuple(args, "Od", &seq, &seconds)) {
+        return NULL;
+    }
+
+    PyObject *fast = PySequence_Fast(seq, "expected a sequence");
+    if (fast == NULL) {
+        return NULL;
+    }
+
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(fast);
+    PyObject *children = PyList_New(n);
+    if (children == NULL) {
+        Py_DECREF(fast);
+        return NULL;
+    }
+
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        PyObject *child = PyAwaitable_New();
+        if (child == NULL) {
+            Py_DECREF(children);
+            Py_DECREF(fast);
+            return NULL;
+        }
+
+        PyList_SET_ITEM(children, i, child);
+        if (
+            PyAwaitable_AddAwait(
+                child,
+                PySequence_Fast_GET_ITEM(fast, i),
+                NULL,
+                NULL
+            ) < 0
+            || PyAwaitable_SetStepDeadline(child, seconds) < 0
+        ) {
+            Py_DECREF(children);
+            Py_DECREF(fast);
+            return NULL;
+        }
+    }
+
+    Py_DECREF(fast);
+    PyObject *awaitable = Bench_GatherSequence(children);
+    Py_DECREF(children);
+    return awaitable;
+}
+
+BENCHES(timer) = {
+    {"sleep", sleep_many, METH_VARARGS, NULL},
+    {"deadlines", deadlines, METH_VARARGS, NULL},
+    {NULL}
+};
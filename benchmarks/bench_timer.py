@@ -0,0 +1,32 @@
+import asyncio
+
+from harness import bench, benchmark, best_of, report, run
+
+
+@benchmark
+def sleep() -> None:
+    """100,000 concurrent sleeps and deadlines vs. asyncio."""
+    n = 100_000
+    delay = 0.01
+
+    async def python_sleep() -> None:
+        await asyncio.gather(*(asyncio.sleep(delay) for _ in range(n)))
+
+    python = best_of(run(python_sleep), repeat=3)
+    report(f"asyncio.sleep({delay}) x {n}", python, n)
+    native = best_of(run(lambda: bench.sleep(n, delay)), repeat=3)
+    report(f"PyAwaitable_AddSleep({delay}) x {n}", native, n, python)
+
+    # The deadlines are all armed at once, and then all cancelled
+    async def python_deadlines() -> None:
+        await asyncio.gather(
+            *(asyncio.wait_for(asyncio.sleep(0), 10) for _ in range(n))
+        )
+
+    async def native_deadlines() -> None:
+        await bench.deadlines([asyncio.sleep(0) for _ in range(n)], 10)
+
+    python = best_of(run(python_deadlines), repeat=3)
+    report(f"asyncio.wait_for() x {n}", python, n)
+    native = best_of(run(native_deadlines), repeat=3)
+    report(f"PyAwaitable_SetStepDeadline() x {n}", native, n, python)
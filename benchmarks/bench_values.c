@@ -0,0 +1,174 @@
+#include <Python.h>
+#include <pyawaitable.h>
+#include "bench.h"
+
+/* Objects to store as values; their identity doesn't matter */
+#define NUM_VALUES 4
+static void
+value_objects(PyObject **values)
+{
+    values[0] = Py_None;
+    values[1] = Py_True;
+    values[2] = Py_False;
+    values[3] = Py_Ellipsis;
+}
+
+/* Each of these saves NUM_VALUES values into a new awaitable n times */
+
+static PyObject *
+save_varargs(PyObject *self, PyObject *args)
+{
+    Py_ssize_t n;
+    if (!PyArg_ParseTuple(args, "n", &n)) {
+        return NULL;
+    }
+
+    PyObject *values[NUM_VALUES];
+    value_objects(values);
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        PyObject *awaitable = PyAwaitable_New();
+        if (awaitable == NULL) {
+            return NULL;
+        }
+
+        int res = PyAwaitable_SaveValues(
+            awaitable,
+            NUM_VALUES,
+            values[0],
+            values[1],
+            values[2],
+            values[3]
+        );
+        Py_DECREF(awaitable);
+        if (res < 0) {
+            return NULL;
+        }
+    }
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+save_array(PyObject *self, PyObject *args)
+{
+    Py_ssize_t n;
+    if (!PyArg_ParseTuple(args, "n", &n)) {
+        return NULL;
+    }
+
+    PyObject *values[NUM_VALUES];
+    value_objects(values);
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        PyObject *awaitable = PyAwaitable_New();
+        if (awaitable == NULL) {
+            return NULL;
+        }
+
+        int res = PyAwaitable_SaveValuesArray(awaitable, values, NUM_VALUES);
+        Py_DECREF(awaitable);
+        if (res < 0) {
+            return NULL;
+        }
+    }
+
+    Py_RETURN_NONE;
+}
+
+/* Each of these unpacks NUM_VALUES values from one awaitable n times */
+
+static PyObject *
+new_with_values(void)
+{
+    PyObject *values[NUM_VALUES];
+    value_objects(values);
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    if (PyAwaitable_SaveValuesArray(awaitable, values, NUM_VALUES) < 0) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    return awaitable;
+}
+
+static PyObject *
+unpack_varargs(PyObject *self, PyObject *args)
+{
+    Py_ssize_t n;
+    if (!PyArg_ParseTuple(args, "n", &n)) {
+        return NULL;
+    }
+
+    PyObject *awaitable = new_with_values();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    bench_source = awaitable;
+    PyObject *values[NUM_VALUES];
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        if (
+            PyAwaitable_UnpackValues(
+                bench_source,
+                &values[0],
+                &values[1],
+                &values[2],
+                &values[3]
+            ) < 0
+        ) {
+            Py_DECREF(awaitable);
+            return NULL;
+        }
+
+        bench_sink = values[i % NUM_VALUES];
+    }
+
+    Py_DECREF(awaitable);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+unpack_array(PyObject *self, PyObject *args)
+{
+    Py_ssize_t n;
+    if (!PyArg_ParseTuple(args, "n", &n)) {
+        return NULL;
+    }
+
+    PyObject *awaitable = new_with_values();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    bench_source = awaitable;
+    PyObject *values[NUM_VALUES];
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        if (
+            PyAwaitable_UnpackValuesRange(
+                bench_source,
+                0,
+                NUM_VALUES,
+                values
+            ) < 0
+        ) {
+            Py_DECREF(awaitable);
+            return NULL;
+        }
+
+        bench_sink = values[i % NUM_VALUES];
+    }
+
+    Py_DECREF(awaitable);
+    Py_RETURN_NONE;
+}
+
+BENCHES(values) = {
+    {"save_varargs", save_varargs, METH_VARARGS, NULL},
+    {"save_array", save_array, METH_VARARGS, NULL},
+    {"unpack_varargs", unpack_varargs, METH_VARARGS, NULL},
+    {"unpack_array", unpack_array, METH_VARARGS, NULL},
+    {NULL}
+};
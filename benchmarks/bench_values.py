@@ -0,0 +1,17 @@
+from harness import bench, benchmark, best_of, report
+
+
+@benchmark
+def values() -> None:
+    """Saving and unpacking four object values, varargs vs. arrays."""
+    n = 1_000_000
+    new = best_of(lambda: bench.new_awaitables(n))
+    report("PyAwaitable_New() alone", new, n)
+    save_varargs = best_of(lambda: bench.save_varargs(n)) - new
+    report("New + SaveValues (minus New)", save_varargs, n)
+    save_array = best_of(lambda: bench.save_array(n)) - new
+    report("New + SaveValuesArray (minus New)", save_array, n, save_varargs)
+    unpack_varargs = best_of(lambda: bench.unpack_varargs(n))
+    report("UnpackValues", unpack_varargs, n)
+    unpack_array = best_of(lambda: bench.unpack_array(n))
+    report("UnpackValuesRange", unpack_array, n, unpack_varargs)
@@ -0,0 +1,63 @@
+"""Helpers that are shared by every benchmark."""
+
+from __future__ import annotations
+
+import asyncio
+import threading
+import time
+from collections.abc import Callable
+from typing import Any
+
+import _pyawaitable_bench as bench
+
+REPEAT = 5
+BENCHMARKS: dict[str, Callable[[], None]] = {}
+
+__all__ = (
+    "REPEAT",
+    "BENCHMARKS",
+    "bench",
+    "benchmark",
+    "best_of",
+    "run",
+    "run_on_threads",
+    "report",
+)
+
+
+def benchmark(func: Callable[[], None]) -> Callable[[], None]:
+    BENCHMARKS[func.__name__] = func
+    return func
+
+
+def best_of(func: Callable[[], Any], repeat: int = REPEAT) -> float:
+    """Run func repeat times, and return the fastest time in seconds."""
+    best = float("inf")
+    for _ in range(repeat):
+        start = time.perf_counter()
+        func()
+        best = min(best, time.perf_counter() - start)
+    return best
+
+
+def run(make: Callable[[], Any]) -> Callable[[], Any]:
+    """Return a function that runs make() to completion on a new loop."""
+    return lambda: asyncio.run(make())
+
+
+def run_on_threads(count: int, target: Callable[[], None]) -> float:
+    """Run target on count threads at once, and return the time in seconds."""
+    threads = [threading.Thread(target=target) for _ in range(count)]
+    start = time.perf_counter()
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    return time.perf_counter() - start
+
+
+def report(name: str, seconds: float, ops: int, baseline: float | None = None):
+    line = f"  {name:<36} {seconds * 1e9 / ops:>12.1f} ns/op"
+    if baseline is not None:
+        line += f"  ({baseline / seconds:.2f}x)"
+    print(line)
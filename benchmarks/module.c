@@ -0,0 +1,93 @@
+/*
+ * This file holds the only copy of PyAwaitable. BENCH_MODULE_INIT is the name
+ * of the init function, so that the same benchmarks can be built again with
+ * PYAWAITABLE_NO_IO_URING.
+ */
+#define PYAWAITABLE_IMPLEMENTATION
+#include <Python.h>
+#include <pyawaitable.h>
+#include "bench.h"
+
+#ifndef BENCH_MODULE_INIT
+#  define BENCH_MODULE_INIT PyInit__pyawaitable_bench
+#endif
+
+void *volatile bench_sink;
+PyObject *volatile bench_source;
+
+static PyObject *
+new_awaitable(PyObject *self, PyObject *nothing)
+{
+    return PyAwaitable_New();
+}
+
+static PyObject *
+new_awaitables(PyObject *self, PyObject *args)
+{
+    Py_ssize_t n;
+    if (!PyArg_ParseTuple(args, "n", &n)) {
+        return NULL;
+    }
+
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        PyObject *awaitable = PyAwaitable_New();
+        if (awaitable == NULL) {
+            return NULL;
+        }
+        Py_DECREF(awaitable);
+    }
+
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef bench_methods[] = {
+    {"new_awaitable", new_awaitable, METH_NOARGS, NULL},
+    {"new_awaitables", new_awaitables, METH_VARARGS, NULL},
+    {NULL}
+};
+
+static int
+bench_exec(PyObject *mod)
+{
+#define ADD_BENCHES(name)                                                      \
+        do {                                                                   \
+            if (PyModule_AddFunctions(mod, _pyawaitable_bench_ ## name) < 0) { \
+                return -1;                                                     \
+            }                                                                  \
+        } while (0)
+
+    ADD_BENCHES(values);
+    ADD_BENCHES(startup);
+    ADD_BENCHES(subinterpreters);
+    ADD_BENCHES(gather);
+    ADD_BENCHES(timer);
+    ADD_BENCHES(pool);
+    ADD_BENCHES(io);
+    ADD_BENCHES(fileio);
+#undef ADD_BENCHES
+    return PyAwaitable_Init();
+}
+
+static PyModuleDef_Slot bench_slots[] = {
+    {Py_mod_exec, bench_exec},
+#ifdef Py_MOD_PER_INTERPRETER_GIL_SUPPORTED
+    {Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED},
+#endif
+#ifdef Py_GIL_DISABLED
+    {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#endif
+    {0, NULL}
+};
+
+static PyModuleDef bench_module = {
+    .m_base = PyModuleDef_HEAD_INIT,
+    .m_size = 0,
+    .m_methods = bench_methods,
+    .m_slots = bench_slots,
+};
+
+PyMODINIT_FUNC
+BENCH_MODULE_INIT(void)
+{
+    return PyModuleDef_Init(&bench_module);
+}
@@ -0,0 +1,74 @@
+from setuptools import setup, Extension
+from glob import glob
+from pathlib import Path
+import subprocess
+import sys
+
+def find_local_pyawaitable() -> str:
+    """Regenerate the local copy of pyawaitable.h and find its directory"""
+    top_level = Path(__file__).parent.parent
+    # pyawaitable.h isn't checked in, so build it from the current sources
+    subprocess.run(
+        [sys.executable, "hatch_build.py"],
+        cwd=top_level,
+        check=True,
+    )
+    source = top_level / "src" / "pyawaitable"
+    return str(source.absolute())
+
+# module.c holds the only copy of PyAwaitable, and every feature adds its
+# own bench_*.c file
+BENCH_SOURCES = ["module.c", *sorted(glob("bench_*.c"))]
+
+def bench_extension(name: str, *macros: tuple[str, None]) -> Extension:
+    return Extension(
+        name,
+        BENCH_SOURCES,
+        include_dirs=[PYAWAITABLE_INCLUDE],
+        define_macros=[
+            ("PYAWAITABLE_SINGLE_IMPLEMENTATION", None),
+            ("BENCH_MODULE_INIT", f"PyInit_{name}"),
+            *macros,
+        ],
+        extra_compile_args=["-O2"]
+    )
+
+# Keep this in sync with bench_startup.py
+STARTUP_MODULES = 16
+
+def startup_extension(name: str, *macros: tuple[str, None]) -> Extension:
+    return Extension(
+        name,
+        ["startup.c"],
+        include_dirs=[PYAWAITABLE_INCLUDE],
+        define_macros=[("STARTUP_MODULE_INIT", f"PyInit_{name}"), *macros],
+        extra_compile_args=["-O2"]
+    )
+
+if __name__ == "__main__":
+    PYAWAITABLE_INCLUDE = find_local_pyawaitable()
+    setup(
+        # The benchmark scripts are ran from here, not installed
+        py_modules=[],
+        ext_modules=[
+            bench_extension("_pyawaitable_bench"),
+            # The same benchmarks, but file I/O only uses the thread pool
+            bench_extension(
+                "_pyawaitable_bench_nouring",
+                ("PYAWAITABLE_NO_IO_URING", None)
+            ),
+            # Each of these vendors its own copy of PyAwaitable
+            *(
+                startup_extension(f"_pyawaitable_startup_{i}")
+                for i in range(STARTUP_MODULES)
+            ),
+            # Baselines for those, without PyAwaitable
+            *(
+                startup_extension(
+                    f"_pyawaitable_startup_plain_{i}",
+                    ("STARTUP_NO_PYAWAITABLE", None)
+                )
+                for i in range(STARTUP_MODULES)
+            ),
+        ]
+    )
@@ -0,0 +1,40 @@
+/*
+ * An otherwise empty extension, which is built several times under different
+ * names, so that each copy vendors its own PyAwaitable. STARTUP_MODULE_INIT
+ * is the name of the init function. With STARTUP_NO_PYAWAITABLE, the module
+ * doesn't touch PyAwaitable at all, which gives a baseline for the import.
+ */
+#include <Python.h>
+#ifndef STARTUP_NO_PYAWAITABLE
+#include <pyawaitable.h>
+#endif
+
+static int
+startup_exec(PyObject *mod)
+{
+#ifdef STARTUP_NO_PYAWAITABLE
+    return 0;
+#else
+    return PyAwaitable_Init();
+#endif
+}
+
+static PyModuleDef_Slot startup_slots[] = {
+    {Py_mod_exec, startup_exec},
+#ifdef Py_MOD_PER_INTERPRETER_GIL_SUPPORTED
+    {Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED},
+#endif
+    {0, NULL}
+};
+
+static PyModuleDef startup_module = {
+    .m_base = PyModuleDef_HEAD_INIT,
+    .m_size = 0,
+    .m_slots = startup_slots,
+};
+
+PyMODINIT_FUNC
+STARTUP_MODULE_INIT(void)
+{
+    return PyModuleDef_Init(&startup_module);
+}
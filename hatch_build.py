@@ -30,21 +30,43 @@ HEADER_FILES: list[str] = [
     "dist.h",
     "array.h",
     "backport.h",
+    "gate.h",
+    "driver.h",
+    "timer.h",
     "coro.h",
     "awaitableobject.h",
     "genwrapper.h",
     "values.h",
     "with.h",
+    "soon.h",
+    "pool.h",
+    "future.h",
+    "io.h",
+    "fileio.h",
     "init.h",
+    "interp.h",
+    "gather.h",
+    "capi.h",
 ]
 SOURCE_FILES: list[Path] = [
     Path("./src/_pyawaitable/array.c"),
+    Path("./src/_pyawaitable/gate.c"),
     Path("./src/_pyawaitable/coro.c"),
     Path("./src/_pyawaitable/awaitable.c"),
     Path("./src/_pyawaitable/genwrapper.c"),
     Path("./src/_pyawaitable/values.c"),
     Path("./src/_pyawaitable/with.c"),
     Path("./src/_pyawaitable/init.c"),
+    Path("./src/_pyawaitable/soon.c"),
+    Path("./src/_pyawaitable/interp.c"),
+    Path("./src/_pyawaitable/gather.c"),
+    Path("./src/_pyawaitable/timer.c"),
+    Path("./src/_pyawaitable/future.c"),
+    Path("./src/_pyawaitable/pool.c"),
+    Path("./src/_pyawaitable/io.c"),
+    Path("./src/_pyawaitable/fileio.c"),
+    Path("./src/_pyawaitable/capi.c"),
+    Path("./src/_pyawaitable/driver.c"),
 ]
 
 INCLUDE_REGEX = re.compile(r"#include <(.+)>")
@@ -57,6 +79,14 @@ EXPLICIT_REGEX = re.compile(r".*_PyAwaitable_MANGLE\((.+)\).*")
 NO_EXPLICIT_REGEX = re.compile(r".*_PyAwaitable_NO_MANGLE\((.+)\).*")
 DEFINE_REGEX = re.compile(r" *# *define *(\w+)(\(.*\))?.*")
 
+# In single-implementation mode, only the translation unit that defines
+# PYAWAITABLE_IMPLEMENTATION gets the definitions; the rest only see the
+# declarations from the headers.
+IMPLEMENTATION_GUARD = """
+#if !defined(PYAWAITABLE_SINGLE_IMPLEMENTATION) \\
+    || defined(PYAWAITABLE_IMPLEMENTATION)
+"""
+
 HEADER_GUARD = """
 #ifndef PYAWAITABLE_VENDOR_H
 #define PYAWAITABLE_VENDOR_H
@@ -288,6 +318,7 @@ def process_files(fp: TextIO) -> None:
             to_write.append("\n".join(lines))
 
     log("Processing source files...")
+    to_write.append(IMPLEMENTATION_GUARD)
     with logging_context():
         for source_file in SOURCE_FILES:
             lines: list[str] = source_file.read_text(encoding="utf-8").split(
@@ -298,6 +329,9 @@ def process_files(fp: TextIO) -> None:
             mangle_names(changed_names, lines)
             find_defines(lines, source_macros)
             to_write.append("\n".join(lines))
+    to_write.append(
+        "#endif /* !PYAWAITABLE_SINGLE_IMPLEMENTATION || PYAWAITABLE_IMPLEMENTATION */"
+    )
 
     log("Writing macros...")
     with logging_context():
@@ -357,7 +391,7 @@ def deduce_release_level(part: str) -> tuple[str, str]:
     if number and not number.isdigit():
         raise RuntimeError(f"{number} is not a valid number")
 
-    if number == "":
+    if not number:
         number = "0"
 
     amount = 2 if level == BETA else 3
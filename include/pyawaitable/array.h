@@ -92,6 +92,20 @@ pyawaitable_array_init_with_size(
 _PyAwaitable_INTERNAL(int)
 pyawaitable_array_append(pyawaitable_array * array, void *item);
 
+/*
+ * Append nitems items to the array, growing the allocation at most once.
+ *
+ * Returns -1 upon failure, 0 otherwise.
+ * If this fails, none of the items are appended, and the deallocator
+ * is not ran on any of them.
+ */
+_PyAwaitable_INTERNAL(int)
+pyawaitable_array_extend(
+    pyawaitable_array * array,
+    void *const *items,
+    Py_ssize_t nitems
+);
+
 /*
  * Insert an item at the target index. The index
  * must currently be a valid index in the array.
@@ -237,6 +251,23 @@ pyawaitable_array_GET_ITEM(pyawaitable_array *array, Py_ssize_t index)
     return array->items[index];
 }
 
+/*
+ * Get a pointer to the contiguous items starting at index. The index
+ * may be equal to the length of the array, in which case the pointer
+ * must not be dereferenced.
+ *
+ * The returned pointer is invalidated by any operation that adds items
+ * to the array. This function cannot fail.
+ */
+static inline void **
+pyawaitable_array_GET_ITEMS(pyawaitable_array *array, Py_ssize_t index)
+{
+    pyawaitable_array_ASSERT_VALID(array);
+    assert(index >= 0);
+    assert(index <= array->length);
+    return array->items + index;
+}
+
 /*
  * Get the length of the array. This cannot fail.
  */
@@ -6,18 +6,64 @@
 
 #include <pyawaitable/array.h>
 #include <pyawaitable/dist.h>
+#include <pyawaitable/timer.h>
 
 typedef int (*PyAwaitable_Callback)(PyObject *, PyObject *);
 typedef int (*PyAwaitable_Error)(PyObject *, PyObject *);
 typedef int (*PyAwaitable_Defer)(PyObject *);
 
+/* Variants of the above that take a user-data pointer */
+typedef int (*PyAwaitable_CallbackEx)(PyObject *, PyObject *, void *);
+typedef int (*PyAwaitable_ErrorEx)(PyObject *, PyObject *, void *);
+typedef int (*PyAwaitable_DeferEx)(PyObject *, void *);
+
+/* Pure C function that's ran without the GIL, and its result callback */
+typedef void *(*PyAwaitable_NoGIL)(void *);
+typedef int (*PyAwaitable_NoGILResult)(PyObject *, void *, void *);
+/* Frees the result instead, if the awaitable was cancelled in the meantime */
+typedef void (*PyAwaitable_NoGILRelease)(void *, void *);
+
 typedef struct _pyawaitable_callback {
     PyObject *coro;
+    /*
+     * If with_userdata is set, these are actually PyAwaitable_CallbackEx
+     * (or PyAwaitable_DeferEx) and PyAwaitable_ErrorEx, and have to be
+     * casted back before they're called.
+     */
     PyAwaitable_Callback callback;
     PyAwaitable_Error err_callback;
+    void *userdata;
+    /*
+     * If this is non-NULL, this step calls it with userdata while the GIL
+     * is released, and callback is a PyAwaitable_NoGILResult.
+     */
+    PyAwaitable_NoGIL nogil;
+    /* Called instead of callback if the step was cancelled, or NULL */
+    PyAwaitable_NoGILRelease nogil_release;
+    /* Seconds that the step may take once it starts, or -1 for no limit */
+    double deadline;
+    pyawaitable_timer deadline_timer;
+    /* Strong reference to the task to cancel, while the deadline is armed */
+    PyObject *deadline_task;
+    /* Set once the deadline has cancelled the task */
+    bool deadline_expired;
+    bool with_userdata;
     bool done;
+    /*
+     * Atomic; set once PyAwaitable_Cancel() has retired the callback, so a
+     * deadline that's still armed doesn't cancel the task anymore.
+     */
+    long retired;
+    /* Next callback in the awaitable's list of retired ones */
+    struct _pyawaitable_callback *retired_next;
 } _PyAwaitable_MANGLE(pyawaitable_callback);
 
+/*
+ * On free-threaded builds, everything below that another thread might touch
+ * (the arrays, the state, the result, and the step budget) is protected by
+ * a critical section on the awaitable. Only one thread may drive the
+ * awaitable at a time, though, like with coroutines.
+ */
 struct _PyAwaitableObject {
     PyObject_HEAD
 
@@ -35,12 +81,33 @@ struct _PyAwaitableObject {
     PyObject *aw_result;
     /* Strong reference to the genwrapper. */
     PyObject *aw_gen;
-    /* Set to 1 if the object was cancelled, for introspection against callbacks */
-    int aw_recently_cancelled;
+    /*
+     * Set to 1 if the object was cancelled, for introspection against
+     * callbacks. This is atomic, so the driver can check it without a
+     * critical section.
+     */
+    long aw_recently_cancelled;
+    /*
+     * Callbacks that were running when the awaitable was cancelled, which
+     * the driver might still be using. These are linked through
+     * retired_next, and freed by the driver before its next step.
+     */
+    pyawaitable_callback *aw_retired;
+    /*
+     * Number of steps that may run synchronously before yielding to the
+     * event loop, or 0 for unlimited. The interpreter's default is copied
+     * in when the awaitable is created.
+     */
+    Py_ssize_t aw_step_budget;
+    /* Number of times that the step budget was exhausted */
+    Py_ssize_t aw_budget_hits;
 };
 
 typedef struct _PyAwaitableObject PyAwaitableObject;
-_PyAwaitable_INTERNAL_DATA(PyTypeObject) PyAwaitable_Type;
+/* Each interpreter creates its own heap type from this */
+_PyAwaitable_INTERNAL_DATA(PyType_Spec) PyAwaitable_TypeSpec;
+
+#define PyAwaitable_STEP_BUDGET_DEFAULT -1
 
 _PyAwaitable_API(int)
 PyAwaitable_SetResult(PyObject * awaitable, PyObject * result);
@@ -53,15 +120,76 @@ PyAwaitable_AddAwait(
     PyAwaitable_Error err
 );
 
+_PyAwaitable_API(int)
+PyAwaitable_AddExpr(
+    PyObject * aw,
+    PyObject * expr,
+    PyAwaitable_Callback cb,
+    PyAwaitable_Error err
+);
+
+_PyAwaitable_API(int)
+PyAwaitable_AddAwaitEx(
+    PyObject * aw,
+    PyObject * coro,
+    PyAwaitable_CallbackEx cb,
+    PyAwaitable_ErrorEx err,
+    void *userdata
+);
+
 _PyAwaitable_API(int)
 PyAwaitable_DeferAwait(PyObject * aw, PyAwaitable_Defer cb);
 
+_PyAwaitable_API(int)
+PyAwaitable_DeferAwaitEx(
+    PyObject * aw,
+    PyAwaitable_DeferEx cb,
+    void *userdata
+);
+
+_PyAwaitable_API(int)
+PyAwaitable_DeferNoGIL(
+    PyObject * aw,
+    PyAwaitable_NoGIL func,
+    PyAwaitable_NoGILResult cb,
+    void *arg
+);
+
+_PyAwaitable_API(int)
+PyAwaitable_DeferNoGILEx(
+    PyObject * aw,
+    PyAwaitable_NoGIL func,
+    PyAwaitable_NoGILResult cb,
+    PyAwaitable_NoGILRelease release,
+    void *arg
+);
+
 _PyAwaitable_API(void)
 PyAwaitable_Cancel(PyObject * aw);
 
+_PyAwaitable_API(int)
+PyAwaitable_SetStepBudget(PyObject * aw, Py_ssize_t budget);
+
+_PyAwaitable_API(int)
+PyAwaitable_SetDefaultStepBudget(Py_ssize_t budget);
+
+_PyAwaitable_API(Py_ssize_t)
+PyAwaitable_GetStepBudgetHits(PyObject * aw);
+
+_PyAwaitable_API(Py_ssize_t)
+PyAwaitable_GetTotalStepBudgetHits(void);
+
 _PyAwaitable_INTERNAL(PyObject *)
 awaitable_next(PyObject * self);
 
+/* Free a list of callbacks that were retired by PyAwaitable_Cancel() */
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_FreeRetired(pyawaitable_callback * cb);
+
+/* PyAwaitable_SendFunc for this version's awaitables */
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_Send(PyObject * self, PyObject **presult);
+
 _PyAwaitable_API(PyObject *)
 PyAwaitable_New(void);
 
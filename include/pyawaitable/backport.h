@@ -23,8 +23,105 @@ _PyAwaitable_NO_MANGLE(Py_XNewRef)(PyObject *o)
 }
 #endif
 
+#ifdef Py_TPFLAGS_IMMUTABLETYPE
+#define _PyAwaitable_TPFLAGS_IMMUTABLETYPE Py_TPFLAGS_IMMUTABLETYPE
+#else
+#define _PyAwaitable_TPFLAGS_IMMUTABLETYPE 0
+#endif
+
+/*
+ * Per-object locking for free-threaded builds. On builds with a GIL
+ * (including everything before 3.13), these are just a block. Code inside
+ * must not return or jump out of it.
+ */
+#ifdef Py_BEGIN_CRITICAL_SECTION
+#define _PyAwaitable_BEGIN_CRITICAL_SECTION(op) Py_BEGIN_CRITICAL_SECTION(op)
+#define _PyAwaitable_END_CRITICAL_SECTION() Py_END_CRITICAL_SECTION()
+#else
+#define _PyAwaitable_BEGIN_CRITICAL_SECTION(op) {
+#define _PyAwaitable_END_CRITICAL_SECTION() }
+#endif
+
+/*
+ * Atomic operations, for data that's shared with threads that might not
+ * hold the GIL (or an attached thread state at all). These are all
+ * sequentially consistent.
+ */
+#if defined(_MSC_VER) && !defined(__clang__)
+#  include <intrin.h>
+#define _PyAwaitable_ATOMIC_LOAD_PTR(ptr) \
+        _InterlockedCompareExchangePointer((void *volatile *)(ptr), NULL, NULL)
+#define _PyAwaitable_ATOMIC_EXCHANGE_PTR(ptr, value) \
+        _InterlockedExchangePointer((void *volatile *)(ptr), (value))
+#define _PyAwaitable_ATOMIC_CAS_PTR(ptr, expected, desired) \
+        (_InterlockedCompareExchangePointer(                \
+    (void *volatile *)(ptr),                                \
+    (desired),                                              \
+    (expected)                                              \
+        ) == (void *)(expected))
+#define _PyAwaitable_ATOMIC_LOAD_LONG(ptr) \
+        _InterlockedCompareExchange((volatile long *)(ptr), 0, 0)
+#define _PyAwaitable_ATOMIC_EXCHANGE_LONG(ptr, value) \
+        _InterlockedExchange((volatile long *)(ptr), (value))
+#define _PyAwaitable_ATOMIC_CAS_LONG(ptr, expected, desired) \
+        (_InterlockedCompareExchange(                        \
+    (volatile long *)(ptr),                                  \
+    (desired),                                               \
+    (expected)                                               \
+        ) == (expected))
+#define _PyAwaitable_ATOMIC_ADD_LONG(ptr, value) \
+        _InterlockedExchangeAdd((volatile long *)(ptr), (value))
+#  ifdef _WIN64
+#define _PyAwaitable_ATOMIC_LOAD_SSIZE(ptr) \
+        _InterlockedCompareExchange64((volatile __int64 *)(ptr), 0, 0)
+#define _PyAwaitable_ATOMIC_EXCHANGE_SSIZE(ptr, value) \
+        _InterlockedExchange64((volatile __int64 *)(ptr), (value))
+#define _PyAwaitable_ATOMIC_ADD_SSIZE(ptr, value) \
+        _InterlockedExchangeAdd64((volatile __int64 *)(ptr), (value))
+#  else
+#define _PyAwaitable_ATOMIC_LOAD_SSIZE(ptr) _PyAwaitable_ATOMIC_LOAD_LONG(ptr)
+#define _PyAwaitable_ATOMIC_EXCHANGE_SSIZE(ptr, value) \
+        _PyAwaitable_ATOMIC_EXCHANGE_LONG(ptr, value)
+#define _PyAwaitable_ATOMIC_ADD_SSIZE(ptr, value) \
+        _PyAwaitable_ATOMIC_ADD_LONG(ptr, value)
+#  endif
+#else
+#define _PyAwaitable_ATOMIC_LOAD_PTR(ptr) \
+        __atomic_load_n((ptr), __ATOMIC_SEQ_CST)
+#define _PyAwaitable_ATOMIC_EXCHANGE_PTR(ptr, value) \
+        __atomic_exchange_n((ptr), (value), __ATOMIC_SEQ_CST)
+#define _PyAwaitable_ATOMIC_CAS_PTR(ptr, expected, desired) \
+        __sync_bool_compare_and_swap((ptr), (expected), (desired))
+#define _PyAwaitable_ATOMIC_LOAD_LONG(ptr) \
+        __atomic_load_n((ptr), __ATOMIC_SEQ_CST)
+#define _PyAwaitable_ATOMIC_EXCHANGE_LONG(ptr, value) \
+        __atomic_exchange_n((ptr), (value), __ATOMIC_SEQ_CST)
+#define _PyAwaitable_ATOMIC_CAS_LONG(ptr, expected, desired) \
+        __sync_bool_compare_and_swap((ptr), (expected), (desired))
+#define _PyAwaitable_ATOMIC_ADD_LONG(ptr, value) \
+        __atomic_fetch_add((ptr), (value), __ATOMIC_SEQ_CST)
+#define _PyAwaitable_ATOMIC_LOAD_SSIZE(ptr) \
+        __atomic_load_n((ptr), __ATOMIC_SEQ_CST)
+#define _PyAwaitable_ATOMIC_EXCHANGE_SSIZE(ptr, value) \
+        __atomic_exchange_n((ptr), (value), __ATOMIC_SEQ_CST)
+#define _PyAwaitable_ATOMIC_ADD_SSIZE(ptr, value) \
+        __atomic_fetch_add((ptr), (value), __ATOMIC_SEQ_CST)
+#endif
+
+#if PY_VERSION_HEX < 0x030d0000
+static inline int
+_PyAwaitable_NO_MANGLE(PyObject_GetOptionalAttr)(
+    PyObject *obj,
+    PyObject *name,
+    PyObject **result
+)
+{
+    return _PyObject_LookupAttr(obj, name, result);
+}
+#endif
+
 #if PY_VERSION_HEX < 0x030c0000
-static PyObject *
+static inline PyObject *
 _PyAwaitable_NO_MANGLE(PyErr_GetRaisedException)(void)
 {
     PyObject *type, *val, *tb;
@@ -36,7 +133,7 @@ _PyAwaitable_NO_MANGLE(PyErr_GetRaisedException)(void)
     return val;
 }
 
-static void
+static inline void
 _PyAwaitable_NO_MANGLE(PyErr_SetRaisedException)(PyObject *err)
 {
     // NOTE: We need to incref the type object here, even though
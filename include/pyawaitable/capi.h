@@ -0,0 +1,234 @@
+#ifndef PYAWAITABLE_CAPI_H
+#define PYAWAITABLE_CAPI_H
+
+#include <Python.h>
+#include <stdarg.h>
+#include <pyawaitable/awaitableobject.h>
+#include <pyawaitable/dist.h>
+#include <pyawaitable/fileio.h>
+#include <pyawaitable/future.h>
+#include <pyawaitable/gather.h>
+#include <pyawaitable/init.h>
+#include <pyawaitable/interp.h>
+#include <pyawaitable/io.h>
+#include <pyawaitable/pool.h>
+#include <pyawaitable/soon.h>
+#include <pyawaitable/timer.h>
+
+/*
+ * Version of the function table below. Entries are only ever appended to
+ * the end (which is tracked by the size field), so this only changes if an
+ * existing entry has to change.
+ */
+#define PyAwaitable_ABI_VERSION 1
+/* Key of the table's capsule in the interpreter state dictionary */
+#define PyAwaitable_CAPI_KEY "pyawaitable.capi.1"
+#define PyAwaitable_CAPI_CAPSULE "pyawaitable.capi"
+
+/*
+ * Table of the public API, exported by copies of PyAwaitable that were
+ * compiled with PYAWAITABLE_SHARED. Every other shared copy in the same
+ * interpreter binds to the newest one that was initialized before it.
+ */
+typedef struct _pyawaitable_capi {
+    /* sizeof(PyAwaitable_CAPI) in the copy that exported the table */
+    size_t size;
+    long magic_version;
+    PyObject *(*New)(void);
+    PyTypeObject *(*GetType)(void);
+    int (*SetResult)(PyObject *, PyObject *);
+    int (*AddAwait)(
+        PyObject *,
+        PyObject *,
+        PyAwaitable_Callback,
+        PyAwaitable_Error
+    );
+    int (*AddExpr)(
+        PyObject *,
+        PyObject *,
+        PyAwaitable_Callback,
+        PyAwaitable_Error
+    );
+    int (*AddAwaitEx)(
+        PyObject *,
+        PyObject *,
+        PyAwaitable_CallbackEx,
+        PyAwaitable_ErrorEx,
+        void *
+    );
+    int (*DeferAwait)(PyObject *, PyAwaitable_Defer);
+    int (*DeferAwaitEx)(PyObject *, PyAwaitable_DeferEx, void *);
+    int (*DeferNoGIL)(
+        PyObject *,
+        PyAwaitable_NoGIL,
+        PyAwaitable_NoGILResult,
+        void *
+    );
+    int (*DeferNoGILEx)(
+        PyObject *,
+        PyAwaitable_NoGIL,
+        PyAwaitable_NoGILResult,
+        PyAwaitable_NoGILRelease,
+        void *
+    );
+    void (*Cancel)(PyObject *);
+    int (*SetStepBudget)(PyObject *, Py_ssize_t);
+    int (*SetDefaultStepBudget)(Py_ssize_t);
+    Py_ssize_t (*GetStepBudgetHits)(PyObject *);
+    Py_ssize_t (*GetTotalStepBudgetHits)(void);
+    int (*AsyncWith)(
+        PyObject *,
+        PyObject *,
+        PyAwaitable_Callback,
+        PyAwaitable_Error
+    );
+    int (*AsyncWithEx)(
+        PyObject *,
+        PyObject *,
+        PyAwaitable_CallbackEx,
+        PyAwaitable_ErrorEx,
+        void *
+    );
+    int (*CallSoon)(PyAwaitable_SoonFunc, void *);
+    int (*CallSoonThreadsafe)(PyObject *, PyAwaitable_SoonFunc, void *);
+    int (*AddInterpreterCall)(
+        PyObject *,
+        PyInterpreterState *,
+        PyAwaitable_InterpreterFunc,
+        void *,
+        PyAwaitable_NoGILResult
+    );
+    /* Object values */
+    int (*SaveValuesV)(PyObject *, Py_ssize_t, va_list);
+    int (*UnpackValuesV)(PyObject *, va_list);
+    int (*SetValue)(PyObject *, Py_ssize_t, PyObject *);
+    PyObject *(*GetValue)(PyObject *, Py_ssize_t);
+    int (*SaveValuesArray)(PyObject *, PyObject *const *, Py_ssize_t);
+    PyObject **(*BorrowValues)(PyObject *, Py_ssize_t, Py_ssize_t);
+    int (*UnpackValuesRange)(PyObject *, Py_ssize_t, Py_ssize_t, PyObject **);
+    /* Arbitrary values */
+    int (*SaveArbValuesV)(PyObject *, Py_ssize_t, va_list);
+    int (*UnpackArbValuesV)(PyObject *, va_list);
+    int (*SetArbValue)(PyObject *, Py_ssize_t, void *);
+    void *(*GetArbValue)(PyObject *, Py_ssize_t);
+    int (*SaveArbValuesArray)(PyObject *, void *const *, Py_ssize_t);
+    void **(*BorrowArbValues)(PyObject *, Py_ssize_t, Py_ssize_t);
+    int (*UnpackArbValuesRange)(PyObject *, Py_ssize_t, Py_ssize_t, void **);
+    /* Concurrency */
+    int (*AddGather)(
+        PyObject *,
+        PyObject *const *,
+        Py_ssize_t,
+        PyAwaitable_GatherCallback,
+        PyAwaitable_Error,
+        int
+    );
+    int (*AddRace)(
+        PyObject *,
+        PyObject *const *,
+        Py_ssize_t,
+        PyAwaitable_RaceCallback,
+        PyAwaitable_Error
+    );
+    /* Timers */
+    int (*AddSleep)(PyObject *, double);
+    int (*SetStepDeadline)(PyObject *, double);
+    /*
+     * C futures. PyAwaitable_Complete() isn't here, because futures carry
+     * their own completion function.
+     */
+    PyAwaitable_Future *(*AddFuture)(
+        PyObject *,
+        PyAwaitable_NoGILResult,
+        void *
+    );
+    /* Thread pool */
+    int (*AddBlocking)(
+        PyObject *,
+        PyAwaitable_NoGIL,
+        void *,
+        PyAwaitable_NoGILResult
+    );
+    int (*AddParallelMap)(
+        PyObject *,
+        PyAwaitable_NoGIL,
+        void *const *,
+        Py_ssize_t,
+        Py_ssize_t,
+        PyAwaitable_MapCallback
+    );
+    /* File descriptors */
+    int (*AddReadable)(PyObject *, int, PyAwaitable_FDCallback);
+    int (*AddWritable)(PyObject *, int, PyAwaitable_FDCallback);
+    int (*AddReadInto)(
+        PyObject *,
+        int,
+        void *,
+        Py_ssize_t,
+        PyAwaitable_ReadCallback
+    );
+    int (*AddReadIntoBuffer)(
+        PyObject *,
+        int,
+        PyObject *,
+        PyAwaitable_ReadCallback
+    );
+    PyObject *(*NewWriter)(int, Py_ssize_t);
+    int (*Write)(PyObject *, const void *, Py_ssize_t);
+    int (*WriteBuffer)(PyObject *, PyObject *);
+    int (*AddDrain)(PyObject *, PyObject *);
+    int (*AddFlush)(PyObject *, PyObject *);
+    /* File I/O */
+    int (*AddPread)(
+        PyObject *,
+        int,
+        void *,
+        Py_ssize_t,
+        long long,
+        PyAwaitable_SizeCallback
+    );
+    int (*AddPwrite)(
+        PyObject *,
+        int,
+        const void *,
+        Py_ssize_t,
+        long long,
+        PyAwaitable_SizeCallback
+    );
+    int (*AddSendfile)(
+        PyObject *,
+        int,
+        int,
+        long long,
+        long long,
+        PyAwaitable_SizeCallback
+    );
+} PyAwaitable_CAPI;
+
+#ifdef PYAWAITABLE_SHARED
+/*
+ * Publish our table in the interpreter, or bind to the one that's already
+ * there if it came from another version of PyAwaitable.
+ */
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_BindCAPI(pyawaitable_state * state, PyObject * interp_dict);
+
+/*
+ * Used at the top of each public function; if we're bound to another copy,
+ * the call (e.g. New()) is made through its table instead.
+ */
+#define _PyAwaitable_FORWARD(err, call)                                \
+        do {                                                           \
+            pyawaitable_state *_fw_state = _PyAwaitable_GetState();    \
+            if (PyAwaitable_UNLIKELY(_fw_state == NULL)) {             \
+                return err;                                            \
+            }                                                          \
+            if (PyAwaitable_UNLIKELY(_fw_state->capi != NULL)) {       \
+                return _fw_state->capi->call;                          \
+            }                                                          \
+        } while (0)
+#else
+#define _PyAwaitable_FORWARD(err, call)
+#endif
+
+#endif
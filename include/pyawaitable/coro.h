@@ -7,6 +7,10 @@
 #ifndef _PYAWAITABLE_VENDOR
 _PyAwaitable_INTERNAL_DATA(PyMethodDef) pyawaitable_methods[];
 #endif
-_PyAwaitable_INTERNAL_DATA(PyAsyncMethods) pyawaitable_async_methods;
+
+#if PY_MINOR_VERSION > 9
+_PyAwaitable_INTERNAL(PySendResult)
+awaitable_am_send(PyObject * self, PyObject * arg, PyObject * *presult);
+#endif
 
 #endif
@@ -6,9 +6,33 @@
     "Python 3.8 and older are no longer supported, please use Python 3.9 or newer."
 #endif
 
-#ifdef _PYAWAITABLE_VENDOR
-#define _PyAwaitable_API(ret) static ret
-#define _PyAwaitable_INTERNAL(ret) static ret
+#include <pyawaitable/optimize.h>
+
+/*
+ * By default, the vendored copy gives every translation unit its own static
+ * copy of PyAwaitable. If PYAWAITABLE_SINGLE_IMPLEMENTATION is defined in
+ * every translation unit, PyAwaitable only gets defined in the one that also
+ * defines PYAWAITABLE_IMPLEMENTATION, and the others link against it. The
+ * symbols are kept hidden so they don't leak out of the extension module.
+ */
+#if defined(_PYAWAITABLE_VENDOR) && defined(PYAWAITABLE_SINGLE_IMPLEMENTATION)
+#if defined(PYAWAITABLE_IMPLEMENTATION) && defined(PYAWAITABLE_UNCHECKED)
+#error \
+    "PYAWAITABLE_UNCHECKED cannot be used in the PYAWAITABLE_IMPLEMENTATION file."
+#endif
+#if defined(__GNUC__) && !defined(_WIN32)
+#define _PyAwaitable_HIDDEN __attribute__((visibility("hidden")))
+#else
+#define _PyAwaitable_HIDDEN
+#endif
+#define _PyAwaitable_API(ret) _PyAwaitable_HIDDEN ret
+#define _PyAwaitable_INTERNAL(ret) _PyAwaitable_HIDDEN ret
+#define _PyAwaitable_INTERNAL_DATA(tp) extern _PyAwaitable_HIDDEN tp
+#define _PyAwaitable_INTERNAL_DATA_DEF(tp) _PyAwaitable_HIDDEN tp
+#elif defined(_PYAWAITABLE_VENDOR)
+/* Most files only use a few of these, so don't warn about the rest */
+#define _PyAwaitable_API(ret) static PyAwaitable_MAYBE_UNUSED ret
+#define _PyAwaitable_INTERNAL(ret) static PyAwaitable_MAYBE_UNUSED ret
 #define _PyAwaitable_INTERNAL_DATA(tp) static tp
 #define _PyAwaitable_INTERNAL_DATA_DEF(tp) static tp
 #else
@@ -20,6 +44,26 @@
 #define PyAwaitable_MAGIC_NUMBER 0
 #endif
 
+/*
+ * If PYAWAITABLE_UNCHECKED is defined before including PyAwaitable, the
+ * hot value accessors skip their runtime checks and are inlined into the
+ * caller. Passing an invalid index is then undefined behavior (and only
+ * caught by assertions in debug builds).
+ */
+#ifdef PYAWAITABLE_UNCHECKED
+#define _PyAwaitable_HOT_API(ret) static inline PyAwaitable_HOT ret
+#else
+#define _PyAwaitable_HOT_API(ret) _PyAwaitable_API(ret)
+#endif
+
+/*
+ * A shared copy might be bound to another version of PyAwaitable, so it
+ * can't assume anything about the layout of an awaitable.
+ */
+#if defined(PYAWAITABLE_SHARED) && defined(PYAWAITABLE_UNCHECKED)
+#error "PYAWAITABLE_UNCHECKED cannot be used with PYAWAITABLE_SHARED."
+#endif
+
 #define _PyAwaitable_MANGLE(name) name
 #define _PyAwaitable_NO_MANGLE(name) name
 
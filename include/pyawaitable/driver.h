@@ -0,0 +1,77 @@
+#ifndef PYAWAITABLE_DRIVER_H
+#define PYAWAITABLE_DRIVER_H
+
+#include <Python.h>
+#include <pyawaitable/dist.h>
+
+/*
+ * Results of PyAwaitable_SendFunc. These have the same values as
+ * PySendResult, so they can be returned from am_send directly.
+ */
+#define PyAwaitable_SEND_RETURN 0
+#define PyAwaitable_SEND_ERROR -1
+#define PyAwaitable_SEND_NEXT 1
+
+/*
+ * Run an awaitable until it yields (PyAwaitable_SEND_NEXT) or returns
+ * (PyAwaitable_SEND_RETURN). Either way, *presult is set to a strong
+ * reference to the yielded or returned value. On failure, *presult is
+ * set to NULL and an exception is set.
+ */
+typedef int (*PyAwaitable_SendFunc)(PyObject *, PyObject **);
+
+/*
+ * Stable interface that lets any version of PyAwaitable recognize and run
+ * another version's awaitables. Each version hands out a capsule with its
+ * driver through an attribute of its awaitables, named
+ * PyAwaitable_DRIVER_ATTR, which is looked up on their type.
+ *
+ * Fields are only ever appended, so check the size before using anything
+ * past send.
+ */
+typedef struct _pyawaitable_driver {
+    /* sizeof(PyAwaitable_Driver) in the version that created the type */
+    size_t size;
+    long magic_version;
+    PyAwaitable_SendFunc send;
+} PyAwaitable_Driver;
+
+#define PyAwaitable_DRIVER_ATTR "__pyawaitable_driver__"
+#define PyAwaitable_DRIVER_CAPSULE "pyawaitable.driver"
+
+#define _PyAwaitable_DRIVER_CACHE_SIZE 64
+
+/*
+ * Version tags of heap types that are known to not have a driver, such as
+ * asyncio's futures. A type gets a new version tag whenever it's modified,
+ * so a stale entry can never match. Slots are only accessed atomically,
+ * since any thread can fill them in.
+ */
+typedef struct _pyawaitable_driver_cache {
+    long misses[_PyAwaitable_DRIVER_CACHE_SIZE];
+} _PyAwaitable_MANGLE(pyawaitable_driver_cache);
+
+/* Create the capsule that's handed out by our awaitables */
+_PyAwaitable_INTERNAL(PyObject *)
+_PyAwaitable_NewDriverCapsule(void);
+
+/*
+ * Getter for PyAwaitable_DRIVER_ATTR, which returns the state's capsule.
+ * Using a descriptor lets the type be immutable from the start.
+ */
+_PyAwaitable_INTERNAL_DATA(PyGetSetDef) pyawaitable_driver_getset[];
+
+/*
+ * Get the send function for op if it's an awaitable from any version of
+ * PyAwaitable, or NULL if it's anything else. key is the interned
+ * PyAwaitable_DRIVER_ATTR string, and types without it are remembered in
+ * cache. This never fails.
+ */
+_PyAwaitable_INTERNAL(PyAwaitable_SendFunc)
+_PyAwaitable_FindDriver(
+    pyawaitable_driver_cache * cache,
+    PyObject * op,
+    PyObject * key
+);
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef PYAWAITABLE_FILEIO_H
+#define PYAWAITABLE_FILEIO_H
+
+#include <Python.h>
+#include <pyawaitable/dist.h>
+#include <pyawaitable/future.h>
+#include <pyawaitable/pool.h>
+
+/*
+ * Positional file I/O goes through io_uring when the kernel headers have
+ * it, unless PYAWAITABLE_NO_IO_URING is defined. Either way, it falls back
+ * to the thread pool whenever the ring can't take a request.
+ */
+#if defined(__linux__) && !defined(PYAWAITABLE_NO_IO_URING) \
+    && defined(__has_include)
+#  if __has_include(<linux/io_uring.h>)
+#define _PyAwaitable_HAVE_IO_URING
+#  endif
+#endif
+
+#ifdef _PyAwaitable_HAVE_IO_URING
+#  include <linux/io_uring.h>
+#  include <sys/uio.h>
+#endif
+
+/* Called with the number of bytes that were transferred */
+typedef int (*PyAwaitable_SizeCallback)(PyObject *awaitable, Py_ssize_t size);
+
+/*
+ * A single pread() or pwrite(). This is shared between the step and
+ * whatever runs the operation, since a cancelled step can't stop the
+ * operation once it's been handed off. For the same reason, the operation
+ * only ever touches its own copy of the data.
+ */
+typedef struct _pyawaitable_fileio_op {
+    /* Runs the operation on the thread pool, if it falls back to it */
+    pyawaitable_job job;
+    /* The future that the job completes */
+    PyAwaitable_Future *pool_future;
+    /* Atomic; the step holds one, and the ring or the pool holds another */
+    long refcount;
+    int fd;
+    int writing;
+    /*
+     * The caller's buffer, which a read is copied into once the step gets
+     * its result, or NULL for a write. It's never touched by the ring or
+     * the pool.
+     */
+    void *buffer;
+    Py_ssize_t size;
+    long long offset;
+    PyAwaitable_SizeCallback cb;
+    /* The number of bytes that were transferred, or a negated errno */
+    Py_ssize_t result;
+#ifdef _PyAwaitable_HAVE_IO_URING
+    struct iovec iov;
+    /*
+     * Strong reference to the asyncio future that the step awaits while
+     * the operation is in the ring, or NULL.
+     */
+    PyObject *future;
+#endif
+    /* The operation's own copy of the data; there's room for size bytes */
+    char data[1];
+} _PyAwaitable_MANGLE(pyawaitable_fileio_op);
+
+#ifdef _PyAwaitable_HAVE_IO_URING
+/*
+ * An io_uring instance, along with the eventfd that it signals upon
+ * completions. The eventfd is watched by one event loop at a time.
+ */
+typedef struct _pyawaitable_ring {
+    int ring_fd;
+    int event_fd;
+    /* Strong reference to the loop that watches event_fd, or NULL */
+    PyObject *loop;
+    /* The number of operations that haven't been reaped yet */
+    unsigned inflight;
+    unsigned entries;
+    /* Shared with the kernel */
+    void *sq_ptr;
+    size_t sq_size;
+    void *cq_ptr;
+    size_t cq_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+} _PyAwaitable_MANGLE(pyawaitable_ring);
+#endif
+
+struct _pyawaitable_ring;
+
+/*
+ * State for file I/O steps, owned by the interpreter state. Copies of
+ * PyAwaitable that were built with and without io_uring can share it, so
+ * its layout can't depend on _PyAwaitable_HAVE_IO_URING.
+ */
+typedef struct _pyawaitable_fileio {
+    /* Frees the state; set by the copy that created it, which owns the ring */
+    void (*free)(struct _pyawaitable_fileio *);
+    /* asyncio.get_running_loop */
+    PyObject *get_running_loop;
+    /* Function that the loop calls once the ring has completions, or NULL */
+    PyObject *reap;
+    /*
+     * NULL if io_uring isn't available, in which case the pool is used. This
+     * is only touched by copies that were built with io_uring.
+     */
+    struct _pyawaitable_ring *ring;
+} _PyAwaitable_MANGLE(pyawaitable_fileio);
+
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_FileIOFree(pyawaitable_fileio * fileio);
+
+_PyAwaitable_API(int)
+PyAwaitable_AddPread(
+    PyObject * awaitable,
+    int fd,
+    void *buffer,
+    Py_ssize_t size,
+    long long offset,
+    PyAwaitable_SizeCallback cb
+);
+
+_PyAwaitable_API(int)
+PyAwaitable_AddPwrite(
+    PyObject * awaitable,
+    int fd,
+    const void *buffer,
+    Py_ssize_t size,
+    long long offset,
+    PyAwaitable_SizeCallback cb
+);
+
+_PyAwaitable_API(int)
+PyAwaitable_AddSendfile(
+    PyObject * awaitable,
+    int out_fd,
+    int in_fd,
+    long long offset,
+    long long count,
+    PyAwaitable_SizeCallback cb
+);
+
+#endif
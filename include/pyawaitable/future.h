@@ -0,0 +1,120 @@
+#ifndef PYAWAITABLE_FUTURE_H
+#define PYAWAITABLE_FUTURE_H
+
+#include <Python.h>
+#include <pythread.h>
+#include <pyawaitable/array.h>
+#include <pyawaitable/awaitableobject.h> // PyAwaitable_NoGILResult
+#include <pyawaitable/dist.h>
+#include <pyawaitable/gate.h>
+#include <pyawaitable/pool.h>
+
+/* States of a pyawaitable_future */
+#define _PyAwaitable_FUTURE_PENDING 0
+/* The step has started, and the future is bound to its event loop */
+#define _PyAwaitable_FUTURE_WAITING 1
+#define _PyAwaitable_FUTURE_DONE 2
+
+struct _pyawaitable_hub;
+
+/*
+ * Future that's completed from C, possibly on a thread that doesn't hold
+ * the GIL. It's owned by two references: one for the step that waits on it,
+ * and one for whoever completes it.
+ */
+typedef struct _pyawaitable_future {
+    /*
+     * This has to come first, so that PyAwaitable_Complete() works on
+     * futures from any copy of PyAwaitable.
+     */
+    void (*complete)(struct _pyawaitable_future *, void *);
+    /* Next future in the hub's queue of completions */
+    struct _pyawaitable_future *next;
+    /* Atomic */
+    long state;
+    /* Atomic */
+    long refcount;
+    void *result;
+    /* Hub of the loop that the step runs on, once it's waiting */
+    struct _pyawaitable_hub *hub;
+    /*
+     * Strong reference to the asyncio future that the step awaits, or NULL.
+     * This is only touched with the GIL held.
+     */
+    PyObject *py_future;
+    /*
+     * Jobs that complete the future, which are submitted to the thread pool
+     * once the step starts, or NULL. These own the completer's reference.
+     */
+    pyawaitable_job *jobs;
+    /*
+     * Frees the result once the future itself is freed, or NULL. This might
+     * be called without a thread state.
+     */
+    void (*free_result)(void *);
+} PyAwaitable_Future;
+
+/*
+ * Completions for a single event loop. Completed futures are pushed onto a
+ * lock-free stack by any number of threads, and the loop takes all of them
+ * at once. Only the push that finds the stack empty wakes up the loop.
+ */
+typedef struct _pyawaitable_hub {
+    /* Atomic; the stack of completed futures, newest first */
+    PyAwaitable_Future *head;
+    /* Atomic; the state holds one, and each waiting future holds another */
+    long refcount;
+    /* Strong reference to the event loop */
+    PyObject *loop;
+    /* For waking up the loop from threads without a thread state */
+    pyawaitable_gate *gate;
+    /*
+     * File descriptors that the loop watches for wakeups, or -1 if the loop
+     * can't watch them (such as with the proactor on Windows), in which
+     * case it's woken up with PyAwaitable_CallSoonThreadsafe() instead.
+     * These are the same for an eventfd.
+     */
+    int read_fd;
+    int write_fd;
+} _PyAwaitable_MANGLE(pyawaitable_hub);
+
+/* State for C futures, owned by the interpreter state */
+typedef struct _pyawaitable_hubs {
+    /* Array of pyawaitable_hub pointers, one per event loop */
+    pyawaitable_array hubs;
+    /* Function that drains a hub; called by the event loop */
+    PyObject *drain;
+    /* asyncio.get_running_loop */
+    PyObject *get_running_loop;
+    /* The interpreter's gate, which every hub shares */
+    pyawaitable_gate *gate;
+} _PyAwaitable_MANGLE(pyawaitable_hubs);
+
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_HubsFree(pyawaitable_hubs * hubs);
+
+/*
+ * Like PyAwaitable_AddFuture(), but the future is completed by the given
+ * jobs, which are submitted to the thread pool once the step starts. If
+ * the step never starts, the jobs are discarded. On failure, the jobs are
+ * left to the caller.
+ */
+_PyAwaitable_INTERNAL(PyAwaitable_Future *)
+_PyAwaitable_AddJobFuture(
+    PyObject * awaitable,
+    PyAwaitable_NoGILResult cb,
+    void *arg,
+    pyawaitable_job * jobs
+);
+
+_PyAwaitable_API(PyAwaitable_Future *)
+PyAwaitable_AddFuture(
+    PyObject * awaitable,
+    PyAwaitable_NoGILResult cb,
+    void *arg
+);
+
+_PyAwaitable_API(void)
+PyAwaitable_Complete(PyAwaitable_Future * future, void *result);
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef PYAWAITABLE_GATE_H
+#define PYAWAITABLE_GATE_H
+
+#include <Python.h>
+#include <pythread.h>
+#include <pyawaitable/dist.h>
+
+/*
+ * Lets threads attach to an interpreter that they don't belong to, such as
+ * to wake up one of its event loops or to call into it from another
+ * interpreter. Each interpreter's state owns one, and it's closed before
+ * the interpreter starts finalizing, after which nothing attaches to it
+ * anymore.
+ */
+typedef struct _pyawaitable_gate {
+    PyInterpreterState *interp;
+    /* Protects everything below; it's never held while waiting on the GIL */
+    PyThread_type_lock lock;
+    /* Held until the last attached thread leaves a closed gate */
+    PyThread_type_lock idle;
+    /* Number of threads that are attached through the gate */
+    long active;
+    int closed;
+    /* Whether idle is being waited on */
+    int waiting;
+    /*
+     * Atomic; the state holds one, and so does the atexit hook, the
+     * registry, and everything that might attach through the gate.
+     */
+    long refcount;
+} _PyAwaitable_MANGLE(pyawaitable_gate);
+
+/*
+ * Gates that can be found by their interpreter from anywhere in the
+ * process. Each interpreter's state points to a registry, and so does each
+ * copy of PyAwaitable. Whenever a copy is used in an interpreter, their
+ * registries are merged, so copies that have met in any interpreter find
+ * each other's gates. Each entry holds a reference, and closed gates are
+ * thrown out whenever this is used.
+ *
+ * Registries are allocated with PyMem_RawMalloc(), since they aren't
+ * per-interpreter, and live for as long as the process does.
+ */
+typedef struct _pyawaitable_gate_registry {
+    /* Atomic; the registry that this one was merged into, if any */
+    struct _pyawaitable_gate_registry *forward;
+    /* Protects everything below */
+    PyThread_type_lock lock;
+    pyawaitable_gate **gates;
+    Py_ssize_t length;
+    Py_ssize_t capacity;
+} _PyAwaitable_MANGLE(pyawaitable_gate_registry);
+
+/* Atomic; the registry that this copy has joined, created upon first use */
+_PyAwaitable_INTERNAL_DATA(pyawaitable_gate_registry *) pyawaitable_gates;
+
+/*
+ * Create a gate for the current interpreter, which is closed at exit.
+ *
+ * Returns a new reference, or NULL with an exception set on failure.
+ */
+_PyAwaitable_INTERNAL(pyawaitable_gate *)
+_PyAwaitable_GateNew(void);
+
+/* This doesn't need a thread state */
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_GateRelease(pyawaitable_gate * gate);
+
+/*
+ * Stop anything new from attaching to the interpreter. If wait is set, this
+ * also waits for the threads that are already attached, which needs the
+ * GIL to be released, so it's only done while the interpreter can still
+ * hand it over.
+ */
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_GateClose(pyawaitable_gate * gate, int wait);
+
+/*
+ * Start using the gate's interpreter, and return whether it's still
+ * usable. If it is, _PyAwaitable_GateLeave() has to be called once we're
+ * done. This doesn't need a thread state.
+ */
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_GateEnter(pyawaitable_gate * gate);
+
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_GateLeave(pyawaitable_gate * gate);
+
+/*
+ * Attach a new thread state for the gate's interpreter, from a thread that
+ * doesn't have one. This enters the gate, so it returns NULL if the
+ * interpreter is exiting, or if there's no memory for a thread state.
+ */
+_PyAwaitable_INTERNAL(PyThreadState *)
+_PyAwaitable_GateAttach(pyawaitable_gate * gate);
+
+/* Delete the thread state from _PyAwaitable_GateAttach(), and leave */
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_GateDetach(pyawaitable_gate * gate, PyThreadState * tstate);
+
+/*
+ * Make the gate findable with _PyAwaitable_GateFind(). *shared is the
+ * registry of the gate's interpreter, which is merged with this copy's.
+ *
+ * Returns -1 with an exception set on failure.
+ */
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_GateRegister(
+    pyawaitable_gate_registry * *shared,
+    pyawaitable_gate * gate
+);
+
+/*
+ * Get a new reference to the open gate for interp from registry, or NULL
+ * if there isn't one. This doesn't set an exception.
+ */
+_PyAwaitable_INTERNAL(pyawaitable_gate *)
+_PyAwaitable_GateFind(
+    pyawaitable_gate_registry * registry,
+    PyInterpreterState * interp
+);
+
+#endif
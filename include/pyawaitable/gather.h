@@ -0,0 +1,73 @@
+#ifndef PYAWAITABLE_GATHER_H
+#define PYAWAITABLE_GATHER_H
+
+#include <Python.h>
+#include <pyawaitable/awaitableobject.h> // PyAwaitable_Error
+#include <pyawaitable/dist.h>
+
+/* Cancel the other awaitables as soon as one of them fails */
+#define PyAwaitable_GATHER_CANCEL_ON_ERROR (1 << 0)
+/* Wait for everything, and raise all failures in an ExceptionGroup */
+#define PyAwaitable_GATHER_EXCEPTION_GROUP (1 << 1)
+
+/*
+ * Called once every gathered awaitable has finished. results holds
+ * borrowed references, in the same order that the awaitables were passed.
+ */
+typedef int (*PyAwaitable_GatherCallback)(
+    PyObject *awaitable,
+    PyObject **results,
+    Py_ssize_t size
+);
+
+/*
+ * Resolve an asyncio future by calling method (set_result or set_exception)
+ * with value, unless it's already done, which is the case if the step that
+ * awaits it was cancelled. Returns 1 if this call resolved it, 0 if it was
+ * already done, and -1 with an exception set on failure.
+ */
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_ResolveFuture(
+    PyObject * future,
+    const char *method,
+    PyObject * value
+);
+
+/*
+ * Create the inner awaitable for a step that runs on its own, which the
+ * outer awaitable will await. A borrowed reference to the outer awaitable
+ * is saved as the first arbitrary value.
+ */
+_PyAwaitable_INTERNAL(PyObject *)
+_PyAwaitable_NewInner(PyObject * awaitable);
+
+_PyAwaitable_API(int)
+PyAwaitable_AddGather(
+    PyObject * awaitable,
+    PyObject *const *coros,
+    Py_ssize_t size,
+    PyAwaitable_GatherCallback cb,
+    PyAwaitable_Error err,
+    int flags
+);
+
+/*
+ * Called with the index and result of the first awaitable to finish, once
+ * it has succeeded. The result is a borrowed reference.
+ */
+typedef int (*PyAwaitable_RaceCallback)(
+    PyObject *awaitable,
+    Py_ssize_t index,
+    PyObject *result
+);
+
+_PyAwaitable_API(int)
+PyAwaitable_AddRace(
+    PyObject * awaitable,
+    PyObject *const *coros,
+    Py_ssize_t size,
+    PyAwaitable_RaceCallback cb,
+    PyAwaitable_Error err
+);
+
+#endif
@@ -4,22 +4,45 @@
 #include <Python.h>
 #include <pyawaitable/awaitableobject.h>
 #include <pyawaitable/dist.h>
+#include <pyawaitable/driver.h>
 
-_PyAwaitable_INTERNAL_DATA(PyTypeObject) _PyAwaitableGenWrapperType;
+_PyAwaitable_INTERNAL_DATA(PyType_Spec) _PyAwaitableGenWrapper_TypeSpec;
 
 typedef struct _GenWrapperObject {
     PyObject_HEAD
     PyAwaitableObject *gw_aw;
+    /*
+     * What the running step is awaiting. PyAwaitable_Cancel() can clear this
+     * from another thread, so it's only changed in a critical section on
+     * gw_aw, and the driver holds its own reference while sending to it.
+     */
     PyObject *gw_current_await;
+    /*
+     * If gw_current_await is an awaitable from any version of PyAwaitable,
+     * this is its send function, and it's ran directly instead of going
+     * through __await__. NULL otherwise.
+     */
+    PyAwaitable_SendFunc gw_current_send;
+    /*
+     * Strong reference to an exception that was thrown into us, to be
+     * thrown into gw_current_await upon the next send. NULL otherwise.
+     */
+    PyObject *gw_throw;
+    /* Number of steps started since we last yielded to the event loop */
+    Py_ssize_t gw_sync_steps;
 } _PyAwaitable_MANGLE(GenWrapperObject);
 
 _PyAwaitable_INTERNAL(PyObject *)
 _PyAwaitableGenWrapper_Next(PyObject * self);
 
+/* Same as above, but returns the result instead of raising StopIteration */
+_PyAwaitable_INTERNAL(int)
+_PyAwaitableGenWrapper_Send(PyObject * self, PyObject **presult);
+
 _PyAwaitable_INTERNAL(int)
 _PyAwaitableGenWrapper_FireErrCallback(
     PyObject * self,
-    PyAwaitable_Error err_callback
+    pyawaitable_callback * cb
 );
 
 _PyAwaitable_INTERNAL(PyObject *)
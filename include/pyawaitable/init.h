@@ -2,10 +2,153 @@
 #define PYAWAITABLE_INIT_H
 
 #include <Python.h>
+#include <stdint.h>
+#include <pyawaitable/array.h>
+#include <pyawaitable/backport.h>
 #include <pyawaitable/dist.h>
+#include <pyawaitable/driver.h>
+#include <pyawaitable/fileio.h>
+#include <pyawaitable/future.h>
+#include <pyawaitable/gate.h>
+#include <pyawaitable/io.h>
+#include <pyawaitable/optimize.h>
+#include <pyawaitable/pool.h>
+#include <pyawaitable/soon.h>
+#include <pyawaitable/timer.h>
 
-_PyAwaitable_INTERNAL(PyObject *)
-_PyAwaitable_GetState(void);
+/* Interpreter-wide step budget settings and metrics */
+typedef struct _pyawaitable_step_budget {
+    /* Step budget used by awaitables that don't have their own */
+    Py_ssize_t default_budget;
+    /* Number of times that any awaitable exhausted its step budget */
+    Py_ssize_t total_hits;
+} _PyAwaitable_MANGLE(pyawaitable_step_budget);
+
+struct _pyawaitable_capi;
+
+/*
+ * Per-interpreter state for a single version of PyAwaitable. This is owned
+ * by a capsule in the interpreter's state dictionary, under a key that
+ * contains the magic number, so every copy of the same version shares it.
+ */
+typedef struct _pyawaitable_state {
+    long magic_version;
+    /* Strong references */
+    PyTypeObject *awaitable_type;
+    PyTypeObject *genwrapper_type;
+    pyawaitable_step_budget step_budget;
+    /* Interned PyAwaitable_DRIVER_ATTR, for looking up other versions */
+    PyObject *driver_key;
+    pyawaitable_driver_cache driver_cache;
+    /* Capsule with our driver, which our awaitables hand out */
+    PyObject *driver;
+    /* Lets other threads and interpreters attach to this interpreter */
+    pyawaitable_gate *gate;
+    /* Atomic; shared with every copy that has been used here */
+    pyawaitable_gate_registry *gates;
+    /* Created upon the first call to PyAwaitable_CallSoon() */
+    pyawaitable_soon *soon;
+    /* Created upon the first timer, like the above */
+    pyawaitable_timers *timers;
+    /* Created upon the first C future, like the above */
+    pyawaitable_hubs *hubs;
+    /* Started upon the first blocking call, like the above */
+    pyawaitable_pool *pool;
+    /* Created upon the first I/O step, like the above */
+    pyawaitable_io *io;
+    /* Created upon the first file I/O step, like the above */
+    pyawaitable_fileio *fileio;
+    /*
+     * Table of another version of PyAwaitable that our shared copies
+     * forward to, or NULL if they use their own code.
+     */
+    const struct _pyawaitable_capi *capi;
+    /*
+     * Generation counters (long *) of every copy that has cached this
+     * state, which are all bumped when the state is destroyed.
+     */
+    pyawaitable_array cache_generations;
+    /* Guards cache_generations, since any thread can register a copy */
+    PyThread_type_lock cache_lock;
+} _PyAwaitable_MANGLE(pyawaitable_state);
+
+/*
+ * Per-thread cache for _PyAwaitable_GetState(). The cached state is only
+ * valid for the cached interpreter, and only until this copy's generation
+ * changes. Interpreter IDs and addresses can both be reused once an
+ * interpreter is gone (the main interpreter gets the same ones back if
+ * Python is initialized again), so destroying a state bumps the generation
+ * of every copy that cached it, which invalidates the cache on all threads.
+ */
+_PyAwaitable_INTERNAL_DATA(PyAwaitable_thread_local PyInterpreterState *)
+pyawaitable_fast_interp;
+_PyAwaitable_INTERNAL_DATA(PyAwaitable_thread_local long)
+pyawaitable_fast_generation;
+_PyAwaitable_INTERNAL_DATA(PyAwaitable_thread_local pyawaitable_state *)
+pyawaitable_fast_state;
+_PyAwaitable_INTERNAL_DATA(long) pyawaitable_state_generation;
+
+/*
+ * Is this thread's cached state the one for interp?
+ */
+static inline int
+_PyAwaitable_IsStateCached(PyInterpreterState *interp)
+{
+    return interp == pyawaitable_fast_interp
+           && pyawaitable_fast_generation
+           == _PyAwaitable_ATOMIC_LOAD_LONG(&pyawaitable_state_generation);
+}
+
+_PyAwaitable_INTERNAL(pyawaitable_state *)
+_PyAwaitable_GetStateSlow(void);
+
+/*
+ * Get the PyAwaitable state for the current interpreter.
+ *
+ * Returns a borrowed pointer, or NULL with an exception set on failure.
+ */
+static inline pyawaitable_state *
+_PyAwaitable_GetState(void)
+{
+    PyInterpreterState *interp = PyInterpreterState_Get();
+    if (PyAwaitable_LIKELY(_PyAwaitable_IsStateCached(interp))) {
+        assert(pyawaitable_fast_state != NULL);
+        return pyawaitable_fast_state;
+    }
+
+    return _PyAwaitable_GetStateSlow();
+}
+
+/*
+ * Body of a function that returns one of the state's fields, which is
+ * created by create() upon first use. Creating it can run arbitrary code,
+ * and other threads can race us to it, so ours is only published if the
+ * field is still empty; otherwise it's thrown away with destroy().
+ * The function returns a borrowed pointer, or NULL with an exception set.
+ */
+#define _PyAwaitable_LAZY_STATE(field, create, destroy)                      \
+        pyawaitable_state *state = _PyAwaitable_GetState();                  \
+        if (PyAwaitable_UNLIKELY(state == NULL)) {                           \
+            return NULL;                                                     \
+        }                                                                    \
+        void *current = _PyAwaitable_ATOMIC_LOAD_PTR(&state->field);         \
+        if (PyAwaitable_UNLIKELY(current == NULL)) {                         \
+            void *created = create();                                        \
+            if (created == NULL) {                                           \
+                return NULL;                                                 \
+            }                                                                \
+            if (_PyAwaitable_ATOMIC_CAS_PTR(&state->field, NULL, created)) { \
+                current = created;                                           \
+            }                                                                \
+            else {                                                           \
+                destroy(created);                                            \
+                current = _PyAwaitable_ATOMIC_LOAD_PTR(&state->field);       \
+            }                                                                \
+        }                                                                    \
+        return current
+
+_PyAwaitable_INTERNAL(pyawaitable_step_budget *)
+_PyAwaitable_GetStepBudget(void);
 
 _PyAwaitable_API(PyTypeObject *)
 PyAwaitable_GetType(void);
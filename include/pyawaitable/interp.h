@@ -0,0 +1,49 @@
+#ifndef PYAWAITABLE_INTERP_H
+#define PYAWAITABLE_INTERP_H
+
+#include <Python.h>
+#include <pyawaitable/awaitableobject.h> // PyAwaitable_NoGILResult
+#include <pyawaitable/dist.h>
+#include <pyawaitable/future.h>
+#include <pyawaitable/gate.h>
+#include <pyawaitable/pool.h>
+
+/*
+ * Function that runs in another interpreter. It must not touch objects
+ * from the calling interpreter; *payload* and *result* are plain C data.
+ */
+typedef int (*PyAwaitable_InterpreterFunc)(void *payload, void **result);
+
+/*
+ * A call that's in flight between two interpreters. This is a job for the
+ * calling interpreter's thread pool, and is owned by its future.
+ */
+typedef struct _pyawaitable_interp_call {
+    pyawaitable_job job;
+    /* Gate of the target interpreter, which might exit before we run */
+    pyawaitable_gate *gate;
+    PyAwaitable_InterpreterFunc func;
+    void *payload;
+    PyAwaitable_NoGILResult result_callback;
+    void *result;
+    /* Whether the call failed */
+    int failed;
+    /*
+     * Description of the exception raised by func, allocated with
+     * PyMem_RawMalloc(). NULL if func succeeded, or if there wasn't enough
+     * memory to describe it.
+     */
+    char *error;
+    PyAwaitable_Future *future;
+} _PyAwaitable_MANGLE(pyawaitable_interp_call);
+
+_PyAwaitable_API(int)
+PyAwaitable_AddInterpreterCall(
+    PyObject * awaitable,
+    PyInterpreterState * interp,
+    PyAwaitable_InterpreterFunc func,
+    void *payload,
+    PyAwaitable_NoGILResult result_callback
+);
+
+#endif
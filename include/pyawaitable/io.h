@@ -0,0 +1,171 @@
+#ifndef PYAWAITABLE_IO_H
+#define PYAWAITABLE_IO_H
+
+#include <Python.h>
+#include <pyawaitable/awaitableobject.h> // PyAwaitable_Defer
+#include <pyawaitable/dist.h>
+
+/*
+ * Readiness of a file descriptor, as watched by the running event loop.
+ * This is embedded at the start of each I/O step's own structure, which is
+ * owned by a capsule in the first value slot of the step's inner awaitable.
+ */
+typedef struct _pyawaitable_watch {
+    /* Strong reference to the loop that the fd is registered with, or NULL */
+    PyObject *loop;
+    /* Strong reference to the future of the current wait, or NULL */
+    PyObject *future;
+    /* Called with the inner awaitable once the fd is ready */
+    int (*ready)(PyObject *, struct _pyawaitable_watch *);
+    /* Frees the structure that the watch is embedded in */
+    void (*free)(struct _pyawaitable_watch *);
+    int fd;
+    int writable;
+} _PyAwaitable_MANGLE(pyawaitable_watch);
+
+#define _PyAwaitable_IO_ADD_READER 0
+#define _PyAwaitable_IO_REMOVE_READER 1
+#define _PyAwaitable_IO_ADD_WRITER 2
+#define _PyAwaitable_IO_REMOVE_WRITER 3
+
+/* State for I/O steps, owned by the interpreter state */
+typedef struct _pyawaitable_io {
+    /* asyncio.get_running_loop */
+    PyObject *get_running_loop;
+    /* Function that the loop calls once a watched fd is ready */
+    PyObject *ready;
+    /*
+     * The last loop that a watch was registered with, and its bound
+     * add_reader(), remove_reader(), add_writer(), and remove_writer()
+     * methods. These are only touched in a critical section on ready.
+     */
+    PyObject *loop;
+    PyObject *methods[4];
+    /* Function that the loop calls once a writer's fd is writable */
+    PyObject *flush;
+} _PyAwaitable_MANGLE(pyawaitable_io);
+
+/* A buffer in a writer's queue */
+typedef struct _pyawaitable_wbuf {
+    char *data;
+    Py_ssize_t size;
+    /* Number of bytes at the start that were already written */
+    Py_ssize_t offset;
+    /* Size of the allocation if we copied the data, or 0 for a view */
+    Py_ssize_t capacity;
+    Py_buffer view;
+} _PyAwaitable_MANGLE(pyawaitable_wbuf);
+
+/*
+ * Queue of buffers to write to an fd, owned by a capsule. The writer is
+ * bound to the event loop that it's first used on, and is only touched
+ * from that loop's thread.
+ */
+typedef struct _pyawaitable_writer {
+    /* Strong reference to the loop, or NULL if nothing was written yet */
+    PyObject *loop;
+    /* Ring of buffers, where head is the index of the oldest one */
+    pyawaitable_wbuf *queue;
+    Py_ssize_t head;
+    Py_ssize_t length;
+    Py_ssize_t capacity;
+    /* Number of bytes in the queue that haven't been written */
+    Py_ssize_t queued;
+    Py_ssize_t high_water;
+    /* Strong reference to the exception that stopped the writer, or NULL */
+    PyObject *error;
+    /* Lists of futures to resolve at or below high_water, and once empty */
+    PyObject *drain_waiters;
+    PyObject *flush_waiters;
+    int fd;
+    /* Whether a flush is scheduled with PyAwaitable_CallSoon() */
+    int scheduled;
+    /* Whether the loop is watching the fd for writability */
+    int watching;
+} _PyAwaitable_MANGLE(pyawaitable_writer);
+
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_IOFree(pyawaitable_io * io);
+
+/*
+ * Add a step to awaitable that runs start with an inner awaitable. The
+ * inner awaitable holds a capsule that owns the watch in its first value,
+ * and a borrowed reference to awaitable in its first arbitrary value. The
+ * watch is freed on failure.
+ */
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_AddWatchStep(
+    PyObject * awaitable,
+    pyawaitable_watch * watch,
+    PyAwaitable_Defer start
+);
+
+/* Get the watch of an inner awaitable from _PyAwaitable_AddWatchStep() */
+_PyAwaitable_INTERNAL(pyawaitable_watch *)
+_PyAwaitable_GetWatch(PyObject * inner);
+
+/*
+ * Add a step to an inner awaitable from _PyAwaitable_AddWatchStep() that
+ * waits until the fd is ready, and then calls the watch's ready function.
+ * This has to be called while the inner awaitable is running.
+ */
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_WatchWait(PyObject * inner);
+
+/* Called with the fd once it's ready */
+typedef int (*PyAwaitable_FDCallback)(PyObject *awaitable, int fd);
+
+_PyAwaitable_API(int)
+PyAwaitable_AddReadable(
+    PyObject * awaitable,
+    int fd,
+    PyAwaitable_FDCallback cb
+);
+
+_PyAwaitable_API(int)
+PyAwaitable_AddWritable(
+    PyObject * awaitable,
+    int fd,
+    PyAwaitable_FDCallback cb
+);
+
+/* Called with the part of the buffer that was filled */
+typedef int (*PyAwaitable_ReadCallback)(
+    PyObject *awaitable,
+    void *buffer,
+    Py_ssize_t size
+);
+
+_PyAwaitable_API(int)
+PyAwaitable_AddReadInto(
+    PyObject * awaitable,
+    int fd,
+    void *buffer,
+    Py_ssize_t size,
+    PyAwaitable_ReadCallback cb
+);
+
+_PyAwaitable_API(int)
+PyAwaitable_AddReadIntoBuffer(
+    PyObject * awaitable,
+    int fd,
+    PyObject * obj,
+    PyAwaitable_ReadCallback cb
+);
+
+_PyAwaitable_API(PyObject *)
+PyAwaitable_NewWriter(int fd, Py_ssize_t high_water);
+
+_PyAwaitable_API(int)
+PyAwaitable_Write(PyObject * writer, const void *data, Py_ssize_t size);
+
+_PyAwaitable_API(int)
+PyAwaitable_WriteBuffer(PyObject * writer, PyObject * obj);
+
+_PyAwaitable_API(int)
+PyAwaitable_AddDrain(PyObject * awaitable, PyObject * writer);
+
+_PyAwaitable_API(int)
+PyAwaitable_AddFlush(PyObject * awaitable, PyObject * writer);
+
+#endif
@@ -17,11 +17,14 @@
 #define PyAwaitable_CONST __attribute__((const))
 /* Called rarely */
 #define PyAwaitable_COLD __attribute__((cold))
+/* Might not be used by the translation unit that it's defined in */
+#define PyAwaitable_MAYBE_UNUSED __attribute__((unused))
 #else
 #define PyAwaitable_HOT
 #define PyAwaitable_PURE
 #define PyAwaitable_CONST
 #define PyAwaitable_COLD
+#define PyAwaitable_MAYBE_UNUSED
 #endif
 
 #if defined(__GNUC__) || defined(__clang__)
@@ -0,0 +1,110 @@
+#ifndef PYAWAITABLE_POOL_H
+#define PYAWAITABLE_POOL_H
+
+#include <Python.h>
+#include <pythread.h>
+#include <pyawaitable/awaitableobject.h> // PyAwaitable_NoGIL
+#include <pyawaitable/dist.h>
+
+/*
+ * Unit of work for the thread pool. Jobs are intrusive, so queueing them
+ * never allocates.
+ */
+typedef struct _pyawaitable_job {
+    /* Links in whatever queue the job is in */
+    struct _pyawaitable_job *next;
+    struct _pyawaitable_job *prev;
+    /*
+     * Run the job on a worker thread, without a thread state. This is
+     * responsible for freeing the job.
+     */
+    void (*run)(struct _pyawaitable_job *);
+    /* Free a job that will never run. This is called with the GIL held. */
+    void (*discard)(struct _pyawaitable_job *);
+} _PyAwaitable_MANGLE(pyawaitable_job);
+
+struct _pyawaitable_pool;
+
+/*
+ * A worker thread. Each one has its own deque, which it pops from the back
+ * of, and which other workers steal from the front of once they run dry.
+ */
+typedef struct _pyawaitable_worker {
+    struct _pyawaitable_pool *pool;
+    /* Protects the deque */
+    PyThread_type_lock lock;
+    pyawaitable_job *front;
+    pyawaitable_job *back;
+    Py_ssize_t length;
+    /*
+     * Held while the worker is awake. Whoever sets sleeping from 1 to 0
+     * releases it, and the worker acquires it again to go to sleep.
+     */
+    PyThread_type_lock wakeup;
+    /* Atomic */
+    long sleeping;
+} _PyAwaitable_MANGLE(pyawaitable_worker);
+
+/*
+ * Thread pool for an interpreter. This doesn't touch any Python objects, so
+ * the workers don't need a thread state.
+ */
+typedef struct _pyawaitable_pool {
+    /*
+     * Atomic; stack of job batches that have been submitted, but not yet
+     * picked up by a worker. Each batch is linked through prev, and the jobs
+     * in a batch are linked through next.
+     */
+    pyawaitable_job *submitted;
+    /* Atomic; the number of jobs that no worker has taken yet */
+    long pending;
+    /* Atomic; the state holds one, and each running worker holds another */
+    long refcount;
+    /* Atomic */
+    long shutdown;
+    /* Atomic; the number of workers that were started */
+    long num_workers;
+    long max_workers;
+    pyawaitable_worker workers[1];
+} _PyAwaitable_MANGLE(pyawaitable_pool);
+
+/* Stop the pool once the workers run out of jobs. This doesn't wait. */
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_PoolShutdown(pyawaitable_pool * pool);
+
+/*
+ * Submit a list of jobs, linked through next, to the current interpreter's
+ * pool. The whole list costs at most one wakeup.
+ */
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_PoolSubmit(pyawaitable_job * jobs);
+
+_PyAwaitable_API(int)
+PyAwaitable_AddBlocking(
+    PyObject * awaitable,
+    PyAwaitable_NoGIL func,
+    void *arg,
+    PyAwaitable_NoGILResult cb
+);
+
+/*
+ * Called once every item has been mapped. results is only valid until the
+ * callback returns, and is in the same order as the items.
+ */
+typedef int (*PyAwaitable_MapCallback)(
+    PyObject *awaitable,
+    void **results,
+    Py_ssize_t size
+);
+
+_PyAwaitable_API(int)
+PyAwaitable_AddParallelMap(
+    PyObject * awaitable,
+    PyAwaitable_NoGIL func,
+    void *const *items,
+    Py_ssize_t size,
+    Py_ssize_t chunk,
+    PyAwaitable_MapCallback cb
+);
+
+#endif
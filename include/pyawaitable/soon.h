@@ -0,0 +1,56 @@
+#ifndef PYAWAITABLE_SOON_H
+#define PYAWAITABLE_SOON_H
+
+#include <Python.h>
+#include <stdbool.h>
+#include <pyawaitable/array.h>
+#include <pyawaitable/dist.h>
+
+typedef int (*PyAwaitable_SoonFunc)(void *);
+
+/* A single function call scheduled on an event loop */
+typedef struct _pyawaitable_soon_call {
+    PyAwaitable_SoonFunc func;
+    void *arg;
+} _PyAwaitable_MANGLE(pyawaitable_soon_call);
+
+/*
+ * All the calls that are pending for a single event loop. There is at
+ * most one trampoline call scheduled on the loop for each batch.
+ */
+typedef struct _pyawaitable_soon_batch {
+    /* Strong reference to the event loop */
+    PyObject *loop;
+    /* Whether the trampoline was scheduled with call_soon_threadsafe() */
+    bool threadsafe;
+    /* Array of pyawaitable_soon_call pointers */
+    pyawaitable_array calls;
+} _PyAwaitable_MANGLE(pyawaitable_soon_batch);
+
+/* State for PyAwaitable_CallSoon(), owned by the interpreter state */
+typedef struct _pyawaitable_soon {
+    /* Array of pyawaitable_soon_batch pointers, one per event loop */
+    pyawaitable_array batches;
+    /* Function that runs a batch; called by the event loop */
+    PyObject *trampoline;
+    /* asyncio.get_running_loop, loaded upon first use */
+    PyObject *get_running_loop;
+    PyObject *is_closed_str;
+    PyObject *call_soon_str;
+    PyObject *call_soon_threadsafe_str;
+} _PyAwaitable_MANGLE(pyawaitable_soon);
+
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_SoonFree(pyawaitable_soon * soon);
+
+_PyAwaitable_API(int)
+PyAwaitable_CallSoon(PyAwaitable_SoonFunc func, void *arg);
+
+_PyAwaitable_API(int)
+PyAwaitable_CallSoonThreadsafe(
+    PyObject * loop,
+    PyAwaitable_SoonFunc func,
+    void *arg
+);
+
+#endif
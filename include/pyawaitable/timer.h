@@ -0,0 +1,115 @@
+#ifndef PYAWAITABLE_TIMER_H
+#define PYAWAITABLE_TIMER_H
+
+#include <Python.h>
+#include <stdint.h>
+#include <pyawaitable/array.h>
+#include <pyawaitable/dist.h>
+
+/*
+ * Timers live on a hierarchical timing wheel, one per event loop, with
+ * millisecond ticks. Each slot on a level covers as many ticks as the whole
+ * level below it, and timers move down a level when their slot comes up.
+ * Arming and cancelling a timer are O(1), and each wheel only needs a
+ * single timer on the event loop, set for the next tick that has work.
+ */
+#define _PyAwaitable_WHEEL_BITS 6
+#define _PyAwaitable_WHEEL_SLOTS (1 << _PyAwaitable_WHEEL_BITS)
+#define _PyAwaitable_WHEEL_LEVELS 4
+
+struct _pyawaitable_wheel;
+
+/*
+ * Timers are armed and fired on their loop's thread, but can be cancelled
+ * from any thread. So the links, and each wheel's slots and count, are
+ * only changed in a critical section on the trampoline.
+ */
+typedef struct _pyawaitable_timer {
+    /* Links in the list of the slot that the timer is in */
+    struct _pyawaitable_timer *next;
+    struct _pyawaitable_timer **pprev;
+    /*
+     * Atomic; wheel that the timer is armed on, or NULL if it isn't armed.
+     * This is only set in a critical section on the trampoline.
+     */
+    struct _pyawaitable_wheel *wheel;
+    /* Tick that the timer fires on */
+    int64_t expires;
+    /*
+     * Called on the event loop once the timer fires, after it has been
+     * disarmed. Failures are reported with PyErr_WriteUnraisable().
+     */
+    int (*func)(void *);
+    void *arg;
+} _PyAwaitable_MANGLE(pyawaitable_timer);
+
+/* Everything but the slots and count is only used on the loop's thread */
+typedef struct _pyawaitable_wheel {
+    /* Strong reference to the event loop */
+    PyObject *loop;
+    /* Strong reference to the loop's handle for the next tick, or NULL */
+    PyObject *handle;
+    /* Tick that the handle is scheduled for */
+    int64_t scheduled;
+    /* Last tick that was processed */
+    int64_t now;
+    /* Number of armed timers */
+    Py_ssize_t count;
+    pyawaitable_timer *slots[_PyAwaitable_WHEEL_LEVELS][_PyAwaitable_WHEEL_SLOTS];
+} _PyAwaitable_MANGLE(pyawaitable_wheel);
+
+/* State for timers, owned by the interpreter state */
+typedef struct _pyawaitable_timers {
+    /* Array of pyawaitable_wheel pointers, one per event loop */
+    pyawaitable_array wheels;
+    /* Function that advances a wheel; called by the event loop */
+    PyObject *trampoline;
+    /* Loaded from asyncio */
+    PyObject *get_running_loop;
+    PyObject *current_task;
+    PyObject *cancelled_error;
+    PyObject *timeout_error;
+#if PY_VERSION_HEX < 0x030d0000
+    /* time.monotonic, because PyTime_Monotonic() isn't available */
+    PyObject *monotonic;
+#endif
+} _PyAwaitable_MANGLE(pyawaitable_timers);
+
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_TimersFree(pyawaitable_timers * timers);
+
+/*
+ * Arm the timer on loop's wheel, to fire in the given number of seconds
+ * (rounded up to the next tick). func and arg must already be set.
+ */
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_TimerArm(pyawaitable_timer * timer, PyObject * loop, double seconds);
+
+/* Disarm the timer, if it's armed. This cannot fail. */
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_TimerCancel(pyawaitable_timer * timer);
+
+struct _pyawaitable_callback;
+
+/* Arm the step's deadline, now that it has started */
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_StartDeadline(struct _pyawaitable_callback * cb);
+
+/* Disarm the step's deadline, once it's done. This cannot fail. */
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_StopDeadline(struct _pyawaitable_callback * cb);
+
+/*
+ * If the step failed because its deadline passed, replace the exception
+ * (the CancelledError) with a TimeoutError.
+ */
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_DeadlineError(struct _pyawaitable_callback * cb);
+
+_PyAwaitable_API(int)
+PyAwaitable_AddSleep(PyObject * awaitable, double seconds);
+
+_PyAwaitable_API(int)
+PyAwaitable_SetStepDeadline(PyObject * awaitable, double seconds);
+
+#endif
@@ -2,6 +2,10 @@
 #define PYAWAITABLE_VALUES_H
 
 #include <Python.h> // PyObject, Py_ssize_t
+#include <stdarg.h>
+#include <pyawaitable/array.h>
+#include <pyawaitable/awaitableobject.h>
+#include <pyawaitable/backport.h>
 #include <pyawaitable/dist.h>
 
 /* Object values */
@@ -16,6 +20,45 @@ PyAwaitable_SaveValues(
 _PyAwaitable_API(int)
 PyAwaitable_UnpackValues(PyObject * awaitable, ...);
 
+/* va_list versions of the above, for the function table */
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_SaveValuesV(PyObject * aw, Py_ssize_t nargs, va_list vargs);
+
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_UnpackValuesV(PyObject * awaitable, va_list vargs);
+
+#ifdef PYAWAITABLE_UNCHECKED
+_PyAwaitable_HOT_API(int)
+PyAwaitable_SetValue(
+    PyObject * awaitable,
+    Py_ssize_t index,
+    PyObject * new_value
+)
+{
+    PyAwaitableObject *aw = (PyAwaitableObject *) awaitable;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(awaitable);
+    pyawaitable_array_set(&aw->aw_object_values, index, (void *)new_value);
+    _PyAwaitable_END_CRITICAL_SECTION();
+    return 0;
+}
+
+_PyAwaitable_HOT_API(PyObject *)
+PyAwaitable_GetValue(
+    PyObject * awaitable,
+    Py_ssize_t index
+)
+{
+    PyAwaitableObject *aw = (PyAwaitableObject *) awaitable;
+    PyObject *res;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(awaitable);
+    res = (PyObject *)pyawaitable_array_GET_ITEM(
+        &aw->aw_object_values,
+        index
+    );
+    _PyAwaitable_END_CRITICAL_SECTION();
+    return res;
+}
+#else
 _PyAwaitable_API(int)
 PyAwaitable_SetValue(
     PyObject * awaitable,
@@ -27,6 +70,29 @@ PyAwaitable_GetValue(
     PyObject * awaitable,
     Py_ssize_t index
 );
+#endif
+
+_PyAwaitable_API(int)
+PyAwaitable_SaveValuesArray(
+    PyObject * awaitable,
+    PyObject *const *values,
+    Py_ssize_t nargs
+);
+
+_PyAwaitable_API(PyObject **)
+PyAwaitable_BorrowValues(
+    PyObject * awaitable,
+    Py_ssize_t index,
+    Py_ssize_t nargs
+);
+
+_PyAwaitable_API(int)
+PyAwaitable_UnpackValuesRange(
+    PyObject * awaitable,
+    Py_ssize_t index,
+    Py_ssize_t nargs,
+    PyObject **values
+);
 
 /* Arbitrary values */
 
@@ -40,6 +106,41 @@ PyAwaitable_SaveArbValues(
 _PyAwaitable_API(int)
 PyAwaitable_UnpackArbValues(PyObject * awaitable, ...);
 
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_SaveArbValuesV(PyObject * aw, Py_ssize_t nargs, va_list vargs);
+
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_UnpackArbValuesV(PyObject * awaitable, va_list vargs);
+
+#ifdef PYAWAITABLE_UNCHECKED
+_PyAwaitable_HOT_API(int)
+PyAwaitable_SetArbValue(
+    PyObject * awaitable,
+    Py_ssize_t index,
+    void *new_value
+)
+{
+    PyAwaitableObject *aw = (PyAwaitableObject *) awaitable;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(awaitable);
+    pyawaitable_array_set(&aw->aw_arbitrary_values, index, new_value);
+    _PyAwaitable_END_CRITICAL_SECTION();
+    return 0;
+}
+
+_PyAwaitable_HOT_API(void *)
+PyAwaitable_GetArbValue(
+    PyObject * awaitable,
+    Py_ssize_t index
+)
+{
+    PyAwaitableObject *aw = (PyAwaitableObject *) awaitable;
+    void *res;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(awaitable);
+    res = pyawaitable_array_GET_ITEM(&aw->aw_arbitrary_values, index);
+    _PyAwaitable_END_CRITICAL_SECTION();
+    return res;
+}
+#else
 _PyAwaitable_API(int)
 PyAwaitable_SetArbValue(
     PyObject * awaitable,
@@ -52,5 +153,28 @@ PyAwaitable_GetArbValue(
     PyObject * awaitable,
     Py_ssize_t index
 );
+#endif
+
+_PyAwaitable_API(int)
+PyAwaitable_SaveArbValuesArray(
+    PyObject * awaitable,
+    void *const *values,
+    Py_ssize_t nargs
+);
+
+_PyAwaitable_API(void **)
+PyAwaitable_BorrowArbValues(
+    PyObject * awaitable,
+    Py_ssize_t index,
+    Py_ssize_t nargs
+);
+
+_PyAwaitable_API(int)
+PyAwaitable_UnpackArbValuesRange(
+    PyObject * awaitable,
+    Py_ssize_t index,
+    Py_ssize_t nargs,
+    void **values
+);
 
 #endif
@@ -12,4 +12,13 @@ PyAwaitable_AsyncWith(
     PyAwaitable_Error err
 );
 
+_PyAwaitable_API(int)
+PyAwaitable_AsyncWithEx(
+    PyObject * aw,
+    PyObject * ctx,
+    PyAwaitable_CallbackEx cb,
+    PyAwaitable_ErrorEx err,
+    void *userdata
+);
+
 #endif
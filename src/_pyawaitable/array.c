@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include <pyawaitable/array.h>
 #include <pyawaitable/optimize.h>
 
@@ -64,6 +66,51 @@ pyawaitable_array_append(pyawaitable_array *array, void *item)
     return 0;
 }
 
+_PyAwaitable_INTERNAL(int)
+pyawaitable_array_extend(
+    pyawaitable_array * array,
+    void *const *items,
+    Py_ssize_t nitems
+)
+{
+    pyawaitable_array_ASSERT_VALID(array);
+    assert(nitems >= 0);
+    assert(items != NULL || nitems == 0);
+
+    // Like append(), we always keep at least one free slot at the end
+    Py_ssize_t capacity = array->capacity;
+    if (PyAwaitable_UNLIKELY(nitems >= PY_SSIZE_T_MAX - array->length)) {
+        return -1;
+    }
+    while (capacity <= array->length + nitems) {
+        if (
+            PyAwaitable_UNLIKELY(
+                capacity > (Py_ssize_t)(PY_SSIZE_T_MAX / sizeof(void *)) / 2
+            )
+        ) {
+            return -1;
+        }
+        capacity *= 2;
+    }
+
+    if (capacity != array->capacity) {
+        void **new_items = PyMem_Realloc(
+            array->items,
+            sizeof(void *) * capacity
+        );
+        if (PyAwaitable_UNLIKELY(new_items == NULL)) {
+            return -1;
+        }
+
+        array->items = new_items;
+        array->capacity = capacity;
+    }
+
+    memcpy(array->items + array->length, items, sizeof(void *) * nitems);
+    array->length += nitems;
+    return 0;
+}
+
 _PyAwaitable_INTERNAL(int)
 pyawaitable_array_insert(
     pyawaitable_array * array,
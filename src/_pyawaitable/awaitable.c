@@ -4,22 +4,40 @@
 #include <pyawaitable/array.h>
 #include <pyawaitable/awaitableobject.h>
 #include <pyawaitable/backport.h>
+#include <pyawaitable/capi.h>
 #include <pyawaitable/coro.h>
+#include <pyawaitable/driver.h>
 #include <pyawaitable/genwrapper.h>
 #include <pyawaitable/init.h>
 #include <pyawaitable/optimize.h>
+#include <pyawaitable/timer.h>
 
 static void
 callback_dealloc(void *ptr)
 {
     assert(ptr != NULL);
     pyawaitable_callback *cb = (pyawaitable_callback *) ptr;
+    _PyAwaitable_StopDeadline(cb);
     Py_CLEAR(cb->coro);
     PyMem_Free(cb);
 }
 
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_FreeRetired(pyawaitable_callback * cb)
+{
+    while (cb != NULL) {
+        pyawaitable_callback *next = cb->retired_next;
+        callback_dealloc(cb);
+        cb = next;
+    }
+}
+
+/*
+ * The step budget is resolved here, so that the driver doesn't need to look
+ * up the interpreter's default on every step.
+ */
 static PyObject *
-awaitable_new_func(PyTypeObject *tp, PyObject *args, PyObject *kwds)
+awaitable_new_with_budget(PyTypeObject *tp, Py_ssize_t step_budget)
 {
     assert(tp != NULL);
     assert(tp->tp_alloc != NULL);
@@ -35,6 +53,9 @@ awaitable_new_func(PyTypeObject *tp, PyObject *args, PyObject *kwds)
     aw->aw_state = 0;
     aw->aw_result = NULL;
     aw->aw_recently_cancelled = 0;
+    aw->aw_retired = NULL;
+    aw->aw_step_budget = step_budget;
+    aw->aw_budget_hits = 0;
 
     if (pyawaitable_array_init(&aw->aw_callbacks, callback_dealloc) < 0) {
         goto error;
@@ -60,6 +81,20 @@ error:
     return NULL;
 }
 
+static PyObject *
+awaitable_new_func(PyTypeObject *tp, PyObject *args, PyObject *kwds)
+{
+    pyawaitable_step_budget *step_budget = _PyAwaitable_GetStepBudget();
+    if (PyAwaitable_UNLIKELY(step_budget == NULL)) {
+        return NULL;
+    }
+
+    return awaitable_new_with_budget(
+        tp,
+        _PyAwaitable_ATOMIC_LOAD_SSIZE(&step_budget->default_budget)
+    );
+}
+
 _PyAwaitable_INTERNAL(PyObject *)
 awaitable_next(PyObject * self)
 {
@@ -71,12 +106,34 @@ awaitable_next(PyObject * self)
         );
         return NULL;
     }
-    aw->aw_awaited = true;
     PyObject *gen = genwrapper_new(aw);
+    PyObject *old_gen;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(self);
+    aw->aw_awaited = true;
+    old_gen = aw->aw_gen;
     aw->aw_gen = Py_XNewRef(gen);
+    _PyAwaitable_END_CRITICAL_SECTION();
+    Py_XDECREF(old_gen);
     return gen;
 }
 
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_Send(PyObject * self, PyObject **presult)
+{
+    PyAwaitableObject *aw = (PyAwaitableObject *)self;
+    if (aw->aw_gen == NULL) {
+        PyObject *gen = awaitable_next(self);
+        if (PyAwaitable_UNLIKELY(gen == NULL)) {
+            *presult = NULL;
+            return PyAwaitable_SEND_ERROR;
+        }
+        // aw_gen holds a reference now
+        Py_DECREF(gen);
+    }
+
+    return _PyAwaitableGenWrapper_Send(aw->aw_gen, presult);
+}
+
 static int
 awaitable_traverse(PyObject *self, visitproc visit, void *arg)
 {
@@ -90,6 +147,8 @@ awaitable_traverse(PyObject *self, visitproc visit, void *arg)
     }
     Py_VISIT(aw->aw_gen);
     Py_VISIT(aw->aw_result);
+    // Heap types are owned by their instances
+    Py_VISIT(Py_TYPE(self));
     return 0;
 }
 
@@ -110,6 +169,8 @@ static void
 awaitable_dealloc(PyObject *self)
 {
     PyAwaitableObject *aw = (PyAwaitableObject *)self;
+    PyTypeObject *tp = Py_TYPE(self);
+    PyObject_GC_UnTrack(self);
 #define CLEAR_IF_NON_NULL(array)             \
         if (array.items != NULL) {           \
             pyawaitable_array_clear(&array); \
@@ -117,10 +178,14 @@ awaitable_dealloc(PyObject *self)
     CLEAR_IF_NON_NULL(aw->aw_callbacks);
     CLEAR_IF_NON_NULL(aw->aw_arbitrary_values);
 #undef CLEAR_IF_NON_NULL
+    _PyAwaitable_FreeRetired(aw->aw_retired);
 
     (void)awaitable_clear(self);
 
     if (!aw->aw_awaited) {
+        // We might be getting thrown away while an error is propagating,
+        // such as for the steps after one that failed.
+        PyObject *err = PyErr_GetRaisedException();
         if (
             PyErr_WarnEx(
                 PyExc_ResourceWarning,
@@ -130,37 +195,141 @@ awaitable_dealloc(PyObject *self)
         ) {
             PyErr_WriteUnraisable(self);
         }
+        if (err != NULL) {
+            PyErr_SetRaisedException(err);
+        }
     }
 
-    Py_TYPE(self)->tp_free(self);
+    tp->tp_free(self);
+    Py_DECREF(tp);
 }
 
 _PyAwaitable_API(void)
 PyAwaitable_Cancel(PyObject * self)
 {
     assert(self != NULL);
+#ifdef PYAWAITABLE_SHARED
+    pyawaitable_state *state = _PyAwaitable_GetState();
+    if (PyAwaitable_UNLIKELY(state == NULL)) {
+        PyErr_WriteUnraisable(self);
+        return;
+    }
+
+    if (PyAwaitable_UNLIKELY(state->capi != NULL)) {
+        state->capi->Cancel(self);
+        return;
+    }
+#endif
     PyAwaitableObject *aw = (PyAwaitableObject *) self;
+    PyObject *current_await = NULL;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(self);
+    if (aw->aw_state > 0) {
+        // The driver might still be using the running callback, even on
+        // another thread, so it's only freed once the driver moves on.
+        pyawaitable_callback *cb = pyawaitable_array_pop(
+            &aw->aw_callbacks,
+            aw->aw_state - 1
+        );
+        (void)_PyAwaitable_ATOMIC_EXCHANGE_LONG(&cb->retired, 1);
+        cb->retired_next = aw->aw_retired;
+        aw->aw_retired = cb;
+    }
     pyawaitable_array_clear_items(&aw->aw_callbacks);
     aw->aw_state = 0;
     if (aw->aw_gen != NULL) {
         GenWrapperObject *gw = (GenWrapperObject *)aw->aw_gen;
-        Py_CLEAR(gw->gw_current_await);
+        current_await = gw->gw_current_await;
+        gw->gw_current_await = NULL;
     }
 
-    aw->aw_recently_cancelled = 1;
+    (void)_PyAwaitable_ATOMIC_EXCHANGE_LONG(&aw->aw_recently_cancelled, 1);
     aw->aw_awaited = 1;
+    _PyAwaitable_END_CRITICAL_SECTION();
+    // Deallocating this could run arbitrary code
+    Py_XDECREF(current_await);
 }
 
-_PyAwaitable_API(int)
-PyAwaitable_AddAwait(
-    PyObject * self,
-    PyObject * coro,
+static pyawaitable_callback *
+callback_new(
+    PyObject *coro,
     PyAwaitable_Callback cb,
-    PyAwaitable_Error err
+    PyAwaitable_Error err,
+    void *userdata,
+    bool with_userdata
 )
 {
-    PyAwaitableObject *aw = (PyAwaitableObject *) self;
-    assert(Py_IS_TYPE(self, PyAwaitable_GetType()));
+    pyawaitable_callback *aw_c = PyMem_Malloc(sizeof(pyawaitable_callback));
+    if (aw_c == NULL) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    aw_c->coro = Py_XNewRef(coro);
+    aw_c->callback = cb;
+    aw_c->err_callback = err;
+    aw_c->userdata = userdata;
+    aw_c->nogil = NULL;
+    aw_c->nogil_release = NULL;
+    aw_c->deadline = -1;
+    aw_c->deadline_timer.wheel = NULL;
+    aw_c->deadline_task = NULL;
+    aw_c->deadline_expired = false;
+    aw_c->with_userdata = with_userdata;
+    aw_c->done = false;
+    aw_c->retired = 0;
+    aw_c->retired_next = NULL;
+    return aw_c;
+}
+
+/*
+ * Add the callback to the awaitable, which takes ownership of it. The
+ * driver might pick it up on another thread right away, so it must be
+ * fully set up beforehand.
+ */
+static int
+push_callback(PyAwaitableObject *aw, pyawaitable_callback *aw_c)
+{
+    int res;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION((PyObject *)aw);
+    res = pyawaitable_array_append(&aw->aw_callbacks, aw_c);
+    _PyAwaitable_END_CRITICAL_SECTION();
+    if (res < 0) {
+        Py_XDECREF(aw_c->coro);
+        PyMem_Free(aw_c);
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+append_callback(
+    PyAwaitableObject *aw,
+    PyObject *coro,
+    PyAwaitable_Callback cb,
+    PyAwaitable_Error err,
+    void *userdata,
+    bool with_userdata
+)
+{
+    pyawaitable_callback *aw_c = callback_new(
+        coro,
+        cb,
+        err,
+        userdata,
+        with_userdata
+    );
+    if (aw_c == NULL) {
+        return -1;
+    }
+
+    return push_callback(aw, aw_c);
+}
+
+static int
+check_coroutine(PyObject *self, PyObject *coro)
+{
     if (coro == NULL) {
         PyErr_SetString(
             PyExc_ValueError,
@@ -189,24 +358,51 @@ PyAwaitable_AddAwait(
         return -1;
     }
 
-    pyawaitable_callback *aw_c = PyMem_Malloc(sizeof(pyawaitable_callback));
-    if (aw_c == NULL) {
-        PyErr_NoMemory();
+    return 0;
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_AddAwait(
+    PyObject * self,
+    PyObject * coro,
+    PyAwaitable_Callback cb,
+    PyAwaitable_Error err
+)
+{
+    _PyAwaitable_FORWARD(-1, AddAwait(self, coro, cb, err));
+    PyAwaitableObject *aw = (PyAwaitableObject *) self;
+    assert(Py_IS_TYPE(self, PyAwaitable_GetType()));
+    if (check_coroutine(self, coro) < 0) {
         return -1;
     }
 
-    aw_c->coro = Py_NewRef(coro);
-    aw_c->callback = cb;
-    aw_c->err_callback = err;
-    aw_c->done = false;
+    return append_callback(aw, coro, cb, err, NULL, false);
+}
 
-    if (pyawaitable_array_append(&aw->aw_callbacks, aw_c) < 0) {
-        PyMem_Free(aw_c);
-        PyErr_NoMemory();
+_PyAwaitable_API(int)
+PyAwaitable_AddAwaitEx(
+    PyObject * self,
+    PyObject * coro,
+    PyAwaitable_CallbackEx cb,
+    PyAwaitable_ErrorEx err,
+    void *userdata
+)
+{
+    _PyAwaitable_FORWARD(-1, AddAwaitEx(self, coro, cb, err, userdata));
+    PyAwaitableObject *aw = (PyAwaitableObject *) self;
+    assert(Py_IS_TYPE(self, PyAwaitable_GetType()));
+    if (check_coroutine(self, coro) < 0) {
         return -1;
     }
 
-    return 0;
+    return append_callback(
+        aw,
+        coro,
+        (PyAwaitable_Callback)cb,
+        (PyAwaitable_Error)err,
+        userdata,
+        true
+    );
 }
 
 _PyAwaitable_API(int)
@@ -218,6 +414,7 @@ PyAwaitable_AddExpr(
 )
 {
     assert(self != NULL);
+    _PyAwaitable_FORWARD(-1, AddExpr(self, expr, cb, err));
     if (expr == NULL) {
         return -1;
     }
@@ -230,34 +427,195 @@ PyAwaitable_AddExpr(
 _PyAwaitable_API(int)
 PyAwaitable_DeferAwait(PyObject * awaitable, PyAwaitable_Defer cb)
 {
+    _PyAwaitable_FORWARD(-1, DeferAwait(awaitable, cb));
     PyAwaitableObject *aw = (PyAwaitableObject *) awaitable;
     assert(Py_IS_TYPE(awaitable, PyAwaitable_GetType()));
-    pyawaitable_callback *aw_c = PyMem_Malloc(sizeof(pyawaitable_callback));
+    return append_callback(
+        aw,
+        NULL,
+        (PyAwaitable_Callback)cb,
+        NULL,
+        NULL,
+        false
+    );
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_DeferAwaitEx(
+    PyObject * awaitable,
+    PyAwaitable_DeferEx cb,
+    void *userdata
+)
+{
+    _PyAwaitable_FORWARD(-1, DeferAwaitEx(awaitable, cb, userdata));
+    PyAwaitableObject *aw = (PyAwaitableObject *) awaitable;
+    assert(Py_IS_TYPE(awaitable, PyAwaitable_GetType()));
+    return append_callback(
+        aw,
+        NULL,
+        (PyAwaitable_Callback)cb,
+        NULL,
+        userdata,
+        true
+    );
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_DeferNoGIL(
+    PyObject * awaitable,
+    PyAwaitable_NoGIL func,
+    PyAwaitable_NoGILResult cb,
+    void *arg
+)
+{
+    return PyAwaitable_DeferNoGILEx(awaitable, func, cb, NULL, arg);
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_DeferNoGILEx(
+    PyObject * awaitable,
+    PyAwaitable_NoGIL func,
+    PyAwaitable_NoGILResult cb,
+    PyAwaitable_NoGILRelease release,
+    void *arg
+)
+{
+    _PyAwaitable_FORWARD(
+        -1,
+        DeferNoGILEx(awaitable, func, cb, release, arg)
+    );
+    PyAwaitableObject *aw = (PyAwaitableObject *) awaitable;
+    assert(Py_IS_TYPE(awaitable, PyAwaitable_GetType()));
+    if (func == NULL) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "PyAwaitable: NULL passed to PyAwaitable_DeferNoGIL()!"
+        );
+        return -1;
+    }
+
+    pyawaitable_callback *aw_c = callback_new(
+        NULL,
+        (PyAwaitable_Callback)cb,
+        NULL,
+        arg,
+        true
+    );
     if (aw_c == NULL) {
-        PyErr_NoMemory();
         return -1;
     }
 
-    aw_c->coro = NULL;
-    aw_c->callback = (PyAwaitable_Callback)cb;
-    aw_c->err_callback = NULL;
-    aw_c->done = false;
+    aw_c->nogil = func;
+    aw_c->nogil_release = release;
+    return push_callback(aw, aw_c);
+}
 
-    if (pyawaitable_array_append(&aw->aw_callbacks, aw_c) < 0) {
-        PyMem_Free(aw_c);
-        PyErr_NoMemory();
+static int
+check_step_budget(Py_ssize_t budget)
+{
+    if (budget < 0 && budget != PyAwaitable_STEP_BUDGET_DEFAULT) {
+        PyErr_Format(
+            PyExc_ValueError,
+            "PyAwaitable: Invalid step budget: %zd",
+            budget
+        );
         return -1;
     }
 
     return 0;
 }
 
+_PyAwaitable_API(int)
+PyAwaitable_SetStepBudget(PyObject * awaitable, Py_ssize_t budget)
+{
+    _PyAwaitable_FORWARD(-1, SetStepBudget(awaitable, budget));
+    PyAwaitableObject *aw = (PyAwaitableObject *) awaitable;
+    assert(Py_IS_TYPE(awaitable, PyAwaitable_GetType()));
+    if (check_step_budget(budget) < 0) {
+        return -1;
+    }
+
+    if (budget == PyAwaitable_STEP_BUDGET_DEFAULT) {
+        pyawaitable_step_budget *step_budget = _PyAwaitable_GetStepBudget();
+        if (step_budget == NULL) {
+            return -1;
+        }
+
+        budget = _PyAwaitable_ATOMIC_LOAD_SSIZE(&step_budget->default_budget);
+    }
+
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(awaitable);
+    aw->aw_step_budget = budget;
+    _PyAwaitable_END_CRITICAL_SECTION();
+    return 0;
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_SetDefaultStepBudget(Py_ssize_t budget)
+{
+    _PyAwaitable_FORWARD(-1, SetDefaultStepBudget(budget));
+    if (budget == PyAwaitable_STEP_BUDGET_DEFAULT) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "PyAwaitable: The default step budget cannot be "
+            "PyAwaitable_STEP_BUDGET_DEFAULT"
+        );
+        return -1;
+    }
+
+    if (check_step_budget(budget) < 0) {
+        return -1;
+    }
+
+    pyawaitable_step_budget *step_budget = _PyAwaitable_GetStepBudget();
+    if (step_budget == NULL) {
+        return -1;
+    }
+
+    (void)_PyAwaitable_ATOMIC_EXCHANGE_SSIZE(
+        &step_budget->default_budget,
+        budget
+    );
+    return 0;
+}
+
+_PyAwaitable_API(Py_ssize_t)
+PyAwaitable_GetStepBudgetHits(PyObject * awaitable)
+{
+    _PyAwaitable_FORWARD(-1, GetStepBudgetHits(awaitable));
+    PyAwaitableObject *aw = (PyAwaitableObject *) awaitable;
+    assert(Py_IS_TYPE(awaitable, PyAwaitable_GetType()));
+    Py_ssize_t hits;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(awaitable);
+    hits = aw->aw_budget_hits;
+    _PyAwaitable_END_CRITICAL_SECTION();
+    return hits;
+}
+
+_PyAwaitable_API(Py_ssize_t)
+PyAwaitable_GetTotalStepBudgetHits(void)
+{
+    _PyAwaitable_FORWARD(-1, GetTotalStepBudgetHits());
+    pyawaitable_step_budget *step_budget = _PyAwaitable_GetStepBudget();
+    if (step_budget == NULL) {
+        return -1;
+    }
+
+    return _PyAwaitable_ATOMIC_LOAD_SSIZE(&step_budget->total_hits);
+}
+
 _PyAwaitable_API(int)
 PyAwaitable_SetResult(PyObject * awaitable, PyObject * result)
 {
+    _PyAwaitable_FORWARD(-1, SetResult(awaitable, result));
     PyAwaitableObject *aw = (PyAwaitableObject *) awaitable;
     assert(Py_IS_TYPE(awaitable, PyAwaitable_GetType()));
+    PyObject *old;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(awaitable);
+    old = aw->aw_result;
     aw->aw_result = Py_NewRef(result);
+    _PyAwaitable_END_CRITICAL_SECTION();
+    Py_XDECREF(old);
     return 0;
 }
 
@@ -265,25 +623,42 @@ _PyAwaitable_API(PyObject *)
 PyAwaitable_New(void)
 {
     // XXX Use a freelist?
-    PyTypeObject *type = PyAwaitable_GetType();
-    if (PyAwaitable_UNLIKELY(type == NULL)) {
+    // The state lookup is inlined, so the hot path doesn't need a call.
+    pyawaitable_state *state = _PyAwaitable_GetState();
+    if (PyAwaitable_UNLIKELY(state == NULL)) {
         return NULL;
     }
-    PyObject *result = awaitable_new_func(type, NULL, NULL);
-    return result;
+#ifdef PYAWAITABLE_SHARED
+    if (PyAwaitable_UNLIKELY(state->capi != NULL)) {
+        return state->capi->New();
+    }
+#endif
+    return awaitable_new_with_budget(
+        state->awaitable_type,
+        _PyAwaitable_ATOMIC_LOAD_SSIZE(&state->step_budget.default_budget)
+    );
 }
 
-_PyAwaitable_INTERNAL_DATA_DEF(PyTypeObject) PyAwaitable_Type = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "_PyAwaitableType",
-    .tp_basicsize = sizeof(PyAwaitableObject),
-    .tp_dealloc = awaitable_dealloc,
-    .tp_as_async = &pyawaitable_async_methods,
-    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
-    .tp_doc = PyDoc_STR("Awaitable transport utility for the C API."),
-    .tp_iternext = awaitable_next,
-    .tp_new = awaitable_new_func,
-    .tp_clear = awaitable_clear,
-    .tp_traverse = awaitable_traverse,
-    .tp_methods = pyawaitable_methods
+static PyType_Slot pyawaitable_type_slots[] = {
+    {Py_tp_dealloc, awaitable_dealloc},
+    {Py_tp_doc, PyDoc_STR("Awaitable transport utility for the C API.")},
+    {Py_tp_iternext, awaitable_next},
+    {Py_tp_new, awaitable_new_func},
+    {Py_tp_clear, awaitable_clear},
+    {Py_tp_traverse, awaitable_traverse},
+    {Py_tp_methods, pyawaitable_methods},
+    {Py_tp_getset, pyawaitable_driver_getset},
+    {Py_am_await, awaitable_next},
+#if PY_MINOR_VERSION > 9
+    {Py_am_send, awaitable_am_send},
+#endif
+    {0, NULL}
+};
+
+_PyAwaitable_INTERNAL_DATA_DEF(PyType_Spec) PyAwaitable_TypeSpec = {
+    .name = "pyawaitable._PyAwaitableType",
+    .basicsize = sizeof(PyAwaitableObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC
+             | _PyAwaitable_TPFLAGS_IMMUTABLETYPE,
+    .slots = pyawaitable_type_slots
 };
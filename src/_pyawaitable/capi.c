@@ -0,0 +1,151 @@
+#include <Python.h>
+#include <pyawaitable/backport.h>
+#include <pyawaitable/capi.h>
+#include <pyawaitable/dist.h>
+#include <pyawaitable/future.h>
+#include <pyawaitable/gather.h>
+#include <pyawaitable/init.h>
+#include <pyawaitable/io.h>
+#include <pyawaitable/pool.h>
+#include <pyawaitable/timer.h>
+#include <pyawaitable/values.h>
+#include <pyawaitable/with.h>
+
+#ifdef PYAWAITABLE_SHARED
+static const PyAwaitable_CAPI pyawaitable_capi = {
+    .magic_version = PyAwaitable_MAGIC_NUMBER,
+    .size = sizeof(PyAwaitable_CAPI),
+    .New = PyAwaitable_New,
+    .GetType = PyAwaitable_GetType,
+    .SetResult = PyAwaitable_SetResult,
+    .AddAwait = PyAwaitable_AddAwait,
+    .AddExpr = PyAwaitable_AddExpr,
+    .AddAwaitEx = PyAwaitable_AddAwaitEx,
+    .DeferAwait = PyAwaitable_DeferAwait,
+    .DeferAwaitEx = PyAwaitable_DeferAwaitEx,
+    .DeferNoGIL = PyAwaitable_DeferNoGIL,
+    .DeferNoGILEx = PyAwaitable_DeferNoGILEx,
+    .Cancel = PyAwaitable_Cancel,
+    .SetStepBudget = PyAwaitable_SetStepBudget,
+    .SetDefaultStepBudget = PyAwaitable_SetDefaultStepBudget,
+    .GetStepBudgetHits = PyAwaitable_GetStepBudgetHits,
+    .GetTotalStepBudgetHits = PyAwaitable_GetTotalStepBudgetHits,
+    .AsyncWith = PyAwaitable_AsyncWith,
+    .AsyncWithEx = PyAwaitable_AsyncWithEx,
+    .CallSoon = PyAwaitable_CallSoon,
+    .CallSoonThreadsafe = PyAwaitable_CallSoonThreadsafe,
+    .AddInterpreterCall = PyAwaitable_AddInterpreterCall,
+    .SaveValuesV = _PyAwaitable_SaveValuesV,
+    .UnpackValuesV = _PyAwaitable_UnpackValuesV,
+    .SetValue = PyAwaitable_SetValue,
+    .GetValue = PyAwaitable_GetValue,
+    .SaveValuesArray = PyAwaitable_SaveValuesArray,
+    .BorrowValues = PyAwaitable_BorrowValues,
+    .UnpackValuesRange = PyAwaitable_UnpackValuesRange,
+    .SaveArbValuesV = _PyAwaitable_SaveArbValuesV,
+    .UnpackArbValuesV = _PyAwaitable_UnpackArbValuesV,
+    .SetArbValue = PyAwaitable_SetArbValue,
+    .GetArbValue = PyAwaitable_GetArbValue,
+    .SaveArbValuesArray = PyAwaitable_SaveArbValuesArray,
+    .BorrowArbValues = PyAwaitable_BorrowArbValues,
+    .UnpackArbValuesRange = PyAwaitable_UnpackArbValuesRange,
+    .AddGather = PyAwaitable_AddGather,
+    .AddRace = PyAwaitable_AddRace,
+    .AddSleep = PyAwaitable_AddSleep,
+    .SetStepDeadline = PyAwaitable_SetStepDeadline,
+    .AddFuture = PyAwaitable_AddFuture,
+    .AddBlocking = PyAwaitable_AddBlocking,
+    .AddParallelMap = PyAwaitable_AddParallelMap,
+    .AddReadable = PyAwaitable_AddReadable,
+    .AddWritable = PyAwaitable_AddWritable,
+    .AddReadInto = PyAwaitable_AddReadInto,
+    .AddReadIntoBuffer = PyAwaitable_AddReadIntoBuffer,
+    .NewWriter = PyAwaitable_NewWriter,
+    .Write = PyAwaitable_Write,
+    .WriteBuffer = PyAwaitable_WriteBuffer,
+    .AddDrain = PyAwaitable_AddDrain,
+    .AddFlush = PyAwaitable_AddFlush,
+    .AddPread = PyAwaitable_AddPread,
+    .AddPwrite = PyAwaitable_AddPwrite,
+    .AddSendfile = PyAwaitable_AddSendfile,
+};
+
+/*
+ * Is capi from an older version than ours? Tables with more entries are
+ * newer, and the magic number breaks ties.
+ */
+static int
+is_older_capi(const PyAwaitable_CAPI *capi)
+{
+    if (capi->size != pyawaitable_capi.size) {
+        return capi->size < pyawaitable_capi.size;
+    }
+
+    return capi->magic_version < pyawaitable_capi.magic_version;
+}
+
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_BindCAPI(pyawaitable_state * state, PyObject * interp_dict)
+{
+    assert(state != NULL);
+    assert(interp_dict != NULL);
+    PyObject *capsule = PyCapsule_New(
+        (void *)&pyawaitable_capi,
+        PyAwaitable_CAPI_CAPSULE,
+        NULL
+    );
+    if (capsule == NULL) {
+        return -1;
+    }
+
+    PyObject *key = PyUnicode_FromString(PyAwaitable_CAPI_KEY);
+    if (key == NULL) {
+        Py_DECREF(capsule);
+        return -1;
+    }
+
+    // The newest shared copy to get here becomes the one that everyone
+    // initialized after it uses.
+    PyObject *published = PyDict_SetDefault(interp_dict, key, capsule);
+    if (published == NULL) {
+        Py_DECREF(key);
+        Py_DECREF(capsule);
+        return -1;
+    }
+
+    const PyAwaitable_CAPI *capi = PyCapsule_GetPointer(
+        published,
+        PyAwaitable_CAPI_CAPSULE
+    );
+    if (capi == NULL) {
+        Py_DECREF(key);
+        Py_DECREF(capsule);
+        return -1;
+    }
+
+    if (is_older_capi(capi)) {
+        // Copies that already bound to the old table keep using it
+        if (PyDict_SetItem(interp_dict, key, capsule) < 0) {
+            Py_DECREF(key);
+            Py_DECREF(capsule);
+            return -1;
+        }
+        capi = &pyawaitable_capi;
+    }
+    Py_DECREF(key);
+    Py_DECREF(capsule);
+
+    if (
+        capi->magic_version == PyAwaitable_MAGIC_NUMBER ||
+        capi->size < sizeof(PyAwaitable_CAPI)
+    ) {
+        // Either it's the same code as ours, or it's too old to have
+        // everything that we need.
+        capi = NULL;
+    }
+
+    // Other threads might already be using the state
+    (void)_PyAwaitable_ATOMIC_EXCHANGE_PTR(&state->capi, (void *)capi);
+    return 0;
+}
+#endif
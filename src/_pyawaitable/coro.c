@@ -5,6 +5,21 @@
 #include <pyawaitable/genwrapper.h>
 #include <pyawaitable/optimize.h>
 
+static int
+check_running_send(PyObject *value)
+{
+    if (PyAwaitable_UNLIKELY(value != Py_None)) {
+        // Same as the generator wrapper, as steps can't receive values
+        PyErr_SetString(
+            PyExc_TypeError,
+            "PyAwaitable: Can't send non-None values to an awaitable"
+        );
+        return -1;
+    }
+
+    return 0;
+}
+
 static PyObject *
 awaitable_send_with_arg(PyObject *self, PyObject *value)
 {
@@ -16,6 +31,7 @@ awaitable_send_with_arg(PyObject *self, PyObject *value)
         }
 
         if (PyAwaitable_UNLIKELY(value != Py_None)) {
+            Py_DECREF(gen);
             PyErr_SetString(
                 PyExc_RuntimeError,
                 "can't send non-None value to a just-started awaitable"
@@ -27,6 +43,10 @@ awaitable_send_with_arg(PyObject *self, PyObject *value)
         Py_RETURN_NONE;
     }
 
+    if (check_running_send(value) < 0) {
+        return NULL;
+    }
+
     return _PyAwaitableGenWrapper_Next(aw->aw_gen);
 }
 
@@ -57,7 +77,18 @@ awaitable_throw(PyObject *self, PyObject *args)
     }
 
     if (PyType_Check(type)) {
-        PyObject *err = PyObject_CallOneArg(type, value);
+        PyObject *err;
+        if (value != NULL && PyExceptionInstance_Check(value)) {
+            err = Py_NewRef(value);
+        }
+        else if (value == NULL || value == Py_None) {
+            // throw(type), which has no value to construct it with
+            err = PyObject_CallNoArgs(type);
+        }
+        else {
+            err = PyObject_CallOneArg(type, value);
+        }
+
         if (PyAwaitable_UNLIKELY(err == NULL)) {
             return NULL;
         }
@@ -69,7 +100,17 @@ awaitable_throw(PyObject *self, PyObject *args)
             }
         }
 
-        PyErr_Restore(err, NULL, NULL);
+        PyErr_SetRaisedException(err);
+    }
+    else if (PyExceptionInstance_Check(type)) {
+        // throw(exc), which is what asyncio uses
+        if (traceback != NULL) {
+            if (PyException_SetTraceback(type, traceback) < 0) {
+                return NULL;
+            }
+        }
+
+        PyErr_SetRaisedException(Py_NewRef(type));
     }
     else {
         PyErr_Restore(
@@ -80,20 +121,47 @@ awaitable_throw(PyObject *self, PyObject *args)
     }
 
     PyAwaitableObject *aw = (PyAwaitableObject *)self;
-    if ((aw->aw_gen != NULL) && (aw->aw_state != 0)) {
+    bool awaiting = false;
+    pyawaitable_callback *cb = NULL;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(self);
+    if (aw->aw_gen != NULL) {
+        awaiting = ((GenWrapperObject *)aw->aw_gen)->gw_current_await != NULL;
+        if (!awaiting && aw->aw_state != 0) {
+            cb = pyawaitable_array_GET_ITEM(
+                &aw->aw_callbacks,
+                aw->aw_state - 1
+            );
+        }
+    }
+    _PyAwaitable_END_CRITICAL_SECTION();
+
+    if (awaiting) {
+        // Let whatever we're awaiting handle it first
+        GenWrapperObject *gw = (GenWrapperObject *)aw->aw_gen;
+        assert(gw->gw_throw == NULL);
+        gw->gw_throw = PyErr_GetRaisedException();
+
+        PyObject *gen = Py_NewRef((PyObject *)gw);
+        PyObject *res = _PyAwaitableGenWrapper_Next(gen);
+        Py_DECREF(gen);
+        return res;
+    }
+    else if (cb != NULL) {
         GenWrapperObject *gw = (GenWrapperObject *)aw->aw_gen;
-        pyawaitable_callback *cb =
-            pyawaitable_array_GET_ITEM(&aw->aw_callbacks, aw->aw_state - 1);
-        if (cb == NULL) {
+        if (_PyAwaitableGenWrapper_FireErrCallback(self, cb) < 0) {
             return NULL;
         }
 
-        if (_PyAwaitableGenWrapper_FireErrCallback(
-            self,
-            cb->err_callback
-            ) < 0) {
-            return NULL;
+        // The error was handled, so keep going with the next callback
+        if (!_PyAwaitable_ATOMIC_LOAD_LONG(&aw->aw_recently_cancelled)) {
+            cb->done = true;
+            Py_CLEAR(cb->coro);
         }
+
+        PyObject *gen = Py_NewRef((PyObject *)gw);
+        PyObject *res = _PyAwaitableGenWrapper_Next(gen);
+        Py_DECREF(gen);
+        return res;
     }
     else {
         return NULL;
@@ -104,9 +172,19 @@ awaitable_throw(PyObject *self, PyObject *args)
 }
 
 #if PY_MINOR_VERSION > 9
-static PySendResult
-awaitable_am_send(PyObject *self, PyObject *arg, PyObject **presult)
+_PyAwaitable_INTERNAL(PySendResult)
+awaitable_am_send(PyObject * self, PyObject * arg, PyObject * *presult)
 {
+    PyAwaitableObject *aw = (PyAwaitableObject *) self;
+    if (PyAwaitable_LIKELY(aw->aw_gen != NULL)) {
+        if (check_running_send(arg) < 0) {
+            *presult = NULL;
+            return PYGEN_ERROR;
+        }
+
+        return (PySendResult)_PyAwaitableGenWrapper_Send(aw->aw_gen, presult);
+    }
+
     PyObject *send_res = awaitable_send_with_arg(self, arg);
     if (send_res == NULL) {
         if (PyErr_ExceptionMatches(PyExc_StopIteration)) {
@@ -137,12 +215,3 @@ _PyAwaitable_INTERNAL_DATA_DEF(PyMethodDef) pyawaitable_methods[] = {
     {"throw", awaitable_throw, METH_VARARGS, NULL},
     {NULL, NULL, 0, NULL}
 };
-
-_PyAwaitable_INTERNAL_DATA_DEF(PyAsyncMethods) pyawaitable_async_methods = {
-#if PY_MINOR_VERSION > 9
-    .am_await = awaitable_next,
-    .am_send = awaitable_am_send
-#else
-    .am_await = awaitable_next
-#endif
-};
@@ -0,0 +1,158 @@
+#include <Python.h>
+#include <pyawaitable/awaitableobject.h>
+#include <pyawaitable/backport.h>
+#include <pyawaitable/dist.h>
+#include <pyawaitable/driver.h>
+#include <pyawaitable/init.h>
+#include <pyawaitable/optimize.h>
+
+static const PyAwaitable_Driver pyawaitable_driver = {
+    .magic_version = PyAwaitable_MAGIC_NUMBER,
+    .size = sizeof(PyAwaitable_Driver),
+    .send = _PyAwaitable_Send
+};
+
+_PyAwaitable_INTERNAL(PyObject *)
+_PyAwaitable_NewDriverCapsule(void)
+{
+    return PyCapsule_New(
+        (void *)&pyawaitable_driver,
+        PyAwaitable_DRIVER_CAPSULE,
+        NULL
+    );
+}
+
+static PyObject *
+driver_get(PyObject *self, void *closure)
+{
+    pyawaitable_state *state = _PyAwaitable_GetState();
+    if (PyAwaitable_UNLIKELY(state == NULL)) {
+        return NULL;
+    }
+
+    return Py_NewRef(state->driver);
+}
+
+_PyAwaitable_INTERNAL_DATA_DEF(PyGetSetDef) pyawaitable_driver_getset[] = {
+    {PyAwaitable_DRIVER_ATTR, driver_get, NULL, NULL, NULL},
+    {NULL}
+};
+
+#define MISS_SLOT(cache, tag) \
+        (&(cache)->misses[(tag) % _PyAwaitable_DRIVER_CACHE_SIZE])
+
+/*
+ * Get the version tag of tp, or 0 if it doesn't have a valid one. Before
+ * 3.12, an invalidated tag is kept around, and only the flag is cleared.
+ */
+static inline unsigned int
+type_version_tag(PyTypeObject *tp)
+{
+#if PY_VERSION_HEX < 0x030c0000
+    if (!PyType_HasFeature(tp, Py_TPFLAGS_VALID_VERSION_TAG)) {
+        return 0;
+    }
+#endif
+    return tp->tp_version_tag;
+}
+
+/*
+ * Look up name on tp. Returns 1 and sets *result if it's there, 0 if it's
+ * missing, and -1 with an exception set if the lookup failed.
+ */
+static inline int
+lookup_type_attr(PyTypeObject *tp, PyObject *name, PyObject **result)
+{
+#if PY_VERSION_HEX >= 0x030c0000
+    return PyObject_GetOptionalAttr((PyObject *)tp, name, result);
+#else
+    // Missing attributes raise an AttributeError here, which is what makes
+    // the cache worth having.
+    *result = PyObject_GetAttr((PyObject *)tp, name);
+    if (*result != NULL) {
+        return 1;
+    }
+
+    if (PyErr_ExceptionMatches(PyExc_AttributeError)) {
+        PyErr_Clear();
+        return 0;
+    }
+
+    return -1;
+#endif
+}
+
+_PyAwaitable_INTERNAL(PyAwaitable_SendFunc)
+_PyAwaitable_FindDriver(
+    pyawaitable_driver_cache * cache,
+    PyObject * op,
+    PyObject * key
+)
+{
+    assert(cache != NULL);
+    assert(op != NULL);
+    assert(key != NULL);
+    PyTypeObject *tp = Py_TYPE(op);
+    // Every version with a driver uses heap types, so static types (such as
+    // coroutines) can be skipped without a lookup.
+    if (!PyType_HasFeature(tp, Py_TPFLAGS_HEAPTYPE)) {
+        return NULL;
+    }
+
+    unsigned int tag = type_version_tag(tp);
+    if (
+        tag != 0
+        && (unsigned int)_PyAwaitable_ATOMIC_LOAD_LONG(MISS_SLOT(cache, tag))
+        == tag
+    ) {
+        return NULL;
+    }
+
+    // This is looked up on the type, so that it can't run the object's
+    // __getattr__().
+    PyObject *descr;
+    int found = lookup_type_attr(tp, key, &descr);
+    if (found <= 0) {
+        PyErr_Clear();
+        if (found == 0) {
+            // The lookup gives the type a version tag if it didn't have one
+            tag = type_version_tag(tp);
+            (void)_PyAwaitable_ATOMIC_EXCHANGE_LONG(
+                MISS_SLOT(cache, tag),
+                (long)tag
+            );
+        }
+        return NULL;
+    }
+
+    // Our types have a getter, but a plain class attribute works too
+    descrgetfunc get = Py_TYPE(descr)->tp_descr_get;
+    PyObject *capsule = get != NULL
+                        ? get(descr, op, (PyObject *)tp)
+                        : Py_NewRef(descr);
+    Py_DECREF(descr);
+    if (PyAwaitable_UNLIKELY(capsule == NULL)) {
+        PyErr_Clear();
+        return NULL;
+    }
+
+    const PyAwaitable_Driver *driver = PyCapsule_GetPointer(
+        capsule,
+        PyAwaitable_DRIVER_CAPSULE
+    );
+    // The driver itself is static, so it outlives the capsule
+    Py_DECREF(capsule);
+    if (PyAwaitable_UNLIKELY(driver == NULL)) {
+        // Something else that happens to use the same attribute name
+        PyErr_Clear();
+        return NULL;
+    }
+
+    if (driver->size < sizeof(PyAwaitable_Driver)) {
+        return NULL;
+    }
+
+    return driver->send;
+}
+
+#undef MISS_SLOT
@@ -0,0 +1,1046 @@
+#include <Python.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <pyawaitable/awaitableobject.h>
+#include <pyawaitable/backport.h>
+#include <pyawaitable/capi.h>
+#include <pyawaitable/fileio.h>
+#include <pyawaitable/future.h>
+#include <pyawaitable/gather.h>
+#include <pyawaitable/init.h>
+#include <pyawaitable/io.h>
+#include <pyawaitable/optimize.h>
+#include <pyawaitable/values.h>
+
+#ifndef _WIN32
+#  include <unistd.h>
+#endif
+
+#ifdef __linux__
+#  include <sys/sendfile.h>
+#endif
+
+#ifdef _PyAwaitable_HAVE_IO_URING
+#  include <sys/eventfd.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#endif
+
+#define PYAWAITABLE_FILEIO_CAPSULE "pyawaitable.fileio"
+/* Number of submission queue entries in the ring */
+#define _PyAwaitable_RING_ENTRIES 256
+
+#ifndef _WIN32
+static void
+fileio_op_release(pyawaitable_fileio_op *op)
+{
+    if (_PyAwaitable_ATOMIC_ADD_LONG(&op->refcount, -1) == 1) {
+#ifdef _PyAwaitable_HAVE_IO_URING
+        assert(op->future == NULL);
+#endif
+        PyMem_RawFree(op);
+    }
+}
+
+/* Run the operation on a worker thread */
+static void
+fileio_op_run(pyawaitable_job *job)
+{
+    pyawaitable_fileio_op *op = (pyawaitable_fileio_op *)job;
+    PyAwaitable_Future *future = op->pool_future;
+    Py_ssize_t res;
+    do {
+        res = op->writing
+            ? (Py_ssize_t)pwrite(op->fd, op->data, op->size, op->offset)
+            : (Py_ssize_t)pread(op->fd, op->data, op->size, op->offset);
+    } while (res < 0 && errno == EINTR);
+    op->result = res < 0 ? -errno : res;
+    PyAwaitable_Complete(future, op);
+    fileio_op_release(op);
+}
+
+static void
+fileio_op_discard(pyawaitable_job *job)
+{
+    fileio_op_release((pyawaitable_fileio_op *)job);
+}
+
+#ifdef _PyAwaitable_HAVE_IO_URING
+static int
+fileio_ring_enter(pyawaitable_ring *ring, unsigned to_submit)
+{
+    return (int)syscall(
+        __NR_io_uring_enter,
+        ring->ring_fd,
+        to_submit,
+        0,
+        0,
+        NULL,
+        0
+    );
+}
+
+static void
+fileio_ring_free(pyawaitable_ring *ring)
+{
+    if (ring->sqes != NULL) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ptr != NULL && ring->cq_ptr != ring->sq_ptr) {
+        munmap(ring->cq_ptr, ring->cq_size);
+    }
+    if (ring->sq_ptr != NULL) {
+        munmap(ring->sq_ptr, ring->sq_size);
+    }
+    if (ring->event_fd >= 0) {
+        close(ring->event_fd);
+    }
+    if (ring->ring_fd >= 0) {
+        close(ring->ring_fd);
+    }
+    Py_XDECREF(ring->loop);
+    PyMem_Free(ring);
+}
+
+/*
+ * Set up a ring, or return NULL without an exception set if the kernel
+ * (or a seccomp filter) won't give us one.
+ */
+static pyawaitable_ring *
+fileio_ring_new(void)
+{
+    pyawaitable_ring *ring = PyMem_Calloc(1, sizeof(pyawaitable_ring));
+    if (ring == NULL) {
+        return NULL;
+    }
+
+    ring->event_fd = -1;
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->ring_fd = (int)syscall(
+        __NR_io_uring_setup,
+        _PyAwaitable_RING_ENTRIES,
+        &params
+    );
+    if (ring->ring_fd < 0) {
+        fileio_ring_free(ring);
+        return NULL;
+    }
+
+    ring->entries = params.sq_entries;
+    ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_size = params.cq_off.cqes
+        + params.cq_entries * sizeof(struct io_uring_cqe);
+    int single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        ring->sq_size = Py_MAX(ring->sq_size, ring->cq_size);
+    }
+
+    void *sq_ptr = mmap(
+        NULL,
+        ring->sq_size,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        ring->ring_fd,
+        IORING_OFF_SQ_RING
+    );
+    if (sq_ptr == MAP_FAILED) {
+        fileio_ring_free(ring);
+        return NULL;
+    }
+    ring->sq_ptr = sq_ptr;
+
+    if (single_mmap) {
+        ring->cq_ptr = sq_ptr;
+    } else {
+        void *cq_ptr = mmap(
+            NULL,
+            ring->cq_size,
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE,
+            ring->ring_fd,
+            IORING_OFF_CQ_RING
+        );
+        if (cq_ptr == MAP_FAILED) {
+            fileio_ring_free(ring);
+            return NULL;
+        }
+        ring->cq_ptr = cq_ptr;
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes = mmap(
+        NULL,
+        ring->sqes_size,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        ring->ring_fd,
+        IORING_OFF_SQES
+    );
+    if (sqes == MAP_FAILED) {
+        fileio_ring_free(ring);
+        return NULL;
+    }
+    ring->sqes = sqes;
+
+    char *sq = ring->sq_ptr;
+    char *cq = ring->cq_ptr;
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    // Completions are signalled through an eventfd, so a single wakeup of
+    // the loop can reap all of them.
+    ring->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (
+        ring->event_fd < 0
+        || syscall(
+            __NR_io_uring_register,
+            ring->ring_fd,
+            IORING_REGISTER_EVENTFD,
+            &ring->event_fd,
+            1
+        ) < 0
+    ) {
+        fileio_ring_free(ring);
+        return NULL;
+    }
+
+    return ring;
+}
+
+static pyawaitable_fileio *
+get_fileio_state(void);
+
+/* Called by the event loop once the ring has completions */
+static PyObject *
+fileio_reap(PyObject *self, PyObject *unused)
+{
+    pyawaitable_fileio *fileio = get_fileio_state();
+    if (PyAwaitable_UNLIKELY(fileio == NULL)) {
+        return NULL;
+    }
+
+    pyawaitable_ring *ring = fileio->ring;
+    assert(ring != NULL);
+    uint64_t value;
+    if (read(ring->event_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+        return PyErr_SetFromErrno(PyExc_OSError);
+    }
+
+    // The ring is shared by every thread in the interpreter
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(fileio->reap);
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+        pyawaitable_fileio_op *op = (pyawaitable_fileio_op *)(uintptr_t)
+                                    cqe->user_data;
+        op->result = cqe->res;
+        --ring->inflight;
+
+        if (
+            _PyAwaitable_ResolveFuture(op->future, "set_result", Py_None) < 0
+        ) {
+            PyErr_WriteUnraisable(op->future);
+        }
+        Py_CLEAR(op->future);
+        fileio_op_release(op);
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    _PyAwaitable_END_CRITICAL_SECTION();
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef fileio_reap_def = {
+    "_pyawaitable_fileio_reap",
+    fileio_reap,
+    METH_NOARGS,
+    NULL
+};
+
+/*
+ * Make sure that loop watches the ring's eventfd. The ring can only move to
+ * another loop once nothing is in flight. Returns 1 if the ring can't be
+ * used with this loop. This must be called in a critical section on the
+ * reaper.
+ */
+static int
+fileio_ring_bind(pyawaitable_fileio *fileio, PyObject *loop)
+{
+    pyawaitable_ring *ring = fileio->ring;
+    if (ring->loop == loop) {
+        return 0;
+    }
+
+    if (ring->inflight != 0) {
+        return 1;
+    }
+
+    if (ring->loop != NULL) {
+        PyObject *res = PyObject_CallMethod(
+            ring->loop,
+            "remove_reader",
+            "i",
+            ring->event_fd
+        );
+        if (res == NULL) {
+            // The old loop is most likely closed, which already forgot
+            // about the eventfd.
+            PyErr_Clear();
+        }
+        Py_XDECREF(res);
+        Py_CLEAR(ring->loop);
+    }
+
+    PyObject *res = PyObject_CallMethod(
+        loop,
+        "add_reader",
+        "iO",
+        ring->event_fd,
+        fileio->reap
+    );
+    if (res == NULL) {
+        if (PyErr_ExceptionMatches(PyExc_NotImplementedError)) {
+            // The loop can't watch file descriptors
+            PyErr_Clear();
+            return 1;
+        }
+        return -1;
+    }
+
+    Py_DECREF(res);
+    ring->loop = Py_NewRef(loop);
+    return 0;
+}
+
+/*
+ * Put the operation in the ring. Returns 1 if the ring can't take it right
+ * now.
+ */
+static int
+fileio_ring_submit(pyawaitable_ring *ring, pyawaitable_fileio_op *op)
+{
+    if (ring->inflight >= ring->entries) {
+        return 1;
+    }
+
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    // The vectored opcodes work on every kernel that has io_uring
+    sqe->opcode = op->writing ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->fd = op->fd;
+    sqe->off = (uint64_t)op->offset;
+    sqe->addr = (uint64_t)(uintptr_t)&op->iov;
+    sqe->len = 1;
+    sqe->user_data = (uint64_t)(uintptr_t)op;
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    int res;
+    do {
+        res = fileio_ring_enter(ring, 1);
+    } while (res < 0 && errno == EINTR);
+
+    if (res < 1) {
+        // The kernel didn't take it, so take it back
+        __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+        return 1;
+    }
+
+    ++ring->inflight;
+    return 0;
+}
+
+static int
+fileio_ring_done(PyObject *inner, PyObject *unused, void *arg);
+
+/*
+ * Try to run the operation through the ring. Returns 1 if it has to fall
+ * back to the pool instead.
+ */
+static int
+fileio_try_ring(
+    pyawaitable_fileio *fileio,
+    PyObject *inner,
+    pyawaitable_fileio_op *op
+)
+{
+    if (fileio->ring == NULL) {
+        return 1;
+    }
+
+    PyObject *loop = PyObject_CallNoArgs(fileio->get_running_loop);
+    if (loop == NULL) {
+        return -1;
+    }
+
+    PyObject *future = PyObject_CallMethod(loop, "create_future", NULL);
+    if (future == NULL) {
+        Py_DECREF(loop);
+        return -1;
+    }
+
+    int res;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(fileio->reap);
+    res = fileio_ring_bind(fileio, loop);
+    if (res == 0) {
+        // The ring's reference is taken up front, since it can complete
+        // on another thread as soon as it's submitted.
+        op->future = Py_NewRef(future);
+        _PyAwaitable_ATOMIC_ADD_LONG(&op->refcount, 1);
+        res = fileio_ring_submit(fileio->ring, op);
+        if (res != 0) {
+            Py_CLEAR(op->future);
+            _PyAwaitable_ATOMIC_ADD_LONG(&op->refcount, -1);
+        }
+    }
+    _PyAwaitable_END_CRITICAL_SECTION();
+    Py_DECREF(loop);
+
+    if (res != 0) {
+        Py_DECREF(future);
+        return res;
+    }
+
+    // If this fails, the reaper still owns the operation
+    res = PyAwaitable_AddAwaitEx(inner, future, fileio_ring_done, NULL, op);
+    Py_DECREF(future);
+    return res;
+}
+#endif
+
+/* Raise the operation's error, or call back with its result */
+static int
+fileio_deliver(PyObject *inner, pyawaitable_fileio_op *op)
+{
+    if (op->result < 0) {
+        errno = (int)-op->result;
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+
+    if (!op->writing && op->result != 0) {
+        // The step is still running, so the caller's buffer is still valid
+        memcpy(op->buffer, op->data, (size_t)op->result);
+    }
+
+    if (op->cb == NULL) {
+        return 0;
+    }
+
+    PyObject *awaitable = PyAwaitable_GetArbValue(inner, 0);
+    if (awaitable == NULL) {
+        return -1;
+    }
+
+    return op->cb(awaitable, op->result);
+}
+
+#ifdef _PyAwaitable_HAVE_IO_URING
+static int
+fileio_ring_done(PyObject *inner, PyObject *unused, void *arg)
+{
+    return fileio_deliver(inner, (pyawaitable_fileio_op *)arg);
+}
+#endif
+
+static int
+fileio_pool_done(PyObject *inner, void *arg, void *result)
+{
+    return fileio_deliver(inner, (pyawaitable_fileio_op *)arg);
+}
+
+static void
+fileio_capsule_destructor(PyObject *capsule)
+{
+    pyawaitable_fileio_op *op = PyCapsule_GetPointer(
+        capsule,
+        PYAWAITABLE_FILEIO_CAPSULE
+    );
+    if (op == NULL) {
+        PyErr_WriteUnraisable(capsule);
+        return;
+    }
+
+    fileio_op_release(op);
+}
+
+static void
+fileio_free(pyawaitable_fileio *fileio)
+{
+    assert(fileio != NULL);
+    Py_XDECREF(fileio->get_running_loop);
+    Py_XDECREF(fileio->reap);
+#ifdef _PyAwaitable_HAVE_IO_URING
+    if (fileio->ring != NULL) {
+        // Anything still in flight is leaked, since the kernel might
+        // still write to it.
+        fileio_ring_free(fileio->ring);
+    }
+#endif
+    PyMem_Free(fileio);
+}
+
+static pyawaitable_fileio *
+fileio_new_state(void)
+{
+    pyawaitable_fileio *fileio = PyMem_Malloc(sizeof(pyawaitable_fileio));
+    if (fileio == NULL) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    fileio->free = fileio_free;
+    fileio->get_running_loop = NULL;
+    fileio->reap = NULL;
+    fileio->ring = NULL;
+
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (asyncio == NULL) {
+        fileio_free(fileio);
+        return NULL;
+    }
+
+    fileio->get_running_loop = PyObject_GetAttrString(
+        asyncio,
+        "get_running_loop"
+    );
+    Py_DECREF(asyncio);
+    if (fileio->get_running_loop == NULL) {
+        fileio_free(fileio);
+        return NULL;
+    }
+
+#ifdef _PyAwaitable_HAVE_IO_URING
+    fileio->reap = PyCFunction_New(&fileio_reap_def, NULL);
+    if (fileio->reap == NULL) {
+        fileio_free(fileio);
+        return NULL;
+    }
+
+    // Without a ring, everything goes to the pool
+    fileio->ring = fileio_ring_new();
+    if (fileio->ring == NULL && PyErr_Occurred()) {
+        fileio_free(fileio);
+        return NULL;
+    }
+#endif
+
+    return fileio;
+}
+
+#endif
+
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_FileIOFree(pyawaitable_fileio *fileio)
+{
+    assert(fileio != NULL);
+    // The ring can only be freed by the copy that created it
+    fileio->free(fileio);
+}
+
+#ifndef _WIN32
+static pyawaitable_fileio *
+get_fileio_state(void)
+{
+    _PyAwaitable_LAZY_STATE(fileio, fileio_new_state, _PyAwaitable_FileIOFree);
+}
+
+/* Hand the operation to the ring, or to the pool if the ring can't take it */
+static int
+fileio_start(PyObject *inner)
+{
+    PyObject *capsule = PyAwaitable_GetValue(inner, 0);
+    if (capsule == NULL) {
+        return -1;
+    }
+
+    pyawaitable_fileio_op *op = PyCapsule_GetPointer(
+        capsule,
+        PYAWAITABLE_FILEIO_CAPSULE
+    );
+    if (op == NULL) {
+        return -1;
+    }
+
+    pyawaitable_fileio *fileio = get_fileio_state();
+    if (PyAwaitable_UNLIKELY(fileio == NULL)) {
+        return -1;
+    }
+
+#ifdef _PyAwaitable_HAVE_IO_URING
+    int res = fileio_try_ring(fileio, inner, op);
+    if (res <= 0) {
+        return res;
+    }
+#endif
+
+    // The job owns a reference, which it drops once it's done
+    _PyAwaitable_ATOMIC_ADD_LONG(&op->refcount, 1);
+    PyAwaitable_Future *future = _PyAwaitable_AddJobFuture(
+        inner,
+        fileio_pool_done,
+        op,
+        &op->job
+    );
+    if (future == NULL) {
+        _PyAwaitable_ATOMIC_ADD_LONG(&op->refcount, -1);
+        return -1;
+    }
+
+    // Nothing runs the job until this step is over
+    op->pool_future = future;
+    return 0;
+}
+#endif
+
+static int
+add_fileio_step(
+    PyObject *awaitable,
+    int fd,
+    void *buffer,
+    Py_ssize_t size,
+    long long offset,
+    PyAwaitable_SizeCallback cb,
+    int writing
+)
+{
+#ifdef _WIN32
+    PyErr_SetString(
+        PyExc_NotImplementedError,
+        "PyAwaitable: Positional file I/O is not supported on Windows"
+    );
+    return -1;
+#else
+    if (fd < 0) {
+        PyErr_Format(
+            PyExc_ValueError,
+            "PyAwaitable: Invalid file descriptor: %d",
+            fd
+        );
+        return -1;
+    }
+
+    if (size < 0 || (buffer == NULL && size != 0)) {
+        PyErr_SetString(PyExc_ValueError, "PyAwaitable: Invalid buffer");
+        return -1;
+    }
+
+    if (offset < 0) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "PyAwaitable: Offset cannot be negative"
+        );
+        return -1;
+    }
+
+    pyawaitable_fileio_op *op = PyMem_RawMalloc(
+        offsetof(pyawaitable_fileio_op, data) + (size_t)size
+    );
+    if (op == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    op->job.next = NULL;
+    op->job.prev = NULL;
+    op->job.run = fileio_op_run;
+    op->job.discard = fileio_op_discard;
+    op->pool_future = NULL;
+    op->refcount = 1;
+    op->fd = fd;
+    op->writing = writing;
+    op->size = size;
+    op->offset = offset;
+    op->cb = cb;
+    op->result = 0;
+    if (writing) {
+        // The caller's buffer only has to last until we return
+        op->buffer = NULL;
+        if (size != 0) {
+            memcpy(op->data, buffer, (size_t)size);
+        }
+    }
+    else {
+        op->buffer = buffer;
+    }
+#ifdef _PyAwaitable_HAVE_IO_URING
+    op->iov.iov_base = op->data;
+    op->iov.iov_len = (size_t)size;
+    op->future = NULL;
+#endif
+
+    PyObject *capsule = PyCapsule_New(
+        op,
+        PYAWAITABLE_FILEIO_CAPSULE,
+        fileio_capsule_destructor
+    );
+    if (capsule == NULL) {
+        PyMem_RawFree(op);
+        return -1;
+    }
+
+    PyObject *inner = _PyAwaitable_NewInner(awaitable);
+    if (inner == NULL) {
+        Py_DECREF(capsule);
+        return -1;
+    }
+
+    if (PyAwaitable_SaveValues(inner, 1, capsule) < 0) {
+        Py_DECREF(capsule);
+        PyAwaitable_Cancel(inner);
+        Py_DECREF(inner);
+        return -1;
+    }
+    Py_DECREF(capsule);
+
+    // Which way the operation goes depends on the loop that runs it
+    if (
+        PyAwaitable_DeferAwait(inner, fileio_start) < 0
+        || PyAwaitable_AddAwait(awaitable, inner, NULL, NULL) < 0
+    ) {
+        PyAwaitable_Cancel(inner);
+        Py_DECREF(inner);
+        return -1;
+    }
+
+    Py_DECREF(inner);
+    return 0;
+#endif
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_AddPread(
+    PyObject * awaitable,
+    int fd,
+    void *buffer,
+    Py_ssize_t size,
+    long long offset,
+    PyAwaitable_SizeCallback cb
+)
+{
+    _PyAwaitable_FORWARD(
+        -1,
+        AddPread(awaitable, fd, buffer, size, offset, cb)
+    );
+    return add_fileio_step(awaitable, fd, buffer, size, offset, cb, 0);
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_AddPwrite(
+    PyObject * awaitable,
+    int fd,
+    const void *buffer,
+    Py_ssize_t size,
+    long long offset,
+    PyAwaitable_SizeCallback cb
+)
+{
+    _PyAwaitable_FORWARD(
+        -1,
+        AddPwrite(awaitable, fd, buffer, size, offset, cb)
+    );
+    return add_fileio_step(
+        awaitable,
+        fd,
+        (void *)buffer,
+        size,
+        offset,
+        cb,
+        1
+    );
+}
+
+/*
+ * A step that copies from a file to an fd (usually a socket), waiting on
+ * the loop whenever the fd would block.
+ */
+typedef struct _pyawaitable_sendfile {
+    pyawaitable_watch watch;
+    PyAwaitable_SizeCallback cb;
+    int in_fd;
+    /* Offset in in_fd of the next byte to read */
+    long long offset;
+    /* Number of bytes that haven't been read from in_fd yet */
+    long long remaining;
+    /* Number of bytes that were written to the fd */
+    Py_ssize_t sent;
+    /*
+     * Bounce buffer, only allocated if sendfile() isn't usable, along with
+     * the range of it that hasn't been written yet.
+     */
+    char *copy;
+    Py_ssize_t copy_start;
+    Py_ssize_t copy_end;
+} _PyAwaitable_MANGLE(pyawaitable_sendfile);
+
+#ifndef _WIN32
+/* Size of the bounce buffer, and the most that's read into it at once */
+#define _PyAwaitable_SENDFILE_COPY 65536
+
+static void
+sendfile_free(pyawaitable_watch *watch)
+{
+    pyawaitable_sendfile *step = (pyawaitable_sendfile *)watch;
+    PyMem_Free(step->copy);
+    PyMem_Free(step);
+}
+
+/*
+ * Copy through the bounce buffer with pread() and write(). Returns 1 if
+ * the fd would block, 0 once everything was sent, and -1 on failure.
+ */
+static int
+sendfile_copy(pyawaitable_sendfile *step)
+{
+    if (step->copy == NULL) {
+        step->copy = PyMem_Malloc(_PyAwaitable_SENDFILE_COPY);
+        if (step->copy == NULL) {
+            PyErr_NoMemory();
+            return -1;
+        }
+    }
+
+    for (;;) {
+        if (step->copy_start == step->copy_end) {
+            if (step->remaining == 0) {
+                return 0;
+            }
+
+            size_t want = _PyAwaitable_SENDFILE_COPY;
+            if (step->remaining < (long long)want) {
+                want = (size_t)step->remaining;
+            }
+
+            Py_ssize_t n = (Py_ssize_t)pread(
+                step->in_fd,
+                step->copy,
+                want,
+                (off_t)step->offset
+            );
+            if (n == 0) {
+                // EOF
+                step->remaining = 0;
+                return 0;
+            }
+
+            if (n < 0) {
+                if (errno == EINTR) {
+                    if (PyErr_CheckSignals() < 0) {
+                        return -1;
+                    }
+                    continue;
+                }
+
+                PyErr_SetFromErrno(PyExc_OSError);
+                return -1;
+            }
+
+            step->offset += n;
+            step->remaining -= n;
+            step->copy_start = 0;
+            step->copy_end = n;
+        }
+
+        Py_ssize_t n = (Py_ssize_t)write(
+            step->watch.fd,
+            step->copy + step->copy_start,
+            (size_t)(step->copy_end - step->copy_start)
+        );
+        if (n >= 0) {
+            step->copy_start += n;
+            step->sent += n;
+            continue;
+        }
+
+        if (errno == EINTR) {
+            if (PyErr_CheckSignals() < 0) {
+                return -1;
+            }
+            continue;
+        }
+
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 1;
+        }
+
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+}
+
+#ifdef __linux__
+/* Like sendfile_copy(), but the data never leaves the kernel */
+static int
+sendfile_kernel(pyawaitable_sendfile *step)
+{
+    while (step->remaining > 0) {
+        off_t offset = (off_t)step->offset;
+        size_t want = SSIZE_MAX;
+        if (step->remaining < (long long)want) {
+            want = (size_t)step->remaining;
+        }
+
+        Py_ssize_t n = (Py_ssize_t)sendfile(
+            step->watch.fd,
+            step->in_fd,
+            &offset,
+            want
+        );
+        if (n > 0) {
+            step->offset += n;
+            step->remaining -= n;
+            step->sent += n;
+            continue;
+        }
+
+        if (n == 0) {
+            // EOF
+            step->remaining = 0;
+            break;
+        }
+
+        if (errno == EINTR) {
+            if (PyErr_CheckSignals() < 0) {
+                return -1;
+            }
+            continue;
+        }
+
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 1;
+        }
+
+        if (step->sent == 0 && (errno == EINVAL || errno == ENOSYS)) {
+            // These fds can't be used with sendfile()
+            return sendfile_copy(step);
+        }
+
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+
+    return 0;
+}
+#endif
+
+/*
+ * Send as much as the fd takes, and only wait on the loop once it would
+ * block.
+ */
+static int
+sendfile_fill(PyObject *inner, pyawaitable_watch *watch)
+{
+    pyawaitable_sendfile *step = (pyawaitable_sendfile *)watch;
+#ifdef __linux__
+    int res = step->copy == NULL ? sendfile_kernel(step) : sendfile_copy(step);
+#else
+    int res = sendfile_copy(step);
+#endif
+    if (res < 0) {
+        return -1;
+    }
+
+    if (res == 1) {
+        return _PyAwaitable_WatchWait(inner);
+    }
+
+    if (step->cb == NULL) {
+        return 0;
+    }
+
+    PyObject *awaitable = PyAwaitable_GetArbValue(inner, 0);
+    if (awaitable == NULL) {
+        return -1;
+    }
+
+    return step->cb(awaitable, step->sent);
+}
+
+static int
+sendfile_start(PyObject *inner)
+{
+    pyawaitable_watch *watch = _PyAwaitable_GetWatch(inner);
+    if (watch == NULL) {
+        return -1;
+    }
+
+    return sendfile_fill(inner, watch);
+}
+#endif
+
+_PyAwaitable_API(int)
+PyAwaitable_AddSendfile(
+    PyObject * awaitable,
+    int out_fd,
+    int in_fd,
+    long long offset,
+    long long count,
+    PyAwaitable_SizeCallback cb
+)
+{
+    _PyAwaitable_FORWARD(
+        -1,
+        AddSendfile(awaitable, out_fd, in_fd, offset, count, cb)
+    );
+#ifdef _WIN32
+    PyErr_SetString(
+        PyExc_NotImplementedError,
+        "PyAwaitable: Sending files is not supported on Windows"
+    );
+    return -1;
+#else
+    if (out_fd < 0 || in_fd < 0) {
+        PyErr_Format(
+            PyExc_ValueError,
+            "PyAwaitable: Invalid file descriptor: %d",
+            out_fd < 0 ? out_fd : in_fd
+        );
+        return -1;
+    }
+
+    if (offset < 0) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "PyAwaitable: Offset cannot be negative"
+        );
+        return -1;
+    }
+
+    if (count < 0) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "PyAwaitable: Count cannot be negative"
+        );
+        return -1;
+    }
+
+    pyawaitable_sendfile *step = PyMem_Malloc(sizeof(pyawaitable_sendfile));
+    if (step == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    step->watch.ready = sendfile_fill;
+    step->watch.free = sendfile_free;
+    step->watch.fd = out_fd;
+    step->watch.writable = 1;
+    step->cb = cb;
+    step->in_fd = in_fd;
+    step->offset = offset;
+    step->remaining = count;
+    step->sent = 0;
+    step->copy = NULL;
+    step->copy_start = 0;
+    step->copy_end = 0;
+    return _PyAwaitable_AddWatchStep(awaitable, &step->watch, sendfile_start);
+#endif
+}
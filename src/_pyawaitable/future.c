@@ -0,0 +1,797 @@
+#include <Python.h>
+#include <pythread.h>
+#include <stdint.h>
+
+#include <pyawaitable/array.h>
+#include <pyawaitable/awaitableobject.h>
+#include <pyawaitable/backport.h>
+#include <pyawaitable/capi.h>
+#include <pyawaitable/future.h>
+#include <pyawaitable/gate.h>
+#include <pyawaitable/gather.h>
+#include <pyawaitable/init.h>
+#include <pyawaitable/optimize.h>
+#include <pyawaitable/pool.h>
+#include <pyawaitable/soon.h>
+#include <pyawaitable/values.h>
+
+#ifndef _WIN32
+#  include <errno.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+#ifdef __linux__
+#  include <sys/eventfd.h>
+#endif
+
+#define PYAWAITABLE_FUTURE_CAPSULE "pyawaitable.future"
+#define PYAWAITABLE_HUB_CAPSULE "pyawaitable.hub"
+static void
+hub_close_fds(pyawaitable_hub *hub)
+{
+#ifndef _WIN32
+    if (hub->read_fd != -1) {
+        close(hub->read_fd);
+    }
+    if (hub->write_fd != -1 && hub->write_fd != hub->read_fd) {
+        close(hub->write_fd);
+    }
+#endif
+    hub->read_fd = -1;
+    hub->write_fd = -1;
+}
+
+/* Free a hub that has no references left. This needs the GIL. */
+static void
+hub_free(pyawaitable_hub *hub)
+{
+    // Nothing can complete onto this hub anymore. Its loop is either closed
+    // or going away with the interpreter, so it isn't watching the fd.
+    assert(_PyAwaitable_ATOMIC_LOAD_PTR(&hub->head) == NULL);
+    hub_close_fds(hub);
+    Py_CLEAR(hub->loop);
+    _PyAwaitable_GateRelease(hub->gate);
+    PyMem_RawFree(hub);
+}
+
+/* This must be called with the GIL held */
+static void
+hub_release(pyawaitable_hub *hub)
+{
+    if (_PyAwaitable_ATOMIC_ADD_LONG(&hub->refcount, -1) != 1) {
+        return;
+    }
+
+    hub_free(hub);
+}
+
+/*
+ * Drop a reference to the future. The last one might be dropped without
+ * the GIL, but only if the future never started waiting, in which case
+ * there's nothing that needs it.
+ */
+static void
+future_release(PyAwaitable_Future *future)
+{
+    if (_PyAwaitable_ATOMIC_ADD_LONG(&future->refcount, -1) != 1) {
+        return;
+    }
+
+    assert(future->py_future == NULL);
+    if (future->hub != NULL) {
+        hub_release(future->hub);
+    }
+    if (future->free_result != NULL) {
+        future->free_result(future->result);
+    }
+    PyMem_RawFree(future);
+}
+
+/* Tell the asyncio future that the C future is done */
+static int
+future_resolve(PyAwaitable_Future *future)
+{
+    if (future->py_future == NULL) {
+        // The step went away
+        return 0;
+    }
+
+    int res = _PyAwaitable_ResolveFuture(
+        future->py_future,
+        "set_result",
+        Py_None
+    );
+    return res < 0 ? -1 : 0;
+}
+
+/* Resolve everything that has been completed onto the hub */
+static void
+hub_drain(pyawaitable_hub *hub)
+{
+#ifndef _WIN32
+    if (hub->read_fd != -1) {
+        // Read before taking the queue, so that anything pushed after we
+        // take it will wake us up again.
+        char buffer[64];
+        while (read(hub->read_fd, buffer, sizeof(buffer)) > 0) {
+            // An eventfd is read all at once; a pipe might need a few
+        }
+    }
+#endif
+
+    PyAwaitable_Future *future = _PyAwaitable_ATOMIC_EXCHANGE_PTR(
+        &hub->head,
+        NULL
+    );
+
+    // The stack is newest first, so flip it to resolve them in order
+    PyAwaitable_Future *ordered = NULL;
+    while (future != NULL) {
+        PyAwaitable_Future *next = future->next;
+        future->next = ordered;
+        ordered = future;
+        future = next;
+    }
+
+    while (ordered != NULL) {
+        PyAwaitable_Future *next = ordered->next;
+        if (future_resolve(ordered) < 0) {
+            PyErr_WriteUnraisable(hub->loop);
+        }
+        // This was the completer's reference
+        future_release(ordered);
+        ordered = next;
+    }
+}
+
+/* Called by the event loop once the hub's fd is readable */
+static PyObject *
+hub_drain_callback(PyObject *self, PyObject *capsule)
+{
+    pyawaitable_hub *hub = PyCapsule_GetPointer(
+        capsule,
+        PYAWAITABLE_HUB_CAPSULE
+    );
+    if (hub == NULL) {
+        return NULL;
+    }
+
+    hub_drain(hub);
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef hub_drain_def = {
+    "_pyawaitable_drain_completions",
+    hub_drain_callback,
+    METH_O,
+    NULL
+};
+
+/* Called through PyAwaitable_CallSoonThreadsafe(), if there's no fd */
+static int
+hub_drain_soon(void *arg)
+{
+    hub_drain((pyawaitable_hub *)arg);
+    return 0;
+}
+
+static void
+hub_call_drain_soon(pyawaitable_hub *hub)
+{
+    if (PyAwaitable_CallSoonThreadsafe(hub->loop, hub_drain_soon, hub) < 0) {
+        // Most likely, the event loop was closed
+        PyErr_WriteUnraisable(hub->loop);
+    }
+}
+
+/*
+ * Call func with a thread state of the hub's interpreter, from a thread
+ * that might not have one. The caller must keep the gate alive, since func
+ * might free the hub.
+ *
+ * Returns 0 without calling func if the interpreter is exiting, in which
+ * case its loops won't run again.
+ */
+static int
+hub_run_threadsafe(
+    pyawaitable_hub *hub,
+    pyawaitable_gate *gate,
+    void (*func)(pyawaitable_hub *)
+)
+{
+    int ran = 0;
+#if PY_VERSION_HEX >= 0x030c0000
+    // This is the calling thread's own thread state, if it has one
+#  if PY_VERSION_HEX >= 0x030d0000
+    PyThreadState *saved = PyThreadState_GetUnchecked();
+#  else
+    PyThreadState *saved = _PyThreadState_UncheckedGet();
+#  endif
+    if (saved != NULL && PyThreadState_GetInterpreter(saved) == gate->interp) {
+        if (_PyAwaitable_GateEnter(gate)) {
+            func(hub);
+            _PyAwaitable_GateLeave(gate);
+            ran = 1;
+        }
+    }
+    else {
+        if (saved != NULL) {
+            (void)PyEval_SaveThread();
+        }
+        PyThreadState *tstate = _PyAwaitable_GateAttach(gate);
+        if (tstate != NULL) {
+            func(hub);
+            _PyAwaitable_GateDetach(gate, tstate);
+            ran = 1;
+        }
+        if (saved != NULL) {
+            PyEval_RestoreThread(saved);
+        }
+    }
+#else
+    // Before 3.12, there's no way to get the calling thread's own thread
+    // state, only whichever one holds the GIL.
+    if (gate->interp == PyInterpreterState_Main()) {
+        if (_PyAwaitable_GateEnter(gate)) {
+            // The GIL state API only works with the main interpreter, but
+            // it does know whether this thread already holds the GIL.
+            PyGILState_STATE gil = PyGILState_Ensure();
+            func(hub);
+            PyGILState_Release(gil);
+            _PyAwaitable_GateLeave(gate);
+            ran = 1;
+        }
+    }
+    else {
+        // Subinterpreters have to be completed from threads without a
+        // thread state, which the thread pool's workers are.
+        PyThreadState *tstate = _PyAwaitable_GateAttach(gate);
+        if (tstate != NULL) {
+            func(hub);
+            _PyAwaitable_GateDetach(gate, tstate);
+            ran = 1;
+        }
+    }
+#endif
+    return ran;
+}
+
+/*
+ * Same as hub_release(), but from any thread. If the interpreter is
+ * exiting, the loop is leaked along with it.
+ */
+static void
+hub_release_threadsafe(pyawaitable_hub *hub)
+{
+    if (_PyAwaitable_ATOMIC_ADD_LONG(&hub->refcount, -1) != 1) {
+        return;
+    }
+
+    // Freeing the hub drops its reference to the gate, which we're using
+    pyawaitable_gate *gate = hub->gate;
+    _PyAwaitable_ATOMIC_ADD_LONG(&gate->refcount, 1);
+    if (!hub_run_threadsafe(hub, gate, hub_free)) {
+        hub_close_fds(hub);
+        _PyAwaitable_GateRelease(hub->gate);
+        PyMem_RawFree(hub);
+    }
+    _PyAwaitable_GateRelease(gate);
+}
+
+static void
+hub_wakeup(pyawaitable_hub *hub)
+{
+#ifndef _WIN32
+    if (hub->write_fd != -1) {
+#ifdef __linux__
+        uint64_t one = 1;
+        ssize_t res = write(hub->write_fd, &one, sizeof(one));
+#else
+        char one = 1;
+        ssize_t res = write(hub->write_fd, &one, sizeof(one));
+#endif
+        // A full pipe already has a wakeup pending
+        assert(res > 0 || errno == EAGAIN || errno == EWOULDBLOCK);
+        (void)res;
+        return;
+    }
+#endif
+    // If the interpreter is exiting, the loop won't run again, and what's
+    // left on the hub is leaked along with it.
+    (void)hub_run_threadsafe(hub, hub->gate, hub_call_drain_soon);
+}
+
+static void
+future_complete(PyAwaitable_Future *future, void *result)
+{
+    future->result = result;
+    long previous = _PyAwaitable_ATOMIC_EXCHANGE_LONG(
+        &future->state,
+        _PyAwaitable_FUTURE_DONE
+    );
+    assert(previous != _PyAwaitable_FUTURE_DONE);
+    if (previous == _PyAwaitable_FUTURE_PENDING) {
+        // The step will see that we're done once it starts
+        future_release(future);
+        return;
+    }
+
+    // Our reference goes to the hub. Once the future is pushed, the loop
+    // can free it at any time, so only the hub may be used afterwards. The
+    // loop can also drop the future's reference to the hub, so we need our
+    // own until the wakeup is done.
+    pyawaitable_hub *hub = future->hub;
+    _PyAwaitable_ATOMIC_ADD_LONG(&hub->refcount, 1);
+    PyAwaitable_Future *head;
+    do {
+        head = _PyAwaitable_ATOMIC_LOAD_PTR(&hub->head);
+        future->next = head;
+    } while (!_PyAwaitable_ATOMIC_CAS_PTR(&hub->head, head, future));
+
+    if (head == NULL) {
+        // Everything else that's pushed before the loop drains us will
+        // be handled by the same wakeup.
+        hub_wakeup(hub);
+    }
+
+    hub_release_threadsafe(hub);
+}
+
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_HubsFree(pyawaitable_hubs *hubs)
+{
+    assert(hubs != NULL);
+    pyawaitable_array_clear(&hubs->hubs);
+    Py_XDECREF(hubs->drain);
+    Py_XDECREF(hubs->get_running_loop);
+    if (hubs->gate != NULL) {
+        _PyAwaitable_GateRelease(hubs->gate);
+    }
+    PyMem_Free(hubs);
+}
+
+static void
+hub_array_release(void *ptr)
+{
+    hub_release((pyawaitable_hub *)ptr);
+}
+
+static pyawaitable_hubs *
+hubs_state_new(void)
+{
+    pyawaitable_hubs *hubs = PyMem_Malloc(sizeof(pyawaitable_hubs));
+    if (hubs == NULL) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    hubs->drain = NULL;
+    hubs->get_running_loop = NULL;
+    hubs->gate = NULL;
+    if (pyawaitable_array_init(&hubs->hubs, hub_array_release) < 0) {
+        PyMem_Free(hubs);
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    pyawaitable_state *state = _PyAwaitable_GetState();
+    if (state == NULL) {
+        _PyAwaitable_HubsFree(hubs);
+        return NULL;
+    }
+    hubs->gate = state->gate;
+    _PyAwaitable_ATOMIC_ADD_LONG(&hubs->gate->refcount, 1);
+
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (asyncio == NULL) {
+        _PyAwaitable_HubsFree(hubs);
+        return NULL;
+    }
+
+    hubs->get_running_loop = PyObject_GetAttrString(
+        asyncio,
+        "get_running_loop"
+    );
+    Py_DECREF(asyncio);
+    if (hubs->get_running_loop == NULL) {
+        _PyAwaitable_HubsFree(hubs);
+        return NULL;
+    }
+
+    hubs->drain = PyCFunction_New(&hub_drain_def, NULL);
+    if (hubs->drain == NULL) {
+        _PyAwaitable_HubsFree(hubs);
+        return NULL;
+    }
+
+    return hubs;
+}
+
+static pyawaitable_hubs *
+get_hubs_state(void)
+{
+    _PyAwaitable_LAZY_STATE(hubs, hubs_state_new, _PyAwaitable_HubsFree);
+}
+
+/*
+ * Set up the hub's fds, and have the loop watch them. If the loop can't,
+ * the fds are left as -1.
+ */
+static int
+hub_watch(pyawaitable_hubs *hubs, pyawaitable_hub *hub)
+{
+#ifdef _WIN32
+    return 0;
+#else
+#ifdef __linux__
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd == -1) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+    hub->read_fd = fd;
+    hub->write_fd = fd;
+#else
+    int fds[2];
+    if (pipe(fds) == -1) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+    hub->read_fd = fds[0];
+    hub->write_fd = fds[1];
+    for (int i = 0; i < 2; ++i) {
+        if (
+            fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK) == -1
+            || fcntl(fds[i], F_SETFD, FD_CLOEXEC) == -1
+        ) {
+            PyErr_SetFromErrno(PyExc_OSError);
+            hub_close_fds(hub);
+            return -1;
+        }
+    }
+#endif
+
+    // The hub is kept alive by the state for as long as the loop is open
+    PyObject *capsule = PyCapsule_New(hub, PYAWAITABLE_HUB_CAPSULE, NULL);
+    if (capsule == NULL) {
+        hub_close_fds(hub);
+        return -1;
+    }
+
+    PyObject *res = PyObject_CallMethod(
+        hub->loop,
+        "add_reader",
+        "iOO",
+        hub->read_fd,
+        hubs->drain,
+        capsule
+    );
+    Py_DECREF(capsule);
+    if (res == NULL) {
+        hub_close_fds(hub);
+        if (!PyErr_ExceptionMatches(PyExc_NotImplementedError)) {
+            return -1;
+        }
+
+        // Fall back to call_soon_threadsafe()
+        PyErr_Clear();
+        return 0;
+    }
+
+    Py_DECREF(res);
+    return 0;
+#endif
+}
+
+/*
+ * Find the loop's hub, or NULL, and throw away the hubs of any other loops
+ * that have been closed. This must be called in a critical section on the
+ * drain function.
+ */
+static int
+hubs_find(pyawaitable_hubs *hubs, PyObject *loop, pyawaitable_hub **found)
+{
+    *found = NULL;
+    for (Py_ssize_t i = pyawaitable_array_LENGTH(&hubs->hubs); i-- > 0;) {
+        pyawaitable_hub *hub = pyawaitable_array_GET_ITEM(&hubs->hubs, i);
+        if (hub->loop == loop) {
+            // It's running, so it can't be closed
+            *found = hub;
+            continue;
+        }
+
+        PyObject *closed = PyObject_CallMethod(hub->loop, "is_closed", NULL);
+        if (closed == NULL) {
+            return -1;
+        }
+
+        int is_closed = PyObject_IsTrue(closed);
+        Py_DECREF(closed);
+        if (is_closed < 0) {
+            return -1;
+        }
+
+        // The loop might have run arbitrary code, so make sure that the
+        // hub is still where we found it.
+        if (
+            is_closed
+            && i < pyawaitable_array_LENGTH(&hubs->hubs)
+            && pyawaitable_array_GET_ITEM(&hubs->hubs, i) == hub
+        ) {
+            // Futures that are still waiting on it keep it alive
+            pyawaitable_array_remove(&hubs->hubs, i);
+        }
+    }
+
+    return 0;
+}
+
+/* Get a new reference to the loop's hub, creating it if needed */
+static pyawaitable_hub *
+hub_get(pyawaitable_hubs *hubs, PyObject *loop)
+{
+    pyawaitable_hub *hub = NULL;
+    int res;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(hubs->drain);
+    // With a single loop, this doesn't have to call anything
+    res = hubs_find(hubs, loop, &hub);
+    if (res == 0 && hub == NULL) {
+        hub = PyMem_RawMalloc(sizeof(pyawaitable_hub));
+        if (hub == NULL) {
+            PyErr_NoMemory();
+            res = -1;
+        }
+        else {
+            hub->head = NULL;
+            hub->refcount = 1;
+            hub->loop = Py_NewRef(loop);
+            hub->gate = hubs->gate;
+            _PyAwaitable_ATOMIC_ADD_LONG(&hub->gate->refcount, 1);
+            hub->read_fd = -1;
+            hub->write_fd = -1;
+            res = hub_watch(hubs, hub);
+            if (res == 0) {
+                res = pyawaitable_array_append(&hubs->hubs, hub);
+                if (res < 0) {
+                    PyErr_NoMemory();
+                }
+            }
+
+            if (res < 0) {
+                hub_release(hub);
+            }
+        }
+    }
+
+    if (res < 0) {
+        hub = NULL;
+    }
+    else {
+        _PyAwaitable_ATOMIC_ADD_LONG(&hub->refcount, 1);
+    }
+    _PyAwaitable_END_CRITICAL_SECTION();
+
+    return hub;
+}
+
+static void
+future_capsule_destructor(PyObject *capsule)
+{
+    PyAwaitable_Future *future = PyCapsule_GetPointer(
+        capsule,
+        PYAWAITABLE_FUTURE_CAPSULE
+    );
+    if (future == NULL) {
+        PyErr_WriteUnraisable(capsule);
+        return;
+    }
+
+    if (future->jobs != NULL) {
+        // The step never started, so neither will the jobs
+        pyawaitable_job *job = future->jobs;
+        future->jobs = NULL;
+        while (job != NULL) {
+            pyawaitable_job *next = job->next;
+            job->discard(job);
+            job = next;
+        }
+        future_release(future);
+    }
+
+    // This is the step's reference
+    Py_CLEAR(future->py_future);
+    future_release(future);
+}
+
+static int
+future_done(PyObject *inner, PyObject *unused)
+{
+    PyObject *awaitable;
+    PyAwaitable_NoGILResult cb;
+    void *arg;
+    if (PyAwaitable_UnpackArbValues(inner, &awaitable, &cb, &arg) < 0) {
+        return -1;
+    }
+
+    if (cb == NULL) {
+        return 0;
+    }
+
+    PyObject *capsule = PyAwaitable_GetValue(inner, 0);
+    if (capsule == NULL) {
+        return -1;
+    }
+
+    PyAwaitable_Future *future = PyCapsule_GetPointer(
+        capsule,
+        PYAWAITABLE_FUTURE_CAPSULE
+    );
+    if (future == NULL) {
+        return -1;
+    }
+
+    return cb(awaitable, future->result, arg);
+}
+
+static int
+future_start(PyObject *inner)
+{
+    PyObject *capsule = PyAwaitable_GetValue(inner, 0);
+    if (capsule == NULL) {
+        return -1;
+    }
+
+    PyAwaitable_Future *future = PyCapsule_GetPointer(
+        capsule,
+        PYAWAITABLE_FUTURE_CAPSULE
+    );
+    if (future == NULL) {
+        return -1;
+    }
+
+    if (future->jobs != NULL) {
+        pyawaitable_job *jobs = future->jobs;
+        future->jobs = NULL;
+        if (_PyAwaitable_PoolSubmit(jobs) < 0) {
+            // Leave them for the destructor
+            future->jobs = jobs;
+            return -1;
+        }
+    }
+
+    if (
+        _PyAwaitable_ATOMIC_LOAD_LONG(&future->state) ==
+        _PyAwaitable_FUTURE_DONE
+    ) {
+        // It was completed before we even started, so skip the loop
+        return future_done(inner, Py_None);
+    }
+
+    pyawaitable_hubs *hubs = get_hubs_state();
+    if (PyAwaitable_UNLIKELY(hubs == NULL)) {
+        return -1;
+    }
+
+    PyObject *loop = PyObject_CallNoArgs(hubs->get_running_loop);
+    if (loop == NULL) {
+        return -1;
+    }
+
+    future->py_future = PyObject_CallMethod(loop, "create_future", NULL);
+    if (future->py_future == NULL) {
+        Py_DECREF(loop);
+        return -1;
+    }
+
+    future->hub = hub_get(hubs, loop);
+    Py_DECREF(loop);
+    if (future->hub == NULL) {
+        return -1;
+    }
+
+    if (
+        !_PyAwaitable_ATOMIC_CAS_LONG(
+            &future->state,
+            _PyAwaitable_FUTURE_PENDING,
+            _PyAwaitable_FUTURE_WAITING
+        )
+    ) {
+        // It was completed while we were setting up
+        return future_done(inner, Py_None);
+    }
+
+    return PyAwaitable_AddAwait(inner, future->py_future, future_done, NULL);
+}
+
+_PyAwaitable_INTERNAL(PyAwaitable_Future *)
+_PyAwaitable_AddJobFuture(
+    PyObject * awaitable,
+    PyAwaitable_NoGILResult cb,
+    void *arg,
+    pyawaitable_job * jobs
+)
+{
+    PyAwaitable_Future *future = PyMem_RawMalloc(sizeof(PyAwaitable_Future));
+    if (future == NULL) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    future->complete = future_complete;
+    future->next = NULL;
+    future->state = _PyAwaitable_FUTURE_PENDING;
+    // One for the step, and one for the completer
+    future->refcount = 2;
+    future->result = NULL;
+    future->hub = NULL;
+    future->py_future = NULL;
+    future->jobs = NULL;
+    future->free_result = NULL;
+
+    PyObject *capsule = PyCapsule_New(
+        future,
+        PYAWAITABLE_FUTURE_CAPSULE,
+        future_capsule_destructor
+    );
+    if (capsule == NULL) {
+        PyMem_RawFree(future);
+        return NULL;
+    }
+
+    // From here on out, the capsule owns the step's reference
+    PyObject *inner = _PyAwaitable_NewInner(awaitable);
+    if (inner == NULL) {
+        Py_DECREF(capsule);
+        future_release(future);
+        return NULL;
+    }
+
+    if (
+        PyAwaitable_SaveValues(inner, 1, capsule) < 0
+        || PyAwaitable_SaveArbValues(inner, 2, cb, arg) < 0
+    ) {
+        Py_DECREF(capsule);
+        PyAwaitable_Cancel(inner);
+        Py_DECREF(inner);
+        future_release(future);
+        return NULL;
+    }
+    Py_DECREF(capsule);
+
+    // The loop is only known once we're running on it
+    if (
+        PyAwaitable_DeferAwait(inner, future_start) < 0
+        || PyAwaitable_AddAwait(awaitable, inner, NULL, NULL) < 0
+    ) {
+        PyAwaitable_Cancel(inner);
+        Py_DECREF(inner);
+        future_release(future);
+        return NULL;
+    }
+
+    Py_DECREF(inner);
+    // Nothing can start the step until we return, so the jobs can be handed
+    // over now that there's nothing left to fail.
+    future->jobs = jobs;
+    return future;
+}
+
+_PyAwaitable_API(PyAwaitable_Future *)
+PyAwaitable_AddFuture(
+    PyObject * awaitable,
+    PyAwaitable_NoGILResult cb,
+    void *arg
+)
+{
+    _PyAwaitable_FORWARD(NULL, AddFuture(awaitable, cb, arg));
+    return _PyAwaitable_AddJobFuture(awaitable, cb, arg, NULL);
+}
+
+_PyAwaitable_API(void)
+PyAwaitable_Complete(PyAwaitable_Future * future, void *result)
+{
+    // This can't look up the state without a thread state, so it goes
+    // through the future instead of _PyAwaitable_FORWARD().
+    assert(future != NULL);
+    future->complete(future, result);
+}
@@ -0,0 +1,482 @@
+#include <Python.h>
+#include <pythread.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <pyawaitable/backport.h>
+#include <pyawaitable/gate.h>
+#include <pyawaitable/optimize.h>
+
+#define PYAWAITABLE_GATE_CAPSULE "pyawaitable.gate"
+
+_PyAwaitable_INTERNAL_DATA_DEF(pyawaitable_gate_registry *)
+pyawaitable_gates = NULL;
+
+static pyawaitable_gate *
+gate_new(void)
+{
+    pyawaitable_gate *gate = PyMem_RawMalloc(sizeof(pyawaitable_gate));
+    if (gate == NULL) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    gate->interp = PyInterpreterState_Get();
+    gate->lock = PyThread_allocate_lock();
+    gate->idle = PyThread_allocate_lock();
+    if (gate->lock == NULL || gate->idle == NULL) {
+        if (gate->lock != NULL) {
+            PyThread_free_lock(gate->lock);
+        }
+        if (gate->idle != NULL) {
+            PyThread_free_lock(gate->idle);
+        }
+        PyMem_RawFree(gate);
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    // Released by the last thread to leave once the gate is closed
+    PyThread_acquire_lock(gate->idle, WAIT_LOCK);
+    gate->active = 0;
+    gate->closed = 0;
+    gate->waiting = 0;
+    gate->refcount = 1;
+    return gate;
+}
+
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_GateRelease(pyawaitable_gate *gate)
+{
+    if (_PyAwaitable_ATOMIC_ADD_LONG(&gate->refcount, -1) != 1) {
+        return;
+    }
+
+    assert(gate->active == 0);
+    PyThread_release_lock(gate->idle);
+    PyThread_free_lock(gate->idle);
+    PyThread_free_lock(gate->lock);
+    PyMem_RawFree(gate);
+}
+
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_GateEnter(pyawaitable_gate *gate)
+{
+    PyThread_acquire_lock(gate->lock, WAIT_LOCK);
+    int is_open = !gate->closed;
+    if (is_open) {
+        ++gate->active;
+    }
+    PyThread_release_lock(gate->lock);
+    return is_open;
+}
+
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_GateLeave(pyawaitable_gate *gate)
+{
+    PyThread_acquire_lock(gate->lock, WAIT_LOCK);
+    assert(gate->active > 0);
+    if (--gate->active == 0 && gate->waiting) {
+        gate->waiting = 0;
+        PyThread_release_lock(gate->idle);
+    }
+    PyThread_release_lock(gate->lock);
+}
+
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_GateClose(pyawaitable_gate *gate, int wait)
+{
+    PyThread_acquire_lock(gate->lock, WAIT_LOCK);
+    gate->closed = 1;
+    wait = wait && gate->active > 0;
+    gate->waiting = wait;
+    PyThread_release_lock(gate->lock);
+
+    if (wait) {
+        Py_BEGIN_ALLOW_THREADS
+        PyThread_acquire_lock(gate->idle, WAIT_LOCK);
+        Py_END_ALLOW_THREADS
+    }
+}
+
+_PyAwaitable_INTERNAL(PyThreadState *)
+_PyAwaitable_GateAttach(pyawaitable_gate *gate)
+{
+    if (!_PyAwaitable_GateEnter(gate)) {
+        return NULL;
+    }
+
+    // The interpreter can't start finalizing until we leave, so it's safe
+    // to create a thread state for it.
+    PyThreadState *tstate = PyThreadState_New(gate->interp);
+    if (tstate == NULL) {
+        _PyAwaitable_GateLeave(gate);
+        return NULL;
+    }
+
+    PyEval_RestoreThread(tstate);
+    return tstate;
+}
+
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_GateDetach(pyawaitable_gate *gate, PyThreadState *tstate)
+{
+    assert(PyThreadState_Get() == tstate);
+    PyThreadState_Clear(tstate);
+    PyThreadState_DeleteCurrent();
+    _PyAwaitable_GateLeave(gate);
+}
+
+/* Registered with atexit, which runs before the interpreter finalizes */
+static PyObject *
+gate_close_callback(PyObject *capsule, PyObject *unused)
+{
+    pyawaitable_gate *gate = PyCapsule_GetPointer(
+        capsule,
+        PYAWAITABLE_GATE_CAPSULE
+    );
+    if (gate == NULL) {
+        return NULL;
+    }
+
+    _PyAwaitable_GateClose(gate, 1);
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef gate_close_def = {
+    "_pyawaitable_close_gate",
+    gate_close_callback,
+    METH_NOARGS,
+    NULL
+};
+
+static void
+gate_capsule_destructor(PyObject *capsule)
+{
+    pyawaitable_gate *gate = PyCapsule_GetPointer(
+        capsule,
+        PYAWAITABLE_GATE_CAPSULE
+    );
+    if (gate == NULL) {
+        PyErr_WriteUnraisable(capsule);
+        return;
+    }
+
+    _PyAwaitable_GateRelease(gate);
+}
+
+/* Close the gate once the interpreter exits */
+static int
+gate_register_atexit(pyawaitable_gate *gate)
+{
+    PyObject *capsule = PyCapsule_New(
+        gate,
+        PYAWAITABLE_GATE_CAPSULE,
+        gate_capsule_destructor
+    );
+    if (capsule == NULL) {
+        return -1;
+    }
+    // Now owned by the capsule
+    _PyAwaitable_ATOMIC_ADD_LONG(&gate->refcount, 1);
+
+    PyObject *close = PyCFunction_New(&gate_close_def, capsule);
+    Py_DECREF(capsule);
+    if (close == NULL) {
+        return -1;
+    }
+
+    PyObject *atexit = PyImport_ImportModule("atexit");
+    if (atexit == NULL) {
+        Py_DECREF(close);
+        return -1;
+    }
+
+    PyObject *res = PyObject_CallMethod(atexit, "register", "O", close);
+    Py_DECREF(atexit);
+    Py_DECREF(close);
+    if (res == NULL) {
+        return -1;
+    }
+
+    Py_DECREF(res);
+    return 0;
+}
+
+_PyAwaitable_INTERNAL(pyawaitable_gate *)
+_PyAwaitable_GateNew(void)
+{
+    pyawaitable_gate *gate = gate_new();
+    if (gate == NULL) {
+        return NULL;
+    }
+
+    if (gate_register_atexit(gate) < 0) {
+        _PyAwaitable_GateRelease(gate);
+        return NULL;
+    }
+
+    return gate;
+}
+
+static pyawaitable_gate_registry *
+registry_new(void)
+{
+    pyawaitable_gate_registry *registry = PyMem_RawMalloc(
+        sizeof(pyawaitable_gate_registry)
+    );
+    if (registry == NULL) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    registry->lock = PyThread_allocate_lock();
+    if (registry->lock == NULL) {
+        PyMem_RawFree(registry);
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    registry->forward = NULL;
+    registry->gates = NULL;
+    registry->length = 0;
+    registry->capacity = 0;
+    return registry;
+}
+
+/* Only for registries that were never published */
+static void
+registry_free(pyawaitable_gate_registry *registry)
+{
+    assert(registry->length == 0);
+    PyThread_free_lock(registry->lock);
+    PyMem_RawFree(registry->gates);
+    PyMem_RawFree(registry);
+}
+
+/* Follow merged registries to the one that's in use */
+static pyawaitable_gate_registry *
+registry_resolve(pyawaitable_gate_registry *registry)
+{
+    pyawaitable_gate_registry *next;
+    while (
+        (next = _PyAwaitable_ATOMIC_LOAD_PTR(&registry->forward)) != NULL
+    ) {
+        registry = next;
+    }
+
+    return registry;
+}
+
+/* Lock the registry that's in use, and return it */
+static pyawaitable_gate_registry *
+registry_acquire(pyawaitable_gate_registry *registry)
+{
+    for (;;) {
+        registry = registry_resolve(registry);
+        PyThread_acquire_lock(registry->lock, WAIT_LOCK);
+        if (_PyAwaitable_ATOMIC_LOAD_PTR(&registry->forward) == NULL) {
+            return registry;
+        }
+
+        // It was merged while we were waiting for the lock
+        PyThread_release_lock(registry->lock);
+    }
+}
+
+/* Throw out gates that are closed. The registry lock must be held. */
+static void
+registry_prune(pyawaitable_gate_registry *registry)
+{
+    Py_ssize_t kept = 0;
+    for (Py_ssize_t i = 0; i < registry->length; ++i) {
+        pyawaitable_gate *gate = registry->gates[i];
+        PyThread_acquire_lock(gate->lock, WAIT_LOCK);
+        int closed = gate->closed;
+        PyThread_release_lock(gate->lock);
+        if (closed) {
+            _PyAwaitable_GateRelease(gate);
+        }
+        else {
+            registry->gates[kept++] = gate;
+        }
+    }
+
+    registry->length = kept;
+}
+
+/* Make room for length gates. The registry lock must be held. */
+static int
+registry_reserve(pyawaitable_gate_registry *registry, Py_ssize_t length)
+{
+    if (length <= registry->capacity) {
+        return 0;
+    }
+
+    Py_ssize_t capacity = registry->capacity * 2 + 4;
+    if (capacity < length) {
+        capacity = length;
+    }
+
+    pyawaitable_gate **gates = PyMem_RawRealloc(
+        registry->gates,
+        capacity * sizeof(pyawaitable_gate *)
+    );
+    if (gates == NULL) {
+        return -1;
+    }
+
+    registry->gates = gates;
+    registry->capacity = capacity;
+    return 0;
+}
+
+/* Move every gate from one registry into another, and forward to it */
+static int
+registry_merge(
+    pyawaitable_gate_registry *from,
+    pyawaitable_gate_registry *into
+)
+{
+    for (;;) {
+        from = registry_resolve(from);
+        into = registry_resolve(into);
+        if (from == into) {
+            return 0;
+        }
+
+        // Always lock in the same order, so two merges can't deadlock
+        int in_order = (uintptr_t)from < (uintptr_t)into;
+        PyThread_acquire_lock(in_order ? from->lock : into->lock, WAIT_LOCK);
+        PyThread_acquire_lock(in_order ? into->lock : from->lock, WAIT_LOCK);
+        if (
+            _PyAwaitable_ATOMIC_LOAD_PTR(&from->forward) == NULL
+            && _PyAwaitable_ATOMIC_LOAD_PTR(&into->forward) == NULL
+        ) {
+            break;
+        }
+
+        PyThread_release_lock(from->lock);
+        PyThread_release_lock(into->lock);
+    }
+
+    registry_prune(from);
+    registry_prune(into);
+    int res = registry_reserve(into, into->length + from->length);
+    if (res == 0) {
+        memcpy(
+            into->gates + into->length,
+            from->gates,
+            from->length * sizeof(pyawaitable_gate *)
+        );
+        into->length += from->length;
+        from->length = 0;
+        (void)_PyAwaitable_ATOMIC_EXCHANGE_PTR(&from->forward, into);
+    }
+
+    PyThread_release_lock(from->lock);
+    PyThread_release_lock(into->lock);
+    if (res < 0) {
+        PyErr_NoMemory();
+    }
+
+    return res;
+}
+
+/*
+ * Make this copy and the interpreter share a registry, and return it. It
+ * might have been merged again by the time it's used, so it has to be
+ * resolved.
+ */
+static pyawaitable_gate_registry *
+registry_join(pyawaitable_gate_registry **shared)
+{
+    pyawaitable_gate_registry *theirs = _PyAwaitable_ATOMIC_LOAD_PTR(shared);
+    pyawaitable_gate_registry *ours = _PyAwaitable_ATOMIC_LOAD_PTR(
+        &pyawaitable_gates
+    );
+    if (ours == NULL) {
+        // This copy hasn't been used anywhere yet
+        ours = theirs != NULL ? theirs : registry_new();
+        if (ours == NULL) {
+            return NULL;
+        }
+
+        if (!_PyAwaitable_ATOMIC_CAS_PTR(&pyawaitable_gates, NULL, ours)) {
+            if (ours != theirs) {
+                registry_free(ours);
+            }
+            ours = _PyAwaitable_ATOMIC_LOAD_PTR(&pyawaitable_gates);
+        }
+    }
+
+    if (theirs == NULL) {
+        if (_PyAwaitable_ATOMIC_CAS_PTR(shared, NULL, ours)) {
+            return ours;
+        }
+        theirs = _PyAwaitable_ATOMIC_LOAD_PTR(shared);
+    }
+
+    if (registry_merge(ours, theirs) < 0) {
+        return NULL;
+    }
+
+    return theirs;
+}
+
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_GateRegister(
+    pyawaitable_gate_registry **shared,
+    pyawaitable_gate *gate
+)
+{
+    pyawaitable_gate_registry *registry = registry_join(shared);
+    if (registry == NULL) {
+        return -1;
+    }
+
+    registry = registry_acquire(registry);
+    registry_prune(registry);
+    for (Py_ssize_t i = 0; i < registry->length; ++i) {
+        if (registry->gates[i] == gate) {
+            PyThread_release_lock(registry->lock);
+            return 0;
+        }
+    }
+
+    if (registry_reserve(registry, registry->length + 1) < 0) {
+        PyThread_release_lock(registry->lock);
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    _PyAwaitable_ATOMIC_ADD_LONG(&gate->refcount, 1);
+    registry->gates[registry->length++] = gate;
+    PyThread_release_lock(registry->lock);
+    return 0;
+}
+
+_PyAwaitable_INTERNAL(pyawaitable_gate *)
+_PyAwaitable_GateFind(
+    pyawaitable_gate_registry *registry,
+    PyInterpreterState *interp
+)
+{
+    if (registry == NULL) {
+        return NULL;
+    }
+
+    pyawaitable_gate *found = NULL;
+    registry = registry_acquire(registry);
+    registry_prune(registry);
+    for (Py_ssize_t i = 0; i < registry->length; ++i) {
+        pyawaitable_gate *gate = registry->gates[i];
+        if (gate->interp == interp) {
+            _PyAwaitable_ATOMIC_ADD_LONG(&gate->refcount, 1);
+            found = gate;
+            break;
+        }
+    }
+    PyThread_release_lock(registry->lock);
+    return found;
+}
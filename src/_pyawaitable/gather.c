@@ -0,0 +1,747 @@
+#include <Python.h>
+#include <stdint.h>
+
+#include <pyawaitable/awaitableobject.h>
+#include <pyawaitable/backport.h>
+#include <pyawaitable/capi.h>
+#include <pyawaitable/gather.h>
+#include <pyawaitable/optimize.h>
+#include <pyawaitable/values.h>
+
+/*
+ * A gather runs in an inner awaitable. Its object values are the future
+ * that it waits on, followed by the awaitables (and then, once they've been
+ * started, their tasks). Its arbitrary values are listed below.
+ */
+#define GATHER_FUTURE 0
+#define GATHER_TASKS 1
+
+#define GATHER_NUM_ARB 5
+#define GATHER_REMAINING 4
+
+/* Internal flag for PyAwaitable_AddRace() */
+#define GATHER_RACE (1 << 16)
+
+#define GATHER_INT(ptr) ((Py_ssize_t)(intptr_t)(ptr))
+#define GATHER_PTR(num) ((void *)(intptr_t)(num))
+
+static int
+gather_unpack(PyObject *inner, int *flags, Py_ssize_t *size)
+{
+    void *flags_ptr;
+    void *size_ptr;
+    if (
+        PyAwaitable_UnpackArbValues(
+            inner,
+            NULL,
+            NULL,
+            &flags_ptr,
+            &size_ptr,
+            NULL
+        ) < 0
+    ) {
+        return -1;
+    }
+
+    if (flags != NULL) {
+        *flags = (int)GATHER_INT(flags_ptr);
+    }
+    if (size != NULL) {
+        *size = GATHER_INT(size_ptr);
+    }
+    return 0;
+}
+
+static int
+gather_cancel_tasks(PyObject *inner, Py_ssize_t count)
+{
+    for (Py_ssize_t i = 0; i < count; ++i) {
+        PyObject *task = PyAwaitable_GetValue(inner, GATHER_TASKS + i);
+        if (task == NULL) {
+            return -1;
+        }
+
+        // This is a no-op for tasks that already finished
+        PyObject *res = PyObject_CallMethod(task, "cancel", NULL);
+        if (res == NULL) {
+            return -1;
+        }
+        Py_DECREF(res);
+    }
+
+    return 0;
+}
+
+/*
+ * Get the exception that a finished task failed with, or None. A
+ * cancelled task counts as having failed with CancelledError.
+ */
+static PyObject *
+gather_task_exception(PyObject *task)
+{
+    PyObject *exc = PyObject_CallMethod(task, "exception", NULL);
+    if (exc != NULL) {
+        return exc;
+    }
+
+    PyObject *err = PyErr_GetRaisedException();
+    PyObject *cancelled = PyObject_CallMethod(task, "cancelled", NULL);
+    if (cancelled == NULL) {
+        Py_DECREF(err);
+        return NULL;
+    }
+
+    int is_cancelled = PyObject_IsTrue(cancelled);
+    Py_DECREF(cancelled);
+    if (is_cancelled <= 0) {
+        if (is_cancelled == 0) {
+            PyErr_SetRaisedException(err);
+        }
+        else {
+            Py_DECREF(err);
+        }
+        return NULL;
+    }
+
+    return err;
+}
+
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_ResolveFuture(
+    PyObject *future,
+    const char *method,
+    PyObject *value
+)
+{
+    PyObject *done = PyObject_CallMethod(future, "done", NULL);
+    if (done == NULL) {
+        return -1;
+    }
+
+    int is_done = PyObject_IsTrue(done);
+    Py_DECREF(done);
+    if (is_done != 0) {
+        return is_done < 0 ? -1 : 0;
+    }
+
+    PyObject *res = PyObject_CallMethod(future, method, "O", value);
+    if (res == NULL) {
+        return -1;
+    }
+
+    Py_DECREF(res);
+    return 1;
+}
+
+_PyAwaitable_INTERNAL(PyObject *)
+_PyAwaitable_NewInner(PyObject *awaitable)
+{
+    PyObject *inner = PyAwaitable_New();
+    if (inner == NULL) {
+        return NULL;
+    }
+
+    // The outer awaitable is borrowed; it's the one awaiting us.
+    if (PyAwaitable_SaveArbValues(inner, 1, awaitable) < 0) {
+        Py_DECREF(inner);
+        return NULL;
+    }
+
+    return inner;
+}
+
+#if PY_VERSION_HEX >= 0x030b0000
+/* Raise every failure in an ExceptionGroup, once all tasks are done */
+static int
+gather_finish_group(PyObject *inner, PyObject *future, Py_ssize_t size)
+{
+    PyObject *errors = PyList_New(0);
+    if (errors == NULL) {
+        return -1;
+    }
+
+    for (Py_ssize_t i = 0; i < size; ++i) {
+        PyObject *task = PyAwaitable_GetValue(inner, GATHER_TASKS + i);
+        if (task == NULL) {
+            Py_DECREF(errors);
+            return -1;
+        }
+
+        PyObject *exc = gather_task_exception(task);
+        if (exc == NULL) {
+            Py_DECREF(errors);
+            return -1;
+        }
+
+        int res = exc == Py_None ? 0 : PyList_Append(errors, exc);
+        Py_DECREF(exc);
+        if (res < 0) {
+            Py_DECREF(errors);
+            return -1;
+        }
+    }
+
+    if (PyList_GET_SIZE(errors) == 0) {
+        Py_DECREF(errors);
+        return _PyAwaitable_ResolveFuture(future, "set_result", Py_None) < 0 ? -1 : 0;
+    }
+
+    // This creates an ExceptionGroup instead if there are no
+    // BaseExceptions (such as CancelledError) in the list.
+    PyObject *group = PyObject_CallFunction(
+        PyExc_BaseExceptionGroup,
+        "sO",
+        "PyAwaitable: Gathered awaitables failed",
+        errors
+    );
+    Py_DECREF(errors);
+    if (group == NULL) {
+        return -1;
+    }
+
+    int res = _PyAwaitable_ResolveFuture(future, "set_exception", group);
+    Py_DECREF(group);
+    return res < 0 ? -1 : 0;
+}
+#endif
+
+/*
+ * The first task to finish wins the race, whether it succeeded or not.
+ * The future's result is the winner's index.
+ */
+static PyObject *
+race_task_done(PyObject *inner, PyObject *task, Py_ssize_t size)
+{
+    PyObject *future = PyAwaitable_GetValue(inner, GATHER_FUTURE);
+    if (future == NULL) {
+        return NULL;
+    }
+
+    // Always retrieve the exception, even for the losers
+    PyObject *exc = gather_task_exception(task);
+    if (exc == NULL) {
+        return NULL;
+    }
+
+    int res;
+    if (exc != Py_None) {
+        res = _PyAwaitable_ResolveFuture(future, "set_exception", exc);
+    }
+    else {
+        Py_ssize_t index = 0;
+        while (PyAwaitable_GetValue(inner, GATHER_TASKS + index) != task) {
+            ++index;
+            assert(index < size);
+        }
+
+        PyObject *index_obj = PyLong_FromSsize_t(index);
+        res = index_obj == NULL
+              ? -1
+              : _PyAwaitable_ResolveFuture(future, "set_result", index_obj);
+        Py_XDECREF(index_obj);
+    }
+    Py_DECREF(exc);
+
+    if (res < 0 || (res == 1 && gather_cancel_tasks(inner, size) < 0)) {
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+/* Done callback for each of the tasks */
+static PyObject *
+gather_task_done(PyObject *inner, PyObject *task)
+{
+    int flags;
+    Py_ssize_t size;
+    if (gather_unpack(inner, &flags, &size) < 0) {
+        return NULL;
+    }
+
+    if (flags & GATHER_RACE) {
+        return race_task_done(inner, task, size);
+    }
+
+    void *remaining_ptr;
+    if (
+        PyAwaitable_UnpackArbValuesRange(
+            inner,
+            GATHER_REMAINING,
+            1,
+            &remaining_ptr
+        ) < 0
+    ) {
+        return NULL;
+    }
+
+    Py_ssize_t remaining = GATHER_INT(remaining_ptr) - 1;
+    if (
+        PyAwaitable_SetArbValue(
+            inner,
+            GATHER_REMAINING,
+            GATHER_PTR(remaining)
+        ) < 0
+    ) {
+        return NULL;
+    }
+
+    PyObject *future = PyAwaitable_GetValue(inner, GATHER_FUTURE);
+    if (future == NULL) {
+        return NULL;
+    }
+
+    if (!(flags & PyAwaitable_GATHER_EXCEPTION_GROUP)) {
+        // Always retrieve the exception, so asyncio doesn't complain
+        // about it never being retrieved.
+        PyObject *exc = gather_task_exception(task);
+        if (exc == NULL) {
+            return NULL;
+        }
+
+        if (exc != Py_None) {
+            // The first failure wins, and only it cancels the others
+            int res = _PyAwaitable_ResolveFuture(future, "set_exception", exc);
+            Py_DECREF(exc);
+            if (res < 0) {
+                return NULL;
+            }
+
+            if (
+                res == 1 &&
+                (flags & PyAwaitable_GATHER_CANCEL_ON_ERROR) &&
+                gather_cancel_tasks(inner, size) < 0
+            ) {
+                return NULL;
+            }
+
+            Py_RETURN_NONE;
+        }
+
+        Py_DECREF(exc);
+    }
+
+    if (remaining > 0) {
+        Py_RETURN_NONE;
+    }
+
+#if PY_VERSION_HEX >= 0x030b0000
+    if (flags & PyAwaitable_GATHER_EXCEPTION_GROUP) {
+        if (gather_finish_group(inner, future, size) < 0) {
+            return NULL;
+        }
+        Py_RETURN_NONE;
+    }
+#endif
+
+    if (_PyAwaitable_ResolveFuture(future, "set_result", Py_None) < 0) {
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef gather_task_done_def = {
+    "_pyawaitable_on_task_done",
+    gather_task_done,
+    METH_O,
+    NULL
+};
+
+/*
+ * Done callback for the future. If it was cancelled, then so was the
+ * awaitable, so the tasks are cancelled too.
+ */
+static PyObject *
+gather_future_done(PyObject *inner, PyObject *future)
+{
+    PyObject *cancelled = PyObject_CallMethod(future, "cancelled", NULL);
+    if (cancelled == NULL) {
+        return NULL;
+    }
+
+    int is_cancelled = PyObject_IsTrue(cancelled);
+    Py_DECREF(cancelled);
+    if (is_cancelled <= 0) {
+        if (is_cancelled < 0) {
+            return NULL;
+        }
+        Py_RETURN_NONE;
+    }
+
+    Py_ssize_t size;
+    if (
+        gather_unpack(inner, NULL, &size) < 0 ||
+        gather_cancel_tasks(inner, size) < 0
+    ) {
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef gather_future_done_def = {
+    "_pyawaitable_on_future_done",
+    gather_future_done,
+    METH_O,
+    NULL
+};
+
+static int
+gather_done(PyObject *inner, PyObject *unused)
+{
+    PyObject *awaitable;
+    PyAwaitable_GatherCallback cb;
+    Py_ssize_t size;
+    if (
+        PyAwaitable_UnpackArbValues(
+            inner,
+            &awaitable,
+            &cb,
+            NULL,
+            NULL,
+            NULL
+        ) < 0 ||
+        gather_unpack(inner, NULL, &size) < 0
+    ) {
+        return -1;
+    }
+
+    if (cb == NULL) {
+        return 0;
+    }
+
+    PyObject **results = PyMem_New(PyObject *, size > 0 ? size : 1);
+    if (results == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    for (Py_ssize_t i = 0; i < size; ++i) {
+        PyObject *task = PyAwaitable_GetValue(inner, GATHER_TASKS + i);
+        results[i] = task != NULL
+                     ? PyObject_CallMethod(task, "result", NULL)
+                     : NULL;
+        if (results[i] == NULL) {
+            for (Py_ssize_t x = 0; x < i; ++x) {
+                Py_DECREF(results[x]);
+            }
+            PyMem_Free(results);
+            return -1;
+        }
+    }
+
+    Py_INCREF(awaitable);
+    int res = cb(awaitable, results, size);
+    Py_DECREF(awaitable);
+
+    for (Py_ssize_t i = 0; i < size; ++i) {
+        Py_DECREF(results[i]);
+    }
+    PyMem_Free(results);
+    return res;
+}
+
+static int
+race_done(PyObject *inner, PyObject *index_obj)
+{
+    PyObject *awaitable;
+    PyAwaitable_RaceCallback cb;
+    if (
+        PyAwaitable_UnpackArbValues(
+            inner,
+            &awaitable,
+            &cb,
+            NULL,
+            NULL,
+            NULL
+        ) < 0
+    ) {
+        return -1;
+    }
+
+    if (cb == NULL) {
+        return 0;
+    }
+
+    Py_ssize_t index = PyLong_AsSsize_t(index_obj);
+    if (index == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+
+    PyObject *task = PyAwaitable_GetValue(inner, GATHER_TASKS + index);
+    if (task == NULL) {
+        return -1;
+    }
+
+    PyObject *result = PyObject_CallMethod(task, "result", NULL);
+    if (result == NULL) {
+        return -1;
+    }
+
+    Py_INCREF(awaitable);
+    int res = cb(awaitable, index, result);
+    Py_DECREF(awaitable);
+    Py_DECREF(result);
+    return res;
+}
+
+static int
+gather_start(PyObject *inner)
+{
+    int flags;
+    Py_ssize_t size;
+    if (gather_unpack(inner, &flags, &size) < 0) {
+        return -1;
+    }
+
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (asyncio == NULL) {
+        return -1;
+    }
+
+    PyObject *ensure_future = PyObject_GetAttrString(asyncio, "ensure_future");
+    PyObject *loop = PyObject_CallMethod(asyncio, "get_running_loop", NULL);
+    Py_DECREF(asyncio);
+    if (ensure_future == NULL || loop == NULL) {
+        Py_XDECREF(ensure_future);
+        Py_XDECREF(loop);
+        return -1;
+    }
+
+    PyObject *future = PyObject_CallMethod(loop, "create_future", NULL);
+    Py_DECREF(loop);
+    if (future == NULL) {
+        Py_DECREF(ensure_future);
+        return -1;
+    }
+
+    // SetValue() steals the reference
+    int res = PyAwaitable_SetValue(inner, GATHER_FUTURE, future);
+    if (res < 0) {
+        Py_DECREF(future);
+        Py_DECREF(ensure_future);
+        return -1;
+    }
+
+    // The callbacks reference the inner awaitable until the tasks finish
+    PyObject *on_task_done = PyCFunction_New(&gather_task_done_def, inner);
+    if (on_task_done == NULL) {
+        Py_DECREF(ensure_future);
+        return -1;
+    }
+
+    for (Py_ssize_t i = 0; i < size; ++i) {
+        PyObject *coro = PyAwaitable_GetValue(inner, GATHER_TASKS + i);
+        PyObject *task = coro != NULL
+                         ? PyObject_CallOneArg(ensure_future, coro)
+                         : NULL;
+        if (task == NULL) {
+            Py_DECREF(on_task_done);
+            Py_DECREF(ensure_future);
+            // Don't leave the ones that did start running on their own
+            PyObject *err = PyErr_GetRaisedException();
+            if (gather_cancel_tasks(inner, i) < 0) {
+                PyErr_WriteUnraisable(inner);
+            }
+            PyErr_SetRaisedException(err);
+            return -1;
+        }
+
+        if (PyAwaitable_SetValue(inner, GATHER_TASKS + i, task) < 0) {
+            // The task is already scheduled, and the error path below only
+            // cancels the tasks that were stored
+            PyObject *err = PyErr_GetRaisedException();
+            PyObject *cancelled = PyObject_CallMethod(task, "cancel", NULL);
+            if (cancelled == NULL) {
+                PyErr_WriteUnraisable(task);
+            }
+            Py_XDECREF(cancelled);
+            PyErr_SetRaisedException(err);
+            Py_DECREF(task);
+            task = NULL;
+        }
+
+        PyObject *added = task == NULL ? NULL : PyObject_CallMethod(
+            task,
+            "add_done_callback",
+            "O",
+            on_task_done
+        );
+        if (added == NULL) {
+            Py_DECREF(on_task_done);
+            Py_DECREF(ensure_future);
+            PyObject *err = PyErr_GetRaisedException();
+            if (gather_cancel_tasks(inner, task == NULL ? i : i + 1) < 0) {
+                PyErr_WriteUnraisable(inner);
+            }
+            PyErr_SetRaisedException(err);
+            return -1;
+        }
+        Py_DECREF(added);
+    }
+
+    Py_DECREF(on_task_done);
+    Py_DECREF(ensure_future);
+
+    if (size == 0 && _PyAwaitable_ResolveFuture(future, "set_result", Py_None) < 0) {
+        return -1;
+    }
+
+    PyObject *on_future_done = PyCFunction_New(&gather_future_done_def, inner);
+    if (on_future_done == NULL) {
+        return -1;
+    }
+
+    PyObject *added = PyObject_CallMethod(
+        future,
+        "add_done_callback",
+        "O",
+        on_future_done
+    );
+    Py_DECREF(on_future_done);
+    if (added == NULL) {
+        return -1;
+    }
+    Py_DECREF(added);
+
+    return PyAwaitable_AddAwait(
+        inner,
+        future,
+        (flags & GATHER_RACE) ? race_done : gather_done,
+        NULL
+    );
+}
+
+/* Set up the inner awaitable, and make the outer one wait on it */
+static int
+gather_add(
+    PyObject *awaitable,
+    PyObject *const *coros,
+    Py_ssize_t size,
+    void *cb,
+    PyAwaitable_Error err,
+    int flags
+)
+{
+    PyObject *inner = _PyAwaitable_NewInner(awaitable);
+    if (inner == NULL) {
+        return -1;
+    }
+
+    // The future is filled in once the gather starts
+    if (
+        PyAwaitable_SaveValues(inner, 1, Py_None) < 0 ||
+        (size > 0 && PyAwaitable_SaveValuesArray(inner, coros, size) < 0)
+    ) {
+        Py_DECREF(inner);
+        return -1;
+    }
+
+    if (
+        PyAwaitable_SaveArbValues(
+            inner,
+            GATHER_NUM_ARB - 1,
+            cb,
+            GATHER_PTR(flags),
+            GATHER_PTR(size),
+            GATHER_PTR(size)
+        ) < 0
+    ) {
+        Py_DECREF(inner);
+        return -1;
+    }
+
+    // Tasks can only be created once we're running on the loop
+    if (PyAwaitable_DeferAwait(inner, gather_start) < 0) {
+        Py_DECREF(inner);
+        return -1;
+    }
+
+    int res = PyAwaitable_AddAwait(awaitable, inner, NULL, err);
+    Py_DECREF(inner);
+    return res;
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_AddGather(
+    PyObject * awaitable,
+    PyObject *const *coros,
+    Py_ssize_t size,
+    PyAwaitable_GatherCallback cb,
+    PyAwaitable_Error err,
+    int flags
+)
+{
+    _PyAwaitable_FORWARD(
+        -1,
+        AddGather(awaitable, coros, size, cb, err, flags)
+    );
+    if (size < 0 || (coros == NULL && size > 0)) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "PyAwaitable: Invalid awaitables passed to PyAwaitable_AddGather()"
+        );
+        return -1;
+    }
+
+    if (
+        flags & ~(
+            PyAwaitable_GATHER_CANCEL_ON_ERROR |
+            PyAwaitable_GATHER_EXCEPTION_GROUP
+        )
+    ) {
+        PyErr_Format(
+            PyExc_ValueError,
+            "PyAwaitable: Unknown gather flags: %d",
+            flags
+        );
+        return -1;
+    }
+
+    if (
+        (flags & PyAwaitable_GATHER_CANCEL_ON_ERROR) &&
+        (flags & PyAwaitable_GATHER_EXCEPTION_GROUP)
+    ) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "PyAwaitable: PyAwaitable_GATHER_CANCEL_ON_ERROR and "
+            "PyAwaitable_GATHER_EXCEPTION_GROUP can't be used together"
+        );
+        return -1;
+    }
+
+#if PY_VERSION_HEX < 0x030b0000
+    if (flags & PyAwaitable_GATHER_EXCEPTION_GROUP) {
+        PyErr_SetString(
+            PyExc_RuntimeError,
+            "PyAwaitable: PyAwaitable_GATHER_EXCEPTION_GROUP requires "
+            "Python 3.11 or newer"
+        );
+        return -1;
+    }
+#endif
+
+    return gather_add(awaitable, coros, size, cb, err, flags);
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_AddRace(
+    PyObject * awaitable,
+    PyObject *const *coros,
+    Py_ssize_t size,
+    PyAwaitable_RaceCallback cb,
+    PyAwaitable_Error err
+)
+{
+    _PyAwaitable_FORWARD(-1, AddRace(awaitable, coros, size, cb, err));
+    if (size <= 0 || coros == NULL) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "PyAwaitable: PyAwaitable_AddRace() needs at least one awaitable"
+        );
+        return -1;
+    }
+
+    return gather_add(awaitable, coros, size, cb, err, GATHER_RACE);
+}
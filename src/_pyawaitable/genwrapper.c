@@ -4,11 +4,15 @@
 #include <pyawaitable/genwrapper.h>
 #include <pyawaitable/optimize.h>
 #include <pyawaitable/init.h>
+#include <pyawaitable/timer.h>
 #include <stdlib.h>
-#define DONE(cb)                 \
-        do { cb->done = true;    \
-             Py_CLEAR(cb->coro); \
-             Py_CLEAR(g->gw_current_await); } while (0)
+#define DONE(cb)                                   \
+        do { cb->done = true;                      \
+             if (cb->deadline_task != NULL) {      \
+                 _PyAwaitable_StopDeadline(cb);    \
+             }                                     \
+             Py_CLEAR(cb->coro);                   \
+             clear_current_await(g); } while (0)
 #define AW_DONE()               \
         do {                    \
             aw->aw_done = true; \
@@ -18,35 +22,51 @@
         if (PyAwaitable_LIKELY(cb != NULL)) { \
             DONE(cb);                         \
         }
-#define DONE_IF_OK_AND_CHECK(cb)                               \
-        if (PyAwaitable_UNLIKELY(aw->aw_recently_cancelled)) { \
-            cb = NULL;                                         \
-        }                                                      \
-        else {                                                 \
-            DONE(cb);                                          \
+#define CANCELLED(aw) \
+        _PyAwaitable_ATOMIC_LOAD_LONG(&aw->aw_recently_cancelled)
+#define DONE_IF_OK_AND_CHECK(cb)                   \
+        if (PyAwaitable_UNLIKELY(CANCELLED(aw))) { \
+            cb = NULL;                             \
+        }                                          \
+        else {                                     \
+            DONE(cb);                              \
         }
-/* If we recently cancelled, then cb is no longer valid */
-#define CLEAR_CALLBACK_IF_CANCELLED()                          \
-        if (PyAwaitable_UNLIKELY(aw->aw_recently_cancelled)) { \
-            cb = NULL;                                         \
-        }                                                      \
+/*
+ * If we recently cancelled, then cb was retired, and must not be used
+ * for anything but freeing it.
+ */
+#define CLEAR_CALLBACK_IF_CANCELLED()              \
+        if (PyAwaitable_UNLIKELY(CANCELLED(aw))) { \
+            cb = NULL;                             \
+        }                                          \
 
 #define FIRE_ERROR_CALLBACK_AND_NEXT()      \
         if (                                \
     _PyAwaitableGenWrapper_FireErrCallback( \
     (PyObject *) aw,                        \
-    cb->err_callback                        \
+    cb                                      \
     ) < 0                                   \
         ) {                                 \
             DONE_IF_OK_AND_CHECK(cb);       \
             AW_DONE();                      \
-            return NULL;                    \
+            return PyAwaitable_SEND_ERROR;  \
         }                                   \
         DONE_IF_OK_AND_CHECK(cb);           \
-        return _PyAwaitableGenWrapper_Next(self);
+        return _PyAwaitableGenWrapper_Send(self, presult);
 #define RETURN_ADVANCE_GENERATOR() \
         DONE_IF_OK(cb);            \
-        PyAwaitable_MUSTTAIL return _PyAwaitableGenWrapper_Next(self);
+        PyAwaitable_MUSTTAIL return _PyAwaitableGenWrapper_Send(self, presult);
+
+static inline void
+clear_current_await(GenWrapperObject *g)
+{
+    PyObject *current;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION((PyObject *)g->gw_aw);
+    current = g->gw_current_await;
+    g->gw_current_await = NULL;
+    _PyAwaitable_END_CRITICAL_SECTION();
+    Py_XDECREF(current);
+}
 
 static PyObject *
 gen_new(PyTypeObject *tp, PyObject *args, PyObject *kwds)
@@ -62,6 +82,9 @@ gen_new(PyTypeObject *tp, PyObject *args, PyObject *kwds)
     GenWrapperObject *g = (GenWrapperObject *) self;
     g->gw_aw = NULL;
     g->gw_current_await = NULL;
+    g->gw_current_send = NULL;
+    g->gw_throw = NULL;
+    g->gw_sync_steps = 0;
 
     return (PyObject *) g;
 }
@@ -71,7 +94,9 @@ genwrapper_traverse(PyObject *self, visitproc visit, void *arg)
 {
     GenWrapperObject *gw = (GenWrapperObject *) self;
     Py_VISIT(gw->gw_current_await);
+    Py_VISIT(gw->gw_throw);
     Py_VISIT(gw->gw_aw);
+    Py_VISIT(Py_TYPE(self));
     return 0;
 }
 
@@ -80,6 +105,7 @@ genwrapper_clear(PyObject *self)
 {
     GenWrapperObject *gw = (GenWrapperObject *) self;
     Py_CLEAR(gw->gw_current_await);
+    Py_CLEAR(gw->gw_throw);
     Py_CLEAR(gw->gw_aw);
     return 0;
 }
@@ -87,9 +113,11 @@ genwrapper_clear(PyObject *self)
 static void
 gen_dealloc(PyObject *self)
 {
+    PyTypeObject *tp = Py_TYPE(self);
     PyObject_GC_UnTrack(self);
     (void)genwrapper_clear(self);
-    Py_TYPE(self)->tp_free(self);
+    tp->tp_free(self);
+    Py_DECREF(tp);
 }
 
 _PyAwaitable_INTERNAL(PyObject *)
@@ -117,14 +145,19 @@ genwrapper_new(PyAwaitableObject * aw)
 _PyAwaitable_INTERNAL(int)
 _PyAwaitableGenWrapper_FireErrCallback(
     PyObject * self,
-    PyAwaitable_Error err_callback
+    pyawaitable_callback * cb
 )
 {
     assert(PyErr_Occurred() != NULL);
-    if (err_callback == NULL) {
+    if (cb == NULL || cb->err_callback == NULL) {
         return -1;
     }
 
+    // The callback might get cancelled (and thus freed) while it's running
+    PyAwaitable_Error err_callback = cb->err_callback;
+    void *userdata = cb->userdata;
+    bool with_userdata = cb->with_userdata;
+
     PyObject *err = PyErr_GetRaisedException();
     if (PyAwaitable_UNLIKELY(err == NULL)) {
         PyErr_SetString(
@@ -135,7 +168,9 @@ _PyAwaitableGenWrapper_FireErrCallback(
     }
 
     Py_INCREF(self);
-    int e_res = err_callback(self, err);
+    int e_res = with_userdata
+                ? ((PyAwaitable_ErrorEx)err_callback)(self, err, userdata)
+                : err_callback(self, err);
     Py_DECREF(self);
 
     if (e_res < 0) {
@@ -154,65 +189,170 @@ _PyAwaitableGenWrapper_FireErrCallback(
     return 0;
 }
 
-static inline pyawaitable_callback *
-genwrapper_advance(GenWrapperObject *gw)
+static inline int
+call_result_callback(
+    PyAwaitableObject *aw,
+    pyawaitable_callback *cb,
+    PyObject *value
+)
 {
-    return pyawaitable_array_GET_ITEM(
-        &gw->gw_aw->aw_callbacks,
-        gw->gw_aw->aw_state++
-    );
+    if (cb->with_userdata) {
+        return ((PyAwaitable_CallbackEx)cb->callback)(
+            (PyObject *)aw,
+            value,
+            cb->userdata
+        );
+    }
+
+    return cb->callback((PyObject *)aw, value);
 }
 
-static PyObject *
-get_generator_return_value(void)
+static int
+call_nogil(PyAwaitableObject *aw, pyawaitable_callback *cb)
 {
-    PyObject *value;
-    if (PyErr_Occurred()) {
-        value = PyErr_GetRaisedException();
-        assert(value != NULL);
-        assert(PyObject_IsInstance(value, PyExc_StopIteration));
-        PyObject *tmp = PyObject_GetAttrString(value, "value");
-        if (PyAwaitable_UNLIKELY(tmp == NULL)) {
-            Py_DECREF(value);
-            return NULL;
+    // Another thread might cancel (and free) the callback while we
+    // don't hold the GIL, so copy everything we need beforehand.
+    PyAwaitable_NoGIL func = cb->nogil;
+    PyAwaitable_NoGILResult result_callback =
+        (PyAwaitable_NoGILResult)cb->callback;
+    PyAwaitable_NoGILRelease release = cb->nogil_release;
+    void *arg = cb->userdata;
+    void *result;
+
+    Py_BEGIN_ALLOW_THREADS
+    result = func(arg);
+    Py_END_ALLOW_THREADS
+
+    if (PyAwaitable_UNLIKELY(CANCELLED(aw))) {
+        // The callback must not touch an awaitable that isn't running
+        // anymore, so the result can only be thrown away.
+        if (release != NULL) {
+            release(result, arg);
         }
-        Py_DECREF(value);
-        value = tmp;
+        return 0;
     }
-    else {
-        value = Py_NewRef(Py_None);
+
+    if (result_callback == NULL) {
+        return 0;
     }
 
-    return value;
+    return result_callback((PyObject *)aw, result, arg);
 }
 
-static int
-maybe_set_result(PyAwaitableObject *aw)
+static inline int
+call_defer_callback(PyAwaitableObject *aw, pyawaitable_callback *cb)
 {
-    if (pyawaitable_array_LENGTH(&aw->aw_callbacks) == aw->aw_state) {
-        PyErr_SetObject(
-            PyExc_StopIteration,
-            aw->aw_result ? aw->aw_result : Py_None
+    if (cb->nogil != NULL) {
+        return call_nogil(aw, cb);
+    }
+
+    if (PyAwaitable_UNLIKELY(cb->callback == NULL)) {
+        return 0;
+    }
+
+    if (cb->with_userdata) {
+        return ((PyAwaitable_DeferEx)cb->callback)(
+            (PyObject *)aw,
+            cb->userdata
         );
-        return 1;
     }
 
-    return 0;
+    return ((PyAwaitable_Defer)cb->callback)((PyObject *)aw);
 }
 
-static inline PyAwaitable_COLD PyObject *
+/*
+ * Returns 1 if the awaitable has run out of synchronous steps, in which
+ * case we need to yield to the event loop before starting the next one.
+ * This must be called in a critical section on the awaitable.
+ *
+ * Returns -1 with an exception set on failure.
+ */
+static inline int
+step_budget_exhausted(GenWrapperObject *g)
+{
+    PyAwaitableObject *aw = g->gw_aw;
+    Py_ssize_t budget = aw->aw_step_budget;
+    if (PyAwaitable_LIKELY(budget == 0 || ++g->gw_sync_steps <= budget)) {
+        return 0;
+    }
+
+    pyawaitable_step_budget *step_budget = _PyAwaitable_GetStepBudget();
+    if (PyAwaitable_UNLIKELY(step_budget == NULL)) {
+        return -1;
+    }
+
+    g->gw_sync_steps = 0;
+    ++aw->aw_budget_hits;
+    (void)_PyAwaitable_ATOMIC_ADD_SSIZE(&step_budget->total_hits, 1);
+    return 1;
+}
+
+#define NEXT_STEP_RUN 0
+#define NEXT_STEP_DONE 1
+#define NEXT_STEP_YIELD 2
+
+/*
+ * Figure out what to do next, in one critical section, since other threads
+ * can add steps or cancel us at any time:
+ * - NEXT_STEP_RUN: *pcb is the callback to run.
+ * - NEXT_STEP_DONE: there are no more steps to run, and *presult is the
+ *   awaitable's result (or None).
+ * - NEXT_STEP_YIELD: the step budget ran out.
+ * - -1 with an exception set on failure.
+ */
+static inline int
+genwrapper_next_step(
+    GenWrapperObject *g,
+    pyawaitable_callback **pcb,
+    PyObject **presult
+)
+{
+    PyAwaitableObject *aw = g->gw_aw;
+    int res;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION((PyObject *)aw);
+    if (pyawaitable_array_LENGTH(&aw->aw_callbacks) == aw->aw_state) {
+        *presult = Py_NewRef(aw->aw_result ? aw->aw_result : Py_None);
+        res = NEXT_STEP_DONE;
+    }
+    else {
+        res = step_budget_exhausted(g);
+        if (PyAwaitable_UNLIKELY(res == 1)) {
+            res = NEXT_STEP_YIELD;
+        }
+        else if (PyAwaitable_LIKELY(res == 0)) {
+            *pcb = pyawaitable_array_GET_ITEM(
+                &aw->aw_callbacks,
+                aw->aw_state++
+            );
+            res = NEXT_STEP_RUN;
+        }
+    }
+    _PyAwaitable_END_CRITICAL_SECTION();
+    return res;
+}
+
+static inline PyAwaitable_COLD int
 bad_callback(void)
 {
     PyErr_SetString(
         PyExc_SystemError,
         "PyAwaitable: User callback returned -1 without exception set"
     );
-    return NULL;
+    return PyAwaitable_SEND_ERROR;
 }
 
 static inline PyObject *
 get_awaitable_iterator(PyObject *op)
 {
+#if PY_MINOR_VERSION > 9
+    if (PyCoro_CheckExact(op)) {
+        // Like the await expression, drive coroutines directly instead of
+        // going through their wrapper, which can't use am_send. Before 3.10,
+        // we iterate with tp_iternext, which only the wrapper has.
+        return Py_NewRef(op);
+    }
+#endif
+
     if (
         PyAwaitable_UNLIKELY(
             Py_TYPE(op)->tp_as_async == NULL ||
@@ -234,40 +374,228 @@ get_awaitable_iterator(PyObject *op)
     return Py_TYPE(op)->tp_as_async->am_await(op);
 }
 
-_PyAwaitable_INTERNAL(PyObject *) PyAwaitable_HOT
-_PyAwaitableGenWrapper_Next(PyObject *self)
+/*
+ * Start awaiting the callback's coroutine, and set *pcurrent to a new
+ * reference to what we're awaiting. Awaitables from any version of
+ * PyAwaitable are ran through their driver, which doesn't need an iterator
+ * or StopIteration.
+ *
+ * Returns 1 if the awaitable was cancelled before the step could start.
+ */
+static inline int
+start_await(
+    GenWrapperObject *g,
+    pyawaitable_callback *cb,
+    PyObject **pcurrent
+)
+{
+    assert(g->gw_current_await == NULL);
+    pyawaitable_state *state = _PyAwaitable_GetState();
+    if (PyAwaitable_UNLIKELY(state == NULL)) {
+        return -1;
+    }
+
+    PyObject *op = cb->coro;
+    PyAwaitable_SendFunc send;
+    if (Py_IS_TYPE(op, state->awaitable_type)) {
+        send = _PyAwaitable_Send;
+    }
+    else {
+        send = _PyAwaitable_FindDriver(
+            &state->driver_cache,
+            op,
+            state->driver_key
+        );
+    }
+
+    PyObject *current = send != NULL
+                        ? Py_NewRef(op)
+                        : get_awaitable_iterator(op);
+    if (current == NULL) {
+        return -1;
+    }
+
+    // Getting the iterator can run arbitrary code, and another thread
+    // could cancel us in the meantime too.
+    PyAwaitableObject *aw = g->gw_aw;
+    int cancelled;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION((PyObject *)aw);
+    cancelled = aw->aw_state == 0
+                || pyawaitable_array_GET_ITEM(
+        &aw->aw_callbacks,
+        aw->aw_state - 1
+                ) != cb;
+    if (PyAwaitable_LIKELY(!cancelled)) {
+        g->gw_current_send = send;
+        g->gw_current_await = Py_NewRef(current);
+    }
+    _PyAwaitable_END_CRITICAL_SECTION();
+
+    if (PyAwaitable_UNLIKELY(cancelled)) {
+        Py_DECREF(current);
+        return 1;
+    }
+
+    *pcurrent = current;
+    return 0;
+}
+
+/*
+ * Throw the pending exception into the current await, so it gets a chance
+ * to handle it (or clean up) like it would in an await expression.
+ */
+static int
+throw_current(GenWrapperObject *g, PyObject *current, PyObject **presult)
+{
+    PyObject *exc = g->gw_throw;
+    g->gw_throw = NULL;
+    *presult = NULL;
+
+    PyObject *throw = PyObject_GetAttrString(current, "throw");
+    if (throw == NULL) {
+        if (!PyErr_ExceptionMatches(PyExc_AttributeError)) {
+            Py_DECREF(exc);
+            return PyAwaitable_SEND_ERROR;
+        }
+
+        // There's nothing to throw it into, so it's raised right here
+        PyErr_Clear();
+        PyErr_SetRaisedException(exc);
+        return PyAwaitable_SEND_ERROR;
+    }
+
+    PyObject *value = PyObject_CallOneArg(throw, exc);
+    Py_DECREF(throw);
+    Py_DECREF(exc);
+    if (value != NULL) {
+        *presult = value;
+        return PyAwaitable_SEND_NEXT;
+    }
+
+    if (!PyErr_ExceptionMatches(PyExc_StopIteration)) {
+        return PyAwaitable_SEND_ERROR;
+    }
+
+    PyObject *err = PyErr_GetRaisedException();
+    value = PyObject_GetAttrString(err, "value");
+    Py_DECREF(err);
+    if (PyAwaitable_UNLIKELY(value == NULL)) {
+        return PyAwaitable_SEND_ERROR;
+    }
+
+    *presult = value;
+    return PyAwaitable_SEND_RETURN;
+}
+
+/*
+ * Run the current await until it yields or returns, with the same
+ * semantics as PyIter_Send().
+ */
+static inline int
+send_current(GenWrapperObject *g, PyObject *current, PyObject **presult)
+{
+    if (PyAwaitable_UNLIKELY(g->gw_throw != NULL)) {
+        return throw_current(g, current, presult);
+    }
+
+    if (g->gw_current_send != NULL) {
+        return g->gw_current_send(current, presult);
+    }
+
+#if PY_MINOR_VERSION > 9
+    return (int)PyIter_Send(current, Py_None, presult);
+#else
+    PyObject *value = Py_TYPE(current)->tp_iternext(current);
+    if (value != NULL) {
+        *presult = value;
+        return PyAwaitable_SEND_NEXT;
+    }
+
+    if (PyErr_Occurred()) {
+        if (!PyErr_ExceptionMatches(PyExc_StopIteration)) {
+            *presult = NULL;
+            return PyAwaitable_SEND_ERROR;
+        }
+
+        PyObject *err = PyErr_GetRaisedException();
+        value = PyObject_GetAttrString(err, "value");
+        Py_DECREF(err);
+        if (PyAwaitable_UNLIKELY(value == NULL)) {
+            *presult = NULL;
+            return PyAwaitable_SEND_ERROR;
+        }
+    }
+    else {
+        value = Py_NewRef(Py_None);
+    }
+
+    *presult = value;
+    return PyAwaitable_SEND_RETURN;
+#endif
+}
+
+_PyAwaitable_INTERNAL(int) PyAwaitable_HOT
+_PyAwaitableGenWrapper_Send(PyObject *self, PyObject **presult)
 {
     GenWrapperObject *g = (GenWrapperObject *)self;
     PyAwaitableObject *aw = g->gw_aw;
+    *presult = NULL;
 
     if (PyAwaitable_UNLIKELY(aw == NULL)) {
         PyErr_SetString(
             PyExc_RuntimeError,
             "PyAwaitable: Generator cannot be awaited after returning"
         );
-        return NULL;
+        return PyAwaitable_SEND_ERROR;
     }
 
-    pyawaitable_callback *cb;
+    pyawaitable_callback *cb = NULL;
+    PyObject *current;
+    pyawaitable_callback *retired;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION((PyObject *)aw);
+    retired = aw->aw_retired;
+    aw->aw_retired = NULL;
+    current = Py_XNewRef(g->gw_current_await);
+    if (current != NULL) {
+        cb = pyawaitable_array_GET_ITEM(&aw->aw_callbacks, aw->aw_state - 1);
+    }
+    _PyAwaitable_END_CRITICAL_SECTION();
 
-    if (g->gw_current_await == NULL) {
-        if (maybe_set_result(aw)) {
+    if (PyAwaitable_UNLIKELY(retired != NULL)) {
+        // Whatever step used these has returned by now
+        _PyAwaitable_FreeRetired(retired);
+    }
+
+    if (current == NULL) {
+        int next = genwrapper_next_step(g, &cb, presult);
+        if (next == NEXT_STEP_DONE) {
             // Coroutine is done, woohoo!
             AW_DONE();
-            return NULL;
+            return PyAwaitable_SEND_RETURN;
+        }
+
+        if (PyAwaitable_UNLIKELY(next < 0)) {
+            AW_DONE();
+            return PyAwaitable_SEND_ERROR;
+        }
+
+        if (PyAwaitable_UNLIKELY(next == NEXT_STEP_YIELD)) {
+            // Let the event loop run other tasks. A bare yield makes
+            // it resume us on the next iteration.
+            *presult = Py_NewRef(Py_None);
+            return PyAwaitable_SEND_NEXT;
         }
 
-        cb = genwrapper_advance(g);
         assert(cb != NULL);
         assert(cb->done == false);
 
-        if (cb->callback != NULL && cb->coro == NULL) {
-            int def_res = ((PyAwaitable_Defer)cb->callback)((PyObject *)aw);
+        if (cb->coro == NULL) {
+            int def_res = call_defer_callback(aw, cb);
             CLEAR_CALLBACK_IF_CANCELLED();
             if (def_res < 0) {
                 DONE_IF_OK(cb);
                 AW_DONE();
-                return NULL;
+                return PyAwaitable_SEND_ERROR;
             }
 
             // Callback is done.
@@ -275,61 +603,58 @@ _PyAwaitableGenWrapper_Next(PyObject *self)
         }
 
         assert(cb->coro != NULL);
-        g->gw_current_await = get_awaitable_iterator(cb->coro);
-        if (g->gw_current_await == NULL) {
+        int started = start_await(g, cb, &current);
+        if (started < 0) {
             FIRE_ERROR_CALLBACK_AND_NEXT();
         }
-    }
-    else {
-        cb = pyawaitable_array_GET_ITEM(&aw->aw_callbacks, aw->aw_state - 1);
+
+        if (PyAwaitable_UNLIKELY(started == 1)) {
+            // The callback was retired, so move on without it
+            PyAwaitable_MUSTTAIL return _PyAwaitableGenWrapper_Send(
+                self,
+                presult
+            );
+        }
+
+        if (PyAwaitable_UNLIKELY(cb->deadline >= 0)) {
+            if (_PyAwaitable_StartDeadline(cb) < 0) {
+                Py_DECREF(current);
+                FIRE_ERROR_CALLBACK_AND_NEXT();
+            }
+        }
     }
 
-    PyObject *result = Py_TYPE(
-        g->gw_current_await
-    )->tp_iternext(g->gw_current_await);
+    PyObject *value;
+    int status = send_current(g, current, &value);
+    Py_DECREF(current);
 
-    if (result != NULL) {
+    if (status == PyAwaitable_SEND_NEXT) {
         // Yield!
-        return result;
+        g->gw_sync_steps = 0;
+        *presult = value;
+        return PyAwaitable_SEND_NEXT;
     }
 
     // Rare, but it's possible that the generator cancelled us
     CLEAR_CALLBACK_IF_CANCELLED();
 
-    PyObject *occurred = PyErr_Occurred();
-    if (!occurred) {
-        // Coro is done, no result.
-        if (cb == NULL || !cb->callback) {
-            // No callback, skip trying to handle anything
-            RETURN_ADVANCE_GENERATOR();
-        }
-    }
-
-    if (occurred && !PyErr_ExceptionMatches(PyExc_StopIteration)) {
+    if (status == PyAwaitable_SEND_ERROR) {
         // An error occurred!
+        if (PyAwaitable_UNLIKELY(cb != NULL && cb->deadline_expired)) {
+            _PyAwaitable_DeadlineError(cb);
+        }
         FIRE_ERROR_CALLBACK_AND_NEXT();
     }
 
-    // Coroutine is done, but with a non-None result.
+    assert(status == PyAwaitable_SEND_RETURN);
     if (cb == NULL || cb->callback == NULL) {
         // We can disregard the result if there's no callback.
-        PyErr_Clear();
+        Py_DECREF(value);
         RETURN_ADVANCE_GENERATOR();
     }
 
-    assert(cb != NULL);
-    // Deduce the return value of the coroutine
-    PyObject *value = get_generator_return_value();
-    if (value == NULL) {
-        DONE(cb);
-        AW_DONE();
-        return NULL;
-    }
-
-    // Preserve the error callback in case we get cancelled
-    PyAwaitable_Error err_callback = cb->err_callback;
     Py_INCREF(aw);
-    int res = cb->callback((PyObject *) aw, value);
+    int res = call_result_callback(aw, cb, value);
     Py_DECREF(aw);
     Py_DECREF(value);
 
@@ -350,7 +675,7 @@ _PyAwaitableGenWrapper_Next(PyObject *self)
         // regardless of whether a handler is present.
         DONE_IF_OK(cb);
         AW_DONE();
-        return NULL;
+        return PyAwaitable_SEND_ERROR;
     }
 
     if (res < 0) {
@@ -360,15 +685,68 @@ _PyAwaitableGenWrapper_Next(PyObject *self)
     RETURN_ADVANCE_GENERATOR();
 }
 
-_PyAwaitable_INTERNAL_DATA_DEF(PyTypeObject) _PyAwaitableGenWrapperType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "_PyAwaitableGenWrapperType",
-    .tp_basicsize = sizeof(GenWrapperObject),
-    .tp_dealloc = gen_dealloc,
-    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
-    .tp_iter = PyObject_SelfIter,
-    .tp_iternext = _PyAwaitableGenWrapper_Next,
-    .tp_clear = genwrapper_clear,
-    .tp_traverse = genwrapper_traverse,
-    .tp_new = gen_new,
+_PyAwaitable_INTERNAL(PyObject *)
+_PyAwaitableGenWrapper_Next(PyObject *self)
+{
+    PyObject *result;
+    int status = _PyAwaitableGenWrapper_Send(self, &result);
+    if (status != PyAwaitable_SEND_RETURN) {
+        return result;
+    }
+
+    if (result != Py_None) {
+        // Wrap it ourselves, in case it's a tuple or an exception
+        PyObject *stop = PyObject_CallOneArg(PyExc_StopIteration, result);
+        Py_DECREF(result);
+        if (stop == NULL) {
+            return NULL;
+        }
+
+        PyErr_SetObject(PyExc_StopIteration, stop);
+        Py_DECREF(stop);
+        return NULL;
+    }
+
+    Py_DECREF(result);
+    PyErr_SetNone(PyExc_StopIteration);
+    return NULL;
+}
+
+#if PY_MINOR_VERSION > 9
+static PySendResult
+genwrapper_am_send(PyObject *self, PyObject *arg, PyObject **presult)
+{
+    if (PyAwaitable_UNLIKELY(arg != Py_None)) {
+        // Steps can't receive values, and the wrapper never had send()
+        PyErr_SetString(
+            PyExc_TypeError,
+            "PyAwaitable: Can't send non-None values to an awaitable"
+        );
+        *presult = NULL;
+        return PYGEN_ERROR;
+    }
+
+    return (PySendResult)_PyAwaitableGenWrapper_Send(self, presult);
+}
+#endif
+
+static PyType_Slot genwrapper_type_slots[] = {
+    {Py_tp_dealloc, gen_dealloc},
+    {Py_tp_iter, PyObject_SelfIter},
+    {Py_tp_iternext, _PyAwaitableGenWrapper_Next},
+#if PY_MINOR_VERSION > 9
+    {Py_am_send, genwrapper_am_send},
+#endif
+    {Py_tp_clear, genwrapper_clear},
+    {Py_tp_traverse, genwrapper_traverse},
+    {Py_tp_new, gen_new},
+    {0, NULL}
+};
+
+_PyAwaitable_INTERNAL_DATA_DEF(PyType_Spec) _PyAwaitableGenWrapper_TypeSpec = {
+    .name = "pyawaitable._PyAwaitableGenWrapperType",
+    .basicsize = sizeof(GenWrapperObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC
+             | _PyAwaitable_TPFLAGS_IMMUTABLETYPE,
+    .slots = genwrapper_type_slots
 };
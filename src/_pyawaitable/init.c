@@ -1,71 +1,240 @@
+#include <pyawaitable/backport.h>
+#include <pyawaitable/capi.h>
 #include <pyawaitable/dist.h>
+#include <pyawaitable/driver.h>
+#include <pyawaitable/future.h>
+#include <pyawaitable/gate.h>
 #include <pyawaitable/init.h>
+#include <pyawaitable/io.h>
 #include <pyawaitable/awaitableobject.h>
 #include <pyawaitable/genwrapper.h>
-
+#include <pyawaitable/pool.h>
+#include <pyawaitable/soon.h>
+#include <pyawaitable/timer.h>
+
+#define PYAWAITABLE_STATE_CAPSULE "pyawaitable.state"
+#define PYAWAITABLE_STR(x) #x
+#define PYAWAITABLE_XSTR(x) PYAWAITABLE_STR(x)
+/*
+ * Each version gets its own key in the interpreter dictionary, so finding
+ * our state is a single hash lookup, no matter how many other versions of
+ * PyAwaitable are loaded.
+ */
+#define PYAWAITABLE_STATE_KEY \
+        "pyawaitable.state." PYAWAITABLE_XSTR(PyAwaitable_MAGIC_NUMBER)
+
+_PyAwaitable_INTERNAL_DATA_DEF(PyAwaitable_thread_local PyInterpreterState *)
+pyawaitable_fast_interp = NULL;
+_PyAwaitable_INTERNAL_DATA_DEF(PyAwaitable_thread_local long)
+pyawaitable_fast_generation = 0;
+_PyAwaitable_INTERNAL_DATA_DEF(PyAwaitable_thread_local pyawaitable_state *)
+pyawaitable_fast_state = NULL;
+_PyAwaitable_INTERNAL_DATA_DEF(long) pyawaitable_state_generation = 0;
+
+/*
+ * Every interpreter gets its own heap types, so nothing is shared
+ * between interpreters with their own GIL. The types are created upon
+ * first use rather than in PyAwaitable_Init(), so that extensions which
+ * never create an awaitable don't pay for it.
+ */
 static int
-dict_add_type(PyObject *state, PyTypeObject *obj)
+ready_types(pyawaitable_state *state)
 {
-    assert(obj != NULL);
     assert(state != NULL);
-    assert(PyDict_Check(state));
-    assert(obj->tp_name != NULL);
+    if (
+        PyAwaitable_LIKELY(
+            _PyAwaitable_ATOMIC_LOAD_PTR(&state->awaitable_type) != NULL
+        )
+    ) {
+        assert(state->genwrapper_type != NULL);
+        return 0;
+    }
 
-    Py_INCREF(obj);
-    if (PyType_Ready(obj) < 0) {
-        Py_DECREF(obj);
+    PyObject *gw_type = PyType_FromSpec(&_PyAwaitableGenWrapper_TypeSpec);
+    if (gw_type == NULL) {
         return -1;
     }
 
-    if (PyDict_SetItemString(state, obj->tp_name, (PyObject *)obj) < 0) {
-        Py_DECREF(obj);
+    PyObject *aw_type = PyType_FromSpec(&PyAwaitable_TypeSpec);
+    if (aw_type == NULL) {
+        Py_DECREF(gw_type);
         return -1;
     }
-    Py_DECREF(obj);
+
+    // Another thread might be doing the same thing. The generator wrapper
+    // type is published first, since the awaitable type being set means
+    // that both are ready.
+    if (
+        _PyAwaitable_ATOMIC_CAS_PTR(
+            &state->genwrapper_type,
+            NULL,
+            (PyTypeObject *)gw_type
+        )
+    ) {
+        gw_type = NULL;
+    }
+    if (
+        _PyAwaitable_ATOMIC_CAS_PTR(
+            &state->awaitable_type,
+            NULL,
+            (PyTypeObject *)aw_type
+        )
+    ) {
+        aw_type = NULL;
+    }
+
+    Py_XDECREF(gw_type);
+    Py_XDECREF(aw_type);
     return 0;
 }
 
-static int
-init_state(PyObject *state)
+static void
+state_capsule_destructor(PyObject *capsule)
 {
-    assert(state != NULL);
-    assert(PyDict_Check(state));
-    if (dict_add_type(state, &PyAwaitable_Type) < 0) {
-        return -1;
+    pyawaitable_state *state = PyCapsule_GetPointer(
+        capsule,
+        PYAWAITABLE_STATE_CAPSULE
+    );
+    if (state == NULL) {
+        PyErr_WriteUnraisable(capsule);
+        return;
+    }
+
+    // Threads might still have the state cached, even ones that are
+    // running in another interpreter right now.
+    PyThread_acquire_lock(state->cache_lock, WAIT_LOCK);
+    for (
+        Py_ssize_t i = 0;
+        i < pyawaitable_array_LENGTH(&state->cache_generations);
+        ++i
+    ) {
+        long *generation = pyawaitable_array_GET_ITEM(
+            &state->cache_generations,
+            i
+        );
+        _PyAwaitable_ATOMIC_ADD_LONG(generation, 1);
     }
+    pyawaitable_array_clear(&state->cache_generations);
+    PyThread_release_lock(state->cache_lock);
+    PyThread_free_lock(state->cache_lock);
 
-    if (dict_add_type(state, &_PyAwaitableGenWrapperType) < 0) {
-        return -1;
+    if (state->soon != NULL) {
+        _PyAwaitable_SoonFree(state->soon);
     }
 
-    PyObject *version = PyLong_FromLong(PyAwaitable_MAGIC_NUMBER);
-    if (version == NULL) {
-        return -1;
+    if (state->timers != NULL) {
+        _PyAwaitable_TimersFree(state->timers);
     }
 
-    if (PyDict_SetItemString(state, "magic_version", version) < 0) {
-        Py_DECREF(version);
-        return -1;
+    if (state->hubs != NULL) {
+        _PyAwaitable_HubsFree(state->hubs);
     }
 
-    Py_DECREF(version);
-    return 0;
+    if (state->pool != NULL) {
+        _PyAwaitable_PoolShutdown(state->pool);
+    }
+
+    if (state->io != NULL) {
+        _PyAwaitable_IOFree(state->io);
+    }
+
+    if (state->fileio != NULL) {
+        _PyAwaitable_FileIOFree(state->fileio);
+    }
+
+    // This is normally closed at exit already. If it isn't, it's too late
+    // to wait for anything that's attached.
+    _PyAwaitable_GateClose(state->gate, 0);
+    _PyAwaitable_GateRelease(state->gate);
+
+    Py_XDECREF(state->awaitable_type);
+    Py_XDECREF(state->genwrapper_type);
+    Py_DECREF(state->driver_key);
+    Py_DECREF(state->driver);
+    PyMem_Free(state);
 }
 
 static PyObject *
 create_state(void)
 {
-    PyObject *state = PyDict_New();
+    pyawaitable_state *state = PyMem_Malloc(sizeof(pyawaitable_state));
     if (state == NULL) {
+        PyErr_NoMemory();
         return NULL;
     }
 
-    if (init_state(state) < 0) {
-        Py_DECREF(state);
+    state->magic_version = PyAwaitable_MAGIC_NUMBER;
+    state->awaitable_type = NULL;
+    state->genwrapper_type = NULL;
+    state->step_budget.default_budget = 0;
+    state->step_budget.total_hits = 0;
+    state->soon = NULL;
+    state->timers = NULL;
+    state->hubs = NULL;
+    state->pool = NULL;
+    state->io = NULL;
+    state->fileio = NULL;
+    state->capi = NULL;
+    state->driver_key = NULL;
+    memset(&state->driver_cache, 0, sizeof(pyawaitable_driver_cache));
+    state->driver = NULL;
+    state->gates = NULL;
+    if (
+        pyawaitable_array_init_with_size(
+            &state->cache_generations,
+            NULL,
+            2
+        ) < 0
+    ) {
+        PyMem_Free(state);
+        PyErr_NoMemory();
         return NULL;
     }
 
-    return state;
+    state->cache_lock = PyThread_allocate_lock();
+    if (state->cache_lock == NULL) {
+        pyawaitable_array_clear(&state->cache_generations);
+        PyMem_Free(state);
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    state->driver_key = PyUnicode_InternFromString(PyAwaitable_DRIVER_ATTR);
+    if (state->driver_key == NULL) {
+        goto error;
+    }
+
+    // Let other versions recognize our awaitables
+    state->driver = _PyAwaitable_NewDriverCapsule();
+    if (state->driver == NULL) {
+        goto error;
+    }
+
+    state->gate = _PyAwaitable_GateNew();
+    if (state->gate == NULL) {
+        goto error;
+    }
+
+    PyObject *capsule = PyCapsule_New(
+        state,
+        PYAWAITABLE_STATE_CAPSULE,
+        state_capsule_destructor
+    );
+    if (capsule == NULL) {
+        _PyAwaitable_GateClose(state->gate, 0);
+        _PyAwaitable_GateRelease(state->gate);
+        goto error;
+    }
+
+    return capsule;
+
+error:
+    pyawaitable_array_clear(&state->cache_generations);
+    PyThread_free_lock(state->cache_lock);
+    Py_XDECREF(state->driver_key);
+    Py_XDECREF(state->driver);
+    PyMem_Free(state);
+    return NULL;
 }
 
 static PyObject *
@@ -87,7 +256,7 @@ interp_get_dict(void)
     return interp_state;
 }
 
-static inline PyObject *
+static inline void *
 not_initialized(void)
 {
     PyErr_SetString(
@@ -98,281 +267,185 @@ not_initialized(void)
     return NULL;
 }
 
-static inline int
-state_corrupted(const char *err, PyObject *found)
+static pyawaitable_state *
+state_from_capsule(PyObject *capsule)
 {
-    assert(err != NULL);
-    assert(found != NULL);
-    PyErr_Format(
-        PyExc_SystemError,
-        "PyAwaitable corruption! %s: %R",
-        err,
-        found
+    assert(capsule != NULL);
+    pyawaitable_state *state = PyCapsule_GetPointer(
+        capsule,
+        PYAWAITABLE_STATE_CAPSULE
     );
-    Py_DECREF(found);
-    return -1;
-}
+    if (state == NULL) {
+        return NULL;
+    }
 
-static PyObject *
-get_state_value(PyObject *state, const char *name)
-{
-    assert(name != NULL);
-    PyObject *str = PyUnicode_FromString(name);
-    if (str == NULL) {
+    if (state->magic_version != PyAwaitable_MAGIC_NUMBER) {
+        PyErr_Format(
+            PyExc_SystemError,
+            "PyAwaitable corruption! Expected version %ld, got %ld",
+            (long)PyAwaitable_MAGIC_NUMBER,
+            state->magic_version
+        );
         return NULL;
     }
 
-    PyObject *version = PyDict_GetItemWithError(state, str);
-    Py_DECREF(str);
-    return version;
+    return state;
 }
 
-static long
-get_state_version(PyObject *state)
+/*
+ * Make sure that destroying the state invalidates this copy's cache, and
+ * that this copy shares its gates with the interpreter's other copies.
+ * Any thread can get here, so the generations are only touched under the
+ * state's cache lock.
+ */
+static int
+register_copy(pyawaitable_state *state)
 {
-    assert(state != NULL);
-    assert(PyDict_Check(state));
-
-    PyObject *version = get_state_value(state, "magic_version");
-    if (version == NULL) {
+    if (_PyAwaitable_GateRegister(&state->gates, state->gate) < 0) {
         return -1;
     }
 
-    if (!PyLong_CheckExact(version)) {
-        return state_corrupted("Non-int version number", version);
-    }
-
-    long version_num = PyLong_AsLong(version);
-    if (version_num == -1 && PyErr_Occurred()) {
-        Py_DECREF(version);
-        return -1;
-    }
-
-    if (version_num < 0) {
-        return state_corrupted("Found <0 version somehow", version);
-    }
-
-    return version_num;
-}
-
-static PyObject *
-find_module_for_version(PyObject *interp_dict, long version)
-{
-    PyObject *list = PyDict_GetItemString(interp_dict, "_pyawaitable_states");
-    if (list == NULL) {
-        return not_initialized();
+    int res = 0;
+    int found = 0;
+    PyThread_acquire_lock(state->cache_lock, WAIT_LOCK);
+    for (
+        Py_ssize_t i = 0;
+        i < pyawaitable_array_LENGTH(&state->cache_generations);
+        ++i
+    ) {
+        if (
+            pyawaitable_array_GET_ITEM(&state->cache_generations, i)
+            == &pyawaitable_state_generation
+        ) {
+            found = 1;
+            break;
+        }
     }
 
-    if (!PyList_CheckExact(list)) {
-        state_corrupted("_pyawaitable_states is not a list", list);
-        return NULL;
+    if (!found) {
+        res = pyawaitable_array_append(
+            &state->cache_generations,
+            &pyawaitable_state_generation
+        );
     }
+    PyThread_release_lock(state->cache_lock);
 
-    for (Py_ssize_t i = 0; i < PyList_GET_SIZE(list); ++i) {
-        PyObject *mod = PyList_GET_ITEM(list, i);
-        long got_version = get_state_version(mod);
-
-        if (got_version == -1) {
-            return NULL;
-        }
-
-        if (got_version == version) {
-            return mod;
-        }
+    if (res < 0) {
+        PyErr_NoMemory();
+        return -1;
     }
 
-    return not_initialized();
+    return 0;
 }
 
-static PyObject *
-find_top_level_state(PyObject **interp_dict)
+_PyAwaitable_INTERNAL(pyawaitable_state *)
+_PyAwaitable_GetStateSlow(void)
 {
+    PyInterpreterState *interp = PyInterpreterState_Get();
+    // Read this before the lookup, so that a state destroyed in between
+    // can't be cached under the new generation.
+    long generation = _PyAwaitable_ATOMIC_LOAD_LONG(
+        &pyawaitable_state_generation
+    );
     PyObject *dict = interp_get_dict();
     if (dict == NULL) {
         return NULL;
     }
 
-    PyObject *mod = PyDict_GetItemString(dict, "_pyawaitable_state");
-    if (mod == NULL) {
+    PyObject *capsule = PyDict_GetItemString(dict, PYAWAITABLE_STATE_KEY);
+    if (capsule == NULL) {
         return not_initialized();
     }
 
-    if (interp_dict != NULL) {
-        *interp_dict = dict;
-    }
-    return mod;
-}
-
-static PyAwaitable_thread_local PyObject *pyawaitable_fast_state = NULL;
-
-_PyAwaitable_INTERNAL(PyObject *)
-_PyAwaitable_GetState(void)
-{
-    if (pyawaitable_fast_state != NULL) {
-        return pyawaitable_fast_state;
-    }
-
-    PyObject *interp_dict;
-    PyObject *state = find_top_level_state(&interp_dict); // Borrowed reference
+    pyawaitable_state *state = state_from_capsule(capsule);
     if (state == NULL) {
         return NULL;
     }
 
-    long version = get_state_version(state);
-    if (version == -1) {
+    if (ready_types(state) < 0 || register_copy(state) < 0) {
         return NULL;
     }
 
-    if (version != PyAwaitable_MAGIC_NUMBER) {
-        // Not our module!
-        state = find_module_for_version(interp_dict, PyAwaitable_MAGIC_NUMBER);
-        if (state == NULL) {
-            return NULL;
-        }
-    }
-
-    // We want this to be a borrowed reference
+    // Only cache states that are fully usable; PyAwaitable_Init() relies
+    // on this.
+    pyawaitable_fast_interp = interp;
+    pyawaitable_fast_generation = generation;
     pyawaitable_fast_state = state;
     return state;
 }
 
-static PyAwaitable_thread_local PyTypeObject *pyawaitable_fast_aw = NULL;
-static PyAwaitable_thread_local PyTypeObject *pyawaitable_fast_gw = NULL;
-
 _PyAwaitable_API(PyTypeObject *)
 PyAwaitable_GetType(void)
 {
-    if (pyawaitable_fast_aw != NULL) {
-        return pyawaitable_fast_aw;
-    }
-    PyObject *state = _PyAwaitable_GetState();
-    if (state == NULL) {
+    _PyAwaitable_FORWARD(NULL, GetType());
+    pyawaitable_state *state = _PyAwaitable_GetState();
+    if (PyAwaitable_UNLIKELY(state == NULL)) {
         return NULL;
     }
 
-    PyTypeObject *pyawaitable_type = (PyTypeObject *)get_state_value(
-        state,
-        "_PyAwaitableType"
-    );
-    if (pyawaitable_type == NULL) {
-        return NULL;
-    }
-
-    // Should be an immortal reference
-    pyawaitable_fast_aw = pyawaitable_type;
-    return pyawaitable_type;
+    return state->awaitable_type;
 }
 
-
 _PyAwaitable_INTERNAL(PyTypeObject *)
 _PyAwaitable_GetGenWrapperType(void)
 {
-    if (pyawaitable_fast_gw != NULL) {
-        return pyawaitable_fast_gw;
-    }
-    PyObject *state = _PyAwaitable_GetState();
-    if (state == NULL) {
+    pyawaitable_state *state = _PyAwaitable_GetState();
+    if (PyAwaitable_UNLIKELY(state == NULL)) {
         return NULL;
     }
 
-    PyTypeObject *gw_type = (PyTypeObject *)get_state_value(
-        state,
-        "_PyAwaitableGenWrapperType"
-    );
-    if (gw_type == NULL) {
-        return NULL;
-    }
-
-    pyawaitable_fast_gw = gw_type;
-    return (PyTypeObject *)gw_type;
+    return state->genwrapper_type;
 }
 
-static int
-add_state_to_list(PyObject *interp_dict, PyObject *state)
+_PyAwaitable_INTERNAL(pyawaitable_step_budget *)
+_PyAwaitable_GetStepBudget(void)
 {
-    assert(interp_dict != NULL);
-    assert(state != NULL);
-    assert(PyDict_Check(interp_dict));
-    assert(PyDict_Check(state));
-
-    PyObject *pyawaitable_list = Py_XNewRef(
-        PyDict_GetItemString(
-            interp_dict,
-            "_pyawaitable_states"
-        )
-    );
-    if (pyawaitable_list == NULL) {
-        // No list has been set
-        pyawaitable_list = PyList_New(1);
-        if (pyawaitable_list == NULL) {
-            // Memory error
-            return -1;
-        }
-
-        if (
-            PyDict_SetItemString(
-                interp_dict,
-                "_pyawaitable_states",
-                pyawaitable_list
-            ) < 0
-        ) {
-            Py_DECREF(pyawaitable_list);
-            return -1;
-        }
-    }
-
-    if (PyList_Append(pyawaitable_list, state) < 0) {
-        Py_DECREF(pyawaitable_list);
-        return -1;
+    pyawaitable_state *state = _PyAwaitable_GetState();
+    if (PyAwaitable_UNLIKELY(state == NULL)) {
+        return NULL;
     }
 
-    Py_DECREF(pyawaitable_list);
-    return 0;
+    return &state->step_budget;
 }
 
 _PyAwaitable_API(int)
 PyAwaitable_Init(void)
 {
-    PyObject *dict = interp_get_dict();
-    if (dict == NULL) {
-        return -1;
+    if (_PyAwaitable_IsStateCached(PyInterpreterState_Get())) {
+        // We've already used the state from this thread
+        return 0;
     }
 
-    PyObject *state = create_state();
-    if (state == NULL) {
+    PyObject *dict = interp_get_dict();
+    if (dict == NULL) {
         return -1;
     }
 
-    PyObject *existing = PyDict_GetItemString(dict, "_pyawaitable_state");
-    if (existing != NULL) {
-        /* Oh no, PyAwaitable has been used twice! */
-        long version = get_state_version(existing);
-        if (version == -1) {
-            Py_DECREF(state);
+    // If another extension already initialized this version of
+    // PyAwaitable, then we can just share it.
+    PyObject *capsule = PyDict_GetItemString(dict, PYAWAITABLE_STATE_KEY);
+    if (capsule == NULL) {
+        capsule = create_state();
+        if (capsule == NULL) {
             return -1;
         }
 
-        if (version == PyAwaitable_MAGIC_NUMBER) {
-            // Yay! It just happens that it's the same version as us.
-            // Let's just reuse it.
-            Py_DECREF(state);
-            return 0;
-        }
-
-        if (add_state_to_list(dict, state) < 0) {
-            Py_DECREF(state);
+        int res = PyDict_SetItemString(dict, PYAWAITABLE_STATE_KEY, capsule);
+        Py_DECREF(capsule);
+        if (res < 0) {
             return -1;
         }
-
-        Py_DECREF(state);
-        return 0;
+        // The dictionary holds a reference now.
     }
 
-    if (PyDict_SetItemString(dict, "_pyawaitable_state", state) < 0) {
-        Py_DECREF(state);
+    pyawaitable_state *state = state_from_capsule(capsule);
+    if (state == NULL || register_copy(state) < 0) {
         return -1;
     }
 
-    Py_DECREF(state);
+#ifdef PYAWAITABLE_SHARED
+    return _PyAwaitable_BindCAPI(state, dict);
+#else
     return 0;
+#endif
 }
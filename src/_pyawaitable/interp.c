@@ -0,0 +1,198 @@
+#include <Python.h>
+#include <string.h>
+
+#include <pyawaitable/awaitableobject.h>
+#include <pyawaitable/backport.h>
+#include <pyawaitable/capi.h>
+#include <pyawaitable/future.h>
+#include <pyawaitable/gate.h>
+#include <pyawaitable/init.h>
+#include <pyawaitable/interp.h>
+#include <pyawaitable/optimize.h>
+#include <pyawaitable/pool.h>
+
+/* This might be called without a thread state */
+static void
+interp_call_free(void *ptr)
+{
+    pyawaitable_interp_call *call = (pyawaitable_interp_call *)ptr;
+    assert(call != NULL);
+    _PyAwaitable_GateRelease(call->gate);
+    PyMem_RawFree(call->error);
+    PyMem_RawFree(call);
+}
+
+/* Fail the call with a fixed message; there's no exception to describe */
+static void
+interp_call_fail(pyawaitable_interp_call *call, const char *message)
+{
+    size_t size = strlen(message) + 1;
+    call->failed = 1;
+    call->error = PyMem_RawMalloc(size);
+    if (call->error != NULL) {
+        memcpy(call->error, message, size);
+    }
+}
+
+/*
+ * Store a description of the current exception, because exception objects
+ * can't cross the interpreter boundary.
+ */
+static void
+interp_call_save_error(pyawaitable_interp_call *call)
+{
+    assert(PyErr_Occurred());
+    PyObject *exc = PyErr_GetRaisedException();
+    PyObject *str = PyObject_Str(exc);
+    const char *utf8 = str != NULL ? PyUnicode_AsUTF8(str) : NULL;
+    if (utf8 == NULL) {
+        PyErr_Clear();
+        utf8 = "<exception str() failed>";
+    }
+
+    const char *name = Py_TYPE(exc)->tp_name;
+    size_t size = strlen(name) + strlen(utf8) + 3;
+    call->failed = 1;
+    call->error = PyMem_RawMalloc(size);
+    if (call->error != NULL) {
+        PyOS_snprintf(call->error, size, "%s: %s", name, utf8);
+    }
+
+    Py_XDECREF(str);
+    Py_DECREF(exc);
+}
+
+/* Runs on a worker thread from the calling interpreter's pool */
+static void
+interp_call_run(pyawaitable_job *job)
+{
+    pyawaitable_interp_call *call = (pyawaitable_interp_call *)job;
+    // The gate keeps the interpreter from finalizing until we're done
+    PyThreadState *tstate = _PyAwaitable_GateAttach(call->gate);
+    if (tstate == NULL) {
+        interp_call_fail(
+            call,
+            "RuntimeError: Couldn't attach to the target interpreter, "
+            "which is most likely exiting"
+        );
+    }
+    else {
+        if (call->func(call->payload, &call->result) < 0) {
+            interp_call_save_error(call);
+        }
+        _PyAwaitable_GateDetach(call->gate, tstate);
+    }
+
+    // Completing the future doesn't need a thread state in the calling
+    // interpreter. Once it's completed, the future owns the call.
+    PyAwaitable_Complete(call->future, call);
+}
+
+static void
+interp_call_discard(pyawaitable_job *job)
+{
+    // The call is freed along with the future
+}
+
+/* Runs on the calling interpreter's event loop, once the call is done */
+static int
+interp_call_done(PyObject *awaitable, void *result, void *arg)
+{
+    pyawaitable_interp_call *call = (pyawaitable_interp_call *)result;
+    if (call->failed) {
+        // The original exception is described as "name: message"
+        PyErr_Format(
+            PyExc_RuntimeError,
+            "PyAwaitable: Call in another interpreter failed with %s",
+            call->error != NULL ? call->error : "MemoryError"
+        );
+        return -1;
+    }
+
+    if (call->result_callback == NULL) {
+        return 0;
+    }
+
+    return call->result_callback(awaitable, call->result, call->payload);
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_AddInterpreterCall(
+    PyObject * awaitable,
+    PyInterpreterState * interp,
+    PyAwaitable_InterpreterFunc func,
+    void *payload,
+    PyAwaitable_NoGILResult result_callback
+)
+{
+    _PyAwaitable_FORWARD(
+        -1,
+        AddInterpreterCall(awaitable, interp, func, payload, result_callback)
+    );
+    if (interp == NULL || func == NULL) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "PyAwaitable: NULL passed to PyAwaitable_AddInterpreterCall()"
+        );
+        return -1;
+    }
+
+    pyawaitable_state *state = _PyAwaitable_GetState();
+    if (PyAwaitable_UNLIKELY(state == NULL)) {
+        return -1;
+    }
+
+    // Gates are found through the registry that this interpreter shares
+    // with other copies, so the target doesn't need to have been
+    // initialized by this one.
+    pyawaitable_gate *gate = _PyAwaitable_GateFind(
+        _PyAwaitable_ATOMIC_LOAD_PTR(&state->gates),
+        interp
+    );
+    if (gate == NULL) {
+        PyErr_SetString(
+            PyExc_RuntimeError,
+            "PyAwaitable: The target interpreter is exiting, or hasn't "
+            "called PyAwaitable_Init()"
+        );
+        return -1;
+    }
+
+    pyawaitable_interp_call *call = PyMem_RawMalloc(
+        sizeof(pyawaitable_interp_call)
+    );
+    if (call == NULL) {
+        _PyAwaitable_GateRelease(gate);
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    call->job.next = NULL;
+    call->job.prev = NULL;
+    call->job.run = interp_call_run;
+    call->job.discard = interp_call_discard;
+    call->gate = gate;
+    call->func = func;
+    call->payload = payload;
+    call->result_callback = result_callback;
+    call->result = NULL;
+    call->failed = 0;
+    call->error = NULL;
+    // The job is submitted to the pool once the step starts, so a call
+    // ties up at most one worker, and never needs a thread of its own.
+    call->future = _PyAwaitable_AddJobFuture(
+        awaitable,
+        interp_call_done,
+        NULL,
+        &call->job
+    );
+    if (call->future == NULL) {
+        interp_call_free(call);
+        return -1;
+    }
+
+    // Nothing can start the step yet, so the call can be handed over
+    call->future->result = call;
+    call->future->free_result = interp_call_free;
+    return 0;
+}
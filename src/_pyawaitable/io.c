@@ -0,0 +1,1365 @@
+#include <Python.h>
+
+#include <pyawaitable/awaitableobject.h>
+#include <pyawaitable/backport.h>
+#include <pyawaitable/capi.h>
+#include <pyawaitable/gather.h>
+#include <pyawaitable/init.h>
+#include <pyawaitable/io.h>
+#include <pyawaitable/optimize.h>
+#include <pyawaitable/values.h>
+
+#ifndef _WIN32
+#  include <sys/uio.h>
+#  include <unistd.h>
+#endif
+
+#define PYAWAITABLE_WATCH_CAPSULE "pyawaitable.watch"
+#define PYAWAITABLE_WRITER_CAPSULE "pyawaitable.writer"
+
+static const char *const io_loop_methods[] = {
+    "add_reader",
+    "remove_reader",
+    "add_writer",
+    "remove_writer"
+};
+
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_IOFree(pyawaitable_io *io)
+{
+    assert(io != NULL);
+    Py_XDECREF(io->get_running_loop);
+    Py_XDECREF(io->ready);
+    Py_XDECREF(io->loop);
+    for (int i = 0; i < 4; ++i) {
+        Py_XDECREF(io->methods[i]);
+    }
+    Py_XDECREF(io->flush);
+    PyMem_Free(io);
+}
+
+static pyawaitable_io *
+get_io_state(void);
+
+/*
+ * Get a new reference to one of the loop's methods, which is cached for
+ * the last loop that was used.
+ */
+static PyObject *
+io_method(pyawaitable_io *io, PyObject *loop, int which)
+{
+    PyObject *method = NULL;
+    int failed = 0;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(io->ready);
+    if (io->loop != loop) {
+        PyObject *methods[4] = {NULL};
+        for (int i = 0; i < 4; ++i) {
+            methods[i] = PyObject_GetAttrString(loop, io_loop_methods[i]);
+            if (methods[i] == NULL) {
+                failed = 1;
+                break;
+            }
+        }
+
+        if (failed) {
+            for (int i = 0; i < 4; ++i) {
+                Py_XDECREF(methods[i]);
+            }
+        } else {
+            Py_XSETREF(io->loop, Py_NewRef(loop));
+            for (int i = 0; i < 4; ++i) {
+                Py_XSETREF(io->methods[i], methods[i]);
+            }
+        }
+    }
+
+    if (!failed && io->loop == loop) {
+        method = Py_NewRef(io->methods[which]);
+    }
+    _PyAwaitable_END_CRITICAL_SECTION();
+    return method;
+}
+
+/* Stop watching the fd, if the loop is watching it */
+static int
+watch_unregister(pyawaitable_io *io, pyawaitable_watch *watch)
+{
+    if (watch->loop == NULL) {
+        return 0;
+    }
+
+    PyObject *loop = watch->loop;
+    watch->loop = NULL;
+    PyObject *method = io_method(
+        io,
+        loop,
+        watch->writable
+        ? _PyAwaitable_IO_REMOVE_WRITER
+        : _PyAwaitable_IO_REMOVE_READER
+    );
+    Py_DECREF(loop);
+    if (method == NULL) {
+        return -1;
+    }
+
+    PyObject *res = PyObject_CallFunction(method, "i", watch->fd);
+    Py_DECREF(method);
+    if (res == NULL) {
+        return -1;
+    }
+
+    Py_DECREF(res);
+    return 0;
+}
+
+/* Resolve the future with None, or fail it with error if that's given */
+static int
+io_resolve(PyObject *future, PyObject *error)
+{
+    int res = error == NULL
+        ? _PyAwaitable_ResolveFuture(future, "set_result", Py_None)
+        : _PyAwaitable_ResolveFuture(future, "set_exception", error);
+    return res < 0 ? -1 : 0;
+}
+
+/* Called by the event loop once a watched fd is ready */
+static PyObject *
+watch_ready_callback(PyObject *self, PyObject *capsule)
+{
+    pyawaitable_watch *watch = PyCapsule_GetPointer(
+        capsule,
+        PYAWAITABLE_WATCH_CAPSULE
+    );
+    if (watch == NULL) {
+        return NULL;
+    }
+
+    pyawaitable_io *io = get_io_state();
+    if (PyAwaitable_UNLIKELY(io == NULL)) {
+        return NULL;
+    }
+
+    // Each wait only fires once, so that the loop doesn't spin on an fd
+    // that nobody is reading from.
+    if (watch_unregister(io, watch) < 0) {
+        return NULL;
+    }
+
+    if (watch->future != NULL && io_resolve(watch->future, NULL) < 0) {
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef watch_ready_def = {
+    "_pyawaitable_fd_ready",
+    watch_ready_callback,
+    METH_O,
+    NULL
+};
+
+#ifndef _WIN32
+static PyObject *
+writer_on_writable(PyObject *self, PyObject *capsule);
+
+static PyMethodDef writer_writable_def = {
+    "_pyawaitable_writer_flush",
+    writer_on_writable,
+    METH_O,
+    NULL
+};
+#endif
+
+static pyawaitable_io *
+io_state_new(void)
+{
+    pyawaitable_io *io = PyMem_Malloc(sizeof(pyawaitable_io));
+    if (io == NULL) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    io->get_running_loop = NULL;
+    io->ready = NULL;
+    io->loop = NULL;
+    for (int i = 0; i < 4; ++i) {
+        io->methods[i] = NULL;
+    }
+    io->flush = NULL;
+
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (asyncio == NULL) {
+        _PyAwaitable_IOFree(io);
+        return NULL;
+    }
+
+    io->get_running_loop = PyObject_GetAttrString(asyncio, "get_running_loop");
+    Py_DECREF(asyncio);
+    if (io->get_running_loop == NULL) {
+        _PyAwaitable_IOFree(io);
+        return NULL;
+    }
+
+    io->ready = PyCFunction_New(&watch_ready_def, NULL);
+    if (io->ready == NULL) {
+        _PyAwaitable_IOFree(io);
+        return NULL;
+    }
+
+#ifndef _WIN32
+    io->flush = PyCFunction_New(&writer_writable_def, NULL);
+    if (io->flush == NULL) {
+        _PyAwaitable_IOFree(io);
+        return NULL;
+    }
+#endif
+
+    return io;
+}
+
+static pyawaitable_io *
+get_io_state(void)
+{
+    _PyAwaitable_LAZY_STATE(io, io_state_new, _PyAwaitable_IOFree);
+}
+
+static void
+watch_capsule_destructor(PyObject *capsule)
+{
+    pyawaitable_watch *watch = PyCapsule_GetPointer(
+        capsule,
+        PYAWAITABLE_WATCH_CAPSULE
+    );
+    if (watch == NULL) {
+        PyErr_WriteUnraisable(capsule);
+        return;
+    }
+
+    if (watch->loop != NULL) {
+        // The loop holds the capsule while it's watching, so it must have
+        // been closed. This is rare enough to skip the cache (and the
+        // state, which might already be gone).
+        PyObject *err = PyErr_GetRaisedException();
+        PyObject *res = PyObject_CallMethod(
+            watch->loop,
+            watch->writable ? "remove_writer" : "remove_reader",
+            "i",
+            watch->fd
+        );
+        if (res == NULL) {
+            PyErr_WriteUnraisable(watch->loop);
+        } else {
+            Py_DECREF(res);
+        }
+        if (err != NULL) {
+            PyErr_SetRaisedException(err);
+        }
+        Py_CLEAR(watch->loop);
+    }
+
+    Py_CLEAR(watch->future);
+    watch->free(watch);
+}
+
+static int
+watch_done(PyObject *inner, PyObject *unused, void *arg)
+{
+    pyawaitable_watch *watch = (pyawaitable_watch *)arg;
+    assert(watch->loop == NULL);
+    Py_CLEAR(watch->future);
+    return watch->ready(inner, watch);
+}
+
+static int
+watch_error(PyObject *inner, PyObject *err, void *arg)
+{
+    // Most likely, we were cancelled, so the loop is still watching
+    pyawaitable_watch *watch = (pyawaitable_watch *)arg;
+    Py_CLEAR(watch->future);
+    if (watch->loop == NULL) {
+        return -1;
+    }
+
+    pyawaitable_io *io = get_io_state();
+    if (PyAwaitable_UNLIKELY(io == NULL)) {
+        return -2;
+    }
+
+    return watch_unregister(io, watch) < 0 ? -2 : -1;
+}
+
+_PyAwaitable_INTERNAL(pyawaitable_watch *)
+_PyAwaitable_GetWatch(PyObject *inner)
+{
+    PyObject *capsule = PyAwaitable_GetValue(inner, 0);
+    if (capsule == NULL) {
+        return NULL;
+    }
+
+    return PyCapsule_GetPointer(capsule, PYAWAITABLE_WATCH_CAPSULE);
+}
+
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_WatchWait(PyObject *inner)
+{
+    PyObject *capsule = PyAwaitable_GetValue(inner, 0);
+    if (capsule == NULL) {
+        return -1;
+    }
+
+    pyawaitable_watch *watch = PyCapsule_GetPointer(
+        capsule,
+        PYAWAITABLE_WATCH_CAPSULE
+    );
+    if (watch == NULL) {
+        return -1;
+    }
+
+    assert(watch->loop == NULL);
+    assert(watch->future == NULL);
+    pyawaitable_io *io = get_io_state();
+    if (PyAwaitable_UNLIKELY(io == NULL)) {
+        return -1;
+    }
+
+    PyObject *loop = PyObject_CallNoArgs(io->get_running_loop);
+    if (loop == NULL) {
+        return -1;
+    }
+
+    PyObject *future = PyObject_CallMethod(loop, "create_future", NULL);
+    if (future == NULL) {
+        Py_DECREF(loop);
+        return -1;
+    }
+
+    PyObject *add = io_method(
+        io,
+        loop,
+        watch->writable ? _PyAwaitable_IO_ADD_WRITER : _PyAwaitable_IO_ADD_READER
+    );
+    if (add == NULL) {
+        Py_DECREF(future);
+        Py_DECREF(loop);
+        return -1;
+    }
+
+    PyObject *res = PyObject_CallFunction(
+        add,
+        "iOO",
+        watch->fd,
+        io->ready,
+        capsule
+    );
+    Py_DECREF(add);
+    if (res == NULL) {
+        Py_DECREF(future);
+        Py_DECREF(loop);
+        return -1;
+    }
+    Py_DECREF(res);
+
+    watch->loop = loop;
+    watch->future = future;
+    if (
+        PyAwaitable_AddAwaitEx(
+            inner,
+            future,
+            watch_done,
+            watch_error,
+            watch
+        ) < 0
+    ) {
+        Py_CLEAR(watch->future);
+        if (watch_unregister(io, watch) < 0) {
+            PyErr_WriteUnraisable(capsule);
+        }
+        return -1;
+    }
+
+    return 0;
+}
+
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_AddWatchStep(
+    PyObject *awaitable,
+    pyawaitable_watch *watch,
+    PyAwaitable_Defer start
+)
+{
+    watch->loop = NULL;
+    watch->future = NULL;
+    PyObject *capsule = PyCapsule_New(
+        watch,
+        PYAWAITABLE_WATCH_CAPSULE,
+        watch_capsule_destructor
+    );
+    if (capsule == NULL) {
+        watch->free(watch);
+        return -1;
+    }
+
+    PyObject *inner = _PyAwaitable_NewInner(awaitable);
+    if (inner == NULL) {
+        Py_DECREF(capsule);
+        return -1;
+    }
+
+    if (PyAwaitable_SaveValues(inner, 1, capsule) < 0) {
+        Py_DECREF(capsule);
+        PyAwaitable_Cancel(inner);
+        Py_DECREF(inner);
+        return -1;
+    }
+    Py_DECREF(capsule);
+
+    // The fd can only be registered once we're running on the loop
+    if (
+        PyAwaitable_DeferAwait(inner, start) < 0
+        || PyAwaitable_AddAwait(awaitable, inner, NULL, NULL) < 0
+    ) {
+        PyAwaitable_Cancel(inner);
+        Py_DECREF(inner);
+        return -1;
+    }
+
+    Py_DECREF(inner);
+    return 0;
+}
+
+/* A step that waits for readiness, and then calls back with the fd */
+typedef struct _pyawaitable_fd_step {
+    pyawaitable_watch watch;
+    PyAwaitable_FDCallback cb;
+} _PyAwaitable_MANGLE(pyawaitable_fd_step);
+
+static void
+fd_step_free(pyawaitable_watch *watch)
+{
+    PyMem_Free(watch);
+}
+
+static int
+fd_step_ready(PyObject *inner, pyawaitable_watch *watch)
+{
+    pyawaitable_fd_step *step = (pyawaitable_fd_step *)watch;
+    if (step->cb == NULL) {
+        return 0;
+    }
+
+    PyObject *awaitable = PyAwaitable_GetArbValue(inner, 0);
+    if (awaitable == NULL) {
+        return -1;
+    }
+
+    return step->cb(awaitable, watch->fd);
+}
+
+static int
+add_fd_step(
+    PyObject *awaitable,
+    int fd,
+    PyAwaitable_FDCallback cb,
+    int writable
+)
+{
+    if (fd < 0) {
+        PyErr_Format(
+            PyExc_ValueError,
+            "PyAwaitable: Invalid file descriptor: %d",
+            fd
+        );
+        return -1;
+    }
+
+    pyawaitable_fd_step *step = PyMem_Malloc(sizeof(pyawaitable_fd_step));
+    if (step == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    step->watch.ready = fd_step_ready;
+    step->watch.free = fd_step_free;
+    step->watch.fd = fd;
+    step->watch.writable = writable;
+    step->cb = cb;
+    return _PyAwaitable_AddWatchStep(
+        awaitable,
+        &step->watch,
+        _PyAwaitable_WatchWait
+    );
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_AddReadable(
+    PyObject * awaitable,
+    int fd,
+    PyAwaitable_FDCallback cb
+)
+{
+    _PyAwaitable_FORWARD(-1, AddReadable(awaitable, fd, cb));
+    return add_fd_step(awaitable, fd, cb, 0);
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_AddWritable(
+    PyObject * awaitable,
+    int fd,
+    PyAwaitable_FDCallback cb
+)
+{
+    _PyAwaitable_FORWARD(-1, AddWritable(awaitable, fd, cb));
+    return add_fd_step(awaitable, fd, cb, 1);
+}
+
+/* A step that reads into a buffer until it's full, or the fd hits EOF */
+typedef struct _pyawaitable_readinto {
+    pyawaitable_watch watch;
+    PyAwaitable_ReadCallback cb;
+    char *buffer;
+    Py_ssize_t size;
+    Py_ssize_t filled;
+    /* Only set when we hold a buffer export from an object */
+    Py_buffer view;
+    int has_view;
+} _PyAwaitable_MANGLE(pyawaitable_readinto);
+
+#ifndef _WIN32
+static void
+readinto_free(pyawaitable_watch *watch)
+{
+    pyawaitable_readinto *step = (pyawaitable_readinto *)watch;
+    if (step->has_view) {
+        PyBuffer_Release(&step->view);
+    }
+    PyMem_Free(step);
+}
+
+/*
+ * Read as much as the fd has, and only wait on the loop once it would
+ * block. A full buffer usually costs no extra trips through the selector.
+ */
+static int
+readinto_fill(PyObject *inner, pyawaitable_watch *watch)
+{
+    pyawaitable_readinto *step = (pyawaitable_readinto *)watch;
+    while (step->filled < step->size) {
+        Py_ssize_t n = (Py_ssize_t)read(
+            watch->fd,
+            step->buffer + step->filled,
+            (size_t)(step->size - step->filled)
+        );
+        if (n > 0) {
+            step->filled += n;
+            continue;
+        }
+
+        if (n == 0) {
+            // EOF
+            break;
+        }
+
+        if (errno == EINTR) {
+            if (PyErr_CheckSignals() < 0) {
+                return -1;
+            }
+            continue;
+        }
+
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return _PyAwaitable_WatchWait(inner);
+        }
+
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+
+    if (step->cb == NULL) {
+        return 0;
+    }
+
+    PyObject *awaitable = PyAwaitable_GetArbValue(inner, 0);
+    if (awaitable == NULL) {
+        return -1;
+    }
+
+    return step->cb(awaitable, step->buffer, step->filled);
+}
+
+static int
+readinto_start(PyObject *inner)
+{
+    pyawaitable_watch *watch = _PyAwaitable_GetWatch(inner);
+    if (watch == NULL) {
+        return -1;
+    }
+
+    return readinto_fill(inner, watch);
+}
+#endif
+
+/* This takes ownership of view, if it's given */
+static int
+add_readinto_step(
+    PyObject *awaitable,
+    int fd,
+    void *buffer,
+    Py_ssize_t size,
+    Py_buffer *view,
+    PyAwaitable_ReadCallback cb
+)
+{
+#ifdef _WIN32
+    PyErr_SetString(
+        PyExc_NotImplementedError,
+        "PyAwaitable: Reading into a buffer is not supported on Windows"
+    );
+    goto error;
+#else
+    pyawaitable_readinto *step;
+    if (fd < 0) {
+        PyErr_Format(
+            PyExc_ValueError,
+            "PyAwaitable: Invalid file descriptor: %d",
+            fd
+        );
+        goto error;
+    }
+
+    if (size < 0) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "PyAwaitable: Buffer size cannot be negative"
+        );
+        goto error;
+    }
+
+    if (buffer == NULL && size != 0) {
+        PyErr_SetString(PyExc_ValueError, "PyAwaitable: Buffer cannot be NULL");
+        goto error;
+    }
+
+    step = PyMem_Malloc(sizeof(pyawaitable_readinto));
+    if (step == NULL) {
+        PyErr_NoMemory();
+        goto error;
+    }
+
+    step->watch.ready = readinto_fill;
+    step->watch.free = readinto_free;
+    step->watch.fd = fd;
+    step->watch.writable = 0;
+    step->cb = cb;
+    step->buffer = buffer;
+    step->size = size;
+    step->filled = 0;
+    step->has_view = view != NULL;
+    if (view != NULL) {
+        step->view = *view;
+    }
+
+    // The watch owns the view from here on
+    return _PyAwaitable_AddWatchStep(awaitable, &step->watch, readinto_start);
+#endif
+
+error:
+    if (view != NULL) {
+        PyBuffer_Release(view);
+    }
+    return -1;
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_AddReadInto(
+    PyObject * awaitable,
+    int fd,
+    void *buffer,
+    Py_ssize_t size,
+    PyAwaitable_ReadCallback cb
+)
+{
+    _PyAwaitable_FORWARD(-1, AddReadInto(awaitable, fd, buffer, size, cb));
+    return add_readinto_step(awaitable, fd, buffer, size, NULL, cb);
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_AddReadIntoBuffer(
+    PyObject * awaitable,
+    int fd,
+    PyObject * obj,
+    PyAwaitable_ReadCallback cb
+)
+{
+    _PyAwaitable_FORWARD(-1, AddReadIntoBuffer(awaitable, fd, obj, cb));
+    Py_buffer view;
+    if (PyObject_GetBuffer(obj, &view, PyBUF_WRITABLE) < 0) {
+        return -1;
+    }
+
+    return add_readinto_step(awaitable, fd, view.buf, view.len, &view, cb);
+}
+
+#ifndef _WIN32
+/* Smallest allocation that copied writes are coalesced into */
+#define _PyAwaitable_WRITER_CHUNK 4096
+/* Buffer objects smaller than this are copied instead of held */
+#define _PyAwaitable_WRITER_COPY_MAX 256
+/* Most buffers that a single writev() is given */
+#define _PyAwaitable_WRITER_IOV 64
+
+static void
+wbuf_release(pyawaitable_wbuf *buf)
+{
+    if (buf->capacity != 0) {
+        PyMem_Free(buf->data);
+    } else {
+        PyBuffer_Release(&buf->view);
+    }
+}
+
+static pyawaitable_wbuf *
+writer_at(pyawaitable_writer *writer, Py_ssize_t index)
+{
+    assert(index >= 0 && index < writer->length);
+    return &writer->queue[(writer->head + index) % writer->capacity];
+}
+
+static void
+writer_clear(pyawaitable_writer *writer)
+{
+    for (Py_ssize_t i = 0; i < writer->length; ++i) {
+        wbuf_release(writer_at(writer, i));
+    }
+    writer->head = 0;
+    writer->length = 0;
+    writer->queued = 0;
+}
+
+static void
+writer_free(pyawaitable_writer *writer)
+{
+    writer_clear(writer);
+    PyMem_Free(writer->queue);
+    Py_XDECREF(writer->loop);
+    Py_XDECREF(writer->error);
+    Py_XDECREF(writer->drain_waiters);
+    Py_XDECREF(writer->flush_waiters);
+    PyMem_Free(writer);
+}
+
+/* Get a new buffer at the back of the queue, which the caller fills in */
+static pyawaitable_wbuf *
+writer_push(pyawaitable_writer *writer)
+{
+    if (writer->length == writer->capacity) {
+        Py_ssize_t capacity = writer->capacity == 0 ? 8 : writer->capacity * 2;
+        pyawaitable_wbuf *queue = PyMem_New(pyawaitable_wbuf, capacity);
+        if (queue == NULL) {
+            PyErr_NoMemory();
+            return NULL;
+        }
+
+        // Unroll the ring, so the oldest buffer is at the start again
+        for (Py_ssize_t i = 0; i < writer->length; ++i) {
+            queue[i] = *writer_at(writer, i);
+        }
+        PyMem_Free(writer->queue);
+        writer->queue = queue;
+        writer->head = 0;
+        writer->capacity = capacity;
+    }
+
+    ++writer->length;
+    return writer_at(writer, writer->length - 1);
+}
+
+/* Drop size bytes that were written from the front of the queue */
+static void
+writer_consume(pyawaitable_writer *writer, Py_ssize_t size)
+{
+    writer->queued -= size;
+    while (size > 0) {
+        pyawaitable_wbuf *buf = writer_at(writer, 0);
+        Py_ssize_t left = buf->size - buf->offset;
+        if (size < left) {
+            buf->offset += size;
+            return;
+        }
+
+        size -= left;
+        wbuf_release(buf);
+        writer->head = (writer->head + 1) % writer->capacity;
+        --writer->length;
+    }
+}
+
+/* Resolve (or fail) every future that's waiting in the list */
+static void
+writer_wake(PyObject *waiters, PyObject *error)
+{
+    Py_ssize_t size = PyList_GET_SIZE(waiters);
+    if (size == 0) {
+        return;
+    }
+
+    PyObject *futures = PyList_GetSlice(waiters, 0, size);
+    if (futures == NULL || PyList_SetSlice(waiters, 0, size, NULL) < 0) {
+        Py_XDECREF(futures);
+        PyErr_WriteUnraisable(waiters);
+        return;
+    }
+
+    for (Py_ssize_t i = 0; i < size; ++i) {
+        PyObject *future = PyList_GET_ITEM(futures, i);
+        if (io_resolve(future, error) < 0) {
+            PyErr_WriteUnraisable(future);
+        }
+    }
+    Py_DECREF(futures);
+}
+
+/* Register or unregister the fd with the loop's add_writer() */
+static int
+writer_watch(
+    pyawaitable_io *io,
+    PyObject *capsule,
+    pyawaitable_writer *writer,
+    int watching
+)
+{
+    PyObject *method = io_method(
+        io,
+        writer->loop,
+        watching ? _PyAwaitable_IO_ADD_WRITER : _PyAwaitable_IO_REMOVE_WRITER
+    );
+    if (method == NULL) {
+        return -1;
+    }
+
+    PyObject *res = watching
+        ? PyObject_CallFunction(method, "iOO", writer->fd, io->flush, capsule)
+        : PyObject_CallFunction(method, "i", writer->fd);
+    Py_DECREF(method);
+    if (res == NULL) {
+        return -1;
+    }
+
+    Py_DECREF(res);
+    writer->watching = watching;
+    return 0;
+}
+
+/*
+ * Stop the writer with the current exception. Everything that's queued is
+ * dropped, and everyone waiting on the writer gets the exception.
+ */
+static void
+writer_fail(pyawaitable_io *io, PyObject *capsule, pyawaitable_writer *writer)
+{
+    PyObject *err = PyErr_GetRaisedException();
+    assert(err != NULL);
+    if (
+        writer->watching
+        && (io == NULL || writer_watch(io, capsule, writer, 0) < 0)
+    ) {
+        PyErr_WriteUnraisable(capsule);
+    }
+
+    writer_clear(writer);
+    Py_XSETREF(writer->error, err);
+    writer_wake(writer->drain_waiters, err);
+    writer_wake(writer->flush_waiters, err);
+}
+
+/*
+ * Write as much of the queue as the fd will take, with one writev() for
+ * each batch of buffers, and watch the fd for whatever is left over.
+ */
+static void
+writer_flush(PyObject *capsule, pyawaitable_writer *writer)
+{
+    pyawaitable_io *io = get_io_state();
+    if (PyAwaitable_UNLIKELY(io == NULL)) {
+        writer_fail(io, capsule, writer);
+        return;
+    }
+
+    while (writer->length > 0) {
+        struct iovec iov[_PyAwaitable_WRITER_IOV];
+        int count = (int)Py_MIN(writer->length, _PyAwaitable_WRITER_IOV);
+        Py_ssize_t total = 0;
+        for (int i = 0; i < count; ++i) {
+            pyawaitable_wbuf *buf = writer_at(writer, i);
+            iov[i].iov_base = buf->data + buf->offset;
+            iov[i].iov_len = (size_t)(buf->size - buf->offset);
+            total += buf->size - buf->offset;
+        }
+
+        Py_ssize_t written = (Py_ssize_t)writev(writer->fd, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                if (PyErr_CheckSignals() < 0) {
+                    writer_fail(io, capsule, writer);
+                    return;
+                }
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+
+            PyErr_SetFromErrno(PyExc_OSError);
+            writer_fail(io, capsule, writer);
+            return;
+        }
+
+        writer_consume(writer, written);
+        if (written < total) {
+            // The fd is full, so don't bother trying again right away
+            break;
+        }
+    }
+
+    if (writer->watching != (writer->length > 0)) {
+        if (writer_watch(io, capsule, writer, writer->length > 0) < 0) {
+            writer_fail(io, capsule, writer);
+            return;
+        }
+    }
+
+    if (writer->queued <= writer->high_water) {
+        writer_wake(writer->drain_waiters, NULL);
+    }
+
+    if (writer->queued == 0) {
+        writer_wake(writer->flush_waiters, NULL);
+    }
+}
+
+/* Called by the event loop once the fd is writable */
+static PyObject *
+writer_on_writable(PyObject *self, PyObject *capsule)
+{
+    pyawaitable_writer *writer = PyCapsule_GetPointer(
+        capsule,
+        PYAWAITABLE_WRITER_CAPSULE
+    );
+    if (writer == NULL) {
+        return NULL;
+    }
+
+    if (writer->error == NULL) {
+        writer_flush(capsule, writer);
+    }
+    Py_RETURN_NONE;
+}
+
+/* Flushes everything that was written since the flush was scheduled */
+static int
+writer_on_soon(void *arg)
+{
+    PyObject *capsule = (PyObject *)arg;
+    pyawaitable_writer *writer = PyCapsule_GetPointer(
+        capsule,
+        PYAWAITABLE_WRITER_CAPSULE
+    );
+    if (writer == NULL) {
+        Py_DECREF(capsule);
+        return -1;
+    }
+
+    writer->scheduled = 0;
+    if (writer->error == NULL && !writer->watching) {
+        writer_flush(capsule, writer);
+    }
+    Py_DECREF(capsule);
+    return 0;
+}
+
+static void
+writer_capsule_destructor(PyObject *capsule)
+{
+    pyawaitable_writer *writer = PyCapsule_GetPointer(
+        capsule,
+        PYAWAITABLE_WRITER_CAPSULE
+    );
+    if (writer == NULL) {
+        PyErr_WriteUnraisable(capsule);
+        return;
+    }
+
+    if (writer->watching) {
+        // Like with watches, the loop must have been closed
+        PyObject *err = PyErr_GetRaisedException();
+        PyObject *res = PyObject_CallMethod(
+            writer->loop,
+            "remove_writer",
+            "i",
+            writer->fd
+        );
+        if (res == NULL) {
+            PyErr_WriteUnraisable(writer->loop);
+        } else {
+            Py_DECREF(res);
+        }
+        if (err != NULL) {
+            PyErr_SetRaisedException(err);
+        }
+    }
+
+    writer_free(writer);
+}
+
+/* Get a writer that can still be written to */
+static pyawaitable_writer *
+writer_get(PyObject *capsule)
+{
+    pyawaitable_writer *writer = PyCapsule_GetPointer(
+        capsule,
+        PYAWAITABLE_WRITER_CAPSULE
+    );
+    if (writer == NULL) {
+        return NULL;
+    }
+
+    if (writer->error != NULL) {
+        PyErr_SetRaisedException(Py_NewRef(writer->error));
+        return NULL;
+    }
+
+    if (writer->loop == NULL) {
+        pyawaitable_io *io = get_io_state();
+        if (PyAwaitable_UNLIKELY(io == NULL)) {
+            return NULL;
+        }
+
+        writer->loop = PyObject_CallNoArgs(io->get_running_loop);
+        if (writer->loop == NULL) {
+            return NULL;
+        }
+    }
+
+    return writer;
+}
+
+/* Add a step to awaitable that waits for one of the lists of waiters */
+static int
+writer_wait(PyObject *awaitable, pyawaitable_writer *writer, PyObject *waiters)
+{
+    PyObject *future = PyObject_CallMethod(writer->loop, "create_future", NULL);
+    if (future == NULL) {
+        return -1;
+    }
+
+    if (
+        PyList_Append(waiters, future) < 0
+        || PyAwaitable_AddAwait(awaitable, future, NULL, NULL) < 0
+    ) {
+        Py_DECREF(future);
+        return -1;
+    }
+
+    Py_DECREF(future);
+    return 0;
+}
+
+/* Make sure that a flush is coming */
+static int
+writer_queued(PyObject *capsule, pyawaitable_writer *writer)
+{
+    // Everything written until the loop gets to us goes into one flush
+    if (!writer->scheduled && !writer->watching) {
+        Py_INCREF(capsule);
+        if (PyAwaitable_CallSoon(writer_on_soon, capsule) < 0) {
+            Py_DECREF(capsule);
+            return -1;
+        }
+        writer->scheduled = 1;
+    }
+
+    return 0;
+}
+
+/* Copy data to the end of the queue, sharing the last copy if it fits */
+static int
+writer_copy(pyawaitable_writer *writer, const void *data, Py_ssize_t size)
+{
+    pyawaitable_wbuf *last = writer->length > 0
+        ? writer_at(writer, writer->length - 1)
+        : NULL;
+    if (last == NULL || last->capacity - last->size < size) {
+        Py_ssize_t capacity = Py_MAX(size, _PyAwaitable_WRITER_CHUNK);
+        char *copy = PyMem_Malloc(capacity);
+        if (copy == NULL) {
+            PyErr_NoMemory();
+            return -1;
+        }
+
+        last = writer_push(writer);
+        if (last == NULL) {
+            PyMem_Free(copy);
+            return -1;
+        }
+
+        last->data = copy;
+        last->size = 0;
+        last->offset = 0;
+        last->capacity = capacity;
+    }
+
+    memcpy(last->data + last->size, data, size);
+    last->size += size;
+    writer->queued += size;
+    return 0;
+}
+
+/*
+ * Start a step from add_writer_step(). A drain only waits while the queue
+ * is over the high-water mark, and a flush waits until it's empty.
+ */
+static int
+writer_step_start(PyObject *inner, int flush)
+{
+    PyObject *capsule = PyAwaitable_GetValue(inner, 0);
+    if (capsule == NULL) {
+        return -1;
+    }
+
+    pyawaitable_writer *writer = writer_get(capsule);
+    if (writer == NULL) {
+        return -1;
+    }
+
+    if (writer->queued <= (flush ? 0 : writer->high_water)) {
+        return 0;
+    }
+
+    return writer_wait(
+        inner,
+        writer,
+        flush ? writer->flush_waiters : writer->drain_waiters
+    );
+}
+
+static int
+drain_step_start(PyObject *inner)
+{
+    return writer_step_start(inner, 0);
+}
+
+static int
+flush_step_start(PyObject *inner)
+{
+    return writer_step_start(inner, 1);
+}
+
+/* Add a step that checks the queue once it starts */
+static int
+add_writer_step(PyObject *awaitable, PyObject *writer, PyAwaitable_Defer start)
+{
+    if (PyCapsule_GetPointer(writer, PYAWAITABLE_WRITER_CAPSULE) == NULL) {
+        return -1;
+    }
+
+    PyObject *inner = PyAwaitable_New();
+    if (inner == NULL) {
+        return -1;
+    }
+
+    if (
+        PyAwaitable_SaveValues(inner, 1, writer) < 0
+        || PyAwaitable_DeferAwait(inner, start) < 0
+        || PyAwaitable_AddAwait(awaitable, inner, NULL, NULL) < 0
+    ) {
+        PyAwaitable_Cancel(inner);
+        Py_DECREF(inner);
+        return -1;
+    }
+
+    Py_DECREF(inner);
+    return 0;
+}
+#endif
+
+_PyAwaitable_API(PyObject *)
+PyAwaitable_NewWriter(int fd, Py_ssize_t high_water)
+{
+    _PyAwaitable_FORWARD(NULL, NewWriter(fd, high_water));
+#ifdef _WIN32
+    PyErr_SetString(
+        PyExc_NotImplementedError,
+        "PyAwaitable: Writers are not supported on Windows"
+    );
+    return NULL;
+#else
+    if (fd < 0) {
+        PyErr_Format(
+            PyExc_ValueError,
+            "PyAwaitable: Invalid file descriptor: %d",
+            fd
+        );
+        return NULL;
+    }
+
+    if (high_water < 0) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "PyAwaitable: High-water mark cannot be negative"
+        );
+        return NULL;
+    }
+
+    pyawaitable_writer *writer = PyMem_Malloc(sizeof(pyawaitable_writer));
+    if (writer == NULL) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    writer->loop = NULL;
+    writer->queue = NULL;
+    writer->head = 0;
+    writer->length = 0;
+    writer->capacity = 0;
+    writer->queued = 0;
+    writer->high_water = high_water;
+    writer->error = NULL;
+    writer->drain_waiters = PyList_New(0);
+    writer->flush_waiters = PyList_New(0);
+    writer->fd = fd;
+    writer->scheduled = 0;
+    writer->watching = 0;
+    if (writer->drain_waiters == NULL || writer->flush_waiters == NULL) {
+        writer_free(writer);
+        return NULL;
+    }
+
+    PyObject *capsule = PyCapsule_New(
+        writer,
+        PYAWAITABLE_WRITER_CAPSULE,
+        writer_capsule_destructor
+    );
+    if (capsule == NULL) {
+        writer_free(writer);
+        return NULL;
+    }
+
+    return capsule;
+#endif
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_Write(PyObject * writer, const void *data, Py_ssize_t size)
+{
+    _PyAwaitable_FORWARD(-1, Write(writer, data, size));
+#ifdef _WIN32
+    PyErr_SetString(
+        PyExc_NotImplementedError,
+        "PyAwaitable: Writers are not supported on Windows"
+    );
+    return -1;
+#else
+    if (size < 0 || (data == NULL && size != 0)) {
+        PyErr_SetString(PyExc_ValueError, "PyAwaitable: Invalid buffer");
+        return -1;
+    }
+
+    pyawaitable_writer *queue = writer_get(writer);
+    if (queue == NULL) {
+        return -1;
+    }
+
+    if (size == 0) {
+        return 0;
+    }
+
+    if (writer_copy(queue, data, size) < 0) {
+        return -1;
+    }
+
+    return writer_queued(writer, queue);
+#endif
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_WriteBuffer(PyObject * writer, PyObject * obj)
+{
+    _PyAwaitable_FORWARD(-1, WriteBuffer(writer, obj));
+#ifdef _WIN32
+    PyErr_SetString(
+        PyExc_NotImplementedError,
+        "PyAwaitable: Writers are not supported on Windows"
+    );
+    return -1;
+#else
+    pyawaitable_writer *queue = writer_get(writer);
+    if (queue == NULL) {
+        return -1;
+    }
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(obj, &view, PyBUF_SIMPLE) < 0) {
+        return -1;
+    }
+
+    if (view.len == 0) {
+        PyBuffer_Release(&view);
+        return 0;
+    }
+
+    if (view.len < _PyAwaitable_WRITER_COPY_MAX) {
+        // Holding on to a small buffer costs more than copying it
+        int res = writer_copy(queue, view.buf, view.len);
+        PyBuffer_Release(&view);
+        if (res < 0) {
+            return -1;
+        }
+    } else {
+        pyawaitable_wbuf *buf = writer_push(queue);
+        if (buf == NULL) {
+            PyBuffer_Release(&view);
+            return -1;
+        }
+
+        buf->data = view.buf;
+        buf->size = view.len;
+        buf->offset = 0;
+        buf->capacity = 0;
+        buf->view = view;
+        queue->queued += view.len;
+    }
+
+    return writer_queued(writer, queue);
+#endif
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_AddDrain(PyObject * awaitable, PyObject * writer)
+{
+    _PyAwaitable_FORWARD(-1, AddDrain(awaitable, writer));
+#ifdef _WIN32
+    PyErr_SetString(
+        PyExc_NotImplementedError,
+        "PyAwaitable: Writers are not supported on Windows"
+    );
+    return -1;
+#else
+    return add_writer_step(awaitable, writer, drain_step_start);
+#endif
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_AddFlush(PyObject * awaitable, PyObject * writer)
+{
+    _PyAwaitable_FORWARD(-1, AddFlush(awaitable, writer));
+#ifdef _WIN32
+    PyErr_SetString(
+        PyExc_NotImplementedError,
+        "PyAwaitable: Writers are not supported on Windows"
+    );
+    return -1;
+#else
+    return add_writer_step(awaitable, writer, flush_step_start);
+#endif
+}
@@ -0,0 +1,644 @@
+#include <Python.h>
+#include <pythread.h>
+#include <limits.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <pyawaitable/awaitableobject.h>
+#include <pyawaitable/backport.h>
+#include <pyawaitable/capi.h>
+#include <pyawaitable/future.h>
+#include <pyawaitable/init.h>
+#include <pyawaitable/optimize.h>
+#include <pyawaitable/pool.h>
+
+static void
+pool_free(pyawaitable_pool *pool)
+{
+    for (long i = 0; i < pool->max_workers; ++i) {
+        pyawaitable_worker *worker = &pool->workers[i];
+        assert(worker->front == NULL);
+        if (worker->lock != NULL) {
+            PyThread_free_lock(worker->lock);
+        }
+        if (worker->wakeup != NULL) {
+            // Workers hold this while they're awake, which they all are
+            PyThread_release_lock(worker->wakeup);
+            PyThread_free_lock(worker->wakeup);
+        }
+    }
+
+    PyMem_RawFree(pool);
+}
+
+/* This may be called without a thread state */
+static void
+pool_release(pyawaitable_pool *pool)
+{
+    if (_PyAwaitable_ATOMIC_ADD_LONG(&pool->refcount, -1) == 1) {
+        pool_free(pool);
+    }
+}
+
+/* Wake up the worker if it's asleep, and return whether it was */
+static int
+worker_wake(pyawaitable_worker *worker)
+{
+    if (_PyAwaitable_ATOMIC_EXCHANGE_LONG(&worker->sleeping, 0) == 1) {
+        PyThread_release_lock(worker->wakeup);
+        return 1;
+    }
+
+    return 0;
+}
+
+/* Wake up a single sleeping worker, searching from the given index */
+static void
+pool_wake_one(pyawaitable_pool *pool, long start)
+{
+    long num_workers = _PyAwaitable_ATOMIC_LOAD_LONG(&pool->num_workers);
+    for (long i = 0; i < num_workers; ++i) {
+        pyawaitable_worker *worker = &pool->workers[(start + i) % num_workers];
+        if (
+            _PyAwaitable_ATOMIC_LOAD_LONG(&worker->sleeping)
+            && worker_wake(worker)
+        ) {
+            return;
+        }
+    }
+}
+
+/* Push a job onto the back of a deque. The deque's lock must be held. */
+static void
+deque_push(pyawaitable_worker *worker, pyawaitable_job *job)
+{
+    job->next = NULL;
+    job->prev = worker->back;
+    if (worker->back != NULL) {
+        worker->back->next = job;
+    } else {
+        worker->front = job;
+    }
+    worker->back = job;
+    ++worker->length;
+}
+
+/* Pop the newest job off of our own deque */
+static pyawaitable_job *
+worker_pop(pyawaitable_worker *worker)
+{
+    PyThread_acquire_lock(worker->lock, WAIT_LOCK);
+    pyawaitable_job *job = worker->back;
+    if (job != NULL) {
+        worker->back = job->prev;
+        if (worker->back != NULL) {
+            worker->back->next = NULL;
+        } else {
+            worker->front = NULL;
+        }
+        --worker->length;
+    }
+    PyThread_release_lock(worker->lock);
+    return job;
+}
+
+/*
+ * Take everything that has been submitted to the pool. The first job is
+ * returned, and the rest go into our deque, where the other workers can
+ * steal them.
+ */
+static pyawaitable_job *
+worker_take_submitted(pyawaitable_worker *worker)
+{
+    pyawaitable_pool *pool = worker->pool;
+    if (_PyAwaitable_ATOMIC_LOAD_PTR(&pool->submitted) == NULL) {
+        return NULL;
+    }
+
+    pyawaitable_job *batch = _PyAwaitable_ATOMIC_EXCHANGE_PTR(
+        &pool->submitted,
+        NULL
+    );
+    pyawaitable_job *first = NULL;
+    PyThread_acquire_lock(worker->lock, WAIT_LOCK);
+    while (batch != NULL) {
+        pyawaitable_job *older = batch->prev;
+        pyawaitable_job *job = batch;
+        while (job != NULL) {
+            pyawaitable_job *next = job->next;
+            if (first == NULL) {
+                first = job;
+            } else {
+                deque_push(worker, job);
+            }
+            job = next;
+        }
+        batch = older;
+    }
+    PyThread_release_lock(worker->lock);
+    return first;
+}
+
+/*
+ * Steal the older half of another worker's deque. The first stolen job is
+ * returned, and the rest go into our deque.
+ */
+static pyawaitable_job *
+worker_steal(pyawaitable_worker *worker)
+{
+    pyawaitable_pool *pool = worker->pool;
+    long num_workers = _PyAwaitable_ATOMIC_LOAD_LONG(&pool->num_workers);
+    long index = (long)(worker - pool->workers);
+    for (long i = 1; i < num_workers; ++i) {
+        pyawaitable_worker *victim = &pool->workers[(index + i) % num_workers];
+        PyThread_acquire_lock(victim->lock, WAIT_LOCK);
+        Py_ssize_t count = (victim->length + 1) / 2;
+        pyawaitable_job *stolen = victim->front;
+        if (count > 0) {
+            pyawaitable_job *last = stolen;
+            for (Py_ssize_t k = 1; k < count; ++k) {
+                last = last->next;
+            }
+
+            victim->front = last->next;
+            if (victim->front != NULL) {
+                victim->front->prev = NULL;
+            } else {
+                victim->back = NULL;
+            }
+            victim->length -= count;
+            last->next = NULL;
+        }
+        PyThread_release_lock(victim->lock);
+
+        if (count == 0) {
+            continue;
+        }
+
+        pyawaitable_job *rest = stolen->next;
+        if (rest != NULL) {
+            PyThread_acquire_lock(worker->lock, WAIT_LOCK);
+            while (rest != NULL) {
+                pyawaitable_job *next = rest->next;
+                deque_push(worker, rest);
+                rest = next;
+            }
+            PyThread_release_lock(worker->lock);
+        }
+
+        return stolen;
+    }
+
+    return NULL;
+}
+
+static void
+worker_sleep(pyawaitable_worker *worker)
+{
+    pyawaitable_pool *pool = worker->pool;
+    // Anyone who submits after this point will see that we're asleep, and
+    // anyone who submitted before it will be seen by the check below.
+    _PyAwaitable_ATOMIC_EXCHANGE_LONG(&worker->sleeping, 1);
+    if (
+        _PyAwaitable_ATOMIC_LOAD_LONG(&pool->pending) == 0
+        && !_PyAwaitable_ATOMIC_LOAD_LONG(&pool->shutdown)
+    ) {
+        PyThread_acquire_lock(worker->wakeup, WAIT_LOCK);
+        return;
+    }
+
+    if (_PyAwaitable_ATOMIC_EXCHANGE_LONG(&worker->sleeping, 0) == 0) {
+        // We were woken up in the meantime, so the lock has been (or is
+        // about to be) released. Take it back.
+        PyThread_acquire_lock(worker->wakeup, WAIT_LOCK);
+    }
+}
+
+/* Entry point for the worker threads */
+static void
+worker_main(void *arg)
+{
+    pyawaitable_worker *worker = (pyawaitable_worker *)arg;
+    pyawaitable_pool *pool = worker->pool;
+    long index = (long)(worker - pool->workers);
+    for (;;) {
+        pyawaitable_job *job = worker_pop(worker);
+        if (job == NULL) {
+            job = worker_take_submitted(worker);
+        }
+        if (job == NULL) {
+            job = worker_steal(worker);
+        }
+
+        if (job != NULL) {
+            if (_PyAwaitable_ATOMIC_ADD_LONG(&pool->pending, -1) > 1) {
+                // There's more to do than we can handle alone
+                pool_wake_one(pool, index + 1);
+            }
+            job->run(job);
+            continue;
+        }
+
+        if (_PyAwaitable_ATOMIC_LOAD_LONG(&pool->shutdown)) {
+            break;
+        }
+
+        worker_sleep(worker);
+    }
+
+    pool_release(pool);
+}
+
+/* Get the number of workers to start, which is the number of CPUs */
+static long
+pool_size(void)
+{
+    PyObject *os = PyImport_ImportModule("os");
+    if (os == NULL) {
+        return -1;
+    }
+
+    PyObject *count = PyObject_CallMethod(os, "cpu_count", NULL);
+    Py_DECREF(os);
+    if (count == NULL) {
+        return -1;
+    }
+
+    if (count == Py_None) {
+        // The number of CPUs can't be determined
+        Py_DECREF(count);
+        return 4;
+    }
+
+    long size = PyLong_AsLong(count);
+    Py_DECREF(count);
+    if (size == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+
+    return size < 1 ? 1 : size;
+}
+
+static pyawaitable_pool *
+pool_new(void)
+{
+    long size = pool_size();
+    if (size < 0) {
+        return NULL;
+    }
+
+    pyawaitable_pool *pool = PyMem_RawMalloc(
+        offsetof(pyawaitable_pool, workers)
+        + (size_t)size * sizeof(pyawaitable_worker)
+    );
+    if (pool == NULL) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    pool->submitted = NULL;
+    pool->pending = 0;
+    pool->refcount = 1;
+    pool->shutdown = 0;
+    pool->num_workers = 0;
+    pool->max_workers = size;
+    int failed = 0;
+    for (long i = 0; i < size; ++i) {
+        pyawaitable_worker *worker = &pool->workers[i];
+        worker->pool = pool;
+        worker->front = NULL;
+        worker->back = NULL;
+        worker->length = 0;
+        worker->sleeping = 0;
+        worker->lock = failed ? NULL : PyThread_allocate_lock();
+        worker->wakeup = failed ? NULL : PyThread_allocate_lock();
+        if (worker->wakeup != NULL) {
+            PyThread_acquire_lock(worker->wakeup, WAIT_LOCK);
+        }
+        failed = failed || worker->lock == NULL || worker->wakeup == NULL;
+    }
+
+    if (failed) {
+        pool_free(pool);
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    for (long i = 0; i < size; ++i) {
+        // The worker needs to count itself as soon as it starts
+        _PyAwaitable_ATOMIC_ADD_LONG(&pool->refcount, 1);
+        _PyAwaitable_ATOMIC_ADD_LONG(&pool->num_workers, 1);
+        if (
+            PyThread_start_new_thread(worker_main, &pool->workers[i]) ==
+            PYTHREAD_INVALID_THREAD_ID
+        ) {
+            _PyAwaitable_ATOMIC_ADD_LONG(&pool->refcount, -1);
+            _PyAwaitable_ATOMIC_ADD_LONG(&pool->num_workers, -1);
+            break;
+        }
+    }
+
+    if (_PyAwaitable_ATOMIC_LOAD_LONG(&pool->num_workers) == 0) {
+        pool_free(pool);
+        PyErr_SetString(
+            PyExc_RuntimeError,
+            "PyAwaitable: Failed to start any worker threads"
+        );
+        return NULL;
+    }
+
+    return pool;
+}
+
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_PoolShutdown(pyawaitable_pool *pool)
+{
+    assert(pool != NULL);
+    _PyAwaitable_ATOMIC_EXCHANGE_LONG(&pool->shutdown, 1);
+    long num_workers = _PyAwaitable_ATOMIC_LOAD_LONG(&pool->num_workers);
+    for (long i = 0; i < num_workers; ++i) {
+        worker_wake(&pool->workers[i]);
+    }
+
+    // The workers finish whatever is left, and the last one out frees it
+    pool_release(pool);
+}
+
+static pyawaitable_pool *
+get_pool(void)
+{
+    _PyAwaitable_LAZY_STATE(pool, pool_new, _PyAwaitable_PoolShutdown);
+}
+
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_PoolSubmit(pyawaitable_job *jobs)
+{
+    assert(jobs != NULL);
+    pyawaitable_pool *pool = get_pool();
+    if (PyAwaitable_UNLIKELY(pool == NULL)) {
+        return -1;
+    }
+
+    long count = 0;
+    for (pyawaitable_job *job = jobs; job != NULL; job = job->next) {
+        ++count;
+    }
+
+    // This has to be visible before the jobs are, so that a worker that's
+    // about to sleep knows to look for them.
+    _PyAwaitable_ATOMIC_ADD_LONG(&pool->pending, count);
+    pyawaitable_job *head;
+    do {
+        head = _PyAwaitable_ATOMIC_LOAD_PTR(&pool->submitted);
+        jobs->prev = head;
+    } while (!_PyAwaitable_ATOMIC_CAS_PTR(&pool->submitted, head, jobs));
+
+    if (head == NULL) {
+        // Whoever takes these will take anything else that's submitted in
+        // the meantime, and wake up more workers if there's enough to share.
+        pool_wake_one(pool, 0);
+    }
+
+    return 0;
+}
+
+typedef struct _pyawaitable_blocking {
+    pyawaitable_job job;
+    PyAwaitable_NoGIL func;
+    void *arg;
+    PyAwaitable_Future *future;
+} _PyAwaitable_MANGLE(pyawaitable_blocking);
+
+static void
+blocking_run(pyawaitable_job *job)
+{
+    pyawaitable_blocking *blocking = (pyawaitable_blocking *)job;
+    PyAwaitable_Future *future = blocking->future;
+    void *result = blocking->func(blocking->arg);
+    PyMem_RawFree(blocking);
+    PyAwaitable_Complete(future, result);
+}
+
+static void
+blocking_discard(pyawaitable_job *job)
+{
+    PyMem_RawFree(job);
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_AddBlocking(
+    PyObject * awaitable,
+    PyAwaitable_NoGIL func,
+    void *arg,
+    PyAwaitable_NoGILResult cb
+)
+{
+    _PyAwaitable_FORWARD(-1, AddBlocking(awaitable, func, arg, cb));
+    if (func == NULL) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "PyAwaitable: NULL passed to PyAwaitable_AddBlocking()!"
+        );
+        return -1;
+    }
+
+    pyawaitable_blocking *blocking = PyMem_RawMalloc(
+        sizeof(pyawaitable_blocking)
+    );
+    if (blocking == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    blocking->job.next = NULL;
+    blocking->job.prev = NULL;
+    blocking->job.run = blocking_run;
+    blocking->job.discard = blocking_discard;
+    blocking->func = func;
+    blocking->arg = arg;
+    blocking->future = _PyAwaitable_AddJobFuture(
+        awaitable,
+        cb,
+        arg,
+        &blocking->job
+    );
+    if (blocking->future == NULL) {
+        PyMem_RawFree(blocking);
+        return -1;
+    }
+
+    return 0;
+}
+
+struct _pyawaitable_map;
+
+typedef struct _pyawaitable_map_chunk {
+    pyawaitable_job job;
+    struct _pyawaitable_map *map;
+    Py_ssize_t start;
+    Py_ssize_t stop;
+} _PyAwaitable_MANGLE(pyawaitable_map_chunk);
+
+/*
+ * State for a parallel map. This is a single allocation, which is owned by
+ * the future as its result.
+ */
+typedef struct _pyawaitable_map {
+    PyAwaitable_NoGIL func;
+    PyAwaitable_MapCallback cb;
+    PyAwaitable_Future *future;
+    Py_ssize_t size;
+    /* Atomic; the number of chunks that haven't finished */
+    long remaining;
+    /* These point into the same allocation */
+    void **items;
+    void **results;
+    pyawaitable_map_chunk chunks[1];
+} _PyAwaitable_MANGLE(pyawaitable_map);
+
+static void
+map_chunk_run(pyawaitable_job *job)
+{
+    pyawaitable_map_chunk *chunk = (pyawaitable_map_chunk *)job;
+    pyawaitable_map *map = chunk->map;
+    for (Py_ssize_t i = chunk->start; i < chunk->stop; ++i) {
+        // Every chunk writes to its own part of the array
+        map->results[i] = map->func(map->items[i]);
+    }
+
+    if (_PyAwaitable_ATOMIC_ADD_LONG(&map->remaining, -1) == 1) {
+        // We were the last one, so everything is in place
+        PyAwaitable_Complete(map->future, map);
+    }
+}
+
+static void
+map_chunk_discard(pyawaitable_job *job)
+{
+    // The chunks are freed along with the map
+}
+
+static void
+map_free(void *ptr)
+{
+    PyMem_RawFree(ptr);
+}
+
+static int
+map_done(PyObject *awaitable, void *result, void *arg)
+{
+    pyawaitable_map *map = (pyawaitable_map *)result;
+    return map->cb(awaitable, map->results, map->size);
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_AddParallelMap(
+    PyObject * awaitable,
+    PyAwaitable_NoGIL func,
+    void *const *items,
+    Py_ssize_t size,
+    Py_ssize_t chunk,
+    PyAwaitable_MapCallback cb
+)
+{
+    _PyAwaitable_FORWARD(
+        -1,
+        AddParallelMap(awaitable, func, items, size, chunk, cb)
+    );
+    if (func == NULL) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "PyAwaitable: NULL passed to PyAwaitable_AddParallelMap()!"
+        );
+        return -1;
+    }
+
+    if (size < 0 || chunk < 1) {
+        PyErr_Format(
+            PyExc_ValueError,
+            "PyAwaitable: Invalid size (%zd) or chunk size (%zd)",
+            size,
+            chunk
+        );
+        return -1;
+    }
+
+    if (items == NULL && size > 0) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "PyAwaitable: NULL items passed to PyAwaitable_AddParallelMap()!"
+        );
+        return -1;
+    }
+
+    Py_ssize_t num_chunks = size / chunk + (size % chunk != 0);
+    // Every item needs its own slot for the item and the result
+    if (
+        num_chunks > LONG_MAX
+        || size > (PY_SSIZE_T_MAX / 2 - (Py_ssize_t)sizeof(pyawaitable_map))
+        / (Py_ssize_t)(2 * sizeof(void *) + sizeof(pyawaitable_map_chunk))
+    ) {
+        PyErr_SetString(
+            PyExc_OverflowError,
+            "PyAwaitable: Too many items for a parallel map"
+        );
+        return -1;
+    }
+
+    size_t chunks_size = offsetof(pyawaitable_map, chunks)
+                         + (size_t)(num_chunks > 0 ? num_chunks : 1)
+                         * sizeof(pyawaitable_map_chunk);
+    pyawaitable_map *map = PyMem_RawMalloc(
+        chunks_size + (size_t)size * 2 * sizeof(void *)
+    );
+    if (map == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    map->func = func;
+    map->cb = cb;
+    map->size = size;
+    map->remaining = (long)num_chunks;
+    // The items are copied, so the caller doesn't have to keep them around
+    map->items = (void **)((char *)map + chunks_size);
+    map->results = map->items + size;
+    if (size > 0) {
+        memcpy(map->items, items, (size_t)size * sizeof(void *));
+    }
+
+    pyawaitable_job *jobs = NULL;
+    // Link them back to front, so that the list is in order
+    for (Py_ssize_t i = num_chunks; i-- > 0;) {
+        pyawaitable_map_chunk *map_chunk = &map->chunks[i];
+        map_chunk->job.next = jobs;
+        map_chunk->job.prev = NULL;
+        map_chunk->job.run = map_chunk_run;
+        map_chunk->job.discard = map_chunk_discard;
+        map_chunk->map = map;
+        map_chunk->start = i * chunk;
+        map_chunk->stop = Py_MIN(size, (i + 1) * chunk);
+        jobs = &map_chunk->job;
+    }
+
+    map->future = _PyAwaitable_AddJobFuture(
+        awaitable,
+        cb == NULL ? NULL : map_done,
+        NULL,
+        jobs
+    );
+    if (map->future == NULL) {
+        PyMem_RawFree(map);
+        return -1;
+    }
+
+    // Nothing can start the step yet, so the map can be handed over
+    map->future->result = map;
+    map->future->free_result = map_free;
+    if (num_chunks == 0) {
+        // There's nothing to run
+        PyAwaitable_Complete(map->future, map);
+    }
+
+    return 0;
+}
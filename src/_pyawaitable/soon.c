@@ -0,0 +1,449 @@
+#include <Python.h>
+
+#include <pyawaitable/array.h>
+#include <pyawaitable/backport.h>
+#include <pyawaitable/capi.h>
+#include <pyawaitable/init.h>
+#include <pyawaitable/optimize.h>
+#include <pyawaitable/soon.h>
+
+/*
+ * Borrowed reference to the loop whose trampoline is running on this
+ * thread, and the thread state that it's running in. The loop is known to
+ * be running in there, so calls made by the batch don't need to look it up.
+ */
+static PyAwaitable_thread_local PyObject *soon_running_loop = NULL;
+static PyAwaitable_thread_local PyThreadState *soon_running_tstate = NULL;
+
+static void
+soon_batch_dealloc(void *ptr)
+{
+    assert(ptr != NULL);
+    pyawaitable_soon_batch *batch = (pyawaitable_soon_batch *)ptr;
+    Py_CLEAR(batch->loop);
+    if (batch->calls.items != NULL) {
+        pyawaitable_array_clear(&batch->calls);
+    }
+    PyMem_Free(batch);
+}
+
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_SoonFree(pyawaitable_soon *soon)
+{
+    assert(soon != NULL);
+    pyawaitable_array_clear(&soon->batches);
+    Py_XDECREF(soon->trampoline);
+    Py_XDECREF(soon->get_running_loop);
+    Py_XDECREF(soon->is_closed_str);
+    Py_XDECREF(soon->call_soon_str);
+    Py_XDECREF(soon->call_soon_threadsafe_str);
+    PyMem_Free(soon);
+}
+
+/* This must be called in a critical section on the trampoline */
+static pyawaitable_soon_batch *
+soon_pop_batch(pyawaitable_soon *soon, PyObject *loop)
+{
+    for (Py_ssize_t i = 0; i < pyawaitable_array_LENGTH(&soon->batches); ++i) {
+        pyawaitable_soon_batch *batch = pyawaitable_array_GET_ITEM(
+            &soon->batches,
+            i
+        );
+        if (batch->loop == loop) {
+            return pyawaitable_array_pop(&soon->batches, i);
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Called by the event loop. This runs all the calls that were
+ * batched for the loop since the trampoline was scheduled.
+ */
+static PyObject *
+soon_trampoline(PyObject *self, PyObject *loop)
+{
+    pyawaitable_state *state = _PyAwaitable_GetState();
+    if (PyAwaitable_UNLIKELY(state == NULL)) {
+        return NULL;
+    }
+
+    pyawaitable_soon *soon = state->soon;
+    assert(soon != NULL);
+
+    // Calls made from here on out will go into a new batch
+    pyawaitable_soon_batch *batch;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(soon->trampoline);
+    batch = soon_pop_batch(soon, loop);
+    _PyAwaitable_END_CRITICAL_SECTION();
+    if (PyAwaitable_UNLIKELY(batch == NULL)) {
+        PyErr_SetString(
+            PyExc_SystemError,
+            "PyAwaitable: Trampoline was called without a pending batch"
+        );
+        return NULL;
+    }
+
+    PyObject *outer_loop = soon_running_loop;
+    PyThreadState *outer_tstate = soon_running_tstate;
+    soon_running_loop = loop;
+    soon_running_tstate = PyThreadState_Get();
+    for (Py_ssize_t i = 0; i < pyawaitable_array_LENGTH(&batch->calls); ++i) {
+        pyawaitable_soon_call *call = pyawaitable_array_GET_ITEM(
+            &batch->calls,
+            i
+        );
+        if (call->func(call->arg) < 0) {
+            // Don't let one failing call stop the rest of the batch
+            PyErr_WriteUnraisable(soon->trampoline);
+        }
+    }
+    soon_running_loop = outer_loop;
+    soon_running_tstate = outer_tstate;
+
+    soon_batch_dealloc(batch);
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef soon_trampoline_def = {
+    "_pyawaitable_soon_trampoline",
+    soon_trampoline,
+    METH_O,
+    NULL
+};
+
+static pyawaitable_soon *
+soon_state_new(void)
+{
+    pyawaitable_soon *soon = PyMem_Malloc(sizeof(pyawaitable_soon));
+    if (soon == NULL) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    soon->trampoline = NULL;
+    soon->get_running_loop = NULL;
+    soon->is_closed_str = NULL;
+    soon->call_soon_str = NULL;
+    soon->call_soon_threadsafe_str = NULL;
+    if (pyawaitable_array_init(&soon->batches, soon_batch_dealloc) < 0) {
+        PyMem_Free(soon);
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    soon->is_closed_str = PyUnicode_InternFromString("is_closed");
+    if (soon->is_closed_str == NULL) {
+        _PyAwaitable_SoonFree(soon);
+        return NULL;
+    }
+
+    soon->call_soon_str = PyUnicode_InternFromString("call_soon");
+    if (soon->call_soon_str == NULL) {
+        _PyAwaitable_SoonFree(soon);
+        return NULL;
+    }
+
+    soon->call_soon_threadsafe_str = PyUnicode_InternFromString(
+        "call_soon_threadsafe"
+    );
+    if (soon->call_soon_threadsafe_str == NULL) {
+        _PyAwaitable_SoonFree(soon);
+        return NULL;
+    }
+
+    // The trampoline looks up the state itself, so it doesn't need a self
+    soon->trampoline = PyCFunction_New(&soon_trampoline_def, NULL);
+    if (soon->trampoline == NULL) {
+        _PyAwaitable_SoonFree(soon);
+        return NULL;
+    }
+
+    return soon;
+}
+
+static pyawaitable_soon *
+get_soon_state(void)
+{
+    _PyAwaitable_LAZY_STATE(soon, soon_state_new, _PyAwaitable_SoonFree);
+}
+
+/*
+ * A loop that's closed before its trampoline runs drops the trampoline, so
+ * the batch would keep the loop alive forever. Throw away those batches,
+ * except for the one that belongs to loop.
+ */
+static int
+soon_drop_closed(pyawaitable_soon *soon, PyObject *loop)
+{
+    for (Py_ssize_t i = pyawaitable_array_LENGTH(&soon->batches) - 1; i >= 0;
+         --i) {
+        pyawaitable_soon_batch *batch = pyawaitable_array_GET_ITEM(
+            &soon->batches,
+            i
+        );
+        if (batch->loop == loop) {
+            continue;
+        }
+
+        PyObject *closed = PyObject_CallMethodNoArgs(
+            batch->loop,
+            soon->is_closed_str
+        );
+        if (closed == NULL) {
+            return -1;
+        }
+
+        int is_closed = PyObject_IsTrue(closed);
+        Py_DECREF(closed);
+        if (is_closed < 0) {
+            return -1;
+        }
+
+        // The loop might have run arbitrary code, so make sure that the
+        // batch is still where we found it.
+        if (
+            is_closed
+            && i < pyawaitable_array_LENGTH(&soon->batches)
+            && pyawaitable_array_GET_ITEM(&soon->batches, i) == batch
+        ) {
+            pyawaitable_array_remove(&soon->batches, i);
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Add the call to the loop's batch, scheduling the trampoline if needed.
+ * This steals the call, and must be called in a critical section on the
+ * trampoline.
+ */
+static int
+soon_batch_call_lock_held(
+    pyawaitable_soon *soon,
+    PyObject *loop,
+    pyawaitable_soon_call *call,
+    bool threadsafe
+)
+{
+    pyawaitable_soon_batch *batch = NULL;
+    for (Py_ssize_t i = 0; i < pyawaitable_array_LENGTH(&soon->batches); ++i) {
+        pyawaitable_soon_batch *item = pyawaitable_array_GET_ITEM(
+            &soon->batches,
+            i
+        );
+        // A batch scheduled with call_soon() won't wake up a loop that's
+        // blocked on I/O, so threadsafe calls can only join threadsafe
+        // batches.
+        if (item->loop == loop && (item->threadsafe || !threadsafe)) {
+            batch = item;
+            break;
+        }
+    }
+
+    if (batch != NULL) {
+        // The trampoline is already scheduled on this loop
+        if (pyawaitable_array_append(&batch->calls, call) < 0) {
+            PyMem_Free(call);
+            PyErr_NoMemory();
+            return -1;
+        }
+
+        return 0;
+    }
+
+    // This is the loop's first call since its trampoline last ran, which is
+    // rare enough to check for batches that will never run.
+    if (soon_drop_closed(soon, loop) < 0) {
+        PyMem_Free(call);
+        return -1;
+    }
+
+    batch = PyMem_Malloc(sizeof(pyawaitable_soon_batch));
+    if (batch == NULL) {
+        PyMem_Free(call);
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    batch->loop = Py_NewRef(loop);
+    batch->threadsafe = threadsafe;
+    if (pyawaitable_array_init(&batch->calls, PyMem_Free) < 0) {
+        pyawaitable_array_ZERO(&batch->calls);
+        soon_batch_dealloc(batch);
+        PyMem_Free(call);
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    if (pyawaitable_array_append(&batch->calls, call) < 0) {
+        soon_batch_dealloc(batch);
+        PyMem_Free(call);
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    // Track the batch before scheduling, so the trampoline can always
+    // find it.
+    if (pyawaitable_array_append(&soon->batches, batch) < 0) {
+        soon_batch_dealloc(batch);
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    PyObject *args[] = {loop, soon->trampoline, loop};
+    PyObject *handle = PyObject_VectorcallMethod(
+        threadsafe ? soon->call_soon_threadsafe_str : soon->call_soon_str,
+        args,
+        3 | PY_VECTORCALL_ARGUMENTS_OFFSET,
+        NULL
+    );
+    if (handle == NULL) {
+        // The loop might have run arbitrary code, so look the batch up
+        // again instead of assuming it's still on the end.
+        for (Py_ssize_t i = 0; i < pyawaitable_array_LENGTH(&soon->batches);
+             ++i) {
+            if (pyawaitable_array_GET_ITEM(&soon->batches, i) == batch) {
+                pyawaitable_array_remove(&soon->batches, i);
+                break;
+            }
+        }
+        return -1;
+    }
+    Py_DECREF(handle);
+
+    return 0;
+}
+
+/* Same as above, but for any thread */
+static int
+soon_batch_call(
+    pyawaitable_soon *soon,
+    PyObject *loop,
+    pyawaitable_soon_call *call,
+    bool threadsafe
+)
+{
+    int res;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(soon->trampoline);
+    res = soon_batch_call_lock_held(soon, loop, call, threadsafe);
+    _PyAwaitable_END_CRITICAL_SECTION();
+    return res;
+}
+
+static int
+soon_enqueue(
+    PyObject *loop,
+    PyAwaitable_SoonFunc func,
+    void *arg,
+    bool threadsafe
+)
+{
+    assert(loop != NULL);
+    if (func == NULL) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "PyAwaitable: NULL function passed to PyAwaitable_CallSoon()"
+        );
+        return -1;
+    }
+
+    pyawaitable_soon *soon = get_soon_state();
+    if (soon == NULL) {
+        return -1;
+    }
+
+    pyawaitable_soon_call *call = PyMem_Malloc(sizeof(pyawaitable_soon_call));
+    if (call == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    call->func = func;
+    call->arg = arg;
+
+    return soon_batch_call(soon, loop, call, threadsafe);
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_CallSoon(PyAwaitable_SoonFunc func, void *arg)
+{
+    _PyAwaitable_FORWARD(-1, CallSoon(func, arg));
+    pyawaitable_soon *soon = get_soon_state();
+    if (soon == NULL) {
+        return -1;
+    }
+
+    PyObject *get_running_loop = _PyAwaitable_ATOMIC_LOAD_PTR(
+        &soon->get_running_loop
+    );
+    if (PyAwaitable_UNLIKELY(get_running_loop == NULL)) {
+        PyObject *asyncio = PyImport_ImportModule("asyncio");
+        if (asyncio == NULL) {
+            return -1;
+        }
+
+        get_running_loop = PyObject_GetAttrString(
+            asyncio,
+            "get_running_loop"
+        );
+        Py_DECREF(asyncio);
+        if (get_running_loop == NULL) {
+            return -1;
+        }
+
+        if (
+            !_PyAwaitable_ATOMIC_CAS_PTR(
+                &soon->get_running_loop,
+                NULL,
+                get_running_loop
+            )
+        ) {
+            // Another thread beat us to it
+            Py_DECREF(get_running_loop);
+            get_running_loop = _PyAwaitable_ATOMIC_LOAD_PTR(
+                &soon->get_running_loop
+            );
+        }
+    }
+
+    PyObject *loop;
+    if (
+        soon_running_loop != NULL
+        && soon_running_tstate == PyThreadState_Get()
+    ) {
+        // Called by the trampoline's batch, so we know the loop already
+        loop = Py_NewRef(soon_running_loop);
+    }
+    else {
+        loop = PyObject_CallNoArgs(get_running_loop);
+        if (loop == NULL) {
+            return -1;
+        }
+    }
+
+    int res = soon_enqueue(loop, func, arg, false);
+    Py_DECREF(loop);
+    return res;
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_CallSoonThreadsafe(
+    PyObject * loop,
+    PyAwaitable_SoonFunc func,
+    void *arg
+)
+{
+    _PyAwaitable_FORWARD(-1, CallSoonThreadsafe(loop, func, arg));
+    if (loop == NULL) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "PyAwaitable: NULL loop passed to PyAwaitable_CallSoonThreadsafe()"
+        );
+        return -1;
+    }
+
+    return soon_enqueue(loop, func, arg, true);
+}
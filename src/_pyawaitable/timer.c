@@ -0,0 +1,862 @@
+#include <Python.h>
+#include <math.h>
+#include <stdint.h>
+
+#include <pyawaitable/array.h>
+#include <pyawaitable/awaitableobject.h>
+#include <pyawaitable/backport.h>
+#include <pyawaitable/capi.h>
+#include <pyawaitable/gather.h>
+#include <pyawaitable/init.h>
+#include <pyawaitable/optimize.h>
+#include <pyawaitable/timer.h>
+#include <pyawaitable/values.h>
+
+#define WHEEL_MASK (_PyAwaitable_WHEEL_SLOTS - 1)
+#define WHEEL_SHIFT(level) ((level) * _PyAwaitable_WHEEL_BITS)
+#define PYAWAITABLE_SLEEP_CAPSULE "pyawaitable.sleep"
+
+/* Current time, in ticks (milliseconds) */
+static int
+timer_now(pyawaitable_timers *timers, int64_t *now)
+{
+#if PY_VERSION_HEX >= 0x030d0000
+    PyTime_t ns;
+    if (PyTime_Monotonic(&ns) < 0) {
+        return -1;
+    }
+
+    *now = (int64_t)(ns / 1000000);
+    return 0;
+#else
+    PyObject *res = PyObject_CallNoArgs(timers->monotonic);
+    if (res == NULL) {
+        return -1;
+    }
+
+    double seconds = PyFloat_AsDouble(res);
+    Py_DECREF(res);
+    if (seconds == -1.0 && PyErr_Occurred()) {
+        return -1;
+    }
+
+    *now = (int64_t)(seconds * 1000);
+    return 0;
+#endif
+}
+
+/* This must be called in a critical section on the trampoline */
+static void
+timer_unlink(pyawaitable_timer *timer)
+{
+    assert(timer->wheel != NULL);
+    *timer->pprev = timer->next;
+    if (timer->next != NULL) {
+        timer->next->pprev = timer->pprev;
+    }
+
+    timer->next = NULL;
+    timer->pprev = NULL;
+    (void)_PyAwaitable_ATOMIC_EXCHANGE_PTR(&timer->wheel, NULL);
+}
+
+/*
+ * Put the timer on the lowest level whose slots can tell its tick apart
+ * from the current one. Timers that are further out than the top level can
+ * reach go in its last slot, and get moved again once it comes up. This
+ * must be called in a critical section on the trampoline.
+ */
+static void
+wheel_link(pyawaitable_wheel *wheel, pyawaitable_timer *timer)
+{
+    // Timers that are moved down from a higher level can expire right now
+    assert(timer->expires >= wheel->now);
+    int level;
+    int64_t block = 0;
+    for (level = 0; level < _PyAwaitable_WHEEL_LEVELS; ++level) {
+        block = timer->expires >> WHEEL_SHIFT(level);
+        if (block - (wheel->now >> WHEEL_SHIFT(level)) < WHEEL_MASK + 1) {
+            break;
+        }
+    }
+
+    if (level == _PyAwaitable_WHEEL_LEVELS) {
+        --level;
+        block = (wheel->now >> WHEEL_SHIFT(level)) + WHEEL_MASK;
+    }
+
+    pyawaitable_timer **slot = &wheel->slots[level][block & WHEEL_MASK];
+    timer->next = *slot;
+    if (timer->next != NULL) {
+        timer->next->pprev = &timer->next;
+    }
+    timer->pprev = slot;
+    *slot = timer;
+    (void)_PyAwaitable_ATOMIC_EXCHANGE_PTR(&timer->wheel, wheel);
+}
+
+/*
+ * Get the next tick on which there's a slot to cascade or fire, or -1 if
+ * there are no timers. This must be called in a critical section on the
+ * trampoline.
+ */
+static int64_t
+wheel_next_tick(pyawaitable_wheel *wheel)
+{
+    if (wheel->count == 0) {
+        return -1;
+    }
+
+    int64_t next = -1;
+    for (int level = 0; level < _PyAwaitable_WHEEL_LEVELS; ++level) {
+        int64_t block = wheel->now >> WHEEL_SHIFT(level);
+        for (int64_t i = 1; i <= WHEEL_MASK; ++i) {
+            if (wheel->slots[level][(block + i) & WHEEL_MASK] != NULL) {
+                int64_t tick = (block + i) << WHEEL_SHIFT(level);
+                if (next == -1 || tick < next) {
+                    next = tick;
+                }
+                break;
+            }
+        }
+    }
+
+    assert(next != -1);
+    return next;
+}
+
+/*
+ * Take the next timer that expires by the given tick off the wheel, moving
+ * the wheel forward as far as it needs to. Skips straight over ticks that
+ * have nothing on them. Returns NULL once the wheel has reached the tick.
+ * This must be called in a critical section on the trampoline.
+ */
+static pyawaitable_timer *
+wheel_pop_lock_held(pyawaitable_wheel *wheel, int64_t target)
+{
+    for (;;) {
+        // Timers are armed for later ticks, so anything left in the current
+        // slot is due now.
+        pyawaitable_timer *timer = wheel->slots[0][wheel->now & WHEEL_MASK];
+        if (timer != NULL) {
+            assert(timer->expires == wheel->now);
+            timer_unlink(timer);
+            --wheel->count;
+            return timer;
+        }
+
+        if (wheel->now >= target) {
+            return NULL;
+        }
+
+        int64_t tick = wheel_next_tick(wheel);
+        if (tick == -1 || tick > target) {
+            wheel->now = target;
+            return NULL;
+        }
+
+        wheel->now = tick;
+        // Move timers down from the higher levels first, so they can keep
+        // falling through the lower ones.
+        for (int level = _PyAwaitable_WHEEL_LEVELS - 1; level > 0; --level) {
+            int64_t mask = ((int64_t)1 << WHEEL_SHIFT(level)) - 1;
+            if ((tick & mask) != 0) {
+                continue;
+            }
+
+            pyawaitable_timer **slot =
+                &wheel->slots[level][(tick >> WHEEL_SHIFT(level)) & WHEEL_MASK];
+            timer = *slot;
+            *slot = NULL;
+            while (timer != NULL) {
+                pyawaitable_timer *next = timer->next;
+                wheel_link(wheel, timer);
+                timer = next;
+            }
+        }
+    }
+}
+
+/*
+ * Run the wheel up to the given tick, firing every timer that expires on
+ * the way. Each timer is taken off the wheel before its function is
+ * called, and the functions are called without the lock, since they can
+ * cancel other timers.
+ */
+static void
+wheel_advance(
+    pyawaitable_timers *timers,
+    pyawaitable_wheel *wheel,
+    int64_t target
+)
+{
+    for (;;) {
+        pyawaitable_timer *timer;
+        _PyAwaitable_BEGIN_CRITICAL_SECTION(timers->trampoline);
+        timer = wheel_pop_lock_held(wheel, target);
+        _PyAwaitable_END_CRITICAL_SECTION();
+        if (timer == NULL) {
+            return;
+        }
+
+        if (timer->func(timer->arg) < 0) {
+            PyErr_WriteUnraisable(timers->trampoline);
+        }
+    }
+}
+
+/*
+ * Make sure that the event loop will wake us up in time for the next tick
+ * that has work on it.
+ */
+static int
+wheel_schedule(pyawaitable_timers *timers, pyawaitable_wheel *wheel)
+{
+    int64_t tick;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(timers->trampoline);
+    tick = wheel_next_tick(wheel);
+    _PyAwaitable_END_CRITICAL_SECTION();
+    if (tick == -1) {
+        return 0;
+    }
+
+    if (wheel->handle != NULL) {
+        if (wheel->scheduled <= tick) {
+            return 0;
+        }
+
+        PyObject *res = PyObject_CallMethod(wheel->handle, "cancel", NULL);
+        if (res == NULL) {
+            return -1;
+        }
+        Py_DECREF(res);
+        Py_CLEAR(wheel->handle);
+    }
+
+    int64_t now;
+    if (timer_now(timers, &now) < 0) {
+        return -1;
+    }
+
+    double delay = tick > now ? (double)(tick - now) / 1000 : 0;
+    wheel->handle = PyObject_CallMethod(
+        wheel->loop,
+        "call_later",
+        "dOO",
+        delay,
+        timers->trampoline,
+        wheel->loop
+    );
+    if (wheel->handle == NULL) {
+        return -1;
+    }
+
+    wheel->scheduled = tick;
+    return 0;
+}
+
+/* This must be called in a critical section on the trampoline */
+static void
+wheel_free(void *ptr)
+{
+    assert(ptr != NULL);
+    pyawaitable_wheel *wheel = (pyawaitable_wheel *)ptr;
+    // Anything still armed just won't fire
+    for (int level = 0; level < _PyAwaitable_WHEEL_LEVELS; ++level) {
+        for (int i = 0; i < _PyAwaitable_WHEEL_SLOTS; ++i) {
+            while (wheel->slots[level][i] != NULL) {
+                timer_unlink(wheel->slots[level][i]);
+            }
+        }
+    }
+
+    Py_CLEAR(wheel->loop);
+    Py_CLEAR(wheel->handle);
+    PyMem_Free(wheel);
+}
+
+/*
+ * Find the wheel for the loop, or -1 if there isn't one. This must be
+ * called in a critical section on the trampoline.
+ */
+static Py_ssize_t
+wheel_find(pyawaitable_timers *timers, PyObject *loop)
+{
+    for (Py_ssize_t i = 0; i < pyawaitable_array_LENGTH(&timers->wheels); ++i) {
+        pyawaitable_wheel *wheel = pyawaitable_array_GET_ITEM(
+            &timers->wheels,
+            i
+        );
+        if (wheel->loop == loop) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_TimersFree(pyawaitable_timers *timers)
+{
+    assert(timers != NULL);
+    pyawaitable_array_clear(&timers->wheels);
+    Py_XDECREF(timers->trampoline);
+    Py_XDECREF(timers->get_running_loop);
+    Py_XDECREF(timers->current_task);
+    Py_XDECREF(timers->cancelled_error);
+    Py_XDECREF(timers->timeout_error);
+#if PY_VERSION_HEX < 0x030d0000
+    Py_XDECREF(timers->monotonic);
+#endif
+    PyMem_Free(timers);
+}
+
+static pyawaitable_timers *
+get_timers_state(void);
+
+/*
+ * Called by the event loop once the wheel's next tick has come. This
+ * fires everything that has expired, and then either goes back to sleep
+ * until the tick after that, or throws the wheel away if it's empty.
+ */
+static PyObject *
+wheel_trampoline(PyObject *self, PyObject *loop)
+{
+    pyawaitable_timers *timers = get_timers_state();
+    if (PyAwaitable_UNLIKELY(timers == NULL)) {
+        return NULL;
+    }
+
+    // Every loop has its own wheel, but they all share one array
+    pyawaitable_wheel *wheel = NULL;
+    Py_ssize_t index;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(timers->trampoline);
+    index = wheel_find(timers, loop);
+    if (index != -1) {
+        wheel = pyawaitable_array_GET_ITEM(&timers->wheels, index);
+    }
+    _PyAwaitable_END_CRITICAL_SECTION();
+    if (wheel == NULL) {
+        // Already thrown away
+        Py_RETURN_NONE;
+    }
+
+    Py_CLEAR(wheel->handle);
+    int64_t now;
+    if (timer_now(timers, &now) < 0) {
+        return NULL;
+    }
+
+    // The loop is allowed to call us a little early
+    wheel_advance(timers, wheel, Py_MAX(now, wheel->scheduled));
+    // Other threads can only cancel timers, so an empty wheel stays empty
+    Py_ssize_t count;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(timers->trampoline);
+    count = wheel->count;
+    _PyAwaitable_END_CRITICAL_SECTION();
+    if (count != 0) {
+        if (wheel_schedule(timers, wheel) < 0) {
+            return NULL;
+        }
+
+        Py_RETURN_NONE;
+    }
+
+    if (wheel->handle != NULL) {
+        // A timer was armed and then cancelled while we were firing
+        PyObject *res = PyObject_CallMethod(wheel->handle, "cancel", NULL);
+        if (res == NULL) {
+            return NULL;
+        }
+        Py_DECREF(res);
+    }
+
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(timers->trampoline);
+    index = wheel_find(timers, loop);
+    if (index != -1) {
+        pyawaitable_array_remove(&timers->wheels, index);
+    }
+    _PyAwaitable_END_CRITICAL_SECTION();
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef wheel_trampoline_def = {
+    "_pyawaitable_timer_trampoline",
+    wheel_trampoline,
+    METH_O,
+    NULL
+};
+
+static pyawaitable_timers *
+timers_state_new(void)
+{
+    pyawaitable_timers *timers = PyMem_Malloc(sizeof(pyawaitable_timers));
+    if (timers == NULL) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    timers->trampoline = NULL;
+    timers->get_running_loop = NULL;
+    timers->current_task = NULL;
+    timers->cancelled_error = NULL;
+    timers->timeout_error = NULL;
+#if PY_VERSION_HEX < 0x030d0000
+    timers->monotonic = NULL;
+#endif
+    if (pyawaitable_array_init(&timers->wheels, wheel_free) < 0) {
+        PyMem_Free(timers);
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (asyncio == NULL) {
+        _PyAwaitable_TimersFree(timers);
+        return NULL;
+    }
+
+    timers->get_running_loop = PyObject_GetAttrString(
+        asyncio,
+        "get_running_loop"
+    );
+    timers->current_task = PyObject_GetAttrString(asyncio, "current_task");
+    timers->cancelled_error = PyObject_GetAttrString(
+        asyncio,
+        "CancelledError"
+    );
+    timers->timeout_error = PyObject_GetAttrString(asyncio, "TimeoutError");
+    Py_DECREF(asyncio);
+    if (
+        timers->get_running_loop == NULL || timers->current_task == NULL
+        || timers->cancelled_error == NULL || timers->timeout_error == NULL
+    ) {
+        _PyAwaitable_TimersFree(timers);
+        return NULL;
+    }
+
+#if PY_VERSION_HEX < 0x030d0000
+    PyObject *time = PyImport_ImportModule("time");
+    if (time == NULL) {
+        _PyAwaitable_TimersFree(timers);
+        return NULL;
+    }
+
+    timers->monotonic = PyObject_GetAttrString(time, "monotonic");
+    Py_DECREF(time);
+    if (timers->monotonic == NULL) {
+        _PyAwaitable_TimersFree(timers);
+        return NULL;
+    }
+#endif
+
+    // The trampoline looks up the state itself, so it doesn't need a self
+    timers->trampoline = PyCFunction_New(&wheel_trampoline_def, NULL);
+    if (timers->trampoline == NULL) {
+        _PyAwaitable_TimersFree(timers);
+        return NULL;
+    }
+
+    return timers;
+}
+
+static pyawaitable_timers *
+get_timers_state(void)
+{
+    _PyAwaitable_LAZY_STATE(timers, timers_state_new, _PyAwaitable_TimersFree);
+}
+
+/* Get the wheel for the loop, creating it if needed */
+static pyawaitable_wheel *
+wheel_get(pyawaitable_timers *timers, PyObject *loop)
+{
+    pyawaitable_wheel *wheel = NULL;
+    int res = 0;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(timers->trampoline);
+    Py_ssize_t index = wheel_find(timers, loop);
+    if (index != -1) {
+        wheel = pyawaitable_array_GET_ITEM(&timers->wheels, index);
+    }
+    else {
+        wheel = PyMem_Calloc(1, sizeof(pyawaitable_wheel));
+        if (wheel != NULL) {
+            wheel->loop = Py_NewRef(loop);
+            res = pyawaitable_array_append(&timers->wheels, wheel);
+            if (res < 0) {
+                wheel_free(wheel);
+            }
+        }
+    }
+    _PyAwaitable_END_CRITICAL_SECTION();
+
+    if (wheel == NULL || res < 0) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    return wheel;
+}
+
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_TimerArm(
+    pyawaitable_timer *timer,
+    PyObject *loop,
+    double seconds
+)
+{
+    assert(timer->wheel == NULL);
+    assert(timer->func != NULL);
+    pyawaitable_timers *timers = get_timers_state();
+    if (PyAwaitable_UNLIKELY(timers == NULL)) {
+        return -1;
+    }
+
+    pyawaitable_wheel *wheel = wheel_get(timers, loop);
+    if (wheel == NULL) {
+        return -1;
+    }
+
+    int64_t now;
+    if (timer_now(timers, &now) < 0) {
+        return -1;
+    }
+
+    int64_t expires = now + (int64_t)ceil(seconds * 1000);
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(timers->trampoline);
+    if (wheel->count == 0) {
+        // Nothing is armed, so the wheel can skip ahead for free
+        wheel->now = Py_MAX(wheel->now, now);
+    }
+
+    timer->expires = Py_MAX(expires, wheel->now + 1);
+    wheel_link(wheel, timer);
+    ++wheel->count;
+    _PyAwaitable_END_CRITICAL_SECTION();
+
+    if (wheel_schedule(timers, wheel) < 0) {
+        _PyAwaitable_TimerCancel(timer);
+        return -1;
+    }
+
+    return 0;
+}
+
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_TimerCancel(pyawaitable_timer *timer)
+{
+    if (_PyAwaitable_ATOMIC_LOAD_PTR(&timer->wheel) == NULL) {
+        // Never armed, or already fired
+        return;
+    }
+
+    // The timer is armed, so the state already exists
+    pyawaitable_timers *timers = get_timers_state();
+    if (PyAwaitable_UNLIKELY(timers == NULL)) {
+        PyErr_WriteUnraisable(NULL);
+        return;
+    }
+
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(timers->trampoline);
+    // The loop might have fired it in the meantime
+    if (timer->wheel != NULL) {
+        // If this empties the wheel, the trampoline will throw it away
+        --timer->wheel->count;
+        timer_unlink(timer);
+    }
+    _PyAwaitable_END_CRITICAL_SECTION();
+}
+
+static int
+deadline_fire(void *arg)
+{
+    pyawaitable_callback *cb = (pyawaitable_callback *)arg;
+    if (_PyAwaitable_ATOMIC_LOAD_LONG(&cb->retired)) {
+        // The awaitable was cancelled, so the task has moved on
+        return 0;
+    }
+
+    cb->deadline_expired = true;
+    PyObject *res = PyObject_CallMethod(cb->deadline_task, "cancel", NULL);
+    if (res == NULL) {
+        return -1;
+    }
+
+    Py_DECREF(res);
+    return 0;
+}
+
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_StartDeadline(pyawaitable_callback *cb)
+{
+    assert(cb->deadline >= 0);
+    assert(cb->deadline_task == NULL);
+    pyawaitable_timers *timers = get_timers_state();
+    if (PyAwaitable_UNLIKELY(timers == NULL)) {
+        return -1;
+    }
+
+    PyObject *loop = PyObject_CallNoArgs(timers->get_running_loop);
+    if (loop == NULL) {
+        return -1;
+    }
+
+    // The deadline works by cancelling whatever task is running us
+    PyObject *task = PyObject_CallOneArg(timers->current_task, loop);
+    if (task == NULL) {
+        Py_DECREF(loop);
+        return -1;
+    }
+
+    if (task == Py_None) {
+        Py_DECREF(task);
+        Py_DECREF(loop);
+        PyErr_SetString(
+            PyExc_RuntimeError,
+            "PyAwaitable: Step deadlines can only be used inside a task"
+        );
+        return -1;
+    }
+
+    cb->deadline_task = task;
+    cb->deadline_expired = false;
+    cb->deadline_timer.func = deadline_fire;
+    cb->deadline_timer.arg = cb;
+    int res = _PyAwaitable_TimerArm(&cb->deadline_timer, loop, cb->deadline);
+    Py_DECREF(loop);
+    if (res < 0) {
+        Py_CLEAR(cb->deadline_task);
+        return -1;
+    }
+
+    return 0;
+}
+
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_StopDeadline(pyawaitable_callback *cb)
+{
+    _PyAwaitable_TimerCancel(&cb->deadline_timer);
+    Py_CLEAR(cb->deadline_task);
+}
+
+_PyAwaitable_INTERNAL(void)
+_PyAwaitable_DeadlineError(pyawaitable_callback *cb)
+{
+    assert(PyErr_Occurred());
+    if (cb == NULL || !cb->deadline_expired) {
+        return;
+    }
+
+    pyawaitable_timers *timers = get_timers_state();
+    if (PyAwaitable_UNLIKELY(timers == NULL)) {
+        return;
+    }
+
+    if (!PyErr_ExceptionMatches(timers->cancelled_error)) {
+        return;
+    }
+
+    cb->deadline_expired = false;
+    PyObject *cancelled = PyErr_GetRaisedException();
+#if PY_VERSION_HEX >= 0x030b0000
+    // Take back our cancellation; if anything else cancelled the task too,
+    // then the CancelledError is theirs.
+    PyObject *res = PyObject_CallMethod(cb->deadline_task, "uncancel", NULL);
+    if (res == NULL) {
+        Py_DECREF(cancelled);
+        return;
+    }
+
+    Py_ssize_t remaining = PyLong_AsSsize_t(res);
+    Py_DECREF(res);
+    if (remaining != 0) {
+        if (remaining == -1 && PyErr_Occurred()) {
+            Py_DECREF(cancelled);
+        }
+        else {
+            PyErr_SetRaisedException(cancelled);
+        }
+        return;
+    }
+#endif
+
+    PyObject *timeout = PyObject_CallNoArgs(timers->timeout_error);
+    if (timeout == NULL) {
+        Py_DECREF(cancelled);
+        return;
+    }
+
+    PyException_SetCause(timeout, cancelled);
+    PyErr_SetRaisedException(timeout);
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_SetStepDeadline(PyObject *awaitable, double seconds)
+{
+    _PyAwaitable_FORWARD(-1, SetStepDeadline(awaitable, seconds));
+    if (!isfinite(seconds) || seconds < 0) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "PyAwaitable: Deadlines must be finite and non-negative"
+        );
+        return -1;
+    }
+
+    PyAwaitableObject *aw = (PyAwaitableObject *)awaitable;
+    bool found = false;
+    _PyAwaitable_BEGIN_CRITICAL_SECTION(awaitable);
+    Py_ssize_t length = pyawaitable_array_LENGTH(&aw->aw_callbacks);
+    if (length > aw->aw_state) {
+        pyawaitable_callback *cb = pyawaitable_array_GET_ITEM(
+            &aw->aw_callbacks,
+            length - 1
+        );
+        if (cb->coro != NULL) {
+            cb->deadline = seconds;
+            found = true;
+        }
+    }
+    _PyAwaitable_END_CRITICAL_SECTION();
+
+    if (!found) {
+        PyErr_SetString(
+            PyExc_RuntimeError,
+            "PyAwaitable: A deadline needs an awaited step that hasn't "
+            "started yet"
+        );
+        return -1;
+    }
+
+    return 0;
+}
+
+/* A single sleep, owned by a capsule on the sleep's inner awaitable */
+typedef struct _pyawaitable_sleep {
+    pyawaitable_timer timer;
+    /* Future that the inner awaitable waits on, or NULL before it starts */
+    PyObject *future;
+    double seconds;
+} _PyAwaitable_MANGLE(pyawaitable_sleep);
+
+static void
+sleep_capsule_destructor(PyObject *capsule)
+{
+    pyawaitable_sleep *sleep = PyCapsule_GetPointer(
+        capsule,
+        PYAWAITABLE_SLEEP_CAPSULE
+    );
+    if (sleep == NULL) {
+        PyErr_WriteUnraisable(capsule);
+        return;
+    }
+
+    _PyAwaitable_TimerCancel(&sleep->timer);
+    Py_XDECREF(sleep->future);
+    PyMem_Free(sleep);
+}
+
+static int
+sleep_fire(void *arg)
+{
+    pyawaitable_sleep *sleep = (pyawaitable_sleep *)arg;
+    int res = _PyAwaitable_ResolveFuture(sleep->future, "set_result", Py_None);
+    return res < 0 ? -1 : 0;
+}
+
+static int
+sleep_start(PyObject *inner)
+{
+    PyObject *capsule = PyAwaitable_GetValue(inner, 0);
+    if (capsule == NULL) {
+        return -1;
+    }
+
+    pyawaitable_sleep *sleep = PyCapsule_GetPointer(
+        capsule,
+        PYAWAITABLE_SLEEP_CAPSULE
+    );
+    if (sleep == NULL) {
+        return -1;
+    }
+
+    pyawaitable_timers *timers = get_timers_state();
+    if (PyAwaitable_UNLIKELY(timers == NULL)) {
+        return -1;
+    }
+
+    PyObject *loop = PyObject_CallNoArgs(timers->get_running_loop);
+    if (loop == NULL) {
+        return -1;
+    }
+
+    sleep->future = PyObject_CallMethod(loop, "create_future", NULL);
+    if (sleep->future == NULL) {
+        Py_DECREF(loop);
+        return -1;
+    }
+
+    int res = _PyAwaitable_TimerArm(&sleep->timer, loop, sleep->seconds);
+    Py_DECREF(loop);
+    if (res < 0) {
+        return -1;
+    }
+
+    return PyAwaitable_AddAwait(inner, sleep->future, NULL, NULL);
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_AddSleep(PyObject *awaitable, double seconds)
+{
+    _PyAwaitable_FORWARD(-1, AddSleep(awaitable, seconds));
+    if (!isfinite(seconds) || seconds < 0) {
+        PyErr_SetString(
+            PyExc_ValueError,
+            "PyAwaitable: Sleeps must be finite and non-negative"
+        );
+        return -1;
+    }
+
+    pyawaitable_sleep *sleep = PyMem_Malloc(sizeof(pyawaitable_sleep));
+    if (sleep == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    sleep->timer.wheel = NULL;
+    sleep->timer.func = sleep_fire;
+    sleep->timer.arg = sleep;
+    sleep->future = NULL;
+    sleep->seconds = seconds;
+
+    PyObject *capsule = PyCapsule_New(
+        sleep,
+        PYAWAITABLE_SLEEP_CAPSULE,
+        sleep_capsule_destructor
+    );
+    if (capsule == NULL) {
+        PyMem_Free(sleep);
+        return -1;
+    }
+
+    PyObject *inner = PyAwaitable_New();
+    if (inner == NULL) {
+        Py_DECREF(capsule);
+        return -1;
+    }
+
+    if (PyAwaitable_SaveValues(inner, 1, capsule) < 0) {
+        Py_DECREF(capsule);
+        Py_DECREF(inner);
+        return -1;
+    }
+    Py_DECREF(capsule);
+
+    // The timer can only be armed once we're running on the loop
+    if (PyAwaitable_DeferAwait(inner, sleep_start) < 0) {
+        Py_DECREF(inner);
+        return -1;
+    }
+
+    int res = PyAwaitable_AddAwait(awaitable, inner, NULL, NULL);
+    Py_DECREF(inner);
+    return res;
+}
@@ -1,43 +1,47 @@
 #include <Python.h>
 #include <stdarg.h>
+#include <string.h>
 
 #include <pyawaitable/awaitableobject.h>
 #include <pyawaitable/backport.h>
 #include <pyawaitable/array.h>
+#include <pyawaitable/capi.h>
 #include <pyawaitable/values.h>
 #include <pyawaitable/optimize.h>
 
 #define NOTHING
 
-#define SAVE(field, type, extra)                                    \
-        PyAwaitableObject *aw = (PyAwaitableObject *) awaitable;    \
-        pyawaitable_array *array = &aw->field;                      \
-        va_list vargs;                                              \
-        va_start(vargs, nargs);                                     \
-        for (Py_ssize_t i = 0; i < nargs; ++i) {                    \
-            type ptr = va_arg(vargs, type);                         \
-            assert((void *)ptr != NULL);                            \
-            if (pyawaitable_array_append(array, (void *)ptr) < 0) { \
-                PyErr_NoMemory();                                   \
-                return -1;                                          \
-            }                                                       \
-            extra;                                                  \
-        }                                                           \
-        va_end(vargs);                                              \
-        return 0
+/*
+ * Each of these runs in a critical section on the awaitable, since other
+ * threads are allowed to save and fetch values while it's running.
+ */
+#define SAVE(field, type, extra)                                        \
+        PyAwaitableObject *aw = (PyAwaitableObject *) awaitable;        \
+        pyawaitable_array *array = &aw->field;                          \
+        int res = 0;                                                    \
+        _PyAwaitable_BEGIN_CRITICAL_SECTION(awaitable);                 \
+        for (Py_ssize_t i = 0; i < nargs; ++i) {                        \
+            type ptr = va_arg(vargs, type);                             \
+            if (pyawaitable_array_append(array, (void *)ptr) < 0) {     \
+                res = -1;                                               \
+                break;                                                  \
+            }                                                           \
+            extra;                                                      \
+        }                                                               \
+        _PyAwaitable_END_CRITICAL_SECTION();                            \
+        if (res < 0) {                                                  \
+            PyErr_NoMemory();                                           \
+        }                                                               \
+        return res
 
 #define UNPACK(field, type)                                                \
         PyAwaitableObject *aw = (PyAwaitableObject *) awaitable;           \
         pyawaitable_array *array = &aw->field;                             \
+        int res = 0;                                                       \
+        _PyAwaitable_BEGIN_CRITICAL_SECTION(awaitable);                    \
         if (pyawaitable_array_LENGTH(array) == 0) {                        \
-            PyErr_SetString(                                               \
-    PyExc_RuntimeError,                                                    \
-    "PyAwaitable: Object has no stored values"                             \
-            );                                                             \
-            return -1;                                                     \
+            res = -1;                                                      \
         }                                                                  \
-        va_list vargs;                                                     \
-        va_start(vargs, awaitable);                                        \
         for (Py_ssize_t i = 0; i < pyawaitable_array_LENGTH(array); ++i) { \
             type *ptr = va_arg(vargs, type *);                             \
             if (ptr == NULL) {                                             \
@@ -45,28 +49,91 @@
             }                                                              \
             *ptr = (type)pyawaitable_array_GET_ITEM(array, i);             \
         }                                                                  \
-        va_end(vargs);                                                     \
-        return 0
+        _PyAwaitable_END_CRITICAL_SECTION();                               \
+        if (res < 0) {                                                     \
+            PyErr_SetString(                                               \
+    PyExc_RuntimeError,                                                    \
+    "PyAwaitable: Object has no stored values"                             \
+            );                                                             \
+        }                                                                  \
+        return res
 
-#define SET(field, type)                                          \
+#define SET(field, type)                                              \
+        assert(awaitable != NULL);                                    \
+        PyAwaitableObject *aw = (PyAwaitableObject *) awaitable;      \
+        pyawaitable_array *array = &aw->field;                        \
+        int res;                                                      \
+        _PyAwaitable_BEGIN_CRITICAL_SECTION(awaitable);               \
+        res = check_index(index, array);                              \
+        if (res == 0) {                                               \
+            pyawaitable_array_set(array, index, (void *)(new_value)); \
+        }                                                             \
+        _PyAwaitable_END_CRITICAL_SECTION();                          \
+        return res
+
+#define GET(field, type)                                          \
         assert(awaitable != NULL);                                \
         PyAwaitableObject *aw = (PyAwaitableObject *) awaitable;  \
         pyawaitable_array *array = &aw->field;                    \
-        if (check_index(index, array) < 0) {                      \
-            return -1;                                            \
+        type res = (type)NULL;                                    \
+        _PyAwaitable_BEGIN_CRITICAL_SECTION(awaitable);           \
+        if (check_index(index, array) == 0) {                     \
+            res = (type)pyawaitable_array_GET_ITEM(array, index); \
         }                                                         \
-        pyawaitable_array_set(array, index, (void *)(new_value)); \
-        return 0
+        _PyAwaitable_END_CRITICAL_SECTION();                      \
+        return res
+
+#define SAVE_ARRAY(field, extra)                                    \
+        assert(awaitable != NULL);                                  \
+        assert(nargs >= 0);                                         \
+        PyAwaitableObject *aw = (PyAwaitableObject *) awaitable;    \
+        pyawaitable_array *array = &aw->field;                      \
+        void *const *items = (void *const *)values;                 \
+        int res;                                                    \
+        _PyAwaitable_BEGIN_CRITICAL_SECTION(awaitable);             \
+        res = pyawaitable_array_extend(array, items, nargs);        \
+        if (res == 0) {                                             \
+            for (Py_ssize_t i = 0; i < nargs; ++i) {                \
+                extra;                                              \
+            }                                                       \
+        }                                                           \
+        _PyAwaitable_END_CRITICAL_SECTION();                        \
+        if (res < 0) {                                              \
+            PyErr_NoMemory();                                       \
+        }                                                           \
+        return res
+
+#define BORROW(field, type)                                          \
+        assert(awaitable != NULL);                                   \
+        PyAwaitableObject *aw = (PyAwaitableObject *) awaitable;     \
+        pyawaitable_array *array = &aw->field;                       \
+        type *res = NULL;                                            \
+        _PyAwaitable_BEGIN_CRITICAL_SECTION(awaitable);              \
+        if (check_range(index, nargs, array) == 0) {                 \
+            res = (type *)pyawaitable_array_GET_ITEMS(array, index); \
+        }                                                            \
+        _PyAwaitable_END_CRITICAL_SECTION();                         \
+        return res
 
-#define GET(field, type)                                         \
+#define UNPACK_RANGE(field, type)                                \
         assert(awaitable != NULL);                               \
+        assert(values != NULL);                                  \
         PyAwaitableObject *aw = (PyAwaitableObject *) awaitable; \
         pyawaitable_array *array = &aw->field;                   \
-        if (check_index(index, array) < 0) {                     \
-            return (type)NULL;                                   \
+        int res;                                                 \
+        _PyAwaitable_BEGIN_CRITICAL_SECTION(awaitable);          \
+        res = check_range(index, nargs, array);                  \
+        if (res == 0) {                                          \
+            memcpy(                                              \
+    values,                                                      \
+    pyawaitable_array_GET_ITEMS(array, index),                   \
+    sizeof(type) * nargs                                         \
+            );                                                   \
         }                                                        \
-        return (type)pyawaitable_array_GET_ITEM(array, index)
+        _PyAwaitable_END_CRITICAL_SECTION();                     \
+        return res
 
+#ifndef PYAWAITABLE_UNCHECKED
 static int
 check_index(Py_ssize_t index, pyawaitable_array *array)
 {
@@ -89,19 +156,74 @@ check_index(Py_ssize_t index, pyawaitable_array *array)
 
     return 0;
 }
+#endif
+
+static int
+check_range(Py_ssize_t index, Py_ssize_t nargs, pyawaitable_array *array)
+{
+    assert(array != NULL);
+    if (PyAwaitable_UNLIKELY(index < 0 || nargs < 0)) {
+        PyErr_SetString(
+            PyExc_IndexError,
+            "PyAwaitable: Cannot use a negative index or length"
+        );
+        return -1;
+    }
+
+    if (
+        PyAwaitable_UNLIKELY(
+            nargs > pyawaitable_array_LENGTH(array) - index
+        )
+    ) {
+        PyErr_SetString(
+            PyExc_IndexError,
+            "PyAwaitable: Range is out of bounds"
+        );
+        return -1;
+    }
+
+    return 0;
+}
+
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_UnpackValuesV(PyObject * awaitable, va_list vargs)
+{
+    _PyAwaitable_FORWARD(-1, UnpackValuesV(awaitable, vargs));
+    UNPACK(aw_object_values, PyObject *);
+}
 
 _PyAwaitable_API(int)
 PyAwaitable_UnpackValues(PyObject * awaitable, ...)
 {
-    UNPACK(aw_object_values, PyObject *);
+    va_list vargs;
+    va_start(vargs, awaitable);
+    int res = _PyAwaitable_UnpackValuesV(awaitable, vargs);
+    va_end(vargs);
+    return res;
+}
+
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_SaveValuesV(
+    PyObject * awaitable,
+    Py_ssize_t nargs,
+    va_list vargs
+)
+{
+    _PyAwaitable_FORWARD(-1, SaveValuesV(awaitable, nargs, vargs));
+    SAVE(aw_object_values, PyObject *, assert(ptr != NULL); Py_INCREF(ptr));
 }
 
 _PyAwaitable_API(int)
 PyAwaitable_SaveValues(PyObject * awaitable, Py_ssize_t nargs, ...)
 {
-    SAVE(aw_object_values, PyObject *, Py_INCREF(ptr));
+    va_list vargs;
+    va_start(vargs, nargs);
+    int res = _PyAwaitable_SaveValuesV(awaitable, nargs, vargs);
+    va_end(vargs);
+    return res;
 }
 
+#ifndef PYAWAITABLE_UNCHECKED
 _PyAwaitable_API(int)
 PyAwaitable_SetValue(
     PyObject * awaitable,
@@ -109,6 +231,7 @@ PyAwaitable_SetValue(
     PyObject * new_value
 )
 {
+    _PyAwaitable_FORWARD(-1, SetValue(awaitable, index, new_value));
     SET(aw_object_values, Py_NewRef);
 }
 
@@ -118,23 +241,98 @@ PyAwaitable_GetValue(
     Py_ssize_t index
 )
 {
+    _PyAwaitable_FORWARD(NULL, GetValue(awaitable, index));
     GET(aw_object_values, PyObject *);
 }
+#endif
+
+_PyAwaitable_API(int)
+PyAwaitable_SaveValuesArray(
+    PyObject * awaitable,
+    PyObject *const *values,
+    Py_ssize_t nargs
+)
+{
+    _PyAwaitable_FORWARD(-1, SaveValuesArray(awaitable, values, nargs));
+    for (Py_ssize_t i = 0; i < nargs; ++i) {
+        if (PyAwaitable_UNLIKELY(values[i] == NULL)) {
+            PyErr_SetString(
+                PyExc_ValueError,
+                "PyAwaitable: Cannot save NULL as an object value"
+            );
+            return -1;
+        }
+    }
+    SAVE_ARRAY(aw_object_values, Py_INCREF(values[i]));
+}
+
+_PyAwaitable_API(PyObject **)
+PyAwaitable_BorrowValues(
+    PyObject * awaitable,
+    Py_ssize_t index,
+    Py_ssize_t nargs
+)
+{
+    _PyAwaitable_FORWARD(NULL, BorrowValues(awaitable, index, nargs));
+    BORROW(aw_object_values, PyObject *);
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_UnpackValuesRange(
+    PyObject * awaitable,
+    Py_ssize_t index,
+    Py_ssize_t nargs,
+    PyObject **values
+)
+{
+    _PyAwaitable_FORWARD(
+        -1,
+        UnpackValuesRange(awaitable, index, nargs, values)
+    );
+    UNPACK_RANGE(aw_object_values, PyObject *);
+}
 
 /* Arbitrary Values */
 
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_UnpackArbValuesV(PyObject * awaitable, va_list vargs)
+{
+    _PyAwaitable_FORWARD(-1, UnpackArbValuesV(awaitable, vargs));
+    UNPACK(aw_arbitrary_values, void *);
+}
+
 _PyAwaitable_API(int)
 PyAwaitable_UnpackArbValues(PyObject * awaitable, ...)
 {
-    UNPACK(aw_arbitrary_values, void *);
+    va_list vargs;
+    va_start(vargs, awaitable);
+    int res = _PyAwaitable_UnpackArbValuesV(awaitable, vargs);
+    va_end(vargs);
+    return res;
+}
+
+_PyAwaitable_INTERNAL(int)
+_PyAwaitable_SaveArbValuesV(
+    PyObject * awaitable,
+    Py_ssize_t nargs,
+    va_list vargs
+)
+{
+    _PyAwaitable_FORWARD(-1, SaveArbValuesV(awaitable, nargs, vargs));
+    SAVE(aw_arbitrary_values, void *, NOTHING);
 }
 
 _PyAwaitable_API(int)
 PyAwaitable_SaveArbValues(PyObject * awaitable, Py_ssize_t nargs, ...)
 {
-    SAVE(aw_arbitrary_values, void *, NOTHING);
+    va_list vargs;
+    va_start(vargs, nargs);
+    int res = _PyAwaitable_SaveArbValuesV(awaitable, nargs, vargs);
+    va_end(vargs);
+    return res;
 }
 
+#ifndef PYAWAITABLE_UNCHECKED
 _PyAwaitable_API(int)
 PyAwaitable_SetArbValue(
     PyObject * awaitable,
@@ -142,6 +340,7 @@ PyAwaitable_SetArbValue(
     void *new_value
 )
 {
+    _PyAwaitable_FORWARD(-1, SetArbValue(awaitable, index, new_value));
     SET(aw_arbitrary_values, void *);
 }
 
@@ -151,5 +350,44 @@ PyAwaitable_GetArbValue(
     Py_ssize_t index
 )
 {
+    _PyAwaitable_FORWARD(NULL, GetArbValue(awaitable, index));
     GET(aw_arbitrary_values, void *);
 }
+#endif
+
+_PyAwaitable_API(int)
+PyAwaitable_SaveArbValuesArray(
+    PyObject * awaitable,
+    void *const *values,
+    Py_ssize_t nargs
+)
+{
+    _PyAwaitable_FORWARD(-1, SaveArbValuesArray(awaitable, values, nargs));
+    SAVE_ARRAY(aw_arbitrary_values, NOTHING);
+}
+
+_PyAwaitable_API(void **)
+PyAwaitable_BorrowArbValues(
+    PyObject * awaitable,
+    Py_ssize_t index,
+    Py_ssize_t nargs
+)
+{
+    _PyAwaitable_FORWARD(NULL, BorrowArbValues(awaitable, index, nargs));
+    BORROW(aw_arbitrary_values, void *);
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_UnpackArbValuesRange(
+    PyObject * awaitable,
+    Py_ssize_t index,
+    Py_ssize_t nargs,
+    void **values
+)
+{
+    _PyAwaitable_FORWARD(
+        -1,
+        UnpackArbValuesRange(awaitable, index, nargs, values)
+    );
+    UNPACK_RANGE(aw_arbitrary_values, void *);
+}
@@ -1,28 +1,17 @@
 #include <Python.h>
 #include <pyawaitable/backport.h>
+#include <pyawaitable/capi.h>
 #include <pyawaitable/awaitableobject.h>
 #include <pyawaitable/values.h>
 
 static int
-async_with_inner(PyObject *aw, PyObject *res)
+async_with_exit(PyObject *aw, int callback_result)
 {
-    PyAwaitable_Callback cb;
-    PyAwaitable_Error err;
     PyObject *exit;
-    if (PyAwaitable_UnpackArbValues(aw, &cb, &err) < 0) {
-        return -1;
-    }
-
     if (PyAwaitable_UnpackValues(aw, &exit) < 0) {
         return -1;
     }
 
-    Py_INCREF(aw);
-    Py_INCREF(res);
-    int callback_result = cb != NULL ? cb(aw, res) : 0;
-    Py_DECREF(res);
-    Py_DECREF(aw);
-
     PyObject *args[3];
     if (callback_result < 0) {
         PyObject *tp, *val, *tb;
@@ -70,13 +59,47 @@ async_with_inner(PyObject *aw, PyObject *res)
     return 0;
 }
 
-_PyAwaitable_API(int)
-PyAwaitable_AsyncWith(
-    PyObject * aw,
-    PyObject * ctx,
-    PyAwaitable_Callback cb,
-    PyAwaitable_Error err
-)
+static int
+async_with_inner(PyObject *aw, PyObject *res)
+{
+    PyAwaitable_Callback cb;
+    if (PyAwaitable_UnpackArbValues(aw, &cb, NULL) < 0) {
+        return -1;
+    }
+
+    Py_INCREF(aw);
+    Py_INCREF(res);
+    int callback_result = cb != NULL ? cb(aw, res) : 0;
+    Py_DECREF(res);
+    Py_DECREF(aw);
+
+    return async_with_exit(aw, callback_result);
+}
+
+static int
+async_with_inner_ex(PyObject *aw, PyObject *res)
+{
+    PyAwaitable_CallbackEx cb;
+    void *userdata;
+    if (PyAwaitable_UnpackArbValues(aw, &cb, NULL, &userdata) < 0) {
+        return -1;
+    }
+
+    Py_INCREF(aw);
+    Py_INCREF(res);
+    int callback_result = cb != NULL ? cb(aw, res, userdata) : 0;
+    Py_DECREF(res);
+    Py_DECREF(aw);
+
+    return async_with_exit(aw, callback_result);
+}
+
+/*
+ * Create the inner awaitable that enters ctx, calls inner_callback with
+ * the result of __aenter__, and then calls __aexit__.
+ */
+static PyObject *
+async_with_new_inner(PyObject *ctx, PyAwaitable_Callback inner_callback)
 {
     PyObject *with = PyObject_GetAttrString(ctx, "__aenter__");
     if (with == NULL) {
@@ -85,7 +108,7 @@ PyAwaitable_AsyncWith(
             "PyAwaitable: %R is not an async context manager (missing __aenter__)",
             ctx
         );
-        return -1;
+        return NULL;
     }
     PyObject *exit = PyObject_GetAttrString(ctx, "__aexit__");
     if (exit == NULL) {
@@ -95,7 +118,7 @@ PyAwaitable_AsyncWith(
             "PyAwaitable: %R is not an async context manager (missing __aexit__)",
             ctx
         );
-        return -1;
+        return NULL;
     }
 
     PyObject *inner_aw = PyAwaitable_New();
@@ -103,21 +126,14 @@ PyAwaitable_AsyncWith(
     if (inner_aw == NULL) {
         Py_DECREF(with);
         Py_DECREF(exit);
-        return -1;
-    }
-
-    if (PyAwaitable_SaveArbValues(inner_aw, 2, cb, err) < 0) {
-        Py_DECREF(inner_aw);
-        Py_DECREF(with);
-        Py_DECREF(exit);
-        return -1;
+        return NULL;
     }
 
     if (PyAwaitable_SaveValues(inner_aw, 1, exit) < 0) {
         Py_DECREF(inner_aw);
         Py_DECREF(exit);
         Py_DECREF(with);
-        return -1;
+        return NULL;
     }
 
     Py_DECREF(exit);
@@ -127,16 +143,37 @@ PyAwaitable_AsyncWith(
         PyAwaitable_AddExpr(
             inner_aw,
             PyObject_CallNoArgs(with),
-            async_with_inner,
+            inner_callback,
             NULL
         ) < 0
     ) {
         Py_DECREF(inner_aw);
         Py_DECREF(with);
-        return -1;
+        return NULL;
     }
 
     Py_DECREF(with);
+    return inner_aw;
+}
+
+_PyAwaitable_API(int)
+PyAwaitable_AsyncWith(
+    PyObject * aw,
+    PyObject * ctx,
+    PyAwaitable_Callback cb,
+    PyAwaitable_Error err
+)
+{
+    _PyAwaitable_FORWARD(-1, AsyncWith(aw, ctx, cb, err));
+    PyObject *inner_aw = async_with_new_inner(ctx, async_with_inner);
+    if (inner_aw == NULL) {
+        return -1;
+    }
+
+    if (PyAwaitable_SaveArbValues(inner_aw, 2, cb, err) < 0) {
+        Py_DECREF(inner_aw);
+        return -1;
+    }
 
     if (PyAwaitable_AddExpr(aw, inner_aw, NULL, err) < 0) {
         return -1;
@@ -144,3 +181,28 @@ PyAwaitable_AsyncWith(
 
     return 0;
 }
+
+_PyAwaitable_API(int)
+PyAwaitable_AsyncWithEx(
+    PyObject * aw,
+    PyObject * ctx,
+    PyAwaitable_CallbackEx cb,
+    PyAwaitable_ErrorEx err,
+    void *userdata
+)
+{
+    _PyAwaitable_FORWARD(-1, AsyncWithEx(aw, ctx, cb, err, userdata));
+    PyObject *inner_aw = async_with_new_inner(ctx, async_with_inner_ex);
+    if (inner_aw == NULL) {
+        return -1;
+    }
+
+    if (PyAwaitable_SaveArbValues(inner_aw, 3, cb, err, userdata) < 0) {
+        Py_DECREF(inner_aw);
+        return -1;
+    }
+
+    int res = PyAwaitable_AddAwaitEx(aw, inner_aw, NULL, err, userdata);
+    Py_DECREF(inner_aw);
+    return res;
+}
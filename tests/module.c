@@ -1,3 +1,11 @@
+#ifdef PYAWAITABLE_TEST_SHARED
+#define PYAWAITABLE_IMPLEMENTATION
+/* Export PyAwaitable through the function table */
+#define PYAWAITABLE_SHARED
+#define TEST_MODULE_INIT PyInit__pyawaitable_test_shared
+#else
+#define TEST_MODULE_INIT PyInit__pyawaitable_test
+#endif
 #include <Python.h>
 #include <pyawaitable.h>
 #include "pyawaitable_test.h"
@@ -15,12 +23,31 @@ _pyawaitable_test_exec(PyObject *mod)
     ADD_TESTS(awaitable);
     ADD_TESTS(callbacks);
     ADD_TESTS(values);
+    ADD_TESTS(unchecked);
+    ADD_TESTS(soon);
+    ADD_TESTS(interp);
+    ADD_TESTS(capi);
+    ADD_TESTS(driver);
+    ADD_TESTS(gather);
+    ADD_TESTS(timer);
+    ADD_TESTS(future);
+    ADD_TESTS(pool);
+    ADD_TESTS(io);
+    ADD_TESTS(fileio);
+    ADD_TESTS(fileio_nouring);
+    ADD_TESTS(threads);
 #undef ADD_TESTS
     return PyAwaitable_Init();
 }
 
 static PyModuleDef_Slot _pyawaitable_test_slots[] = {
     {Py_mod_exec, _pyawaitable_test_exec},
+#ifdef Py_MOD_PER_INTERPRETER_GIL_SUPPORTED
+    {Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED},
+#endif
+#ifdef Py_GIL_DISABLED
+    {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#endif
     {0, NULL}
 };
 
@@ -31,7 +58,7 @@ static PyModuleDef _pyawaitable_test_module = {
 };
 
 PyMODINIT_FUNC
-PyInit__pyawaitable_test()
+TEST_MODULE_INIT()
 {
     return PyModuleDef_Init(&_pyawaitable_test_module);
 }
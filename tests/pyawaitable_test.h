@@ -7,5 +7,18 @@
 extern TESTS(awaitable);
 extern TESTS(callbacks);
 extern TESTS(values);
+extern TESTS(unchecked);
+extern TESTS(soon);
+extern TESTS(interp);
+extern TESTS(capi);
+extern TESTS(driver);
+extern TESTS(gather);
+extern TESTS(timer);
+extern TESTS(future);
+extern TESTS(pool);
+extern TESTS(io);
+extern TESTS(fileio);
+extern TESTS(fileio_nouring);
+extern TESTS(threads);
 
 #endif
@@ -1,30 +1,43 @@
 from setuptools import setup, Extension
 from pathlib import Path
+import subprocess
+import sys
 from glob import glob
 
-NOT_FOUND = """pyawaitable.h wasn't found! It probably wasn't built.
-
-To build a working copy, you can either install the package
-locally (via `pip install .`), or by executing the `hatch_build.py` file.
-"""
-
 def find_local_pyawaitable() -> str:
-    """Find the directory containing the local copy of pyawaitable.h"""
+    """Regenerate the local copy of pyawaitable.h and find its directory"""
     top_level = Path(__file__).parent.parent
+    # pyawaitable.h isn't checked in, so build it from the current sources
+    subprocess.run(
+        [sys.executable, "hatch_build.py"],
+        cwd=top_level,
+        check=True,
+    )
     source = top_level / "src" / "pyawaitable"
-    if not (source / "pyawaitable.h").exists():
-        raise RuntimeError(NOT_FOUND)
-    
     return str(source.absolute())
 
 if __name__ == "__main__":
+    PYAWAITABLE_INCLUDE = find_local_pyawaitable()
     setup(
         ext_modules=[
+            # Every file gets its own copy of PyAwaitable
             Extension(
                 "_pyawaitable_test",
                 glob("*.c"),
-                include_dirs=[find_local_pyawaitable()],
+                include_dirs=[PYAWAITABLE_INCLUDE],
+                extra_compile_args=["-O0", "-g3"]
+            ),
+            # module.c holds the only copy, and exports it through the
+            # function table
+            Extension(
+                "_pyawaitable_test_shared",
+                glob("*.c"),
+                include_dirs=[PYAWAITABLE_INCLUDE],
+                define_macros=[
+                    ("PYAWAITABLE_SINGLE_IMPLEMENTATION", None),
+                    ("PYAWAITABLE_TEST_SHARED", None),
+                ],
                 extra_compile_args=["-O0", "-g3"]
-            )
+            ),
         ]
     )
@@ -157,6 +157,44 @@ coroutine_trampoline(PyObject *self, PyObject *coro)
     return awaitable;
 }
 
+static int
+handle_zero_division(PyObject *awaitable, PyObject *err)
+{
+    if (!PyErr_GivenExceptionMatches(err, PyExc_ZeroDivisionError)) {
+        return -2;
+    }
+
+    PyObject *handled = PyUnicode_FromString("handled");
+    if (handled == NULL) {
+        return -1;
+    }
+
+    int res = PyAwaitable_SetResult(awaitable, handled);
+    Py_DECREF(handled);
+    return res;
+}
+
+/* Awaits coro, and sets the result to "handled" upon ZeroDivisionError */
+static PyObject *
+handling_awaitable(PyObject *self, PyObject *coro)
+{
+    return Test_NewAwaitableWithCoro(coro, NULL, handle_zero_division);
+}
+
+/* Drops an awaitable that was never awaited while an error is set */
+static PyObject *
+drop_awaitable_while_raising(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    PyErr_SetString(PyExc_ZeroDivisionError, "spam");
+    Py_DECREF(awaitable);
+    return NULL;
+}
+
 static PyObject *
 test_add_await_expr(PyObject *self, PyObject *nothing)
 {
@@ -175,6 +213,313 @@ test_add_await_expr(PyObject *self, PyObject *nothing)
     Py_RETURN_NONE;
 }
 
+static int
+count_step(PyObject *awaitable, void *counter)
+{
+    ++(*(int *)counter);
+    return 0;
+}
+
+static PyObject *
+test_step_budget_yields_to_loop(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    if (PyAwaitable_SetStepBudget(awaitable, 2) < 0) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    int counter = 0;
+    for (int i = 0; i < 5; ++i) {
+        if (PyAwaitable_DeferAwaitEx(awaitable, count_step, &counter) < 0) {
+            Py_DECREF(awaitable);
+            return NULL;
+        }
+    }
+
+    Py_ssize_t total_hits = PyAwaitable_GetTotalStepBudgetHits();
+    PyObject *res = Test_RunAwaitable(awaitable);
+    if (res == NULL) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+    Py_DECREF(res);
+
+    TEST_ASSERT(counter == 5);
+    // Two steps, yield, two steps, yield, one step
+    TEST_ASSERT(PyAwaitable_GetStepBudgetHits(awaitable) == 2);
+    TEST_ASSERT(PyAwaitable_GetTotalStepBudgetHits() >= total_hits + 2);
+    Py_DECREF(awaitable);
+    Py_RETURN_NONE;
+}
+
+typedef struct {
+    int events[8];
+    int count;
+} step_log;
+
+static int
+log_tick(void *arg)
+{
+    step_log *log = (step_log *)arg;
+    log->events[log->count++] = -1;
+    return 0;
+}
+
+static int
+log_step(PyObject *awaitable, void *arg)
+{
+    step_log *log = (step_log *)arg;
+    log->events[log->count] = log->count + 1;
+    if (log->count++ == 0) {
+        // Runs as soon as the loop gets control back
+        return PyAwaitable_CallSoon(log_tick, log);
+    }
+
+    return 0;
+}
+
+static PyObject *
+test_step_budget_lets_loop_run(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    if (PyAwaitable_SetStepBudget(awaitable, 2) < 0) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    step_log log = {{0}, 0};
+    for (int i = 0; i < 5; ++i) {
+        if (PyAwaitable_DeferAwaitEx(awaitable, log_step, &log) < 0) {
+            Py_DECREF(awaitable);
+            return NULL;
+        }
+    }
+
+    PyObject *res = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    if (res == NULL) {
+        return NULL;
+    }
+    Py_DECREF(res);
+
+    // The loop's callback runs between the first and second slices
+    TEST_ASSERT(log.count == 6);
+    TEST_ASSERT(log.events[0] == 1);
+    TEST_ASSERT(log.events[1] == 2);
+    TEST_ASSERT(log.events[2] == -1);
+    TEST_ASSERT(log.events[3] == 4);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_default_step_budget(PyObject *self, PyObject *nothing)
+{
+    PyObject *before = PyAwaitable_New();
+    if (before == NULL) {
+        return NULL;
+    }
+
+    if (PyAwaitable_SetDefaultStepBudget(2) < 0) {
+        Py_DECREF(before);
+        return NULL;
+    }
+
+    PyObject *after = PyAwaitable_New();
+    // Don't leak the default into other tests
+    if (PyAwaitable_SetDefaultStepBudget(0) < 0 || after == NULL) {
+        Py_XDECREF(after);
+        Py_DECREF(before);
+        return NULL;
+    }
+
+    int counter = 0;
+    for (int i = 0; i < 5; ++i) {
+        if (
+            PyAwaitable_DeferAwaitEx(before, count_step, &counter) < 0
+            || PyAwaitable_DeferAwaitEx(after, count_step, &counter) < 0
+        ) {
+            Py_DECREF(before);
+            Py_DECREF(after);
+            return NULL;
+        }
+    }
+
+    PyObject *res = Test_RunAwaitable(before);
+    if (res == NULL) {
+        Py_DECREF(before);
+        Py_DECREF(after);
+        return NULL;
+    }
+    Py_DECREF(res);
+
+    res = Test_RunAwaitable(after);
+    if (res == NULL) {
+        Py_DECREF(before);
+        Py_DECREF(after);
+        return NULL;
+    }
+    Py_DECREF(res);
+
+    TEST_ASSERT(counter == 10);
+    // Only the awaitable created after the change has a budget
+    TEST_ASSERT(PyAwaitable_GetStepBudgetHits(before) == 0);
+    TEST_ASSERT(PyAwaitable_GetStepBudgetHits(after) == 2);
+    Py_DECREF(before);
+    Py_DECREF(after);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_invalid_step_budget(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+    PyAwaitable_Cancel(awaitable);
+
+    TEST_ASSERT(PyAwaitable_SetStepBudget(awaitable, -2) < 0);
+    EXPECT_ERROR(PyExc_ValueError);
+    TEST_ASSERT(
+        PyAwaitable_SetDefaultStepBudget(PyAwaitable_STEP_BUDGET_DEFAULT) < 0
+    );
+    EXPECT_ERROR(PyExc_ValueError);
+
+    Py_DECREF(awaitable);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_state_is_per_interpreter(PyObject *self, PyObject *nothing)
+{
+    PyTypeObject *main_type = PyAwaitable_GetType();
+    if (main_type == NULL) {
+        return NULL;
+    }
+
+    PyThreadState *main_tstate = PyThreadState_Get();
+    PyThreadState *sub_tstate = Py_NewInterpreter();
+    if (sub_tstate == NULL) {
+        PyThreadState_Swap(main_tstate);
+        PyErr_SetString(PyExc_RuntimeError, "failed to create interpreter");
+        return NULL;
+    }
+
+    // This thread's cache must not leak the main interpreter's state
+    int missing = PyAwaitable_GetType() == NULL
+                  && PyErr_ExceptionMatches(PyExc_RuntimeError);
+    PyErr_Clear();
+    int init_ok = PyAwaitable_Init() == 0;
+    PyErr_Clear();
+    PyTypeObject *sub_type = PyAwaitable_GetType();
+    PyErr_Clear();
+
+    Py_EndInterpreter(sub_tstate);
+    PyThreadState_Swap(main_tstate);
+
+    TEST_ASSERT(missing);
+    TEST_ASSERT(init_ok);
+    TEST_ASSERT(sub_type != NULL);
+    // Each interpreter has its own heap types
+    TEST_ASSERT(sub_type != main_type);
+    TEST_ASSERT(PyAwaitable_GetType() == main_type);
+    Py_RETURN_NONE;
+}
+
+/*
+ * A new interpreter can end up at the same address as one that's gone, so
+ * the cache must not hand out the old interpreter's (freed) state.
+ */
+static PyObject *
+test_state_cache_after_interpreter_ends(PyObject *self, PyObject *nothing)
+{
+    PyThreadState *main_tstate = PyThreadState_Get();
+    int cached = 0;
+    int missing = 0;
+    for (int i = 0; i < 2; ++i) {
+        PyThreadState *sub_tstate = Py_NewInterpreter();
+        if (sub_tstate == NULL) {
+            PyThreadState_Swap(main_tstate);
+            PyErr_SetString(
+                PyExc_RuntimeError,
+                "failed to create interpreter"
+            );
+            return NULL;
+        }
+
+        if (i == 0) {
+            cached = PyAwaitable_Init() == 0 && PyAwaitable_GetType() != NULL;
+        }
+        else {
+            missing = PyAwaitable_GetType() == NULL
+                      && PyErr_ExceptionMatches(PyExc_RuntimeError);
+        }
+        PyErr_Clear();
+
+        Py_EndInterpreter(sub_tstate);
+        PyThreadState_Swap(main_tstate);
+    }
+
+    TEST_ASSERT(cached);
+    TEST_ASSERT(missing);
+    Py_RETURN_NONE;
+}
+
+/* asyncio doesn't run reliably in isolated subinterpreters before 3.13 */
+#if PY_VERSION_HEX >= 0x030D0000
+static PyObject *
+test_awaitable_in_isolated_interpreter(PyObject *self, PyObject *nothing)
+{
+    PyThreadState *main_tstate = PyThreadState_Get();
+    PyInterpreterConfig config = {
+        .check_multi_interp_extensions = 1,
+        .gil = PyInterpreterConfig_OWN_GIL,
+    };
+    PyThreadState *sub_tstate;
+    PyStatus status = Py_NewInterpreterFromConfig(&sub_tstate, &config);
+    if (PyStatus_Exception(status)) {
+        PyThreadState_Swap(main_tstate);
+        PyErr_SetString(PyExc_RuntimeError, "failed to create interpreter");
+        return NULL;
+    }
+
+    long value = -1;
+    if (PyAwaitable_Init() == 0) {
+        PyObject *awaitable = PyAwaitable_New();
+        if (awaitable != NULL) {
+            PyObject *expected = PyLong_FromLong(42);
+            if (
+                expected != NULL
+                && PyAwaitable_SetResult(awaitable, expected) == 0
+            ) {
+                PyObject *res = Test_RunAwaitable(awaitable);
+                if (res != NULL) {
+                    value = PyLong_AsLong(res);
+                    Py_DECREF(res);
+                }
+            }
+            Py_XDECREF(expected);
+            Py_DECREF(awaitable);
+        }
+    }
+    PyErr_Clear();
+
+    Py_EndInterpreter(sub_tstate);
+    PyThreadState_Swap(main_tstate);
+    TEST_ASSERT(value == 42);
+    Py_RETURN_NONE;
+}
+#endif
+
 TESTS(awaitable) = {
     TEST_UTIL(generic_awaitable),
     TEST(test_awaitable_new),
@@ -182,6 +527,17 @@ TESTS(awaitable) = {
     TEST_CORO(test_add_await),
     TEST_CORO(test_add_await_special_cases),
     TEST_UTIL(coroutine_trampoline),
+    TEST_UTIL(handling_awaitable),
+    TEST_UTIL(drop_awaitable_while_raising),
     TEST(test_add_await_expr),
+    TEST(test_step_budget_yields_to_loop),
+    TEST(test_step_budget_lets_loop_run),
+    TEST(test_default_step_budget),
+    TEST(test_invalid_step_budget),
+    TEST(test_state_is_per_interpreter),
+    TEST(test_state_cache_after_interpreter_ends),
+#if PY_VERSION_HEX >= 0x030D0000
+    TEST(test_awaitable_in_isolated_interpreter),
+#endif
     {NULL}
 };
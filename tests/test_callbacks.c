@@ -100,6 +100,40 @@ overwriting_error_callback(PyObject *awaitable, PyObject *err)
     return -2;
 }
 
+static int
+userdata_callback(PyObject *awaitable, PyObject *value, void *userdata)
+{
+    TEST_ASSERT_INT(awaitable != NULL);
+    TEST_ASSERT_INT(value == Py_None);
+    TEST_ASSERT_INT(userdata == &callback_called);
+    TEST_ASSERT_INT(callback_called == 0);
+    callback_called = 1;
+    return 0;
+}
+
+static int
+aborting_callback_ex(PyObject *awaitable, PyObject *value, void *userdata)
+{
+    return aborting_callback(awaitable, value);
+}
+
+static int
+userdata_error_callback(PyObject *awaitable, PyObject *err, void *userdata)
+{
+    TEST_ASSERT_INT(!PyErr_Occurred());
+    TEST_ASSERT_INT(userdata == &error_callback_called);
+    return error_callback(awaitable, err);
+}
+
+static int
+userdata_defer_callback(PyObject *awaitable, void *userdata)
+{
+    TEST_ASSERT_INT(awaitable != NULL);
+    TEST_ASSERT_INT(userdata == &callback_called);
+    ++callback_called;
+    return 0;
+}
+
 static PyObject *
 test_callback_is_called(PyObject *self, PyObject *coro)
 {
@@ -133,6 +167,7 @@ test_callback_not_invoked_when_exception(PyObject *self, PyObject *coro)
         return NULL;
     }
     PyObject *res = Test_RunAwaitable(awaitable);
+    TEST_ASSERT(res == NULL);
     EXPECT_ERROR(PyExc_ZeroDivisionError);
     Py_RETURN_NONE;
 }
@@ -260,6 +295,403 @@ test_forcefully_propagating_callback_error(PyObject *self, PyObject *coro)
     Py_RETURN_NONE;
 }
 
+static PyObject *
+test_callback_receives_userdata(PyObject *self, PyObject *coro)
+{
+    callback_called = 0;
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    if (
+        PyAwaitable_AddAwaitEx(
+            awaitable,
+            coro,
+            userdata_callback,
+            aborting_callback_ex,
+            &callback_called
+        ) < 0
+    ) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    PyObject *res = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    if (res == NULL) {
+        return NULL;
+    }
+    Py_DECREF(res);
+    TEST_ASSERT(callback_called == 1);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_error_callback_receives_userdata(PyObject *self, PyObject *coro)
+{
+    error_callback_called = 0;
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    if (
+        PyAwaitable_AddAwaitEx(
+            awaitable,
+            coro,
+            aborting_callback_ex,
+            userdata_error_callback,
+            &error_callback_called
+        ) < 0
+    ) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    PyObject *res = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    if (res == NULL) {
+        return NULL;
+    }
+    Py_DECREF(res);
+    TEST_ASSERT(error_callback_called == 1);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_defer_receives_userdata(PyObject *self, PyObject *nothing)
+{
+    callback_called = 0;
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        if (
+            PyAwaitable_DeferAwaitEx(
+                awaitable,
+                userdata_defer_callback,
+                &callback_called
+            ) < 0
+        ) {
+            Py_DECREF(awaitable);
+            return NULL;
+        }
+    }
+
+    PyObject *res = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    if (res == NULL) {
+        return NULL;
+    }
+    Py_DECREF(res);
+    TEST_ASSERT(callback_called == 2);
+    Py_RETURN_NONE;
+}
+
+/* Enters with 42, or raises ZeroDivisionError from __aenter__ */
+static const char context_manager_source[] =
+    "class ContextManager:\n"
+    "    def __init__(self, fail):\n"
+    "        self.fail = fail\n"
+    "    async def __aenter__(self):\n"
+    "        if self.fail:\n"
+    "            raise ZeroDivisionError\n"
+    "        return 42\n"
+    "    async def __aexit__(self, *args):\n"
+    "        return None\n";
+
+static PyObject *
+new_context_manager(int fail)
+{
+    PyObject *globals = PyDict_New();
+    if (globals == NULL) {
+        return NULL;
+    }
+
+    if (
+        PyDict_SetItemString(globals, "__builtins__", PyEval_GetBuiltins()) < 0
+    ) {
+        Py_DECREF(globals);
+        return NULL;
+    }
+
+    PyObject *res = PyRun_String(
+        context_manager_source,
+        Py_file_input,
+        globals,
+        globals
+    );
+    if (res == NULL) {
+        Py_DECREF(globals);
+        return NULL;
+    }
+    Py_DECREF(res);
+
+    PyObject *cls = PyDict_GetItemString(globals, "ContextManager");
+    PyObject *ctx = cls == NULL
+                    ? NULL
+                    : PyObject_CallFunction(cls, "i", fail);
+    Py_DECREF(globals);
+    return ctx;
+}
+
+static int
+userdata_with_callback(PyObject *awaitable, PyObject *value, void *userdata)
+{
+    TEST_ASSERT_INT(Py_IS_TYPE(awaitable, PyAwaitable_GetType()));
+    TEST_ASSERT_INT(PyLong_AsLong(value) == 42);
+    TEST_ASSERT_INT(userdata == &callback_called);
+    TEST_ASSERT_INT(callback_called == 0);
+    callback_called = 1;
+    return 0;
+}
+
+static PyObject *
+test_async_with_receives_userdata(PyObject *self, PyObject *nothing)
+{
+    callback_called = 0;
+    PyObject *ctx = new_context_manager(0);
+    if (ctx == NULL) {
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        Py_DECREF(ctx);
+        return NULL;
+    }
+
+    int res = PyAwaitable_AsyncWithEx(
+        awaitable,
+        ctx,
+        userdata_with_callback,
+        NULL,
+        &callback_called
+    );
+    Py_DECREF(ctx);
+    if (res < 0) {
+        PyAwaitable_Cancel(awaitable);
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    PyObject *result = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    if (result == NULL) {
+        return NULL;
+    }
+    Py_DECREF(result);
+    TEST_ASSERT(callback_called == 1);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_async_with_error_receives_userdata(PyObject *self, PyObject *nothing)
+{
+    error_callback_called = 0;
+    PyObject *ctx = new_context_manager(1);
+    if (ctx == NULL) {
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        Py_DECREF(ctx);
+        return NULL;
+    }
+
+    int res = PyAwaitable_AsyncWithEx(
+        awaitable,
+        ctx,
+        aborting_callback_ex,
+        userdata_error_callback,
+        &error_callback_called
+    );
+    Py_DECREF(ctx);
+    if (res < 0) {
+        PyAwaitable_Cancel(awaitable);
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    PyObject *result = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    if (result == NULL) {
+        return NULL;
+    }
+    Py_DECREF(result);
+    TEST_ASSERT(error_callback_called == 1);
+    Py_RETURN_NONE;
+}
+
+typedef struct {
+    int input;
+    int output;
+    int had_gil;
+} NoGILData;
+
+static void *
+nogil_double(void *arg)
+{
+    NoGILData *data = (NoGILData *)arg;
+    // PyGILState_Check() always succeeds once subinterpreters exist, so
+    // look at the thread state directly.
+#if PY_VERSION_HEX >= 0x030D0000
+    data->had_gil = PyThreadState_GetUnchecked() != NULL;
+#else
+    data->had_gil = _PyThreadState_UncheckedGet() != NULL;
+#endif
+    data->output = data->input * 2;
+    return &data->output;
+}
+
+static int
+nogil_result(PyObject *awaitable, void *result, void *arg)
+{
+    NoGILData *data = (NoGILData *)arg;
+    TEST_ASSERT_INT(PyGILState_Check());
+    TEST_ASSERT_INT(result == &data->output);
+    PyObject *value = PyLong_FromLong(*(int *)result);
+    if (value == NULL) {
+        return -1;
+    }
+
+    int res = PyAwaitable_SetResult(awaitable, value);
+    Py_DECREF(value);
+    return res;
+}
+
+static PyObject *
+test_nogil_step_result_is_passed_to_callback(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    NoGILData data = {21, 0, -1};
+    if (
+        PyAwaitable_DeferNoGIL(
+            awaitable,
+            nogil_double,
+            nogil_result,
+            &data
+        ) < 0
+    ) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    PyObject *res = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    if (res == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(PyLong_AsLong(res) == 42);
+    Py_DECREF(res);
+    TEST_ASSERT(data.had_gil == 0);
+    Py_RETURN_NONE;
+}
+
+typedef struct {
+    PyObject *awaitable;
+    PyThread_type_lock cancelled;
+    int output;
+    int result_called;
+    int released;
+} NoGILCancelData;
+
+static void
+cancel_from_thread(void *arg)
+{
+    NoGILCancelData *data = (NoGILCancelData *)arg;
+    PyGILState_STATE gil = PyGILState_Ensure();
+    PyAwaitable_Cancel(data->awaitable);
+    PyGILState_Release(gil);
+    PyThread_release_lock(data->cancelled);
+}
+
+static void *
+nogil_wait_for_cancel(void *arg)
+{
+    NoGILCancelData *data = (NoGILCancelData *)arg;
+    // The GIL is released, so the other thread can cancel us right away
+    if (
+        PyThread_start_new_thread(cancel_from_thread, data)
+        == PYTHREAD_INVALID_THREAD_ID
+    ) {
+        return NULL;
+    }
+
+    PyThread_acquire_lock(data->cancelled, WAIT_LOCK);
+    return &data->output;
+}
+
+static int
+nogil_cancelled_result(PyObject *awaitable, void *result, void *arg)
+{
+    NoGILCancelData *data = (NoGILCancelData *)arg;
+    ++data->result_called;
+    return 0;
+}
+
+static void
+nogil_cancelled_release(void *result, void *arg)
+{
+    NoGILCancelData *data = (NoGILCancelData *)arg;
+    if (result == &data->output) {
+        ++data->released;
+    }
+}
+
+static PyObject *
+test_nogil_step_cancelled_while_running(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    NoGILCancelData data = {awaitable, NULL, 0, 0, 0};
+    data.cancelled = PyThread_allocate_lock();
+    if (data.cancelled == NULL) {
+        Py_DECREF(awaitable);
+        return PyErr_NoMemory();
+    }
+    // Held until the other thread has cancelled the awaitable
+    PyThread_acquire_lock(data.cancelled, NOWAIT_LOCK);
+
+    if (
+        PyAwaitable_DeferNoGILEx(
+            awaitable,
+            nogil_wait_for_cancel,
+            nogil_cancelled_result,
+            nogil_cancelled_release,
+            &data
+        ) < 0
+    ) {
+        PyThread_free_lock(data.cancelled);
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    PyObject *res = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    PyThread_free_lock(data.cancelled);
+    if (res == NULL) {
+        return NULL;
+    }
+    Py_DECREF(res);
+
+    TEST_ASSERT(data.result_called == 0);
+    TEST_ASSERT(data.released == 1);
+    Py_RETURN_NONE;
+}
+
 TESTS(callbacks) = {
     TEST_CORO(test_callback_is_called),
     TEST_RAISING_CORO(test_callback_not_invoked_when_exception),
@@ -270,5 +702,12 @@ TESTS(callbacks) = {
     TEST_CORO(test_failing_callback_gives_to_error_callback),
     TEST_CORO(test_failing_callback_with_no_exception),
     TEST_CORO(test_forcefully_propagating_callback_error),
+    TEST_CORO(test_callback_receives_userdata),
+    TEST_RAISING_CORO(test_error_callback_receives_userdata),
+    TEST(test_defer_receives_userdata),
+    TEST(test_async_with_receives_userdata),
+    TEST(test_async_with_error_receives_userdata),
+    TEST(test_nogil_step_result_is_passed_to_callback),
+    TEST(test_nogil_step_cancelled_while_running),
     {NULL}
 };
@@ -0,0 +1,168 @@
+#include <Python.h>
+#include <pyawaitable.h>
+#include "pyawaitable_test.h"
+
+/* Only the shared build exports the function table */
+#ifdef PYAWAITABLE_TEST_SHARED
+static const PyAwaitable_CAPI *
+get_published_capi(void)
+{
+    PyObject *dict = PyInterpreterState_GetDict(PyInterpreterState_Get());
+    if (dict == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "no interpreter dictionary");
+        return NULL;
+    }
+
+    PyObject *capsule = PyDict_GetItemString(dict, PyAwaitable_CAPI_KEY);
+    if (capsule == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "function table wasn't published");
+        return NULL;
+    }
+
+    return PyCapsule_GetPointer(capsule, PyAwaitable_CAPI_CAPSULE);
+}
+
+static PyObject *
+test_capi_is_published(PyObject *self, PyObject *nothing)
+{
+    const PyAwaitable_CAPI *capi = get_published_capi();
+    if (capi == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(capi->size == sizeof(PyAwaitable_CAPI));
+    TEST_ASSERT(capi->magic_version == PyAwaitable_MAGIC_NUMBER);
+    TEST_ASSERT(capi->GetType() == PyAwaitable_GetType());
+
+    PyObject *awaitable = capi->New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(Py_IS_TYPE(awaitable, PyAwaitable_GetType()));
+    Py_DECREF(awaitable);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+other_version_new(void)
+{
+    return Py_NewRef(Py_Ellipsis);
+}
+
+/* Table of a pretend newer version of PyAwaitable that only implements New() */
+static const PyAwaitable_CAPI newer_version = {
+    .size = sizeof(PyAwaitable_CAPI),
+    .magic_version = PyAwaitable_MAGIC_NUMBER + 1,
+    .New = other_version_new
+};
+
+/* Same as above, but from an older version with a smaller table */
+static const PyAwaitable_CAPI older_version = {
+    .size = offsetof(PyAwaitable_CAPI, AddSendfile),
+    .magic_version = PyAwaitable_MAGIC_NUMBER - 1,
+    .New = other_version_new
+};
+
+/*
+ * In a fresh interpreter, publish table before initializing our copy, and
+ * then create an awaitable. *bound is set to the table that ended up in
+ * the interpreter dictionary.
+ */
+static PyObject *
+new_with_published_table(
+    const PyAwaitable_CAPI *table,
+    const PyAwaitable_CAPI **bound
+)
+{
+    *bound = NULL;
+    PyThreadState *main_tstate = PyThreadState_Get();
+    PyThreadState *sub_tstate = Py_NewInterpreter();
+    if (sub_tstate == NULL) {
+        PyThreadState_Swap(main_tstate);
+        PyErr_SetString(PyExc_RuntimeError, "failed to create interpreter");
+        return NULL;
+    }
+
+    int published = 0;
+    PyObject *result = NULL;
+    PyObject *dict = PyInterpreterState_GetDict(PyInterpreterState_Get());
+    PyObject *capsule = PyCapsule_New(
+        (void *)table,
+        PyAwaitable_CAPI_CAPSULE,
+        NULL
+    );
+    if (dict != NULL && capsule != NULL) {
+        published = PyDict_SetItemString(
+            dict,
+            PyAwaitable_CAPI_KEY,
+            capsule
+        ) == 0;
+    }
+    Py_XDECREF(capsule);
+
+    if (published && PyAwaitable_Init() == 0) {
+        result = PyAwaitable_New();
+        *bound = get_published_capi();
+    }
+
+    if (result != NULL && result != Py_Ellipsis) {
+        // Our awaitables can't outlive the interpreter
+        PyAwaitable_Cancel(result);
+        Py_SETREF(result, Py_NewRef(Py_True));
+    }
+    PyErr_Clear();
+
+    Py_EndInterpreter(sub_tstate);
+    PyThreadState_Swap(main_tstate);
+    if (result == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "couldn't create an awaitable");
+    }
+    return result;
+}
+
+static PyObject *
+test_capi_binds_to_newer_version(PyObject *self, PyObject *nothing)
+{
+    const PyAwaitable_CAPI *bound;
+    PyObject *result = new_with_published_table(&newer_version, &bound);
+    if (result == NULL) {
+        return NULL;
+    }
+
+    // Our copy has to go through the other version's table
+    TEST_ASSERT(result == Py_Ellipsis);
+    TEST_ASSERT(bound == &newer_version);
+    Py_DECREF(result);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_capi_replaces_older_version(PyObject *self, PyObject *nothing)
+{
+    const PyAwaitable_CAPI *bound;
+    PyObject *result = new_with_published_table(&older_version, &bound);
+    if (result == NULL) {
+        return NULL;
+    }
+
+    // Our copy uses its own code, and later copies will use our table
+    TEST_ASSERT(result == Py_True);
+    TEST_ASSERT(bound != NULL);
+    TEST_ASSERT(bound != &older_version);
+    TEST_ASSERT(bound->magic_version == PyAwaitable_MAGIC_NUMBER);
+    TEST_ASSERT(bound->size == sizeof(PyAwaitable_CAPI));
+    Py_DECREF(result);
+    Py_RETURN_NONE;
+}
+
+#endif
+
+TESTS(capi) = {
+#ifdef PYAWAITABLE_TEST_SHARED
+    TEST(test_capi_is_published),
+    TEST(test_capi_binds_to_newer_version),
+    TEST(test_capi_replaces_older_version),
+#endif
+    {NULL}
+};
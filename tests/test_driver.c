@@ -0,0 +1,442 @@
+#include <Python.h>
+#include <pyawaitable.h>
+#include "pyawaitable_test.h"
+
+static PyObject *
+test_type_has_driver(PyObject *self, PyObject *nothing)
+{
+    PyTypeObject *type = PyAwaitable_GetType();
+    if (type == NULL) {
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    // The capsule comes from a getter on the type
+    PyObject *capsule = PyObject_GetAttrString(
+        awaitable,
+        PyAwaitable_DRIVER_ATTR
+    );
+    PyAwaitable_Cancel(awaitable);
+    Py_DECREF(awaitable);
+    if (capsule == NULL) {
+        return NULL;
+    }
+
+    const PyAwaitable_Driver *driver = PyCapsule_GetPointer(
+        capsule,
+        PyAwaitable_DRIVER_CAPSULE
+    );
+    Py_DECREF(capsule);
+    if (driver == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(driver->size == sizeof(PyAwaitable_Driver));
+    TEST_ASSERT(driver->magic_version == PyAwaitable_MAGIC_NUMBER);
+    TEST_ASSERT(driver->send != NULL);
+#ifdef Py_TPFLAGS_IMMUTABLETYPE
+    // The driver mustn't need the type to be mutable
+    TEST_ASSERT(PyObject_SetAttrString((PyObject *)type, "spam", Py_None) < 0);
+    EXPECT_ERROR(PyExc_TypeError);
+#endif
+    Py_RETURN_NONE;
+}
+
+/*
+ * Awaitable from a pretend version of PyAwaitable. It can only be ran
+ * through its driver, which yields once and then returns 42.
+ */
+static int other_version_sends = 0;
+
+static int
+other_version_send(PyObject *op, PyObject **presult)
+{
+    if (++other_version_sends == 1) {
+        *presult = Py_NewRef(Py_None);
+        return PyAwaitable_SEND_NEXT;
+    }
+
+    *presult = PyLong_FromLong(42);
+    return *presult == NULL ? PyAwaitable_SEND_ERROR : PyAwaitable_SEND_RETURN;
+}
+
+static const PyAwaitable_Driver other_version_driver = {
+    .size = sizeof(PyAwaitable_Driver),
+    .magic_version = -1,
+    .send = other_version_send
+};
+
+static PyObject *
+other_version_await(PyObject *self)
+{
+    PyErr_SetString(
+        PyExc_RuntimeError,
+        "should have been ran through the driver"
+    );
+    return NULL;
+}
+
+static PyType_Slot other_version_slots[] = {
+    {Py_am_await, other_version_await},
+    {0, NULL}
+};
+
+static PyType_Spec other_version_spec = {
+    .name = "_pyawaitable_test.OtherVersionAwaitable",
+    .basicsize = sizeof(PyObject),
+    .flags = Py_TPFLAGS_DEFAULT,
+    .slots = other_version_slots
+};
+
+static int
+set_other_version_driver(PyObject *type)
+{
+    PyObject *capsule = PyCapsule_New(
+        (void *)&other_version_driver,
+        PyAwaitable_DRIVER_CAPSULE,
+        NULL
+    );
+    if (capsule == NULL) {
+        return -1;
+    }
+
+    int res = PyObject_SetAttrString(type, PyAwaitable_DRIVER_ATTR, capsule);
+    Py_DECREF(capsule);
+    return res;
+}
+
+static PyObject *
+new_other_version_awaitable(void)
+{
+    PyObject *type = PyType_FromSpec(&other_version_spec);
+    if (type == NULL) {
+        return NULL;
+    }
+
+    if (set_other_version_driver(type) < 0) {
+        Py_DECREF(type);
+        return NULL;
+    }
+
+    PyTypeObject *tp = (PyTypeObject *)type;
+    PyObject *op = tp->tp_alloc(tp, 0);
+    Py_DECREF(type);
+    return op;
+}
+
+static int
+check_long_result(PyObject *awaitable, PyObject *result, void *got)
+{
+    *(long *)got = PyLong_AsLong(result);
+    return *(long *)got == -1 && PyErr_Occurred() ? -1 : 0;
+}
+
+static PyObject *
+test_drives_other_versions_directly(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    PyObject *other = new_other_version_awaitable();
+    if (other == NULL) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    long got = 0;
+    other_version_sends = 0;
+    if (
+        PyAwaitable_AddAwaitEx(
+            awaitable,
+            other,
+            check_long_result,
+            NULL,
+            &got
+        ) < 0
+    ) {
+        Py_DECREF(other);
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+    Py_DECREF(other);
+
+    PyObject *res = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    if (res == NULL) {
+        return NULL;
+    }
+    Py_DECREF(res);
+
+    TEST_ASSERT(other_version_sends == 2);
+    TEST_ASSERT(got == 42);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+await_instance(PyObject *type, long *got)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    PyTypeObject *tp = (PyTypeObject *)type;
+    PyObject *op = tp->tp_alloc(tp, 0);
+    if (op == NULL) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    if (
+        PyAwaitable_AddAwaitEx(
+            awaitable,
+            op,
+            check_long_result,
+            NULL,
+            got
+        ) < 0
+    ) {
+        Py_DECREF(op);
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+    Py_DECREF(op);
+
+    PyObject *res = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    return res;
+}
+
+static PyObject *
+test_finds_driver_added_after_miss(PyObject *self, PyObject *nothing)
+{
+    PyObject *type = PyType_FromSpec(&other_version_spec);
+    if (type == NULL) {
+        return NULL;
+    }
+
+    // Without a driver, this goes through __await__, which raises
+    long got = 0;
+    for (int i = 0; i < 2; ++i) {
+        PyObject *res = await_instance(type, &got);
+        if (res != NULL) {
+            Py_DECREF(res);
+            Py_DECREF(type);
+            TEST_ERROR("awaiting without a driver should have failed");
+            return NULL;
+        }
+        if (!PyErr_ExceptionMatches(PyExc_RuntimeError)) {
+            Py_DECREF(type);
+            return NULL;
+        }
+        PyErr_Clear();
+    }
+
+    // Types that were skipped before must be checked again once modified
+    if (set_other_version_driver(type) < 0) {
+        Py_DECREF(type);
+        return NULL;
+    }
+
+    other_version_sends = 0;
+    PyObject *res = await_instance(type, &got);
+    Py_DECREF(type);
+    if (res == NULL) {
+        return NULL;
+    }
+    Py_DECREF(res);
+
+    TEST_ASSERT(other_version_sends == 2);
+    TEST_ASSERT(got == 42);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_send_value_to_driven_awaitable(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    PyObject *other = new_other_version_awaitable();
+    if (other == NULL) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    other_version_sends = 0;
+    if (PyAwaitable_AddAwait(awaitable, other, NULL, NULL) < 0) {
+        Py_DECREF(other);
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+    Py_DECREF(other);
+
+    // Start the awaitable, and then suspend it inside of the other driver
+    for (int i = 0; i < 2; ++i) {
+        PyObject *res = PyObject_CallMethod(awaitable, "send", "O", Py_None);
+        if (res == NULL) {
+            Py_DECREF(awaitable);
+            return NULL;
+        }
+        Py_DECREF(res);
+    }
+    TEST_ASSERT(other_version_sends == 1);
+
+    PyObject *value = PyLong_FromLong(1);
+    if (value == NULL) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    PyObject *res = PyObject_CallMethod(awaitable, "send", "O", value);
+    TEST_ASSERT(res == NULL);
+    EXPECT_ERROR(PyExc_TypeError);
+#if PY_MINOR_VERSION > 9
+    TEST_ASSERT(PyIter_Send(awaitable, value, &res) == PYGEN_ERROR);
+    EXPECT_ERROR(PyExc_TypeError);
+#endif
+    Py_DECREF(value);
+
+    // The value must not have been passed on as a None
+    TEST_ASSERT(other_version_sends == 1);
+    PyAwaitable_Cancel(awaitable);
+    Py_DECREF(awaitable);
+    Py_RETURN_NONE;
+}
+
+static const char coroutine_source[] =
+    "import asyncio\n"
+    "async def coroutine():\n"
+    "    await asyncio.sleep(0)\n"
+    "    return 42\n";
+
+static PyObject *
+new_coroutine(void)
+{
+    PyObject *globals = PyDict_New();
+    if (globals == NULL) {
+        return NULL;
+    }
+
+    if (
+        PyDict_SetItemString(globals, "__builtins__", PyEval_GetBuiltins()) < 0
+    ) {
+        Py_DECREF(globals);
+        return NULL;
+    }
+
+    PyObject *res = PyRun_String(
+        coroutine_source,
+        Py_file_input,
+        globals,
+        globals
+    );
+    if (res == NULL) {
+        Py_DECREF(globals);
+        return NULL;
+    }
+    Py_DECREF(res);
+
+    PyObject *func = PyDict_GetItemString(globals, "coroutine");
+    PyObject *coro = func == NULL ? NULL : PyObject_CallNoArgs(func);
+    Py_DECREF(globals);
+    return coro;
+}
+
+static PyObject *
+test_awaits_native_coroutine(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    PyObject *coro = new_coroutine();
+    if (coro == NULL) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    long got = 0;
+    if (
+        PyAwaitable_AddAwaitEx(
+            awaitable,
+            coro,
+            check_long_result,
+            NULL,
+            &got
+        ) < 0
+    ) {
+        Py_DECREF(coro);
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+    Py_DECREF(coro);
+
+    PyObject *res = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    if (res == NULL) {
+        return NULL;
+    }
+    Py_DECREF(res);
+
+    TEST_ASSERT(got == 42);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_tuple_result(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    PyObject *expected = Py_BuildValue("(ii)", 1, 2);
+    if (expected == NULL) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    if (PyAwaitable_SetResult(awaitable, expected) < 0) {
+        Py_DECREF(expected);
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    PyObject *res = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    if (res == NULL) {
+        Py_DECREF(expected);
+        return NULL;
+    }
+
+    // StopIteration must not unpack the tuple into its arguments
+    int equal = PyObject_RichCompareBool(res, expected, Py_EQ);
+    Py_DECREF(res);
+    Py_DECREF(expected);
+    if (equal < 0) {
+        return NULL;
+    }
+
+    TEST_ASSERT(equal);
+    Py_RETURN_NONE;
+}
+
+TESTS(driver) = {
+    TEST(test_type_has_driver),
+    TEST(test_drives_other_versions_directly),
+    TEST(test_send_value_to_driven_awaitable),
+    TEST(test_finds_driver_added_after_miss),
+    TEST(test_awaits_native_coroutine),
+    TEST(test_tuple_result),
+    {NULL}
+};
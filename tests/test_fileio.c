@@ -0,0 +1,645 @@
+#include <Python.h>
+#include <pyawaitable.h>
+#include "pyawaitable_test.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static FILE *fileio_file = NULL;
+
+static int
+open_file(void)
+{
+    fileio_file = tmpfile();
+    if (fileio_file == NULL) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+
+    return fileno(fileio_file);
+}
+
+static void
+close_file(void)
+{
+    fclose(fileio_file);
+    fileio_file = NULL;
+}
+
+static char fileio_buffer[16];
+
+static int
+check_written(PyObject *awaitable, Py_ssize_t size)
+{
+    TEST_ASSERT_INT(size == 11);
+    return 0;
+}
+
+static int
+set_read_result(PyObject *awaitable, Py_ssize_t size)
+{
+    PyObject *bytes = PyBytes_FromStringAndSize(fileio_buffer, size);
+    if (bytes == NULL) {
+        return -1;
+    }
+
+    int res = PyAwaitable_SetResult(awaitable, bytes);
+    Py_DECREF(bytes);
+    return res;
+}
+
+static PyObject *
+test_pwrite_then_pread(PyObject *self, PyObject *nothing)
+{
+    int fd = open_file();
+    if (fd < 0) {
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (
+        awaitable == NULL
+        || PyAwaitable_AddPwrite(
+            awaitable,
+            fd,
+            "hello world",
+            11,
+            3,
+            check_written
+        ) < 0
+        || PyAwaitable_AddPread(
+            awaitable,
+            fd,
+            fileio_buffer,
+            5,
+            9,
+            set_read_result
+        ) < 0
+    ) {
+        Py_XDECREF(awaitable);
+        close_file();
+        return NULL;
+    }
+
+    PyObject *result = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    close_file();
+    if (result == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(PyBytes_Check(result));
+    TEST_ASSERT(PyBytes_GET_SIZE(result) == 5);
+    TEST_ASSERT(memcmp(PyBytes_AS_STRING(result), "world", 5) == 0);
+    Py_DECREF(result);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_pread_eof(PyObject *self, PyObject *nothing)
+{
+    int fd = open_file();
+    if (fd < 0) {
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (
+        awaitable == NULL
+        || PyAwaitable_AddPread(
+            awaitable,
+            fd,
+            fileio_buffer,
+            sizeof(fileio_buffer),
+            100,
+            set_read_result
+        ) < 0
+    ) {
+        Py_XDECREF(awaitable);
+        close_file();
+        return NULL;
+    }
+
+    PyObject *result = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    close_file();
+    if (result == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(PyBytes_GET_SIZE(result) == 0);
+    Py_DECREF(result);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_pwrite_copies_buffer(PyObject *self, PyObject *nothing)
+{
+    int fd = open_file();
+    if (fd < 0) {
+        return NULL;
+    }
+
+    char data[5];
+    memcpy(data, "hello", 5);
+    PyObject *awaitable = PyAwaitable_New();
+    if (
+        awaitable == NULL
+        || PyAwaitable_AddPwrite(awaitable, fd, data, 5, 0, NULL) < 0
+        || PyAwaitable_AddPread(
+            awaitable,
+            fd,
+            fileio_buffer,
+            5,
+            0,
+            set_read_result
+        ) < 0
+    ) {
+        Py_XDECREF(awaitable);
+        close_file();
+        return NULL;
+    }
+
+    // The write has to use what the buffer held when it was added
+    memcpy(data, "xxxxx", 5);
+    PyObject *result = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    close_file();
+    if (result == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(PyBytes_GET_SIZE(result) == 5);
+    TEST_ASSERT(memcmp(PyBytes_AS_STRING(result), "hello", 5) == 0);
+    Py_DECREF(result);
+    Py_RETURN_NONE;
+}
+
+static int
+fail_immediately(PyObject *awaitable)
+{
+    PyErr_SetString(PyExc_ZeroDivisionError, "cancel the read");
+    return -1;
+}
+
+static PyObject *
+test_pread_cancelled_leaves_buffer(PyObject *self, PyObject *nothing)
+{
+    int fd = open_file();
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (write(fd, "hello world", 11) != 11) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        close_file();
+        return NULL;
+    }
+
+    // The read is handed off before the other awaitable fails, and is
+    // cancelled before its result is delivered.
+    memset(fileio_buffer, '*', sizeof(fileio_buffer));
+    PyObject *coros[2] = {PyAwaitable_New(), PyAwaitable_New()};
+    PyObject *awaitable = PyAwaitable_New();
+    int res = -1;
+    if (
+        coros[0] != NULL && coros[1] != NULL && awaitable != NULL
+        && PyAwaitable_AddPread(
+            coros[0],
+            fd,
+            fileio_buffer,
+            sizeof(fileio_buffer),
+            0,
+            NULL
+        ) == 0
+        && PyAwaitable_DeferAwait(coros[1], fail_immediately) == 0
+    ) {
+        res = PyAwaitable_AddGather(
+            awaitable,
+            coros,
+            2,
+            NULL,
+            NULL,
+            PyAwaitable_GATHER_CANCEL_ON_ERROR
+        );
+    }
+    Py_XDECREF(coros[0]);
+    Py_XDECREF(coros[1]);
+    if (res < 0) {
+        Py_XDECREF(awaitable);
+        close_file();
+        return NULL;
+    }
+
+    PyObject *result = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    TEST_ASSERT(result == NULL);
+    EXPECT_ERROR(PyExc_ZeroDivisionError);
+
+    // Give the read itself plenty of time to finish
+    PyObject *time = PyImport_ImportModule("time");
+    if (time == NULL) {
+        close_file();
+        return NULL;
+    }
+
+    result = PyObject_CallMethod(time, "sleep", "d", 0.05);
+    Py_DECREF(time);
+    close_file();
+    if (result == NULL) {
+        return NULL;
+    }
+
+    Py_DECREF(result);
+    for (size_t i = 0; i < sizeof(fileio_buffer); ++i) {
+        TEST_ASSERT(fileio_buffer[i] == '*');
+    }
+    Py_RETURN_NONE;
+}
+
+/* More than the ring holds at once, so some of these go to the pool */
+#define NUM_READS 300
+static int read_values[NUM_READS];
+
+static int
+check_read_value(PyObject *awaitable, Py_ssize_t size)
+{
+    TEST_ASSERT_INT(size == sizeof(int));
+    int index = (int)(intptr_t)PyAwaitable_GetArbValue(awaitable, 0);
+    TEST_ASSERT_INT(read_values[index] == index);
+    return 0;
+}
+
+static int
+count_reads(PyObject *awaitable, PyObject **results, Py_ssize_t size)
+{
+    TEST_ASSERT_INT(size == NUM_READS);
+    return PyAwaitable_SetResult(awaitable, Py_True);
+}
+
+static PyObject *
+test_pread_many(PyObject *self, PyObject *nothing)
+{
+    int fd = open_file();
+    if (fd < 0) {
+        return NULL;
+    }
+
+    int values[NUM_READS];
+    for (int i = 0; i < NUM_READS; ++i) {
+        values[i] = i;
+        read_values[i] = -1;
+    }
+
+    if (write(fd, values, sizeof(values)) != sizeof(values)) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        close_file();
+        return NULL;
+    }
+
+    PyObject *coros[NUM_READS] = {NULL};
+    for (int i = 0; i < NUM_READS; ++i) {
+        coros[i] = PyAwaitable_New();
+        if (
+            coros[i] == NULL
+            || PyAwaitable_SaveArbValues(coros[i], 1, (void *)(intptr_t)i) < 0
+            || PyAwaitable_AddPread(
+                coros[i],
+                fd,
+                &read_values[i],
+                sizeof(int),
+                i * sizeof(int),
+                check_read_value
+            ) < 0
+        ) {
+            for (int j = 0; j <= i; ++j) {
+                Py_XDECREF(coros[j]);
+            }
+            close_file();
+            return NULL;
+        }
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    int failed = awaitable == NULL
+        || PyAwaitable_AddGather(
+        awaitable,
+        coros,
+        NUM_READS,
+        count_reads,
+        NULL,
+        0
+        ) < 0;
+    for (int i = 0; i < NUM_READS; ++i) {
+        Py_DECREF(coros[i]);
+    }
+
+    if (failed) {
+        Py_XDECREF(awaitable);
+        close_file();
+        return NULL;
+    }
+
+    PyObject *result = Test_RunAndCheck(awaitable, Py_True);
+    close_file();
+    return result;
+}
+
+static int
+never_transferred(PyObject *awaitable, Py_ssize_t size)
+{
+    TEST_ERROR("read from a directory");
+    return -1;
+}
+
+static PyObject *
+test_pread_error(PyObject *self, PyObject *nothing)
+{
+    int fd = open(".", O_RDONLY);
+    if (fd < 0) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        close(fd);
+        return NULL;
+    }
+
+    if (
+        PyAwaitable_AddPread(
+            awaitable,
+            fd,
+            fileio_buffer,
+            sizeof(fileio_buffer),
+            0,
+            never_transferred
+        ) < 0
+    ) {
+        Py_DECREF(awaitable);
+        close(fd);
+        return NULL;
+    }
+
+    PyObject *result = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    close(fd);
+    TEST_ASSERT(result == NULL);
+    EXPECT_ERROR(PyExc_OSError);
+    Py_RETURN_NONE;
+}
+
+static int sendfile_socks[2] = {-1, -1};
+
+static int
+open_socks(void)
+{
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sendfile_socks) < 0) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+
+    if (
+        fcntl(sendfile_socks[0], F_SETFL, O_NONBLOCK) < 0
+        || fcntl(sendfile_socks[1], F_SETFL, O_NONBLOCK) < 0
+    ) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        close(sendfile_socks[0]);
+        close(sendfile_socks[1]);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void
+close_socks(void)
+{
+    close(sendfile_socks[0]);
+    close(sendfile_socks[1]);
+}
+
+/* Much more than the socket buffer holds, so the step has to wait */
+#define SENDFILE_SIZE (1024 * 1024)
+
+static int
+check_sent(PyObject *awaitable, Py_ssize_t size)
+{
+    TEST_ASSERT_INT(size == SENDFILE_SIZE - 1);
+    return 0;
+}
+
+static int
+check_received(PyObject *awaitable, void *buffer, Py_ssize_t size)
+{
+    TEST_ASSERT_INT(size == SENDFILE_SIZE - 1);
+    const unsigned char *data = buffer;
+    for (Py_ssize_t i = 0; i < size; ++i) {
+        TEST_ASSERT_INT(data[i] == (unsigned char)((i + 1) % 251));
+    }
+
+    return 0;
+}
+
+static int
+set_true_result(PyObject *awaitable, PyObject **results, Py_ssize_t size)
+{
+    return PyAwaitable_SetResult(awaitable, Py_True);
+}
+
+static PyObject *
+test_sendfile_large(PyObject *self, PyObject *nothing)
+{
+    int fd = open_file();
+    if (fd < 0) {
+        return NULL;
+    }
+
+    unsigned char *data = PyMem_Malloc(SENDFILE_SIZE);
+    if (data == NULL) {
+        close_file();
+        return PyErr_NoMemory();
+    }
+
+    for (Py_ssize_t i = 0; i < SENDFILE_SIZE; ++i) {
+        data[i] = (unsigned char)(i % 251);
+    }
+
+    if (write(fd, data, SENDFILE_SIZE) != SENDFILE_SIZE) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        PyMem_Free(data);
+        close_file();
+        return NULL;
+    }
+
+    if (open_socks() < 0) {
+        PyMem_Free(data);
+        close_file();
+        return NULL;
+    }
+
+    // Skip the first byte, so the offset has to be respected
+    memset(data, 0, SENDFILE_SIZE);
+    PyObject *coros[2] = {PyAwaitable_New(), PyAwaitable_New()};
+    PyObject *awaitable = PyAwaitable_New();
+    if (
+        coros[0] == NULL
+        || coros[1] == NULL
+        || awaitable == NULL
+        || PyAwaitable_AddSendfile(
+            coros[0],
+            sendfile_socks[0],
+            fd,
+            1,
+            SENDFILE_SIZE,
+            check_sent
+        ) < 0
+        || PyAwaitable_AddReadInto(
+            coros[1],
+            sendfile_socks[1],
+            data,
+            SENDFILE_SIZE - 1,
+            check_received
+        ) < 0
+        || PyAwaitable_AddGather(
+            awaitable,
+            coros,
+            2,
+            set_true_result,
+            NULL,
+            0
+        ) < 0
+    ) {
+        Py_XDECREF(coros[0]);
+        Py_XDECREF(coros[1]);
+        Py_XDECREF(awaitable);
+        PyMem_Free(data);
+        close_socks();
+        close_file();
+        return NULL;
+    }
+
+    Py_DECREF(coros[0]);
+    Py_DECREF(coros[1]);
+    PyObject *result = Test_RunAndCheck(awaitable, Py_True);
+    PyMem_Free(data);
+    close_socks();
+    close_file();
+    return result;
+}
+
+static int
+set_sent_result(PyObject *awaitable, Py_ssize_t size)
+{
+    PyObject *value = PyLong_FromSsize_t(size);
+    if (value == NULL) {
+        return -1;
+    }
+
+    int res = PyAwaitable_SetResult(awaitable, value);
+    Py_DECREF(value);
+    return res;
+}
+
+static PyObject *
+test_sendfile_eof(PyObject *self, PyObject *nothing)
+{
+    int fd = open_file();
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (write(fd, "hello world", 11) != 11) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        close_file();
+        return NULL;
+    }
+
+    if (open_socks() < 0) {
+        close_file();
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (
+        awaitable == NULL
+        || PyAwaitable_AddSendfile(
+            awaitable,
+            sendfile_socks[0],
+            fd,
+            6,
+            100,
+            set_sent_result
+        ) < 0
+    ) {
+        Py_XDECREF(awaitable);
+        close_socks();
+        close_file();
+        return NULL;
+    }
+
+    PyObject *result = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    if (result == NULL) {
+        close_socks();
+        close_file();
+        return NULL;
+    }
+
+    Py_ssize_t received = read(
+        sendfile_socks[1],
+        fileio_buffer,
+        sizeof(fileio_buffer)
+    );
+    close_socks();
+    close_file();
+    TEST_ASSERT(PyLong_AsSsize_t(result) == 5);
+    Py_DECREF(result);
+    TEST_ASSERT(received == 5);
+    TEST_ASSERT(memcmp(fileio_buffer, "world", 5) == 0);
+    Py_RETURN_NONE;
+}
+#endif
+
+static PyObject *
+test_fileio_bad_arguments(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    char buffer[4];
+    TEST_ASSERT(PyAwaitable_AddPread(awaitable, -1, buffer, 4, 0, NULL) < 0);
+    EXPECT_ERROR(PyExc_ValueError);
+    TEST_ASSERT(PyAwaitable_AddPread(awaitable, 0, buffer, 4, -1, NULL) < 0);
+    EXPECT_ERROR(PyExc_ValueError);
+    TEST_ASSERT(PyAwaitable_AddPwrite(awaitable, 0, NULL, 4, 0, NULL) < 0);
+    EXPECT_ERROR(PyExc_ValueError);
+    TEST_ASSERT(PyAwaitable_AddSendfile(awaitable, -1, 0, 0, 4, NULL) < 0);
+    EXPECT_ERROR(PyExc_ValueError);
+    TEST_ASSERT(PyAwaitable_AddSendfile(awaitable, 1, 0, 0, -1, NULL) < 0);
+    EXPECT_ERROR(PyExc_ValueError);
+
+    Py_DECREF(awaitable);
+    Py_RETURN_NONE;
+}
+
+TESTS(fileio) = {
+#ifndef _WIN32
+    TEST(test_pwrite_then_pread),
+    TEST(test_pread_eof),
+    TEST(test_pwrite_copies_buffer),
+    TEST(test_pread_cancelled_leaves_buffer),
+    TEST(test_pread_many),
+    TEST(test_pread_error),
+    TEST(test_sendfile_large),
+    TEST(test_sendfile_eof),
+#endif
+    TEST(test_fileio_bad_arguments),
+    {NULL}
+};
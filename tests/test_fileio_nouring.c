@@ -0,0 +1,125 @@
+/* This file's copy of PyAwaitable is built without io_uring */
+#define PYAWAITABLE_NO_IO_URING
+#include <Python.h>
+#include <pyawaitable.h>
+#include "pyawaitable_test.h"
+
+/* The shared build only has one copy */
+#if !defined(_WIN32) && !defined(PYAWAITABLE_TEST_SHARED)
+#include <stdio.h>
+#include <string.h>
+
+static char nouring_buffer[5];
+
+static int
+check_read(PyObject *awaitable, Py_ssize_t size)
+{
+    TEST_ASSERT_INT(size == 5);
+    TEST_ASSERT_INT(memcmp(nouring_buffer, "world", 5) == 0);
+    return 0;
+}
+
+static int
+pread_without_io_uring(void)
+{
+    FILE *file = tmpfile();
+    if (file == NULL) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+
+    if (fputs("hello world", file) < 0 || fflush(file) != 0) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        fclose(file);
+        return -1;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (
+        awaitable == NULL
+        || PyAwaitable_AddPread(
+            awaitable,
+            fileno(file),
+            nouring_buffer,
+            5,
+            6,
+            check_read
+        ) < 0
+    ) {
+        Py_XDECREF(awaitable);
+        fclose(file);
+        return -1;
+    }
+
+    PyObject *res = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    fclose(file);
+    if (res == NULL) {
+        return -1;
+    }
+
+    Py_DECREF(res);
+    return 0;
+}
+
+/* Look up one of test_fileio.c's tests, which use a copy with io_uring */
+static PyCFunction
+find_fileio_test(const char *name)
+{
+    for (PyMethodDef *def = _pyawaitable_test_fileio; def->ml_name; ++def) {
+        if (strcmp(def->ml_name, name) == 0) {
+            return def->ml_meth;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Copies that were built with and without io_uring share the file I/O
+ * state, so whichever one creates it has to lay it out the same way.
+ */
+static PyObject *
+test_fileio_state_shared_with_io_uring(PyObject *self, PyObject *nothing)
+{
+    PyCFunction pwrite_then_pread = find_fileio_test("test_pwrite_then_pread");
+    TEST_ASSERT(pwrite_then_pread != NULL);
+
+    PyThreadState *main_tstate = PyThreadState_Get();
+    PyThreadState *sub_tstate = Py_NewInterpreter();
+    if (sub_tstate == NULL) {
+        PyThreadState_Swap(main_tstate);
+        PyErr_SetString(PyExc_RuntimeError, "failed to create interpreter");
+        return NULL;
+    }
+
+    // The new interpreter doesn't have any state yet, so this copy creates
+    // it, and then test_fileio.c's copy picks it up.
+    int failed = 1;
+    if (PyAwaitable_Init() == 0 && pread_without_io_uring() == 0) {
+        PyObject *res = pwrite_then_pread(NULL, NULL);
+        if (res != NULL) {
+            Py_DECREF(res);
+            failed = 0;
+        }
+    }
+
+    // Exceptions can't cross over to the main interpreter
+    if (failed) {
+        PyErr_Print();
+    }
+
+    Py_EndInterpreter(sub_tstate);
+    PyThreadState_Swap(main_tstate);
+    TEST_ASSERT(!failed);
+    Py_RETURN_NONE;
+}
+
+#endif
+
+TESTS(fileio_nouring) = {
+#if !defined(_WIN32) && !defined(PYAWAITABLE_TEST_SHARED)
+    TEST(test_fileio_state_shared_with_io_uring),
+#endif
+    {NULL}
+};
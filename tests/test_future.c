@@ -0,0 +1,331 @@
+#include <Python.h>
+#include <pythread.h>
+#include <stdint.h>
+#include <pyawaitable.h>
+#include "pyawaitable_test.h"
+
+#define NUM_FUTURES 64
+
+static intptr_t future_total = 0;
+
+static int
+add_result(PyObject *awaitable, void *result, void *arg)
+{
+    TEST_ASSERT_INT(arg == &future_total);
+    future_total += (intptr_t)result;
+    return 0;
+}
+
+static int
+set_int_result(PyObject *awaitable, void *result, void *arg)
+{
+    PyObject *value = PyLong_FromVoidPtr(result);
+    if (value == NULL) {
+        return -1;
+    }
+
+    int res = PyAwaitable_SetResult(awaitable, value);
+    Py_DECREF(value);
+    return res;
+}
+
+static PyObject *
+test_future_completed_early(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    PyAwaitable_Future *future = PyAwaitable_AddFuture(
+        awaitable,
+        set_int_result,
+        NULL
+    );
+    if (future == NULL) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    // Before the awaitable even starts
+    PyAwaitable_Complete(future, (void *)42);
+    PyObject *result = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    if (result == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(PyLong_AsLong(result) == 42);
+    Py_DECREF(result);
+    Py_RETURN_NONE;
+}
+
+static int
+complete_saved_future(PyObject *awaitable, void *arg)
+{
+    // We're on the loop, but the wakeup still goes through the hub
+    PyAwaitable_Complete((PyAwaitable_Future *)arg, (void *)7);
+    return 0;
+}
+
+static PyObject *
+test_future_completed_while_waiting(PyObject *self, PyObject *nothing)
+{
+    PyObject *coros[2] = {NULL};
+    coros[0] = PyAwaitable_New();
+    if (coros[0] == NULL) {
+        return NULL;
+    }
+
+    future_total = 0;
+    PyAwaitable_Future *future = PyAwaitable_AddFuture(
+        coros[0],
+        add_result,
+        &future_total
+    );
+    if (future == NULL) {
+        Py_DECREF(coros[0]);
+        return NULL;
+    }
+
+    // Gathered tasks start in order, so the future is already waiting by
+    // the time that this completes it.
+    coros[1] = PyAwaitable_New();
+    if (
+        coros[1] == NULL
+        || PyAwaitable_DeferAwaitEx(
+            coros[1],
+            complete_saved_future,
+            future
+        ) < 0
+    ) {
+        PyAwaitable_Complete(future, NULL);
+        Py_XDECREF(coros[1]);
+        Py_DECREF(coros[0]);
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        Py_DECREF(coros[0]);
+        Py_DECREF(coros[1]);
+        return NULL;
+    }
+
+    int res = PyAwaitable_AddGather(awaitable, coros, 2, NULL, NULL, 0);
+    Py_DECREF(coros[0]);
+    Py_DECREF(coros[1]);
+    if (res < 0) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    PyObject *result = Test_RunAndCheck(awaitable, Py_None);
+    if (result == NULL) {
+        return NULL;
+    }
+
+    Py_DECREF(result);
+    TEST_ASSERT(future_total == 7);
+    Py_RETURN_NONE;
+}
+
+static PyAwaitable_Future *thread_futures[NUM_FUTURES];
+
+/* Runs without a thread state */
+static void
+complete_all(void *arg)
+{
+    for (intptr_t i = 0; i < NUM_FUTURES; ++i) {
+        PyAwaitable_Complete(thread_futures[i], (void *)(i + 1));
+    }
+}
+
+static int
+start_completer(PyObject *awaitable)
+{
+    if (PyThread_start_new_thread(complete_all, NULL) ==
+        PYTHREAD_INVALID_THREAD_ID) {
+        PyErr_SetString(PyExc_RuntimeError, "failed to start thread");
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Gather NUM_FUTURES futures that are completed by another thread */
+static PyObject *
+new_thread_completed_gather(void)
+{
+    PyObject *coros[NUM_FUTURES + 1] = {NULL};
+    for (Py_ssize_t i = 0; i < NUM_FUTURES; ++i) {
+        coros[i] = PyAwaitable_New();
+        if (coros[i] == NULL) {
+            return NULL;
+        }
+
+        thread_futures[i] = PyAwaitable_AddFuture(
+            coros[i],
+            add_result,
+            &future_total
+        );
+        if (thread_futures[i] == NULL) {
+            return NULL;
+        }
+    }
+
+    // Started last, so that most of the futures are already waiting
+    coros[NUM_FUTURES] = PyAwaitable_New();
+    if (
+        coros[NUM_FUTURES] == NULL
+        || PyAwaitable_DeferAwait(coros[NUM_FUTURES], start_completer) < 0
+    ) {
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    future_total = 0;
+    int res = PyAwaitable_AddGather(
+        awaitable,
+        coros,
+        NUM_FUTURES + 1,
+        NULL,
+        NULL,
+        0
+    );
+    for (Py_ssize_t i = 0; i <= NUM_FUTURES; ++i) {
+        Py_DECREF(coros[i]);
+    }
+    if (res < 0) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    return awaitable;
+}
+
+static PyObject *
+test_future_completed_from_thread(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = new_thread_completed_gather();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    PyObject *result = Test_RunAndCheck(awaitable, Py_None);
+    if (result == NULL) {
+        return NULL;
+    }
+
+    Py_DECREF(result);
+    TEST_ASSERT(future_total == NUM_FUTURES * (NUM_FUTURES + 1) / 2);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+add_reader_not_implemented(PyObject *self, PyObject *args)
+{
+    PyErr_SetString(PyExc_NotImplementedError, "no add_reader() here");
+    return NULL;
+}
+
+static PyMethodDef add_reader_def = {
+    "add_reader",
+    add_reader_not_implemented,
+    METH_VARARGS,
+    NULL
+};
+
+/* Create an event loop that can't watch file descriptors, like the proactor */
+static PyObject *
+new_loop_without_readers(void)
+{
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (asyncio == NULL) {
+        return NULL;
+    }
+
+    PyObject *base = PyObject_GetAttrString(asyncio, "SelectorEventLoop");
+    Py_DECREF(asyncio);
+    if (base == NULL) {
+        return NULL;
+    }
+
+    // Builtin functions don't get bound, so there's no self to deal with
+    PyObject *add_reader = PyCFunction_New(&add_reader_def, NULL);
+    if (add_reader == NULL) {
+        Py_DECREF(base);
+        return NULL;
+    }
+
+    PyObject *cls = PyObject_CallFunction(
+        (PyObject *)&PyType_Type,
+        "s(O){sO}",
+        "NoReaderLoop",
+        base,
+        "add_reader",
+        add_reader
+    );
+    Py_DECREF(base);
+    Py_DECREF(add_reader);
+    if (cls == NULL) {
+        return NULL;
+    }
+
+    PyObject *loop = PyObject_CallNoArgs(cls);
+    Py_DECREF(cls);
+    return loop;
+}
+
+static PyObject *
+test_future_completed_without_readers(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = new_thread_completed_gather();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    PyObject *loop = new_loop_without_readers();
+    if (loop == NULL) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    // The completer has to attach to the interpreter to wake up the loop
+    PyObject *result = PyObject_CallMethod(
+        loop,
+        "run_until_complete",
+        "O",
+        awaitable
+    );
+    Py_DECREF(awaitable);
+    PyObject *err = PyErr_GetRaisedException();
+    PyObject *close_res = PyObject_CallMethod(loop, "close", NULL);
+    Py_DECREF(loop);
+    if (result == NULL) {
+        Py_XDECREF(close_res);
+        PyErr_SetRaisedException(err);
+        return NULL;
+    }
+
+    Py_DECREF(result);
+    if (close_res == NULL) {
+        return NULL;
+    }
+
+    Py_DECREF(close_res);
+    TEST_ASSERT(future_total == NUM_FUTURES * (NUM_FUTURES + 1) / 2);
+    Py_RETURN_NONE;
+}
+
+TESTS(future) = {
+    TEST(test_future_completed_early),
+    TEST(test_future_completed_while_waiting),
+    TEST(test_future_completed_from_thread),
+    TEST(test_future_completed_without_readers),
+    {NULL}
+};
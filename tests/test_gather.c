@@ -0,0 +1,431 @@
+#include <Python.h>
+#include <pyawaitable.h>
+#include "pyawaitable_test.h"
+
+#define NUM_SLEEPS 3
+
+/* asyncio.sleep(delay, result) */
+static PyObject *
+new_sleep(double delay, long result)
+{
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (asyncio == NULL) {
+        return NULL;
+    }
+
+    PyObject *coro = PyObject_CallMethod(asyncio, "sleep", "dl", delay, result);
+    Py_DECREF(asyncio);
+    return coro;
+}
+
+static int
+raise_value_error(PyObject *awaitable, PyObject *result)
+{
+    PyErr_SetString(PyExc_ValueError, "gather test");
+    return -1;
+}
+
+/* Awaitable that fails with a ValueError after yielding once */
+static PyObject *
+new_failing(void)
+{
+    PyObject *coro = new_sleep(0, 0);
+    if (coro == NULL) {
+        return NULL;
+    }
+
+    PyObject *awaitable = Test_NewAwaitableWithCoro(
+        coro,
+        raise_value_error,
+        NULL
+    );
+    Py_DECREF(coro);
+    return awaitable;
+}
+
+static void
+clear_coros(PyObject **coros, Py_ssize_t size)
+{
+    for (Py_ssize_t i = 0; i < size; ++i) {
+        Py_XDECREF(coros[i]);
+    }
+}
+
+static int
+sum_results(PyObject *awaitable, PyObject **results, Py_ssize_t size)
+{
+    TEST_ASSERT_INT(size == NUM_SLEEPS);
+    long total = 0;
+    for (Py_ssize_t i = 0; i < size; ++i) {
+        // Results are in the same order as the awaitables
+        TEST_ASSERT_INT(PyLong_AsLong(results[i]) == i + 1);
+        total += PyLong_AsLong(results[i]);
+    }
+
+    PyObject *value = PyLong_FromLong(total);
+    if (value == NULL) {
+        return -1;
+    }
+
+    int res = PyAwaitable_SetResult(awaitable, value);
+    Py_DECREF(value);
+    return res;
+}
+
+static PyObject *
+test_gather_results(PyObject *self, PyObject *nothing)
+{
+    PyObject *coros[NUM_SLEEPS] = {NULL};
+    for (Py_ssize_t i = 0; i < NUM_SLEEPS; ++i) {
+        // The later ones finish first
+        coros[i] = new_sleep(0.01 * (NUM_SLEEPS - i), i + 1);
+        if (coros[i] == NULL) {
+            clear_coros(coros, NUM_SLEEPS);
+            return NULL;
+        }
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        clear_coros(coros, NUM_SLEEPS);
+        return NULL;
+    }
+
+    int res = PyAwaitable_AddGather(
+        awaitable,
+        coros,
+        NUM_SLEEPS,
+        sum_results,
+        NULL,
+        0
+    );
+    clear_coros(coros, NUM_SLEEPS);
+    if (res < 0) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    PyObject *result = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    if (result == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(PyLong_AsLong(result) == 6);
+    Py_DECREF(result);
+    Py_RETURN_NONE;
+}
+
+static int
+expect_no_results(PyObject *awaitable, PyObject **results, Py_ssize_t size)
+{
+    TEST_ASSERT_INT(size == 0);
+    return PyAwaitable_SetResult(awaitable, Py_True);
+}
+
+static PyObject *
+test_gather_nothing(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    if (
+        PyAwaitable_AddGather(
+            awaitable,
+            NULL,
+            0,
+            expect_no_results,
+            NULL,
+            0
+        ) < 0
+    ) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    return Test_RunAndCheck(awaitable, Py_True);
+}
+
+static int sibling_cancelled = 0;
+
+static int
+record_cancel(PyObject *awaitable, PyObject *err)
+{
+    TEST_ASSERT_INT(PyErr_GivenExceptionMatches(err, PyExc_BaseException));
+    sibling_cancelled = 1;
+    return -1;
+}
+
+static int
+never_called(PyObject *awaitable, PyObject **results, Py_ssize_t size)
+{
+    TEST_ERROR("gather callback was called after a failure");
+    return -1;
+}
+
+static int
+expect_value_error(PyObject *awaitable, PyObject *err)
+{
+    TEST_ASSERT_INT(PyErr_GivenExceptionMatches(err, PyExc_ValueError));
+    return 0;
+}
+
+static PyObject *
+test_gather_cancel_on_error(PyObject *self, PyObject *nothing)
+{
+    PyObject *coros[2] = {NULL};
+    PyObject *slow = new_sleep(10, 0);
+    if (slow == NULL) {
+        return NULL;
+    }
+
+    coros[0] = Test_NewAwaitableWithCoro(slow, NULL, record_cancel);
+    Py_DECREF(slow);
+    coros[1] = new_failing();
+    if (coros[0] == NULL || coros[1] == NULL) {
+        clear_coros(coros, 2);
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        clear_coros(coros, 2);
+        return NULL;
+    }
+
+    sibling_cancelled = 0;
+    int res = PyAwaitable_AddGather(
+        awaitable,
+        coros,
+        2,
+        never_called,
+        expect_value_error,
+        PyAwaitable_GATHER_CANCEL_ON_ERROR
+    );
+    clear_coros(coros, 2);
+    if (res < 0) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    PyObject *result = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    if (result == NULL) {
+        return NULL;
+    }
+
+    Py_DECREF(result);
+    TEST_ASSERT(sibling_cancelled == 1);
+    Py_RETURN_NONE;
+}
+
+#if PY_VERSION_HEX >= 0x030b0000
+static int
+expect_group(PyObject *awaitable, PyObject *err)
+{
+    TEST_ASSERT_INT(
+        PyErr_GivenExceptionMatches(err, PyExc_BaseExceptionGroup)
+    );
+    // Only an ExceptionGroup is also an Exception
+    TEST_ASSERT_INT(PyErr_GivenExceptionMatches(err, PyExc_Exception));
+    PyObject *errors = PyObject_GetAttrString(err, "exceptions");
+    if (errors == NULL) {
+        return -1;
+    }
+
+    TEST_ASSERT_INT(PyTuple_GET_SIZE(errors) == 2);
+    for (Py_ssize_t i = 0; i < 2; ++i) {
+        PyObject *exc = PyTuple_GET_ITEM(errors, i);
+        TEST_ASSERT_INT(PyErr_GivenExceptionMatches(exc, PyExc_ValueError));
+    }
+
+    Py_DECREF(errors);
+    return 0;
+}
+
+static PyObject *
+test_gather_exception_group(PyObject *self, PyObject *nothing)
+{
+    PyObject *coros[3] = {NULL};
+    coros[0] = new_failing();
+    coros[1] = new_sleep(0, 1);
+    coros[2] = new_failing();
+    if (coros[0] == NULL || coros[1] == NULL || coros[2] == NULL) {
+        clear_coros(coros, 3);
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        clear_coros(coros, 3);
+        return NULL;
+    }
+
+    int res = PyAwaitable_AddGather(
+        awaitable,
+        coros,
+        3,
+        never_called,
+        expect_group,
+        PyAwaitable_GATHER_EXCEPTION_GROUP
+    );
+    clear_coros(coros, 3);
+    if (res < 0) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    return Test_RunAndCheck(awaitable, Py_None);
+}
+#endif
+
+static PyObject *
+test_gather_bad_flags(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    int res = PyAwaitable_AddGather(
+        awaitable,
+        NULL,
+        0,
+        NULL,
+        NULL,
+        PyAwaitable_GATHER_CANCEL_ON_ERROR
+        | PyAwaitable_GATHER_EXCEPTION_GROUP
+    );
+    TEST_ASSERT(res < 0);
+    EXPECT_ERROR(PyExc_ValueError);
+
+    res = PyAwaitable_AddGather(awaitable, NULL, 0, NULL, NULL, 1 << 8);
+    TEST_ASSERT(res < 0);
+    EXPECT_ERROR(PyExc_ValueError);
+    PyAwaitable_Cancel(awaitable);
+    Py_DECREF(awaitable);
+    Py_RETURN_NONE;
+}
+
+static int
+expect_second(PyObject *awaitable, Py_ssize_t index, PyObject *result)
+{
+    TEST_ASSERT_INT(index == 1);
+    TEST_ASSERT_INT(PyLong_AsLong(result) == 2);
+    return PyAwaitable_SetResult(awaitable, result);
+}
+
+static PyObject *
+test_race_first_wins(PyObject *self, PyObject *nothing)
+{
+    PyObject *coros[2] = {NULL};
+    PyObject *slow = new_sleep(10, 1);
+    if (slow == NULL) {
+        return NULL;
+    }
+
+    coros[0] = Test_NewAwaitableWithCoro(slow, NULL, record_cancel);
+    Py_DECREF(slow);
+    coros[1] = new_sleep(0, 2);
+    if (coros[0] == NULL || coros[1] == NULL) {
+        clear_coros(coros, 2);
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        clear_coros(coros, 2);
+        return NULL;
+    }
+
+    sibling_cancelled = 0;
+    int res = PyAwaitable_AddRace(awaitable, coros, 2, expect_second, NULL);
+    clear_coros(coros, 2);
+    if (res < 0) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    PyObject *result = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    if (result == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(PyLong_AsLong(result) == 2);
+    Py_DECREF(result);
+    // The loser is cancelled
+    TEST_ASSERT(sibling_cancelled == 1);
+    Py_RETURN_NONE;
+}
+
+static int
+race_never_called(PyObject *awaitable, Py_ssize_t index, PyObject *result)
+{
+    TEST_ERROR("race callback was called after a failure");
+    return -1;
+}
+
+static PyObject *
+test_race_first_failure(PyObject *self, PyObject *nothing)
+{
+    PyObject *coros[2] = {NULL};
+    coros[0] = new_sleep(10, 1);
+    coros[1] = new_failing();
+    if (coros[0] == NULL || coros[1] == NULL) {
+        clear_coros(coros, 2);
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        clear_coros(coros, 2);
+        return NULL;
+    }
+
+    int res = PyAwaitable_AddRace(
+        awaitable,
+        coros,
+        2,
+        race_never_called,
+        expect_value_error
+    );
+    clear_coros(coros, 2);
+    if (res < 0) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    return Test_RunAndCheck(awaitable, Py_None);
+}
+
+static PyObject *
+test_race_nothing(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(PyAwaitable_AddRace(awaitable, NULL, 0, NULL, NULL) < 0);
+    EXPECT_ERROR(PyExc_ValueError);
+    PyAwaitable_Cancel(awaitable);
+    Py_DECREF(awaitable);
+    Py_RETURN_NONE;
+}
+
+TESTS(gather) = {
+    TEST(test_gather_results),
+    TEST(test_gather_nothing),
+    TEST(test_gather_cancel_on_error),
+#if PY_VERSION_HEX >= 0x030b0000
+    TEST(test_gather_exception_group),
+#endif
+    TEST(test_gather_bad_flags),
+    TEST(test_race_first_wins),
+    TEST(test_race_first_failure),
+    TEST(test_race_nothing),
+    {NULL}
+};
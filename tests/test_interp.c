@@ -0,0 +1,538 @@
+#include <Python.h>
+#include <pythread.h>
+#include <pyawaitable.h>
+#include "pyawaitable_test.h"
+
+typedef struct {
+    PyInterpreterState *ran_in;
+    long input;
+    long output;
+} InterpData;
+
+static int
+double_in_interpreter(void *payload, void **result)
+{
+    InterpData *data = (InterpData *)payload;
+    data->ran_in = PyInterpreterState_Get();
+
+    // Objects created here belong to the target interpreter
+    PyObject *num = PyLong_FromLong(data->input);
+    if (num == NULL) {
+        return -1;
+    }
+
+    PyObject *doubled = PyNumber_Add(num, num);
+    Py_DECREF(num);
+    if (doubled == NULL) {
+        return -1;
+    }
+
+    data->output = PyLong_AsLong(doubled);
+    Py_DECREF(doubled);
+    *result = &data->output;
+    return 0;
+}
+
+static int
+fail_in_interpreter(void *payload, void **result)
+{
+    PyErr_SetString(PyExc_ValueError, "nope");
+    return -1;
+}
+
+static int
+set_doubled_result(PyObject *awaitable, void *result, void *payload)
+{
+    InterpData *data = (InterpData *)payload;
+    TEST_ASSERT_INT(result == &data->output);
+    PyObject *value = PyLong_FromLong(*(long *)result);
+    if (value == NULL) {
+        return -1;
+    }
+
+    int res = PyAwaitable_SetResult(awaitable, value);
+    Py_DECREF(value);
+    return res;
+}
+
+#ifdef PYAWAITABLE_TEST_SHARED
+#define OTHER_TEST_MODULE "_pyawaitable_test"
+#else
+#define OTHER_TEST_MODULE "_pyawaitable_test_shared"
+#endif
+
+static int
+init_through_this_copy(const char *path)
+{
+    return PyAwaitable_Init();
+}
+
+/*
+ * The other test module has its own copy of PyAwaitable. path is the
+ * directory that it's in, since a new interpreter doesn't get the
+ * sys.path of the main one.
+ */
+static int
+init_through_other_module(const char *path)
+{
+    PyObject *sys_path = PySys_GetObject("path");
+    PyObject *dir = PyUnicode_FromString(path);
+    if (sys_path == NULL || dir == NULL) {
+        Py_XDECREF(dir);
+        return -1;
+    }
+
+    int res = PyList_Insert(sys_path, 0, dir);
+    Py_DECREF(dir);
+    if (res < 0) {
+        return -1;
+    }
+
+    PyObject *mod = PyImport_ImportModule(OTHER_TEST_MODULE);
+    if (mod == NULL) {
+        return -1;
+    }
+
+    Py_DECREF(mod);
+    return 0;
+}
+
+/*
+ * Run the awaitable while a subinterpreter exists, and then destroy the
+ * subinterpreter. init is called with path to initialize PyAwaitable in it.
+ */
+static PyObject *
+run_with_subinterpreter(
+    int (*init)(const char *),
+    const char *path,
+    PyAwaitable_InterpreterFunc func,
+    InterpData *data
+)
+{
+    PyThreadState *main_tstate = PyThreadState_Get();
+    PyThreadState *sub_tstate = Py_NewInterpreter();
+    if (sub_tstate == NULL) {
+        PyThreadState_Swap(main_tstate);
+        PyErr_SetString(PyExc_RuntimeError, "failed to create interpreter");
+        return NULL;
+    }
+    // Calls can only go to interpreters that have initialized PyAwaitable
+    if (init(path) < 0) {
+        PyErr_Print();
+        Py_EndInterpreter(sub_tstate);
+        PyThreadState_Swap(main_tstate);
+        PyErr_SetString(PyExc_RuntimeError, "failed to initialize");
+        return NULL;
+    }
+    PyInterpreterState *sub = PyThreadState_GetInterpreter(sub_tstate);
+    PyThreadState_Swap(main_tstate);
+
+    PyObject *res = NULL;
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable != NULL) {
+        if (
+            PyAwaitable_AddInterpreterCall(
+                awaitable,
+                sub,
+                func,
+                data,
+                set_doubled_result
+            ) == 0
+        ) {
+            res = Test_RunAwaitable(awaitable);
+        }
+        Py_DECREF(awaitable);
+    }
+
+    PyObject *exc = PyErr_GetRaisedException();
+    PyThreadState_Swap(sub_tstate);
+    Py_EndInterpreter(sub_tstate);
+    PyThreadState_Swap(main_tstate);
+    if (exc != NULL) {
+        PyErr_SetRaisedException(exc);
+    }
+
+    if (data->ran_in != NULL) {
+        TEST_ASSERT(data->ran_in == sub);
+    }
+    return res;
+}
+
+static PyObject *
+test_interpreter_call_returns_result(PyObject *self, PyObject *nothing)
+{
+    InterpData data = {NULL, 21, 0};
+    PyObject *res = run_with_subinterpreter(
+        init_through_this_copy,
+        NULL,
+        double_in_interpreter,
+        &data
+    );
+    if (res == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(data.ran_in != NULL);
+    TEST_ASSERT(PyLong_AsLong(res) == 42);
+    Py_DECREF(res);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_interpreter_call_propagates_failure(PyObject *self, PyObject *nothing)
+{
+    InterpData data = {NULL, 0, 0};
+    PyObject *res = run_with_subinterpreter(
+        init_through_this_copy,
+        NULL,
+        fail_in_interpreter,
+        &data
+    );
+    TEST_ASSERT(res == NULL);
+    EXPECT_ERROR(PyExc_RuntimeError);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_interpreter_call_finalized_interpreter(PyObject *self, PyObject *nothing)
+{
+    PyThreadState *main_tstate = PyThreadState_Get();
+    PyThreadState *sub_tstate = Py_NewInterpreter();
+    if (sub_tstate == NULL) {
+        PyThreadState_Swap(main_tstate);
+        PyErr_SetString(PyExc_RuntimeError, "failed to create interpreter");
+        return NULL;
+    }
+    // Calls can only go to interpreters that have initialized PyAwaitable
+    if (PyAwaitable_Init() < 0) {
+        PyErr_Print();
+        Py_EndInterpreter(sub_tstate);
+        PyThreadState_Swap(main_tstate);
+        PyErr_SetString(PyExc_RuntimeError, "failed to initialize");
+        return NULL;
+    }
+    PyInterpreterState *sub = PyThreadState_GetInterpreter(sub_tstate);
+    PyThreadState_Swap(main_tstate);
+
+    InterpData data = {NULL, 21, 0};
+    PyObject *awaitable = PyAwaitable_New();
+    int res = -1;
+    if (awaitable != NULL) {
+        res = PyAwaitable_AddInterpreterCall(
+            awaitable,
+            sub,
+            double_in_interpreter,
+            &data,
+            set_doubled_result
+        );
+    }
+
+    // The interpreter goes away before the call gets to run
+    PyObject *exc = PyErr_GetRaisedException();
+    PyThreadState_Swap(sub_tstate);
+    Py_EndInterpreter(sub_tstate);
+    PyThreadState_Swap(main_tstate);
+    if (exc != NULL) {
+        PyErr_SetRaisedException(exc);
+    }
+
+    if (res < 0) {
+        Py_XDECREF(awaitable);
+        return NULL;
+    }
+
+    PyObject *result = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    TEST_ASSERT(result == NULL);
+    EXPECT_ERROR(PyExc_RuntimeError);
+    TEST_ASSERT(data.ran_in == NULL);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_interpreter_call_uninitialized_interpreter(
+    PyObject *self,
+    PyObject *nothing
+)
+{
+    PyThreadState *main_tstate = PyThreadState_Get();
+    PyThreadState *sub_tstate = Py_NewInterpreter();
+    if (sub_tstate == NULL) {
+        PyThreadState_Swap(main_tstate);
+        PyErr_SetString(PyExc_RuntimeError, "failed to create interpreter");
+        return NULL;
+    }
+    PyInterpreterState *sub = PyThreadState_GetInterpreter(sub_tstate);
+    PyThreadState_Swap(main_tstate);
+
+    InterpData data = {NULL, 21, 0};
+    PyObject *awaitable = PyAwaitable_New();
+    int res = 0;
+    if (awaitable != NULL) {
+        res = PyAwaitable_AddInterpreterCall(
+            awaitable,
+            sub,
+            double_in_interpreter,
+            &data,
+            set_doubled_result
+        );
+        PyAwaitable_Cancel(awaitable);
+        Py_DECREF(awaitable);
+    }
+
+    PyObject *exc = PyErr_GetRaisedException();
+    PyThreadState_Swap(sub_tstate);
+    Py_EndInterpreter(sub_tstate);
+    PyThreadState_Swap(main_tstate);
+    PyErr_SetRaisedException(exc);
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(res < 0);
+    EXPECT_ERROR(PyExc_RuntimeError);
+    Py_RETURN_NONE;
+}
+
+typedef struct {
+    InterpData data;
+    PyInterpreterState *sub;
+    /* Each of these is held until the event happens */
+    PyThread_type_lock ready;
+    PyThread_type_lock started;
+    PyThread_type_lock ended;
+    PyThread_type_lock never;
+    int finished;
+    int finished_before_end;
+} EndMidCall;
+
+static int
+slow_double_in_interpreter(void *payload, void **result)
+{
+    EndMidCall *state = (EndMidCall *)payload;
+    PyThread_release_lock(state->started);
+
+    // Give the other thread time to start ending the interpreter
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock_timed(state->never, 100000, 0);
+    Py_END_ALLOW_THREADS
+
+    int res = double_in_interpreter(&state->data, result);
+    state->finished = 1;
+    return res;
+}
+
+static int
+set_slow_doubled_result(PyObject *awaitable, void *result, void *payload)
+{
+    EndMidCall *state = (EndMidCall *)payload;
+    return set_doubled_result(awaitable, result, &state->data);
+}
+
+/* Creates the target interpreter, and ends it once the call has started */
+static void
+end_mid_call_thread(void *arg)
+{
+    EndMidCall *state = (EndMidCall *)arg;
+    PyGILState_STATE gil = PyGILState_Ensure();
+    PyThreadState *own_tstate = PyThreadState_Get();
+    PyThreadState *sub_tstate = Py_NewInterpreter();
+    if (sub_tstate == NULL || PyAwaitable_Init() < 0) {
+        if (sub_tstate != NULL) {
+            PyErr_Print();
+            Py_EndInterpreter(sub_tstate);
+        }
+        PyThreadState_Swap(own_tstate);
+        PyGILState_Release(gil);
+        PyThread_release_lock(state->ready);
+        PyThread_release_lock(state->ended);
+        return;
+    }
+
+    state->sub = PyThreadState_GetInterpreter(sub_tstate);
+    PyThread_release_lock(state->ready);
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(state->started, WAIT_LOCK);
+    Py_END_ALLOW_THREADS
+
+    // This waits for the call to leave the interpreter
+    Py_EndInterpreter(sub_tstate);
+    state->finished_before_end = state->finished;
+    PyThreadState_Swap(own_tstate);
+    PyGILState_Release(gil);
+    PyThread_release_lock(state->ended);
+}
+
+static PyObject *
+test_interpreter_call_target_exits_mid_call(PyObject *self, PyObject *nothing)
+{
+    EndMidCall state = {{NULL, 21, 0}, NULL};
+    PyThread_type_lock *locks[] = {
+        &state.ready,
+        &state.started,
+        &state.ended,
+        &state.never
+    };
+    for (int i = 0; i < 4; ++i) {
+        *locks[i] = PyThread_allocate_lock();
+        if (*locks[i] == NULL) {
+            for (int j = 0; j < i; ++j) {
+                PyThread_free_lock(*locks[j]);
+            }
+            return PyErr_NoMemory();
+        }
+        PyThread_acquire_lock(*locks[i], WAIT_LOCK);
+    }
+
+    PyObject *res = NULL;
+    if (
+        PyThread_start_new_thread(end_mid_call_thread, &state)
+        == PYTHREAD_INVALID_THREAD_ID
+    ) {
+        PyErr_SetString(PyExc_RuntimeError, "failed to start thread");
+        goto done;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(state.ready, WAIT_LOCK);
+    Py_END_ALLOW_THREADS
+    if (state.sub == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "failed to create interpreter");
+        goto wait;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        goto cancel;
+    }
+
+    if (
+        PyAwaitable_AddInterpreterCall(
+            awaitable,
+            state.sub,
+            slow_double_in_interpreter,
+            &state,
+            set_slow_doubled_result
+        ) < 0
+    ) {
+        Py_DECREF(awaitable);
+        goto cancel;
+    }
+
+    res = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    goto wait;
+
+cancel:
+    // Let the thread end the interpreter anyway
+    PyThread_release_lock(state.started);
+wait:
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(state.ended, WAIT_LOCK);
+    Py_END_ALLOW_THREADS
+done:
+    for (int i = 0; i < 4; ++i) {
+        PyThread_release_lock(*locks[i]);
+        PyThread_free_lock(*locks[i]);
+    }
+
+    if (res == NULL) {
+        return NULL;
+    }
+
+    // The call that was already running got to finish first
+    TEST_ASSERT(PyLong_AsLong(res) == 42);
+    Py_DECREF(res);
+    TEST_ASSERT(state.finished_before_end);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_interpreter_call_target_initialized_elsewhere(
+    PyObject *self,
+    PyObject *nothing
+)
+{
+    // The other copy has to have been used here too, so that it shares
+    // its gates with ours
+    PyObject *mod = PyImport_ImportModule(OTHER_TEST_MODULE);
+    if (mod == NULL) {
+        return NULL;
+    }
+
+    PyObject *file = PyModule_GetFilenameObject(mod);
+    Py_DECREF(mod);
+    if (file == NULL) {
+        return NULL;
+    }
+
+    PyObject *os_path = PyImport_ImportModule("os.path");
+    if (os_path == NULL) {
+        Py_DECREF(file);
+        return NULL;
+    }
+
+    PyObject *dir = PyObject_CallMethod(os_path, "dirname", "O", file);
+    Py_DECREF(os_path);
+    Py_DECREF(file);
+    if (dir == NULL) {
+        return NULL;
+    }
+
+    const char *path = PyUnicode_AsUTF8(dir);
+    if (path == NULL) {
+        Py_DECREF(dir);
+        return NULL;
+    }
+
+    InterpData data = {NULL, 21, 0};
+    PyObject *res = run_with_subinterpreter(
+        init_through_other_module,
+        path,
+        double_in_interpreter,
+        &data
+    );
+    Py_DECREF(dir);
+    if (res == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(data.ran_in != NULL);
+    TEST_ASSERT(PyLong_AsLong(res) == 42);
+    Py_DECREF(res);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_interpreter_call_null_arguments(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+    PyAwaitable_Cancel(awaitable);
+
+    TEST_ASSERT(
+        PyAwaitable_AddInterpreterCall(
+            awaitable,
+            NULL,
+            double_in_interpreter,
+            NULL,
+            NULL
+        ) < 0
+    );
+    EXPECT_ERROR(PyExc_ValueError);
+    Py_DECREF(awaitable);
+    Py_RETURN_NONE;
+}
+
+TESTS(interp) = {
+    TEST(test_interpreter_call_returns_result),
+    TEST(test_interpreter_call_propagates_failure),
+    TEST(test_interpreter_call_finalized_interpreter),
+    TEST(test_interpreter_call_uninitialized_interpreter),
+    TEST(test_interpreter_call_target_exits_mid_call),
+    TEST(test_interpreter_call_target_initialized_elsewhere),
+    TEST(test_interpreter_call_null_arguments),
+    {NULL}
+};
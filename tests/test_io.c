@@ -0,0 +1,784 @@
+#include <Python.h>
+#include <pyawaitable.h>
+#include "pyawaitable_test.h"
+
+// The proactor event loop on Windows can't watch file descriptors
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+
+static int io_fds[2] = {-1, -1};
+
+static int
+open_pipe(void)
+{
+    if (pipe(io_fds) < 0) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void
+close_pipe(void)
+{
+    close(io_fds[0]);
+    close(io_fds[1]);
+}
+
+static int
+read_byte(PyObject *awaitable, int fd)
+{
+    TEST_ASSERT_INT(fd == io_fds[0]);
+    char byte;
+    if (read(fd, &byte, 1) != 1) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+
+    PyObject *value = PyLong_FromLong(byte);
+    if (value == NULL) {
+        return -1;
+    }
+
+    int res = PyAwaitable_SetResult(awaitable, value);
+    Py_DECREF(value);
+    return res;
+}
+
+static int
+write_byte(PyObject *awaitable)
+{
+    char byte = 42;
+    if (write(io_fds[1], &byte, 1) != 1) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+set_reader_result(PyObject *awaitable, PyObject **results, Py_ssize_t size)
+{
+    TEST_ASSERT_INT(size == 2);
+    return PyAwaitable_SetResult(awaitable, results[0]);
+}
+
+static PyObject *
+test_readable_waits(PyObject *self, PyObject *nothing)
+{
+    if (open_pipe() < 0) {
+        return NULL;
+    }
+
+    PyObject *coros[2] = {PyAwaitable_New(), PyAwaitable_New()};
+    PyObject *awaitable = PyAwaitable_New();
+    if (
+        coros[0] == NULL
+        || coros[1] == NULL
+        || awaitable == NULL
+        || PyAwaitable_AddReadable(coros[0], io_fds[0], read_byte) < 0
+        // Nothing is written until the reader is already waiting
+        || PyAwaitable_AddSleep(coros[1], 0.01) < 0
+        || PyAwaitable_DeferAwait(coros[1], write_byte) < 0
+        || PyAwaitable_AddGather(
+            awaitable,
+            coros,
+            2,
+            set_reader_result,
+            NULL,
+            0
+        ) < 0
+    ) {
+        Py_XDECREF(coros[0]);
+        Py_XDECREF(coros[1]);
+        Py_XDECREF(awaitable);
+        close_pipe();
+        return NULL;
+    }
+
+    Py_DECREF(coros[0]);
+    Py_DECREF(coros[1]);
+    PyObject *result = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    close_pipe();
+    if (result == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(PyLong_AsLong(result) == 42);
+    Py_DECREF(result);
+    Py_RETURN_NONE;
+}
+
+static int
+set_writable(PyObject *awaitable, int fd)
+{
+    TEST_ASSERT_INT(fd == io_fds[1]);
+    return PyAwaitable_SetResult(awaitable, Py_True);
+}
+
+static PyObject *
+test_writable(PyObject *self, PyObject *nothing)
+{
+    if (open_pipe() < 0) {
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        close_pipe();
+        return NULL;
+    }
+
+    if (PyAwaitable_AddWritable(awaitable, io_fds[1], set_writable) < 0) {
+        Py_DECREF(awaitable);
+        close_pipe();
+        return NULL;
+    }
+
+    PyObject *result = Test_RunAndCheck(awaitable, Py_True);
+    close_pipe();
+    return result;
+}
+
+static int
+expect_timeout(PyObject *awaitable, PyObject *err)
+{
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (asyncio == NULL) {
+        return -1;
+    }
+
+    PyObject *timeout_error = PyObject_GetAttrString(asyncio, "TimeoutError");
+    if (timeout_error == NULL) {
+        Py_DECREF(asyncio);
+        return -1;
+    }
+
+    int matches = PyErr_GivenExceptionMatches(err, timeout_error);
+    Py_DECREF(timeout_error);
+    TEST_ASSERT_INT(matches);
+
+    // This returns whether the fd was still being watched
+    PyObject *loop = PyObject_CallMethod(asyncio, "get_running_loop", NULL);
+    Py_DECREF(asyncio);
+    if (loop == NULL) {
+        return -1;
+    }
+
+    PyObject *removed = PyObject_CallMethod(
+        loop,
+        "remove_reader",
+        "i",
+        io_fds[0]
+    );
+    Py_DECREF(loop);
+    if (removed == NULL) {
+        return -1;
+    }
+
+    Py_DECREF(removed);
+    TEST_ASSERT_INT(removed == Py_False);
+    return PyAwaitable_SetResult(awaitable, Py_True);
+}
+
+static int
+never_ready(PyObject *awaitable, int fd)
+{
+    TEST_ERROR("fd became ready after the wait was cancelled");
+    return -1;
+}
+
+static PyObject *
+test_readable_cancelled(PyObject *self, PyObject *nothing)
+{
+    if (open_pipe() < 0) {
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        close_pipe();
+        return NULL;
+    }
+
+    // The deadline cancels the wait, which has to stop watching the fd
+    if (
+        PyAwaitable_AddReadable(awaitable, io_fds[0], never_ready) < 0
+        || PyAwaitable_SetStepDeadline(awaitable, 0.01) < 0
+        || PyAwaitable_AddSleep(awaitable, 0) < 0
+    ) {
+        PyAwaitable_Cancel(awaitable);
+        Py_DECREF(awaitable);
+        close_pipe();
+        return NULL;
+    }
+
+    // The deadline's error goes to the step after it
+    PyObject *checker = PyAwaitable_New();
+    if (
+        checker == NULL
+        || PyAwaitable_AddAwait(checker, awaitable, NULL, expect_timeout) < 0
+    ) {
+        Py_XDECREF(checker);
+        Py_DECREF(awaitable);
+        close_pipe();
+        return NULL;
+    }
+    Py_DECREF(awaitable);
+
+    PyObject *result = Test_RunAndCheck(checker, Py_True);
+    close_pipe();
+    return result;
+}
+
+static int
+set_bytes_result(PyObject *awaitable, void *buffer, Py_ssize_t size)
+{
+    PyObject *bytes = PyBytes_FromStringAndSize(buffer, size);
+    if (bytes == NULL) {
+        return -1;
+    }
+
+    int res = PyAwaitable_SetResult(awaitable, bytes);
+    Py_DECREF(bytes);
+    return res;
+}
+
+static int
+write_string(const char *str)
+{
+    size_t length = strlen(str);
+    if (write(io_fds[1], str, length) != (ssize_t)length) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+write_head(PyObject *awaitable)
+{
+    return write_string("abc");
+}
+
+static int
+write_tail(PyObject *awaitable)
+{
+    return write_string("def");
+}
+
+static int
+set_first_result(PyObject *awaitable, PyObject **results, Py_ssize_t size)
+{
+    return PyAwaitable_SetResult(awaitable, results[0]);
+}
+
+static PyObject *
+test_readinto_partial(PyObject *self, PyObject *nothing)
+{
+    if (open_pipe() < 0) {
+        return NULL;
+    }
+
+    if (fcntl(io_fds[0], F_SETFL, O_NONBLOCK) < 0) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        close_pipe();
+        return NULL;
+    }
+
+    PyObject *buffer = PyByteArray_FromStringAndSize(NULL, 6);
+    if (buffer == NULL) {
+        close_pipe();
+        return NULL;
+    }
+
+    // The first read only gets half of the buffer, so it has to wait
+    PyObject *coros[2] = {PyAwaitable_New(), PyAwaitable_New()};
+    PyObject *awaitable = PyAwaitable_New();
+    if (
+        coros[0] == NULL
+        || coros[1] == NULL
+        || awaitable == NULL
+        || PyAwaitable_AddReadIntoBuffer(
+            coros[0],
+            io_fds[0],
+            buffer,
+            set_bytes_result
+        ) < 0
+        || PyAwaitable_DeferAwait(coros[1], write_head) < 0
+        || PyAwaitable_AddSleep(coros[1], 0.01) < 0
+        || PyAwaitable_DeferAwait(coros[1], write_tail) < 0
+        || PyAwaitable_AddGather(
+            awaitable,
+            coros,
+            2,
+            set_first_result,
+            NULL,
+            0
+        ) < 0
+    ) {
+        Py_XDECREF(coros[0]);
+        Py_XDECREF(coros[1]);
+        Py_XDECREF(awaitable);
+        Py_DECREF(buffer);
+        close_pipe();
+        return NULL;
+    }
+
+    Py_DECREF(coros[0]);
+    Py_DECREF(coros[1]);
+    PyObject *result = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    close_pipe();
+    if (result == NULL) {
+        Py_DECREF(buffer);
+        return NULL;
+    }
+
+    TEST_ASSERT(PyBytes_Check(result));
+    TEST_ASSERT(strcmp(PyBytes_AS_STRING(result), "abcdef") == 0);
+    TEST_ASSERT(strcmp(PyByteArray_AS_STRING(buffer), "abcdef") == 0);
+    Py_DECREF(result);
+    Py_DECREF(buffer);
+    Py_RETURN_NONE;
+}
+
+static char readinto_buffer[16];
+
+static PyObject *
+test_readinto_eof(PyObject *self, PyObject *nothing)
+{
+    if (open_pipe() < 0) {
+        return NULL;
+    }
+
+    // The writer is gone, so the read stops short of filling the buffer
+    if (write_string("hi") < 0) {
+        close_pipe();
+        return NULL;
+    }
+    close(io_fds[1]);
+    io_fds[1] = -1;
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        close_pipe();
+        return NULL;
+    }
+
+    if (
+        PyAwaitable_AddReadInto(
+            awaitable,
+            io_fds[0],
+            readinto_buffer,
+            sizeof(readinto_buffer),
+            set_bytes_result
+        ) < 0
+    ) {
+        Py_DECREF(awaitable);
+        close_pipe();
+        return NULL;
+    }
+
+    PyObject *result = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    close_pipe();
+    if (result == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(PyBytes_Check(result));
+    TEST_ASSERT(PyBytes_GET_SIZE(result) == 2);
+    TEST_ASSERT(strcmp(PyBytes_AS_STRING(result), "hi") == 0);
+    Py_DECREF(result);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_readinto_bad_arguments(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(PyAwaitable_AddReadInto(awaitable, -1, NULL, 0, NULL) < 0);
+    EXPECT_ERROR(PyExc_ValueError);
+    TEST_ASSERT(
+        PyAwaitable_AddReadInto(awaitable, 0, readinto_buffer, -1, NULL) < 0
+    );
+    EXPECT_ERROR(PyExc_ValueError);
+    TEST_ASSERT(PyAwaitable_AddReadInto(awaitable, 0, NULL, 1, NULL) < 0);
+    EXPECT_ERROR(PyExc_ValueError);
+
+    // Immutable buffers can't be read into
+    PyObject *bytes = PyBytes_FromString("immutable");
+    if (bytes == NULL) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    TEST_ASSERT(PyAwaitable_AddReadIntoBuffer(awaitable, 0, bytes, NULL) < 0);
+    EXPECT_ERROR(PyExc_BufferError);
+
+    Py_DECREF(bytes);
+    Py_DECREF(awaitable);
+    Py_RETURN_NONE;
+}
+
+static PyObject *io_writer = NULL;
+
+static int
+set_nonblocking(int fd)
+{
+    if (fcntl(fd, F_SETFL, O_NONBLOCK) < 0) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+write_frames(PyObject *awaitable)
+{
+    PyObject *tail = PyBytes_FromString("ef");
+    if (tail == NULL) {
+        return -1;
+    }
+
+    if (
+        PyAwaitable_Write(io_writer, "ab", 2) < 0
+        || PyAwaitable_Write(io_writer, "cd", 2) < 0
+        || PyAwaitable_WriteBuffer(io_writer, tail) < 0
+    ) {
+        Py_DECREF(tail);
+        return -1;
+    }
+    Py_DECREF(tail);
+
+    // Nothing is written until the loop gets around to the flush
+    char byte;
+    TEST_ASSERT_INT(read(io_fds[0], &byte, 1) < 0);
+    TEST_ASSERT_INT(errno == EAGAIN || errno == EWOULDBLOCK);
+    return 0;
+}
+
+static int
+read_frames(PyObject *awaitable)
+{
+    char frames[7] = {0};
+    if (read(io_fds[0], frames, 6) != 6) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+
+    PyObject *bytes = PyBytes_FromString(frames);
+    if (bytes == NULL) {
+        return -1;
+    }
+
+    int res = PyAwaitable_SetResult(awaitable, bytes);
+    Py_DECREF(bytes);
+    return res;
+}
+
+static PyObject *
+test_writer_coalesces(PyObject *self, PyObject *nothing)
+{
+    if (open_pipe() < 0) {
+        return NULL;
+    }
+
+    if (set_nonblocking(io_fds[0]) < 0 || set_nonblocking(io_fds[1]) < 0) {
+        close_pipe();
+        return NULL;
+    }
+
+    io_writer = PyAwaitable_NewWriter(io_fds[1], 1024);
+    if (io_writer == NULL) {
+        close_pipe();
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (
+        awaitable == NULL
+        || PyAwaitable_DeferAwait(awaitable, write_frames) < 0
+        || PyAwaitable_AddFlush(awaitable, io_writer) < 0
+        || PyAwaitable_DeferAwait(awaitable, read_frames) < 0
+    ) {
+        Py_XDECREF(awaitable);
+        Py_CLEAR(io_writer);
+        close_pipe();
+        return NULL;
+    }
+
+    PyObject *result = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    Py_CLEAR(io_writer);
+    close_pipe();
+    if (result == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(PyBytes_Check(result));
+    TEST_ASSERT(strcmp(PyBytes_AS_STRING(result), "abcdef") == 0);
+    Py_DECREF(result);
+    Py_RETURN_NONE;
+}
+
+#define WRITER_PAYLOAD (1 << 20)
+static char writer_sink[WRITER_PAYLOAD];
+static int reader_started = 0;
+
+static int
+write_payload(PyObject *awaitable)
+{
+    PyObject *payload = PyBytes_FromStringAndSize(NULL, WRITER_PAYLOAD);
+    if (payload == NULL) {
+        return -1;
+    }
+
+    memset(PyBytes_AS_STRING(payload), 'x', WRITER_PAYLOAD);
+    int res = PyAwaitable_WriteBuffer(io_writer, payload);
+    Py_DECREF(payload);
+    return res;
+}
+
+static int
+check_drained(PyObject *awaitable)
+{
+    // The payload is way over the high-water mark, so we can't get here
+    // until the reader has started draining the pipe
+    TEST_ASSERT_INT(reader_started);
+    return 0;
+}
+
+static int
+start_reader(PyObject *awaitable)
+{
+    reader_started = 1;
+    return 0;
+}
+
+static int
+check_payload(PyObject *awaitable, void *buffer, Py_ssize_t size)
+{
+    TEST_ASSERT_INT(size == WRITER_PAYLOAD);
+    TEST_ASSERT_INT(((char *)buffer)[0] == 'x');
+    TEST_ASSERT_INT(((char *)buffer)[WRITER_PAYLOAD - 1] == 'x');
+    return PyAwaitable_SetResult(awaitable, Py_True);
+}
+
+static int
+set_last_result(PyObject *awaitable, PyObject **results, Py_ssize_t size)
+{
+    return PyAwaitable_SetResult(awaitable, results[size - 1]);
+}
+
+static PyObject *
+test_writer_backpressure(PyObject *self, PyObject *nothing)
+{
+    if (open_pipe() < 0) {
+        return NULL;
+    }
+
+    if (set_nonblocking(io_fds[0]) < 0 || set_nonblocking(io_fds[1]) < 0) {
+        close_pipe();
+        return NULL;
+    }
+
+    io_writer = PyAwaitable_NewWriter(io_fds[1], 1024);
+    if (io_writer == NULL) {
+        close_pipe();
+        return NULL;
+    }
+
+    reader_started = 0;
+    PyObject *coros[2] = {PyAwaitable_New(), PyAwaitable_New()};
+    PyObject *awaitable = PyAwaitable_New();
+    if (
+        coros[0] == NULL
+        || coros[1] == NULL
+        || awaitable == NULL
+        || PyAwaitable_DeferAwait(coros[0], write_payload) < 0
+        || PyAwaitable_AddDrain(coros[0], io_writer) < 0
+        || PyAwaitable_DeferAwait(coros[0], check_drained) < 0
+        || PyAwaitable_AddFlush(coros[0], io_writer) < 0
+        || PyAwaitable_AddSleep(coros[1], 0.01) < 0
+        || PyAwaitable_DeferAwait(coros[1], start_reader) < 0
+        || PyAwaitable_AddReadInto(
+            coros[1],
+            io_fds[0],
+            writer_sink,
+            WRITER_PAYLOAD,
+            check_payload
+        ) < 0
+        || PyAwaitable_AddGather(
+            awaitable,
+            coros,
+            2,
+            set_last_result,
+            NULL,
+            0
+        ) < 0
+    ) {
+        Py_XDECREF(coros[0]);
+        Py_XDECREF(coros[1]);
+        Py_XDECREF(awaitable);
+        Py_CLEAR(io_writer);
+        close_pipe();
+        return NULL;
+    }
+
+    Py_DECREF(coros[0]);
+    Py_DECREF(coros[1]);
+    PyObject *result = Test_RunAndCheck(awaitable, Py_True);
+    Py_CLEAR(io_writer);
+    close_pipe();
+    return result;
+}
+
+static int
+write_byte_to_writer(PyObject *awaitable)
+{
+    return PyAwaitable_Write(io_writer, "x", 1);
+}
+
+static int
+expect_broken_pipe(PyObject *awaitable, PyObject *err)
+{
+    TEST_ASSERT_INT(PyErr_GivenExceptionMatches(err, PyExc_BrokenPipeError));
+    return PyAwaitable_SetResult(awaitable, Py_True);
+}
+
+static PyObject *
+test_writer_error(PyObject *self, PyObject *nothing)
+{
+    if (open_pipe() < 0) {
+        return NULL;
+    }
+
+    // Nobody is left to read, so the flush fails
+    close(io_fds[0]);
+    io_fds[0] = -1;
+    io_writer = PyAwaitable_NewWriter(io_fds[1], 1024);
+    if (io_writer == NULL) {
+        close_pipe();
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (
+        awaitable == NULL
+        || PyAwaitable_DeferAwait(awaitable, write_byte_to_writer) < 0
+        || PyAwaitable_AddFlush(awaitable, io_writer) < 0
+    ) {
+        Py_XDECREF(awaitable);
+        Py_CLEAR(io_writer);
+        close_pipe();
+        return NULL;
+    }
+
+    PyObject *checker = PyAwaitable_New();
+    if (
+        checker == NULL
+        || PyAwaitable_AddAwait(
+            checker,
+            awaitable,
+            NULL,
+            expect_broken_pipe
+        ) < 0
+    ) {
+        Py_XDECREF(checker);
+        Py_DECREF(awaitable);
+        Py_CLEAR(io_writer);
+        close_pipe();
+        return NULL;
+    }
+    Py_DECREF(awaitable);
+
+    PyObject *result = Test_RunAndCheck(checker, Py_True);
+    if (result != NULL) {
+        // The writer stays broken
+        TEST_ASSERT(PyAwaitable_Write(io_writer, "x", 1) < 0);
+        EXPECT_ERROR(PyExc_BrokenPipeError);
+    }
+    Py_CLEAR(io_writer);
+    close_pipe();
+    return result;
+}
+
+static PyObject *
+test_writer_bad_arguments(PyObject *self, PyObject *nothing)
+{
+    TEST_ASSERT(PyAwaitable_NewWriter(-1, 0) == NULL);
+    EXPECT_ERROR(PyExc_ValueError);
+    TEST_ASSERT(PyAwaitable_NewWriter(0, -1) == NULL);
+    EXPECT_ERROR(PyExc_ValueError);
+
+    PyObject *writer = PyAwaitable_NewWriter(0, 0);
+    if (writer == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(PyAwaitable_Write(writer, NULL, 1) < 0);
+    EXPECT_ERROR(PyExc_ValueError);
+    TEST_ASSERT(PyAwaitable_Write(writer, "x", -1) < 0);
+    EXPECT_ERROR(PyExc_ValueError);
+    Py_DECREF(writer);
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    // Only writers can be drained or flushed
+    TEST_ASSERT(PyAwaitable_AddDrain(awaitable, Py_None) < 0);
+    EXPECT_ERROR(PyExc_ValueError);
+    TEST_ASSERT(PyAwaitable_AddFlush(awaitable, Py_None) < 0);
+    EXPECT_ERROR(PyExc_ValueError);
+    Py_DECREF(awaitable);
+    Py_RETURN_NONE;
+}
+#endif
+
+static PyObject *
+test_fd_bad_arguments(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(PyAwaitable_AddReadable(awaitable, -1, NULL) < 0);
+    EXPECT_ERROR(PyExc_ValueError);
+    TEST_ASSERT(PyAwaitable_AddWritable(awaitable, -1, NULL) < 0);
+    EXPECT_ERROR(PyExc_ValueError);
+
+    Py_DECREF(awaitable);
+    Py_RETURN_NONE;
+}
+
+TESTS(io) = {
+#ifndef _WIN32
+    TEST(test_readable_waits),
+    TEST(test_writable),
+    TEST(test_readable_cancelled),
+    TEST(test_readinto_partial),
+    TEST(test_readinto_eof),
+    TEST(test_readinto_bad_arguments),
+    TEST(test_writer_coalesces),
+    TEST(test_writer_backpressure),
+    TEST(test_writer_error),
+    TEST(test_writer_bad_arguments),
+#endif
+    TEST(test_fd_bad_arguments),
+    {NULL}
+};
@@ -2,6 +2,8 @@ import asyncio
 from typing import Any, Callable
 from collections.abc import Awaitable, Coroutine
 import inspect
+import sys
+import threading
 from pytest import raises, warns
 
 NOT_FOUND = """
@@ -10,6 +12,7 @@ Please install it with `pip install ./tests`
 """
 try:
     import _pyawaitable_test
+    import _pyawaitable_test_shared
 except ImportError as err:
     raise RuntimeError(NOT_FOUND) from err
 
@@ -47,6 +50,92 @@ def test_coroutine_propagates_exception():
         asyncio.run(awaitable)
 
 
+MODULES = (_pyawaitable_test, _pyawaitable_test_shared)
+
+
+def start_awaiting(awaitable: Any) -> None:
+    # The first send() only starts the awaitable
+    assert awaitable.send(None) is None
+    # This suspends inside of the coroutine's asyncio.sleep(0)
+    assert awaitable.send(None) is None
+
+
+def test_throw_is_forwarded_to_awaited_coroutine():
+    for module in MODULES:
+        handled = False
+
+        async def catching_coroutine() -> str:
+            nonlocal handled
+            try:
+                await asyncio.sleep(0)
+            except ZeroDivisionError:
+                handled = True
+            return "caught"
+
+        awaitable = module.generic_awaitable(catching_coroutine())
+        start_awaiting(awaitable)
+        # The coroutine handles it, so the awaitable finishes normally
+        with raises(StopIteration):
+            awaitable.throw(ZeroDivisionError())
+
+        assert handled is True
+
+
+def test_throw_accepts_types_and_instances():
+    for module in MODULES:
+        for exc in (ZeroDivisionError, ZeroDivisionError("spam")):
+            awaitable = module.generic_awaitable(dummy_coroutine())
+            start_awaiting(awaitable)
+            with raises(ZeroDivisionError):
+                awaitable.throw(exc)
+
+
+def test_throw_continues_after_error_callback():
+    for module in MODULES:
+        awaitable = module.handling_awaitable(dummy_coroutine())
+        start_awaiting(awaitable)
+        with raises(StopIteration) as info:
+            awaitable.throw(ZeroDivisionError())
+
+        assert info.value.value == "handled"
+
+
+def test_dealloc_keeps_pending_exception():
+    for module in MODULES:
+        with warns(ResourceWarning), raises(ZeroDivisionError):
+            module.drop_awaitable_while_raising(None)
+
+
+def test_awaitables_on_many_threads():
+    for module in MODULES:
+        finished = []
+
+        async def yielding_coroutine() -> None:
+            for _ in range(10):
+                await asyncio.sleep(0)
+
+        def run() -> None:
+            for _ in range(20):
+                awaitable = module.generic_awaitable(yielding_coroutine())
+                assert asyncio.run(awaitable) is None
+            finished.append(True)
+
+        # Switch as often as possible, so that threads interleave mid-step
+        # on builds with the GIL too.
+        interval = sys.getswitchinterval()
+        sys.setswitchinterval(1e-6)
+        try:
+            threads = [threading.Thread(target=run) for _ in range(8)]
+            for thread in threads:
+                thread.start()
+            for thread in threads:
+                thread.join()
+        finally:
+            sys.setswitchinterval(interval)
+
+        assert len(finished) == 8
+
+
 def coro_wrap_call(method: Callable[[Awaitable[Any]], Any], corofunc: Callable[[], Awaitable[Any]]) -> Callable[[], None]:
     def wrapper(*_: Any) -> None:
         method(corofunc())
@@ -59,16 +148,22 @@ def shim_c_function(testfunc: Callable[[], Any]) -> Any:
 
     return shim
 
-for method in dir(_pyawaitable_test):
-    if not method.startswith("test_"):
-        continue
-
-    case: Callable[..., None] = getattr(_pyawaitable_test, method)
-    if method.endswith("needs_coro"):
-        globals()[method.rstrip("_needs_coro")] = coro_wrap_call(case, dummy_coroutine)
-    elif method.endswith("needs_rcoro"):
-        globals()[method.rstrip("_needs_rcoro")] = coro_wrap_call(case, raising_coroutine)
-    else:
-        # Wrap it with a Python function for pytest, because it can't handle C
-        # functions for some reason.
-        globals()[method] = shim_c_function(case)
+def register_tests(module: Any, suffix: str) -> None:
+    for method in dir(module):
+        if not method.startswith("test_"):
+            continue
+
+        case: Callable[..., None] = getattr(module, method)
+        if method.endswith("needs_coro"):
+            globals()[method.rstrip("_needs_coro") + suffix] = coro_wrap_call(case, dummy_coroutine)
+        elif method.endswith("needs_rcoro"):
+            globals()[method.rstrip("_needs_rcoro") + suffix] = coro_wrap_call(case, raising_coroutine)
+        else:
+            # Wrap it with a Python function for pytest, because it can't handle C
+            # functions for some reason.
+            globals()[method + suffix] = shim_c_function(case)
+
+# Every file has its own copy of PyAwaitable
+register_tests(_pyawaitable_test, "")
+# One copy, shared through the function table
+register_tests(_pyawaitable_test_shared, "_shared")
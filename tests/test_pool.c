@@ -0,0 +1,275 @@
+#include <Python.h>
+#include <stdint.h>
+#include <pyawaitable.h>
+#include "pyawaitable_test.h"
+
+#define NUM_BLOCKING 256
+
+static void *
+add_one(void *arg)
+{
+    return (void *)((intptr_t)arg + 1);
+}
+
+static int
+set_int_result(PyObject *awaitable, void *result, void *arg)
+{
+    TEST_ASSERT_INT((intptr_t)result == (intptr_t)arg + 1);
+    PyObject *value = PyLong_FromVoidPtr(result);
+    if (value == NULL) {
+        return -1;
+    }
+
+    int res = PyAwaitable_SetResult(awaitable, value);
+    Py_DECREF(value);
+    return res;
+}
+
+static PyObject *
+test_blocking_result(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    if (
+        PyAwaitable_AddBlocking(
+            awaitable,
+            add_one,
+            (void *)41,
+            set_int_result
+        ) < 0
+    ) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    PyObject *result = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    if (result == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(PyLong_AsLong(result) == 42);
+    Py_DECREF(result);
+    Py_RETURN_NONE;
+}
+
+static intptr_t blocking_total = 0;
+
+static int
+add_to_total(PyObject *awaitable, void *result, void *arg)
+{
+    blocking_total += (intptr_t)result;
+    return 0;
+}
+
+static PyObject *
+test_blocking_many(PyObject *self, PyObject *nothing)
+{
+    PyObject *coros[NUM_BLOCKING] = {NULL};
+    for (Py_ssize_t i = 0; i < NUM_BLOCKING; ++i) {
+        coros[i] = PyAwaitable_New();
+        if (
+            coros[i] == NULL
+            || PyAwaitable_AddBlocking(
+                coros[i],
+                add_one,
+                (void *)(intptr_t)i,
+                add_to_total
+            ) < 0
+        ) {
+            for (Py_ssize_t j = 0; j <= i; ++j) {
+                Py_XDECREF(coros[j]);
+            }
+            return NULL;
+        }
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        for (Py_ssize_t i = 0; i < NUM_BLOCKING; ++i) {
+            Py_DECREF(coros[i]);
+        }
+        return NULL;
+    }
+
+    blocking_total = 0;
+    int res = PyAwaitable_AddGather(
+        awaitable,
+        coros,
+        NUM_BLOCKING,
+        NULL,
+        NULL,
+        0
+    );
+    for (Py_ssize_t i = 0; i < NUM_BLOCKING; ++i) {
+        Py_DECREF(coros[i]);
+    }
+    if (res < 0) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    PyObject *result = Test_RunAndCheck(awaitable, Py_None);
+    if (result == NULL) {
+        return NULL;
+    }
+
+    Py_DECREF(result);
+    TEST_ASSERT(blocking_total == NUM_BLOCKING * (NUM_BLOCKING + 1) / 2);
+    Py_RETURN_NONE;
+}
+
+static void *
+never_called(void *arg)
+{
+    // We don't have a thread state, so all we can do is crash
+    Py_FatalError("blocking function ran for a cancelled awaitable");
+    return NULL;
+}
+
+static PyObject *
+test_blocking_never_started(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(PyAwaitable_AddBlocking(awaitable, NULL, NULL, NULL) < 0);
+    EXPECT_ERROR(PyExc_ValueError);
+
+    // The job has to be thrown away along with the step
+    void *items[3] = {NULL, NULL, NULL};
+    if (
+        PyAwaitable_AddBlocking(awaitable, never_called, NULL, NULL) < 0
+        || PyAwaitable_AddParallelMap(
+            awaitable,
+            never_called,
+            items,
+            3,
+            1,
+            NULL
+        ) < 0
+    ) {
+        PyAwaitable_Cancel(awaitable);
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    PyAwaitable_Cancel(awaitable);
+    Py_DECREF(awaitable);
+    Py_RETURN_NONE;
+}
+
+#define NUM_MAPPED 10007
+
+static void *
+double_item(void *item)
+{
+    return (void *)((intptr_t)item * 2);
+}
+
+static int
+check_doubled(PyObject *awaitable, void **results, Py_ssize_t size)
+{
+    TEST_ASSERT_INT(size == NUM_MAPPED);
+    for (Py_ssize_t i = 0; i < size; ++i) {
+        TEST_ASSERT_INT((intptr_t)results[i] == (intptr_t)i * 2);
+    }
+
+    return PyAwaitable_SetResult(awaitable, Py_True);
+}
+
+static PyObject *
+test_parallel_map_ordered(PyObject *self, PyObject *nothing)
+{
+    void **items = PyMem_Malloc(NUM_MAPPED * sizeof(void *));
+    if (items == NULL) {
+        return PyErr_NoMemory();
+    }
+
+    for (Py_ssize_t i = 0; i < NUM_MAPPED; ++i) {
+        items[i] = (void *)(intptr_t)i;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        PyMem_Free(items);
+        return NULL;
+    }
+
+    // The last chunk is smaller than the rest
+    int res = PyAwaitable_AddParallelMap(
+        awaitable,
+        double_item,
+        items,
+        NUM_MAPPED,
+        64,
+        check_doubled
+    );
+    // The items are copied
+    PyMem_Free(items);
+    if (res < 0) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    return Test_RunAndCheck(awaitable, Py_True);
+}
+
+static int
+check_empty(PyObject *awaitable, void **results, Py_ssize_t size)
+{
+    TEST_ASSERT_INT(size == 0);
+    return PyAwaitable_SetResult(awaitable, Py_True);
+}
+
+static PyObject *
+test_parallel_map_empty(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(
+        PyAwaitable_AddParallelMap(awaitable, double_item, NULL, 0, 0, NULL) < 0
+    );
+    EXPECT_ERROR(PyExc_ValueError);
+    TEST_ASSERT(
+        PyAwaitable_AddParallelMap(awaitable, NULL, NULL, 0, 1, NULL) < 0
+    );
+    EXPECT_ERROR(PyExc_ValueError);
+    TEST_ASSERT(
+        PyAwaitable_AddParallelMap(awaitable, double_item, NULL, 4, 1, NULL) < 0
+    );
+    EXPECT_ERROR(PyExc_ValueError);
+
+    if (
+        PyAwaitable_AddParallelMap(
+            awaitable,
+            double_item,
+            NULL,
+            0,
+            1,
+            check_empty
+        ) < 0
+    ) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    return Test_RunAndCheck(awaitable, Py_True);
+}
+
+TESTS(pool) = {
+    TEST(test_blocking_result),
+    TEST(test_blocking_many),
+    TEST(test_blocking_never_started),
+    TEST(test_parallel_map_ordered),
+    TEST(test_parallel_map_empty),
+    {NULL}
+};
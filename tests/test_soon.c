@@ -0,0 +1,334 @@
+#include <Python.h>
+#include <pyawaitable.h>
+#include "pyawaitable_test.h"
+
+static int
+increment_counter(void *arg)
+{
+    ++*(int *)arg;
+    return 0;
+}
+
+static int
+check_counter(PyObject *awaitable, PyObject *result, void *arg)
+{
+    TEST_ASSERT_INT(*(int *)arg == 3);
+    return 0;
+}
+
+static int
+await_sleep_zero(PyObject *awaitable, void *counter)
+{
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (asyncio == NULL) {
+        return -1;
+    }
+
+    PyObject *coro = PyObject_CallMethod(asyncio, "sleep", "i", 0);
+    Py_DECREF(asyncio);
+    if (coro == NULL) {
+        return -1;
+    }
+
+    int res = PyAwaitable_AddAwaitEx(
+        awaitable,
+        coro,
+        check_counter,
+        NULL,
+        counter
+    );
+    Py_DECREF(coro);
+    return res;
+}
+
+static int
+schedule_soon_calls(PyObject *awaitable, void *counter)
+{
+    for (int i = 0; i < 3; ++i) {
+        if (PyAwaitable_CallSoon(increment_counter, counter) < 0) {
+            return -1;
+        }
+    }
+
+    // None of the calls should run until we yield to the loop
+    TEST_ASSERT_INT(*(int *)counter == 0);
+    return await_sleep_zero(awaitable, counter);
+}
+
+static PyObject *
+test_call_soon_runs_on_next_iteration(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    int counter = 0;
+    if (
+        PyAwaitable_DeferAwaitEx(
+            awaitable,
+            schedule_soon_calls,
+            &counter
+        ) < 0
+    ) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    PyObject *res = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    if (res == NULL) {
+        return NULL;
+    }
+    Py_DECREF(res);
+    TEST_ASSERT(counter == 3);
+    Py_RETURN_NONE;
+}
+
+static int
+schedule_threadsafe_calls(PyObject *awaitable, void *counter)
+{
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (asyncio == NULL) {
+        return -1;
+    }
+
+    PyObject *loop = PyObject_CallMethod(asyncio, "get_running_loop", NULL);
+    Py_DECREF(asyncio);
+    if (loop == NULL) {
+        return -1;
+    }
+
+    // Mix both kinds of calls on the same loop
+    if (
+        PyAwaitable_CallSoon(increment_counter, counter) < 0
+        || PyAwaitable_CallSoonThreadsafe(loop, increment_counter, counter) < 0
+        || PyAwaitable_CallSoonThreadsafe(loop, increment_counter, counter) < 0
+    ) {
+        Py_DECREF(loop);
+        return -1;
+    }
+
+    Py_DECREF(loop);
+    return await_sleep_zero(awaitable, counter);
+}
+
+static PyObject *
+test_call_soon_threadsafe(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    int counter = 0;
+    if (
+        PyAwaitable_DeferAwaitEx(
+            awaitable,
+            schedule_threadsafe_calls,
+            &counter
+        ) < 0
+    ) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    PyObject *res = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    if (res == NULL) {
+        return NULL;
+    }
+    Py_DECREF(res);
+    TEST_ASSERT(counter == 3);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_call_soon_without_running_loop(PyObject *self, PyObject *nothing)
+{
+    int counter = 0;
+    TEST_ASSERT(PyAwaitable_CallSoon(increment_counter, &counter) < 0);
+    EXPECT_ERROR(PyExc_RuntimeError);
+    TEST_ASSERT(counter == 0);
+    Py_RETURN_NONE;
+}
+
+static int
+chain_soon_call(void *counter)
+{
+    ++*(int *)counter;
+    // The trampoline is running, so this reuses its loop
+    return PyAwaitable_CallSoon(increment_counter, counter);
+}
+
+static int
+check_chained_counter(PyObject *awaitable, PyObject *result, void *arg)
+{
+    TEST_ASSERT_INT(*(int *)arg == 2);
+    return 0;
+}
+
+static int
+add_sleep_zero(
+    PyObject *awaitable,
+    PyAwaitable_CallbackEx callback,
+    void *arg
+)
+{
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (asyncio == NULL) {
+        return -1;
+    }
+
+    PyObject *coro = PyObject_CallMethod(asyncio, "sleep", "i", 0);
+    Py_DECREF(asyncio);
+    if (coro == NULL) {
+        return -1;
+    }
+
+    int res = PyAwaitable_AddAwaitEx(awaitable, coro, callback, NULL, arg);
+    Py_DECREF(coro);
+    return res;
+}
+
+static int
+schedule_chained_call(PyObject *awaitable, void *counter)
+{
+    if (PyAwaitable_CallSoon(chain_soon_call, counter) < 0) {
+        return -1;
+    }
+
+    // The chained call runs one iteration after the first one
+    if (
+        add_sleep_zero(awaitable, NULL, NULL) < 0
+        || add_sleep_zero(awaitable, check_chained_counter, counter) < 0
+    ) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static PyObject *
+test_call_soon_from_soon_call(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    int counter = 0;
+    if (
+        PyAwaitable_DeferAwaitEx(
+            awaitable,
+            schedule_chained_call,
+            &counter
+        ) < 0
+    ) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    PyObject *res = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    if (res == NULL) {
+        return NULL;
+    }
+    Py_DECREF(res);
+    TEST_ASSERT(counter == 2);
+    Py_RETURN_NONE;
+}
+
+static int
+schedule_one_call(PyObject *awaitable, void *counter)
+{
+    if (PyAwaitable_CallSoon(increment_counter, counter) < 0) {
+        return -1;
+    }
+
+    return add_sleep_zero(awaitable, NULL, NULL);
+}
+
+/*
+ * Closing a loop throws away its pending trampoline, so the batch has to be
+ * dropped by somebody else, or else it keeps the loop alive.
+ */
+static PyObject *
+test_call_soon_drops_closed_loop(PyObject *self, PyObject *nothing)
+{
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (asyncio == NULL) {
+        return NULL;
+    }
+
+    PyObject *loop = PyObject_CallMethod(asyncio, "new_event_loop", NULL);
+    Py_DECREF(asyncio);
+    if (loop == NULL) {
+        return NULL;
+    }
+
+    int counter = 0;
+    if (
+        PyAwaitable_CallSoonThreadsafe(loop, increment_counter, &counter) < 0
+    ) {
+        Py_DECREF(loop);
+        return NULL;
+    }
+
+    PyObject *closed = PyObject_CallMethod(loop, "close", NULL);
+    if (closed == NULL) {
+        Py_DECREF(loop);
+        return NULL;
+    }
+    Py_DECREF(closed);
+
+    PyObject *ref = PyWeakref_NewRef(loop, NULL);
+    Py_DECREF(loop);
+    if (ref == NULL) {
+        return NULL;
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        Py_DECREF(ref);
+        return NULL;
+    }
+
+    if (
+        PyAwaitable_DeferAwaitEx(awaitable, schedule_one_call, &counter) < 0
+    ) {
+        Py_DECREF(awaitable);
+        Py_DECREF(ref);
+        return NULL;
+    }
+
+    PyObject *res = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    if (res == NULL) {
+        Py_DECREF(ref);
+        return NULL;
+    }
+    Py_DECREF(res);
+    PyGC_Collect();
+
+    // Only the call on the running loop went through
+    PyObject *referent = PyObject_CallNoArgs(ref);
+    Py_DECREF(ref);
+    if (referent == NULL) {
+        return NULL;
+    }
+    int dead = referent == Py_None;
+    Py_DECREF(referent);
+    TEST_ASSERT(counter == 1);
+    TEST_ASSERT(dead);
+    Py_RETURN_NONE;
+}
+
+TESTS(soon) = {
+    TEST(test_call_soon_runs_on_next_iteration),
+    TEST(test_call_soon_threadsafe),
+    TEST(test_call_soon_without_running_loop),
+    TEST(test_call_soon_from_soon_call),
+    TEST(test_call_soon_drops_closed_loop),
+    {NULL}
+};
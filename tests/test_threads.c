@@ -0,0 +1,365 @@
+#include <Python.h>
+#include <pyawaitable.h>
+#include "pyawaitable_test.h"
+
+#define DRIVER_THREADS 8
+#define DRIVER_STEPS 50
+#define ADDED_STEPS 200
+/* Upper bound on polling steps, so that a broken test can't hang forever */
+#define MAX_POLLS 1000000
+
+/* Wait for the lock without holding the GIL, since its holder needs it */
+static void
+wait_for_lock(PyThread_type_lock lock)
+{
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(lock, WAIT_LOCK);
+    Py_END_ALLOW_THREADS
+}
+
+/* Returns 1 if the lock has been released, without waiting on it */
+static int
+lock_was_released(PyThread_type_lock lock)
+{
+    if (PyThread_acquire_lock(lock, NOWAIT_LOCK)) {
+        PyThread_release_lock(lock);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int
+count_step(PyObject *awaitable, void *counter)
+{
+    ++(*(int *)counter);
+    return 0;
+}
+
+static int
+increment_counter(void *arg)
+{
+    ++(*(int *)arg);
+    return 0;
+}
+
+static int
+call_soon_step(PyObject *awaitable, void *counter)
+{
+    return PyAwaitable_CallSoon(increment_counter, counter);
+}
+
+typedef struct {
+    PyThread_type_lock done;
+    int counter;
+    int soon_counter;
+    int ok;
+} DriverData;
+
+/*
+ * Run an awaitable with its own event loop. Every thread does this at the
+ * same time, which hammers the interpreter-wide state for the step budget,
+ * CallSoon() batches, and timer wheels.
+ */
+static int
+drive_awaitable(DriverData *data)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return -1;
+    }
+
+    if (PyAwaitable_SetStepBudget(awaitable, 3) < 0) {
+        Py_DECREF(awaitable);
+        return -1;
+    }
+
+    for (int i = 0; i < DRIVER_STEPS; ++i) {
+        PyObject *value = PyLong_FromLong(i);
+        if (value == NULL) {
+            Py_DECREF(awaitable);
+            return -1;
+        }
+
+        int res = PyAwaitable_SaveValues(awaitable, 1, value);
+        Py_DECREF(value);
+        if (
+            res < 0
+            || PyAwaitable_DeferAwaitEx(
+                awaitable,
+                count_step,
+                &data->counter
+            ) < 0
+            || PyAwaitable_DeferAwaitEx(
+                awaitable,
+                call_soon_step,
+                &data->soon_counter
+            ) < 0
+        ) {
+            Py_DECREF(awaitable);
+            return -1;
+        }
+    }
+
+    if (PyAwaitable_AddSleep(awaitable, 0.001) < 0) {
+        Py_DECREF(awaitable);
+        return -1;
+    }
+
+    PyObject *res = Test_RunAwaitable(awaitable);
+    if (res == NULL) {
+        Py_DECREF(awaitable);
+        return -1;
+    }
+    Py_DECREF(res);
+
+    for (int i = 0; i < DRIVER_STEPS; ++i) {
+        PyObject *value = PyAwaitable_GetValue(awaitable, i);
+        if (value == NULL || PyLong_AsLong(value) != i) {
+            Py_DECREF(awaitable);
+            return -1;
+        }
+    }
+
+    Py_DECREF(awaitable);
+    return 0;
+}
+
+static void
+driver_thread(void *arg)
+{
+    DriverData *data = (DriverData *)arg;
+    PyGILState_STATE gil = PyGILState_Ensure();
+    if (drive_awaitable(data) < 0) {
+        PyErr_Clear();
+    }
+    else {
+        data->ok = 1;
+    }
+    PyGILState_Release(gil);
+    PyThread_release_lock(data->done);
+}
+
+static PyObject *
+test_threads_drive_awaitables_concurrently(PyObject *self, PyObject *nothing)
+{
+    DriverData data[DRIVER_THREADS];
+    int started = 0;
+    for (; started < DRIVER_THREADS; ++started) {
+        DriverData *item = &data[started];
+        item->counter = 0;
+        item->soon_counter = 0;
+        item->ok = 0;
+        item->done = PyThread_allocate_lock();
+        if (item->done == NULL) {
+            PyErr_NoMemory();
+            break;
+        }
+        // Held until the thread is finished
+        PyThread_acquire_lock(item->done, NOWAIT_LOCK);
+        if (
+            PyThread_start_new_thread(driver_thread, item)
+            == PYTHREAD_INVALID_THREAD_ID
+        ) {
+            PyThread_free_lock(item->done);
+            PyErr_SetString(PyExc_RuntimeError, "could not start thread");
+            break;
+        }
+    }
+
+    int ok = started == DRIVER_THREADS;
+    for (int i = 0; i < started; ++i) {
+        wait_for_lock(data[i].done);
+        PyThread_free_lock(data[i].done);
+        ok = ok && data[i].ok;
+        ok = ok && data[i].counter == DRIVER_STEPS;
+        ok = ok && data[i].soon_counter == DRIVER_STEPS;
+    }
+
+    if (PyErr_Occurred()) {
+        return NULL;
+    }
+    TEST_ASSERT(ok);
+    Py_RETURN_NONE;
+}
+
+typedef struct {
+    PyObject *awaitable;
+    PyThread_type_lock done;
+    int counter;
+    int polls;
+    int ok;
+} PollData;
+
+static int
+await_sleep_zero(
+    PyObject *awaitable,
+    PyAwaitable_CallbackEx callback,
+    void *arg
+)
+{
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (asyncio == NULL) {
+        return -1;
+    }
+
+    PyObject *coro = PyObject_CallMethod(asyncio, "sleep", "i", 0);
+    Py_DECREF(asyncio);
+    if (coro == NULL) {
+        return -1;
+    }
+
+    int res = PyAwaitable_AddAwaitEx(awaitable, coro, callback, NULL, arg);
+    Py_DECREF(coro);
+    return res;
+}
+
+/* Keep the awaitable busy on the event loop until the other thread is done */
+static int
+poll_until_done(PyObject *awaitable, PyObject *result, void *arg)
+{
+    PollData *data = (PollData *)arg;
+    if (lock_was_released(data->done)) {
+        return 0;
+    }
+
+    TEST_ASSERT_INT(++data->polls < MAX_POLLS);
+    return await_sleep_zero(awaitable, poll_until_done, data);
+}
+
+static int
+start_polling(PyObject *awaitable, void *arg)
+{
+    return await_sleep_zero(awaitable, poll_until_done, arg);
+}
+
+/*
+ * Run an awaitable that polls the event loop until func is done with it on
+ * another thread. The awaitable is left in data->awaitable, even on failure.
+ */
+static PyObject *
+run_polling_with_thread(PollData *data, void (*func)(void *))
+{
+    data->awaitable = PyAwaitable_New();
+    if (data->awaitable == NULL) {
+        return NULL;
+    }
+
+    data->done = PyThread_allocate_lock();
+    if (data->done == NULL) {
+        return PyErr_NoMemory();
+    }
+    // Held until the other thread is finished
+    PyThread_acquire_lock(data->done, NOWAIT_LOCK);
+
+    if (PyAwaitable_DeferAwaitEx(data->awaitable, start_polling, data) < 0) {
+        PyThread_free_lock(data->done);
+        return NULL;
+    }
+
+    if (PyThread_start_new_thread(func, data) == PYTHREAD_INVALID_THREAD_ID) {
+        PyAwaitable_Cancel(data->awaitable);
+        PyThread_free_lock(data->done);
+        PyErr_SetString(PyExc_RuntimeError, "could not start thread");
+        return NULL;
+    }
+
+    PyObject *res = Test_RunAwaitable(data->awaitable);
+    // The thread might still need the awaitable
+    wait_for_lock(data->done);
+    PyThread_free_lock(data->done);
+    return res;
+}
+
+static void
+add_steps_from_thread(void *arg)
+{
+    PollData *data = (PollData *)arg;
+    PyGILState_STATE gil = PyGILState_Ensure();
+    data->ok = 1;
+    for (int i = 0; i < ADDED_STEPS; ++i) {
+        PyObject *value = PyLong_FromLong(i);
+        if (
+            value == NULL
+            || PyAwaitable_SaveValues(data->awaitable, 1, value) < 0
+            || PyAwaitable_DeferAwaitEx(
+                data->awaitable,
+                count_step,
+                &data->counter
+            ) < 0
+        ) {
+            Py_XDECREF(value);
+            PyErr_Clear();
+            data->ok = 0;
+            break;
+        }
+        Py_DECREF(value);
+    }
+    PyGILState_Release(gil);
+    PyThread_release_lock(data->done);
+}
+
+static PyObject *
+test_threads_add_steps_while_running(PyObject *self, PyObject *nothing)
+{
+    PollData data = {NULL, NULL, 0, 0, 0};
+    PyObject *res = run_polling_with_thread(&data, add_steps_from_thread);
+    if (res == NULL) {
+        Py_XDECREF(data.awaitable);
+        return NULL;
+    }
+    Py_DECREF(res);
+
+    TEST_ASSERT(data.ok);
+    TEST_ASSERT(data.counter == ADDED_STEPS);
+    for (int i = 0; i < ADDED_STEPS; ++i) {
+        PyObject *value = PyAwaitable_GetValue(data.awaitable, i);
+        if (value == NULL) {
+            Py_DECREF(data.awaitable);
+            return NULL;
+        }
+        if (PyLong_AsLong(value) != i) {
+            Py_DECREF(data.awaitable);
+            TEST_ERROR("values were saved out of order");
+            return NULL;
+        }
+    }
+
+    Py_DECREF(data.awaitable);
+    Py_RETURN_NONE;
+}
+
+static void
+cancel_from_thread(void *arg)
+{
+    PollData *data = (PollData *)arg;
+    PyGILState_STATE gil = PyGILState_Ensure();
+    // With the GIL, this happens whenever the driver lets go of it, which
+    // includes the middle of the coroutine that it's awaiting.
+    PyAwaitable_Cancel(data->awaitable);
+    data->ok = 1;
+    PyGILState_Release(gil);
+    PyThread_release_lock(data->done);
+}
+
+static PyObject *
+test_threads_cancel_while_awaiting(PyObject *self, PyObject *nothing)
+{
+    PollData data = {NULL, NULL, 0, 0, 0};
+    PyObject *res = run_polling_with_thread(&data, cancel_from_thread);
+    Py_XDECREF(data.awaitable);
+    if (res == NULL) {
+        return NULL;
+    }
+    Py_DECREF(res);
+
+    TEST_ASSERT(data.ok);
+    Py_RETURN_NONE;
+}
+
+TESTS(threads) = {
+    TEST(test_threads_drive_awaitables_concurrently),
+    TEST(test_threads_add_steps_while_running),
+    TEST(test_threads_cancel_while_awaiting),
+    {NULL}
+};
@@ -0,0 +1,242 @@
+#include <Python.h>
+#include <math.h>
+#include <stdint.h>
+#include <pyawaitable.h>
+#include "pyawaitable_test.h"
+
+#define NUM_SLEEPERS 3
+
+static Py_ssize_t wake_order[NUM_SLEEPERS];
+static Py_ssize_t num_woken = 0;
+
+static int
+record_wake(PyObject *awaitable)
+{
+    void *index;
+    if (PyAwaitable_UnpackArbValues(awaitable, &index) < 0) {
+        return -1;
+    }
+
+    TEST_ASSERT_INT(num_woken < NUM_SLEEPERS);
+    wake_order[num_woken++] = (Py_ssize_t)(intptr_t)index;
+    return 0;
+}
+
+/* Awaitable that sleeps, and then records its index */
+static PyObject *
+new_sleeper(double seconds, Py_ssize_t index)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    if (
+        PyAwaitable_SaveArbValues(awaitable, 1, (void *)(intptr_t)index) < 0
+        || PyAwaitable_AddSleep(awaitable, seconds) < 0
+        || PyAwaitable_DeferAwait(awaitable, record_wake) < 0
+    ) {
+        PyAwaitable_Cancel(awaitable);
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    return awaitable;
+}
+
+static PyObject *
+test_sleep_order(PyObject *self, PyObject *nothing)
+{
+    // The first one is far enough out to start on a higher level
+    static const double seconds[NUM_SLEEPERS] = {0.1, 0.01, 0.05};
+    PyObject *coros[NUM_SLEEPERS] = {NULL};
+    for (Py_ssize_t i = 0; i < NUM_SLEEPERS; ++i) {
+        coros[i] = new_sleeper(seconds[i], i);
+        if (coros[i] == NULL) {
+            for (Py_ssize_t j = 0; j < i; ++j) {
+                Py_DECREF(coros[j]);
+            }
+            return NULL;
+        }
+    }
+
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        for (Py_ssize_t i = 0; i < NUM_SLEEPERS; ++i) {
+            Py_DECREF(coros[i]);
+        }
+        return NULL;
+    }
+
+    num_woken = 0;
+    int res = PyAwaitable_AddGather(
+        awaitable,
+        coros,
+        NUM_SLEEPERS,
+        NULL,
+        NULL,
+        0
+    );
+    for (Py_ssize_t i = 0; i < NUM_SLEEPERS; ++i) {
+        Py_DECREF(coros[i]);
+    }
+    if (res < 0) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    PyObject *result = Test_RunAndCheck(awaitable, Py_None);
+    if (result == NULL) {
+        return NULL;
+    }
+
+    Py_DECREF(result);
+    TEST_ASSERT(num_woken == NUM_SLEEPERS);
+    TEST_ASSERT(wake_order[0] == 1);
+    TEST_ASSERT(wake_order[1] == 2);
+    TEST_ASSERT(wake_order[2] == 0);
+    Py_RETURN_NONE;
+}
+
+/* asyncio.sleep(delay, result) */
+static PyObject *
+new_asyncio_sleep(double delay, long result)
+{
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (asyncio == NULL) {
+        return NULL;
+    }
+
+    PyObject *coro = PyObject_CallMethod(asyncio, "sleep", "dl", delay, result);
+    Py_DECREF(asyncio);
+    return coro;
+}
+
+static int
+expect_timeout(PyObject *awaitable, PyObject *err)
+{
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (asyncio == NULL) {
+        return -1;
+    }
+
+    PyObject *timeout_error = PyObject_GetAttrString(asyncio, "TimeoutError");
+    Py_DECREF(asyncio);
+    if (timeout_error == NULL) {
+        return -1;
+    }
+
+    int matches = PyErr_GivenExceptionMatches(err, timeout_error);
+    Py_DECREF(timeout_error);
+    TEST_ASSERT_INT(matches);
+    return PyAwaitable_SetResult(awaitable, Py_True);
+}
+
+static int
+deadline_never_called(PyObject *awaitable, PyObject *result)
+{
+    TEST_ERROR("step finished after its deadline");
+    return -1;
+}
+
+static PyObject *
+test_step_deadline_expires(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    PyObject *coro = new_asyncio_sleep(10, 0);
+    if (coro == NULL) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    int res = PyAwaitable_AddAwait(
+        awaitable,
+        coro,
+        deadline_never_called,
+        expect_timeout
+    );
+    Py_DECREF(coro);
+    if (res < 0 || PyAwaitable_SetStepDeadline(awaitable, 0.01) < 0) {
+        PyAwaitable_Cancel(awaitable);
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    return Test_RunAndCheck(awaitable, Py_True);
+}
+
+static int
+set_result(PyObject *awaitable, PyObject *result)
+{
+    return PyAwaitable_SetResult(awaitable, result);
+}
+
+static PyObject *
+test_step_deadline_met(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    PyObject *coro = new_asyncio_sleep(0, 42);
+    if (coro == NULL) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    int res = PyAwaitable_AddAwait(awaitable, coro, set_result, NULL);
+    Py_DECREF(coro);
+    if (res < 0 || PyAwaitable_SetStepDeadline(awaitable, 10) < 0) {
+        PyAwaitable_Cancel(awaitable);
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    PyObject *result = Test_RunAwaitable(awaitable);
+    Py_DECREF(awaitable);
+    if (result == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(PyLong_AsLong(result) == 42);
+    Py_DECREF(result);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_timer_bad_arguments(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+
+    TEST_ASSERT(PyAwaitable_AddSleep(awaitable, -1) < 0);
+    EXPECT_ERROR(PyExc_ValueError);
+    TEST_ASSERT(PyAwaitable_AddSleep(awaitable, NAN) < 0);
+    EXPECT_ERROR(PyExc_ValueError);
+
+    // There's no step to put a deadline on
+    TEST_ASSERT(PyAwaitable_SetStepDeadline(awaitable, 1) < 0);
+    EXPECT_ERROR(PyExc_RuntimeError);
+    TEST_ASSERT(PyAwaitable_DeferAwait(awaitable, record_wake) == 0);
+    TEST_ASSERT(PyAwaitable_SetStepDeadline(awaitable, 1) < 0);
+    EXPECT_ERROR(PyExc_RuntimeError);
+
+    PyAwaitable_Cancel(awaitable);
+    Py_DECREF(awaitable);
+    Py_RETURN_NONE;
+}
+
+TESTS(timer) = {
+    TEST(test_sleep_order),
+    TEST(test_step_deadline_expires),
+    TEST(test_step_deadline_met),
+    TEST(test_timer_bad_arguments),
+    {NULL}
+};
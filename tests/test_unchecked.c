@@ -0,0 +1,68 @@
+/* Everything in this file uses the inlined, unchecked value accessors */
+#define PYAWAITABLE_UNCHECKED
+#include <Python.h>
+#include <pyawaitable.h>
+#include "pyawaitable_test.h"
+
+static PyObject *
+test_unchecked_object_values(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+    PyAwaitable_Cancel(awaitable);
+
+    PyObject *str = PyUnicode_FromString("hello world");
+    if (str == NULL) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    if (PyAwaitable_SaveValues(awaitable, 2, Py_None, str) < 0) {
+        Py_DECREF(str);
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    TEST_ASSERT(PyAwaitable_GetValue(awaitable, 0) == Py_None);
+    TEST_ASSERT(PyAwaitable_GetValue(awaitable, 1) == str);
+    TEST_ASSERT(PyAwaitable_SetValue(awaitable, 0, Py_NewRef(str)) == 0);
+    TEST_ASSERT(PyAwaitable_GetValue(awaitable, 0) == str);
+
+    Py_DECREF(str);
+    Py_DECREF(awaitable);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_unchecked_arbitrary_values(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+    PyAwaitable_Cancel(awaitable);
+
+    int sentinel;
+    void *dummy = &sentinel;
+
+    if (PyAwaitable_SaveArbValues(awaitable, 2, dummy, awaitable) < 0) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    TEST_ASSERT(PyAwaitable_GetArbValue(awaitable, 0) == dummy);
+    TEST_ASSERT(PyAwaitable_GetArbValue(awaitable, 1) == awaitable);
+    TEST_ASSERT(PyAwaitable_SetArbValue(awaitable, 1, NULL) == 0);
+    TEST_ASSERT(PyAwaitable_GetArbValue(awaitable, 1) == NULL);
+
+    Py_DECREF(awaitable);
+    Py_RETURN_NONE;
+}
+
+TESTS(unchecked) = {
+    TEST(test_unchecked_object_values),
+    TEST(test_unchecked_arbitrary_values),
+    {NULL}
+};
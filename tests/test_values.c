@@ -266,6 +266,166 @@ test_get_and_set_object_values(PyObject *self, PyObject *nothing)
     Py_RETURN_NONE;
 }
 
+static PyObject *
+test_save_and_borrow_object_values_array(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+    PyAwaitable_Cancel(awaitable);
+
+    // Enough values to force the array to grow
+    PyObject *values[20];
+    for (int i = 0; i < 20; ++i) {
+        values[i] = PyLong_FromLong(1000 + i);
+        if (values[i] == NULL) {
+            for (int x = 0; x < i; ++x) {
+                Py_DECREF(values[x]);
+            }
+            Py_DECREF(awaitable);
+            return NULL;
+        }
+    }
+
+    int res = PyAwaitable_SaveValuesArray(awaitable, values, 20);
+    for (int i = 0; i < 20; ++i) {
+        TEST_ASSERT(Py_REFCNT(values[i]) >= 2);
+        Py_DECREF(values[i]);
+    }
+    if (res < 0) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    PyObject **borrowed = PyAwaitable_BorrowValues(awaitable, 7, 3);
+    if (borrowed == NULL) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+    TEST_ASSERT(borrowed[0] == values[7]);
+    TEST_ASSERT(borrowed[2] == values[9]);
+
+    PyObject *unpacked[2];
+    if (PyAwaitable_UnpackValuesRange(awaitable, 18, 2, unpacked) < 0) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+    TEST_ASSERT(unpacked[0] == values[18]);
+    TEST_ASSERT(unpacked[1] == values[19]);
+    TEST_ASSERT(PyAwaitable_GetValue(awaitable, 19) == values[19]);
+
+    Py_DECREF(awaitable);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_save_and_borrow_arbitrary_values_array(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+    PyAwaitable_Cancel(awaitable);
+
+    int sentinel;
+    void *values[3] = {&sentinel, NULL, &sentinel};
+    if (PyAwaitable_SaveArbValuesArray(awaitable, values, 3) < 0) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    // Mixing with the varargs API should work too
+    if (PyAwaitable_SaveArbValues(awaitable, 1, awaitable) < 0) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    void **borrowed = PyAwaitable_BorrowArbValues(awaitable, 1, 3);
+    if (borrowed == NULL) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+    TEST_ASSERT(borrowed[0] == NULL);
+    TEST_ASSERT(borrowed[1] == &sentinel);
+    TEST_ASSERT(borrowed[2] == awaitable);
+
+    void *unpacked;
+    if (PyAwaitable_UnpackArbValuesRange(awaitable, 0, 1, &unpacked) < 0) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+    TEST_ASSERT(unpacked == &sentinel);
+
+    Py_DECREF(awaitable);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_value_ranges_out_of_bounds(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+    PyAwaitable_Cancel(awaitable);
+
+    if (PyAwaitable_SaveValues(awaitable, 2, Py_None, Py_True) < 0) {
+        Py_DECREF(awaitable);
+        return NULL;
+    }
+
+    TEST_ASSERT(PyAwaitable_BorrowValues(awaitable, 1, 2) == NULL);
+    EXPECT_ERROR(PyExc_IndexError);
+
+    TEST_ASSERT(PyAwaitable_BorrowValues(awaitable, -1, 1) == NULL);
+    EXPECT_ERROR(PyExc_IndexError);
+
+    PyObject *unpacked[3];
+    TEST_ASSERT(PyAwaitable_UnpackValuesRange(awaitable, 0, 3, unpacked) < 0);
+    EXPECT_ERROR(PyExc_IndexError);
+
+    void *arb;
+    TEST_ASSERT(PyAwaitable_UnpackArbValuesRange(awaitable, 0, 1, &arb) < 0);
+    EXPECT_ERROR(PyExc_IndexError);
+
+    // Empty ranges at the end are fine
+    TEST_ASSERT(PyAwaitable_BorrowValues(awaitable, 2, 0) != NULL);
+
+    Py_DECREF(awaitable);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+test_save_values_array_rejects_bad_input(PyObject *self, PyObject *nothing)
+{
+    PyObject *awaitable = PyAwaitable_New();
+    if (awaitable == NULL) {
+        return NULL;
+    }
+    PyAwaitable_Cancel(awaitable);
+
+    PyObject *values[2] = {Py_None, NULL};
+    TEST_ASSERT(PyAwaitable_SaveValuesArray(awaitable, values, 2) < 0);
+    EXPECT_ERROR(PyExc_ValueError);
+
+    // The array can't grow that far, so nothing is read from it
+    void *arb[1] = {NULL};
+    TEST_ASSERT(
+        PyAwaitable_SaveArbValuesArray(awaitable, arb, PY_SSIZE_T_MAX / 2) < 0
+    );
+    EXPECT_ERROR(PyExc_MemoryError);
+
+    // Nothing was stored by either call
+    TEST_ASSERT(PyAwaitable_BorrowValues(awaitable, 0, 1) == NULL);
+    EXPECT_ERROR(PyExc_IndexError);
+    TEST_ASSERT(PyAwaitable_BorrowArbValues(awaitable, 0, 1) == NULL);
+    EXPECT_ERROR(PyExc_IndexError);
+
+    Py_DECREF(awaitable);
+    Py_RETURN_NONE;
+}
+
 TESTS(values) = {
     TEST(test_store_and_load_object_values),
     TEST(test_object_values_can_outlive_awaitable),
@@ -274,5 +434,9 @@ TESTS(values) = {
     TEST(test_load_arbitrary_null_pointer),
     TEST(test_get_and_set_arbitrary_values),
     TEST(test_get_and_set_object_values),
+    TEST(test_save_and_borrow_object_values_array),
+    TEST(test_save_and_borrow_arbitrary_values_array),
+    TEST(test_value_ranges_out_of_bounds),
+    TEST(test_save_values_array_rejects_bad_input),
     {NULL}
 };
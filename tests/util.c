@@ -48,13 +48,15 @@ Test_SetNoMemory(void)
     PyMem_GetAllocator(PYMEM_DOMAIN_MEM, &hook.mem);
     PyMem_GetAllocator(PYMEM_DOMAIN_OBJ, &hook.obj);
 
+    // Memory that's freed in the meantime has to go back to the allocator
+    // of its own domain
     alloc.ctx = &hook.raw;
     PyMem_SetAllocator(PYMEM_DOMAIN_RAW, &alloc);
 
-    alloc.ctx = &hook.raw;
+    alloc.ctx = &hook.mem;
     PyMem_SetAllocator(PYMEM_DOMAIN_MEM, &alloc);
 
-    alloc.ctx = &hook.raw;
+    alloc.ctx = &hook.obj;
     PyMem_SetAllocator(PYMEM_DOMAIN_OBJ, &alloc);
 }
 